@@ -42,6 +42,9 @@ typedef struct _AudinALSADevice
 	int wformat;
 	int block_size;
 	ADPCM adpcm;
+	DSP_RESAMPLER* resampler;
+	uint8* resample_buffer;
+	int resample_frames;
 
 	freerdp_thread* thread;
 
@@ -83,6 +86,13 @@ static boolean audin_alsa_set_params(AudinALSADevice* alsa, snd_pcm_t* capture_h
 			"different from target rate %d / channel %d, resampling required.",
 			alsa->actual_rate, alsa->actual_channels,
 			alsa->target_rate, alsa->target_channels);
+
+		alsa->resampler = dsp_resampler_new(alsa->bytes_per_channel,
+			alsa->actual_channels, alsa->actual_rate,
+			alsa->target_channels, alsa->target_rate);
+		alsa->resample_frames = dsp_resampler_get_max_frames(alsa->resampler, alsa->frames_per_packet);
+		alsa->resample_buffer = (uint8*) xmalloc(alsa->resample_frames *
+			alsa->target_channels * alsa->bytes_per_channel);
 	}
 	return true;
 }
@@ -96,26 +106,22 @@ static boolean audin_alsa_thread_receive(AudinALSADevice* alsa, uint8* src, int
 	uint8* encoded_data;
 	int rbytes_per_frame;
 	int tbytes_per_frame;
-	uint8* resampled_data;
 
 	rbytes_per_frame = alsa->actual_channels * alsa->bytes_per_channel;
 	tbytes_per_frame = alsa->target_channels * alsa->bytes_per_channel;
 
-	if ((alsa->target_rate == alsa->actual_rate) &&
-		(alsa->target_channels == alsa->actual_channels))
+	if (alsa->resampler == NULL)
 	{
-		resampled_data = NULL;
 		frames = size / rbytes_per_frame;
 	}
 	else
 	{
-		resampled_data = dsp_resample(src, alsa->bytes_per_channel,
-			alsa->actual_channels, alsa->actual_rate, size / rbytes_per_frame,
-			alsa->target_channels, alsa->target_rate, &frames);
+		frames = dsp_resampler_process(alsa->resampler, src, size / rbytes_per_frame,
+			alsa->resample_buffer, alsa->resample_frames);
 		DEBUG_DVC("resampled %d frames at %d to %d frames at %d",
 			size / rbytes_per_frame, alsa->actual_rate, frames, alsa->target_rate);
 		size = frames * tbytes_per_frame;
-		src = resampled_data;
+		src = alsa->resample_buffer;
 	}
 
 	while (frames > 0)
@@ -162,9 +168,6 @@ static boolean audin_alsa_thread_receive(AudinALSADevice* alsa, uint8* src, int
 		frames -= cframes;
 	}
 
-	if (resampled_data)
-		xfree(resampled_data);
-
 	return ret;
 }
 
@@ -218,6 +221,13 @@ static void* audin_alsa_thread_func(void* arg)
 	xfree(buffer);
 	xfree(alsa->buffer);
 	alsa->buffer = NULL;
+	if (alsa->resampler != NULL)
+	{
+		dsp_resampler_free(alsa->resampler);
+		alsa->resampler = NULL;
+	}
+	xfree(alsa->resample_buffer);
+	alsa->resample_buffer = NULL;
 	if (capture_handle)
 		snd_pcm_close(capture_handle);
 
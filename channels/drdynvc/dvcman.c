@@ -45,6 +45,9 @@ struct _DVCMAN
 	int num_listeners;
 
 	LIST* channels;
+
+	/* reassembly buffers for fragmented data */
+	STREAM_POOL* pool;
 };
 
 typedef struct _DVCMAN_LISTENER DVCMAN_LISTENER;
@@ -183,6 +186,7 @@ IWTSVirtualChannelManager* dvcman_new(drdynvcPlugin* plugin)
 	dvcman->iface.PushEvent = dvcman_push_event;
 	dvcman->drdynvc = plugin;
 	dvcman->channels = list_new();
+	dvcman->pool = stream_pool_new();
 
 	return (IWTSVirtualChannelManager*) dvcman;
 }
@@ -232,6 +236,7 @@ void dvcman_free(IWTSVirtualChannelManager* pChannelMgr)
 		dvcman_channel_free(channel);
 
 	list_free(dvcman->channels);
+	stream_pool_free(dvcman->pool);
 
 	for (i = 0; i < dvcman->num_listeners; i++)
 	{
@@ -367,7 +372,7 @@ int dvcman_close_channel(IWTSVirtualChannelManager* pChannelMgr, uint32 ChannelI
 
 	if (channel->dvc_data)
 	{
-		stream_free(channel->dvc_data);
+		stream_pool_release(channel->dvcman->pool, channel->dvc_data);
 		channel->dvc_data = NULL;
 	}
 
@@ -391,9 +396,9 @@ int dvcman_receive_channel_data_first(IWTSVirtualChannelManager* pChannelMgr, ui
 	}
 
 	if (channel->dvc_data)
-		stream_free(channel->dvc_data);
+		stream_pool_release(channel->dvcman->pool, channel->dvc_data);
 
-	channel->dvc_data = stream_new(length);
+	channel->dvc_data = stream_pool_acquire(channel->dvcman->pool, length);
 
 	return 0;
 }
@@ -417,7 +422,7 @@ int dvcman_receive_channel_data(IWTSVirtualChannelManager* pChannelMgr, uint32 C
 		if (stream_get_length(channel->dvc_data) + data_size > stream_get_size(channel->dvc_data))
 		{
 			DEBUG_WARN("data exceeding declared length!");
-			stream_free(channel->dvc_data);
+			stream_pool_release(channel->dvcman->pool, channel->dvc_data);
 			channel->dvc_data = NULL;
 			return 1;
 		}
@@ -428,7 +433,7 @@ int dvcman_receive_channel_data(IWTSVirtualChannelManager* pChannelMgr, uint32 C
 		{
 			error = channel->channel_callback->OnDataReceived(channel->channel_callback,
 				stream_get_size(channel->dvc_data), stream_get_data(channel->dvc_data));
-			stream_free(channel->dvc_data);
+			stream_pool_release(channel->dvcman->pool, channel->dvc_data);
 			channel->dvc_data = NULL;
 		}
 	}
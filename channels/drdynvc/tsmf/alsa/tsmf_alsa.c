@@ -40,6 +40,9 @@ typedef struct _TSMFALSAAudioDevice
 	uint32 source_channels;
 	uint32 actual_channels;
 	uint32 bytes_per_sample;
+	DSP_RESAMPLER* resampler;
+	uint8* resample_buffer;
+	int resample_buffer_size;
 } TSMFALSAAudioDevice;
 
 static boolean tsmf_alsa_open_device(TSMFALSAAudioDevice* alsa)
@@ -138,6 +141,20 @@ static boolean tsmf_alsa_set_format(ITSMFAudioDevice* audio,
 			alsa->actual_rate, alsa->actual_channels,
 			alsa->source_rate, alsa->source_channels);
 	}
+
+	if (alsa->resampler != NULL)
+	{
+		dsp_resampler_free(alsa->resampler);
+		alsa->resampler = NULL;
+	}
+
+	if ((alsa->actual_rate != alsa->source_rate) ||
+		(alsa->actual_channels != alsa->source_channels))
+	{
+		alsa->resampler = dsp_resampler_new(alsa->bytes_per_sample,
+			alsa->source_channels, alsa->source_rate,
+			alsa->actual_channels, alsa->actual_rate);
+	}
 	return true;
 }
 
@@ -151,7 +168,6 @@ static boolean tsmf_alsa_play(ITSMFAudioDevice* audio, uint8* data, uint32 data_
 	uint8* pindex;
 	int rbytes_per_frame;
 	int sbytes_per_frame;
-	uint8* resampled_data;
 	TSMFALSAAudioDevice* alsa = (TSMFALSAAudioDevice*) audio;
 
 	DEBUG_DVC("data_size %d", data_size);
@@ -161,21 +177,26 @@ static boolean tsmf_alsa_play(ITSMFAudioDevice* audio, uint8* data, uint32 data_
 		sbytes_per_frame = alsa->source_channels * alsa->bytes_per_sample;
 		rbytes_per_frame = alsa->actual_channels * alsa->bytes_per_sample;
 
-		if ((alsa->source_rate == alsa->actual_rate) &&
-			(alsa->source_channels == alsa->actual_channels))
+		if (alsa->resampler == NULL)
 		{
-			resampled_data = NULL;
 			src = data;
 		}
 		else
 		{
-			resampled_data = dsp_resample(data, alsa->bytes_per_sample,
-				alsa->source_channels, alsa->source_rate, data_size / sbytes_per_frame,
-				alsa->actual_channels, alsa->actual_rate, &frames);
+			frames = dsp_resampler_get_max_frames(alsa->resampler, data_size / sbytes_per_frame);
+			if (frames * rbytes_per_frame > alsa->resample_buffer_size)
+			{
+				xfree(alsa->resample_buffer);
+				alsa->resample_buffer_size = frames * rbytes_per_frame;
+				alsa->resample_buffer = (uint8*) xmalloc(alsa->resample_buffer_size);
+			}
+
+			frames = dsp_resampler_process(alsa->resampler, data, data_size / sbytes_per_frame,
+				alsa->resample_buffer, frames);
 			DEBUG_DVC("resampled %d frames at %d to %d frames at %d",
 				data_size / sbytes_per_frame, alsa->source_rate, frames, alsa->actual_rate);
 			data_size = frames * rbytes_per_frame;
-			src = resampled_data;
+			src = alsa->resample_buffer;
 		}
 
 		pindex = src;
@@ -203,9 +224,6 @@ static boolean tsmf_alsa_play(ITSMFAudioDevice* audio, uint8* data, uint32 data_
 				break;
 			pindex += error * rbytes_per_frame;
 		}
-
-		if (resampled_data)
-			xfree(resampled_data);
 	}
 	xfree(data);
 
@@ -229,6 +247,11 @@ static uint64 tsmf_alsa_get_latency(ITSMFAudioDevice* audio)
 
 static void tsmf_alsa_flush(ITSMFAudioDevice* audio)
 {
+	TSMFALSAAudioDevice* alsa = (TSMFALSAAudioDevice*) audio;
+
+	/* do not interpolate across a seek */
+	if (alsa->resampler != NULL)
+		dsp_resampler_reset(alsa->resampler);
 }
 
 static void tsmf_alsa_free(ITSMFAudioDevice* audio)
@@ -242,6 +265,9 @@ static void tsmf_alsa_free(ITSMFAudioDevice* audio)
 		snd_pcm_drain(alsa->out_handle);
 		snd_pcm_close(alsa->out_handle);
 	}
+	if (alsa->resampler != NULL)
+		dsp_resampler_free(alsa->resampler);
+	xfree(alsa->resample_buffer);
 	xfree(alsa);
 }
 
@@ -260,7 +260,6 @@ static boolean tsmf_ffmpeg_decode_video(ITSMFDecoder* decoder, const uint8* data
 	TSMFFFmpegDecoder* mdecoder = (TSMFFFmpegDecoder*) decoder;
 	int decoded;
 	int len;
-	AVFrame* frame;
 	boolean ret = true;
 
 #if LIBAVCODEC_VERSION_MAJOR < 52 || (LIBAVCODEC_VERSION_MAJOR == 52 && LIBAVCODEC_VERSION_MINOR <= 20)
@@ -296,19 +295,10 @@ static boolean tsmf_ffmpeg_decode_video(ITSMFDecoder* decoder, const uint8* data
 			mdecoder->codec_context->pix_fmt,
 			mdecoder->codec_context->width, mdecoder->codec_context->height);
 
+		/* The picture stays in the codec frame until it is asked for, so it
+		   can be copied straight into the frame the renderer will use. */
 		mdecoder->decoded_size = avpicture_get_size(mdecoder->codec_context->pix_fmt,
 			mdecoder->codec_context->width, mdecoder->codec_context->height);
-		mdecoder->decoded_data = xzalloc(mdecoder->decoded_size);
-		frame = avcodec_alloc_frame();
-		avpicture_fill((AVPicture *) frame, mdecoder->decoded_data,
-			mdecoder->codec_context->pix_fmt,
-			mdecoder->codec_context->width, mdecoder->codec_context->height);
-
-		av_picture_copy((AVPicture *) frame, (AVPicture *) mdecoder->frame,
-			mdecoder->codec_context->pix_fmt,
-			mdecoder->codec_context->width, mdecoder->codec_context->height);
-
-		av_free(frame);
 	}
 
 	return ret;
@@ -430,8 +420,21 @@ static boolean tsmf_ffmpeg_decode(ITSMFDecoder* decoder, const uint8* data, uint
 static uint8* tsmf_ffmpeg_get_decoded_data(ITSMFDecoder* decoder, uint32* size)
 {
 	TSMFFFmpegDecoder* mdecoder = (TSMFFFmpegDecoder*) decoder;
+	AVPicture picture;
 	uint8* buf;
 
+	if (mdecoder->media_type == AVMEDIA_TYPE_VIDEO && mdecoder->decoded_size > 0)
+	{
+		mdecoder->decoded_data = xzalloc(mdecoder->decoded_size);
+		avpicture_fill(&picture, mdecoder->decoded_data,
+			mdecoder->codec_context->pix_fmt,
+			mdecoder->codec_context->width, mdecoder->codec_context->height);
+
+		av_picture_copy(&picture, (AVPicture*) mdecoder->frame,
+			mdecoder->codec_context->pix_fmt,
+			mdecoder->codec_context->width, mdecoder->codec_context->height);
+	}
+
 	*size = mdecoder->decoded_size;
 	buf = mdecoder->decoded_data;
 	mdecoder->decoded_data = NULL;
@@ -439,6 +442,33 @@ static uint8* tsmf_ffmpeg_get_decoded_data(ITSMFDecoder* decoder, uint32* size)
 	return buf;
 }
 
+static boolean tsmf_ffmpeg_get_decoded_picture(ITSMFDecoder* decoder, uint8* data,
+	const uint32* offsets, const uint32* pitches)
+{
+	TSMFFFmpegDecoder* mdecoder = (TSMFFFmpegDecoder*) decoder;
+	AVPicture picture;
+	int i;
+
+	if (mdecoder->media_type != AVMEDIA_TYPE_VIDEO || mdecoder->decoded_size == 0)
+		return false;
+	if (mdecoder->codec_context->pix_fmt != PIX_FMT_YUV420P)
+		return false;
+
+	memset(&picture, 0, sizeof(picture));
+	for (i = 0; i < 3; i++)
+	{
+		picture.data[i] = data + offsets[i];
+		picture.linesize[i] = pitches[i];
+	}
+
+	av_picture_copy(&picture, (AVPicture*) mdecoder->frame,
+		mdecoder->codec_context->pix_fmt,
+		mdecoder->codec_context->width, mdecoder->codec_context->height);
+
+	mdecoder->decoded_size = 0;
+	return true;
+}
+
 static uint32 tsmf_ffmpeg_get_decoded_format(ITSMFDecoder* decoder)
 {
 	TSMFFFmpegDecoder* mdecoder = (TSMFFFmpegDecoder*) decoder;
@@ -509,6 +539,7 @@ TSMFDecoderEntry(void)
 	decoder->iface.SetFormat = tsmf_ffmpeg_set_format;
 	decoder->iface.Decode = tsmf_ffmpeg_decode;
 	decoder->iface.GetDecodedData = tsmf_ffmpeg_get_decoded_data;
+	decoder->iface.GetDecodedPicture = tsmf_ffmpeg_get_decoded_picture;
 	decoder->iface.GetDecodedFormat = tsmf_ffmpeg_get_decoded_format;
 	decoder->iface.GetDecodedDimension = tsmf_ffmpeg_get_decoded_dimension;
 	decoder->iface.Free = tsmf_ffmpeg_free;
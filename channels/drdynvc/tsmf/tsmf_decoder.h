@@ -33,6 +33,8 @@ struct _ITSMFDecoder
 	boolean (*Decode) (ITSMFDecoder* decoder, const uint8* data, uint32 data_size, uint32 extensions);
 	/* Get the decoded data */
 	uint8* (*GetDecodedData) (ITSMFDecoder* decoder, uint32* size);
+	/* Optional: copy the decoded video frame into planes at the given offsets and pitches */
+	boolean (*GetDecodedPicture) (ITSMFDecoder* decoder, uint8* data, const uint32* offsets, const uint32* pitches);
 	/* Get the pixel format of decoded video frame */
 	uint32 (*GetDecodedFormat) (ITSMFDecoder* decoder);
 	/* Get the width and height of decoded video frame */
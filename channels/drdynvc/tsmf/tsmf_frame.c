@@ -0,0 +1,290 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol client.
+ * Video Redirection Virtual Channel - Video Frame Pool
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <freerdp/utils/memory.h>
+#include <freerdp/utils/list.h>
+#include <freerdp/utils/mutex.h>
+
+#include "tsmf_frame.h"
+
+/* Frames kept for reuse: the decode-ahead queue, plus the frames being
+   decoded into and shown */
+#define TSMF_FRAME_POOL_SIZE	6
+
+struct _TSMF_FRAME_POOL
+{
+	freerdp_mutex mutex;
+	int refs;
+	boolean closed;
+
+	uint32 pixfmt;
+	uint32 width;
+	uint32 height;
+
+	/* Bumped whenever the layout changes, stale frames are not reused */
+	uint32 generation;
+	uint32 size;
+	uint32 offsets[3];
+	uint32 pitches[3];
+
+	LIST* frames;
+};
+
+static void tsmf_frame_free(TSMF_FRAME* frame)
+{
+	if (frame->shm)
+	{
+		shmdt(frame->data);
+		shmctl(frame->shmid, IPC_RMID, NULL);
+	}
+	else
+	{
+		xfree(frame->data);
+	}
+	xfree(frame);
+}
+
+static void tsmf_frame_pool_discard(TSMF_FRAME_POOL* pool)
+{
+	TSMF_FRAME* frame;
+
+	while ((frame = (TSMF_FRAME*) list_dequeue(pool->frames)) != NULL)
+		tsmf_frame_free(frame);
+}
+
+static void tsmf_frame_pool_unref(TSMF_FRAME_POOL* pool)
+{
+	boolean last;
+
+	freerdp_mutex_lock(pool->mutex);
+	last = (--pool->refs == 0);
+	freerdp_mutex_unlock(pool->mutex);
+
+	if (last)
+	{
+		tsmf_frame_pool_discard(pool);
+		list_free(pool->frames);
+		freerdp_mutex_free(pool->mutex);
+		xfree(pool);
+	}
+}
+
+/* Tightly packed planar 4:2:0, as the decoders produce it */
+static void tsmf_frame_pool_set_packed(TSMF_FRAME_POOL* pool)
+{
+	uint32 luma = pool->width * pool->height;
+	uint32 chroma = ((pool->width + 1) / 2) * ((pool->height + 1) / 2);
+
+	pool->size = luma + chroma * 2;
+	pool->offsets[0] = 0;
+	pool->offsets[1] = luma;
+	pool->offsets[2] = luma + chroma;
+	pool->pitches[0] = pool->width;
+	pool->pitches[1] = (pool->width + 1) / 2;
+	pool->pitches[2] = (pool->width + 1) / 2;
+}
+
+/* The renderer layout comes from outside the channel, check it before writing to it */
+static boolean tsmf_frame_pool_check_layout(TSMF_FRAME_POOL* pool, uint32 size,
+	const uint32* offsets, const uint32* pitches)
+{
+	int i;
+	uint32 width;
+	uint32 height;
+
+	if (size == 0)
+		return false;
+
+	for (i = 0; i < 3; i++)
+	{
+		width = (i == 0 ? pool->width : (pool->width + 1) / 2);
+		height = (i == 0 ? pool->height : (pool->height + 1) / 2);
+
+		if (pitches[i] < width)
+			return false;
+		if (offsets[i] > size || (uint64) pitches[i] * (height - 1) + width > size - offsets[i])
+			return false;
+	}
+
+	return true;
+}
+
+TSMF_FRAME_POOL* tsmf_frame_pool_new(void)
+{
+	TSMF_FRAME_POOL* pool;
+
+	pool = xnew(TSMF_FRAME_POOL);
+	pool->mutex = freerdp_mutex_new();
+	pool->frames = list_new();
+	pool->refs = 1;
+
+	return pool;
+}
+
+void tsmf_frame_pool_free(TSMF_FRAME_POOL* pool)
+{
+	freerdp_mutex_lock(pool->mutex);
+	pool->closed = true;
+	tsmf_frame_pool_discard(pool);
+	freerdp_mutex_unlock(pool->mutex);
+
+	tsmf_frame_pool_unref(pool);
+}
+
+/**
+ * Get a frame for a picture of the given format and size. Only planar 4:2:0
+ * frames are pooled, NULL tells the caller to fall back to a heap buffer.
+ */
+TSMF_FRAME* tsmf_frame_pool_get(TSMF_FRAME_POOL* pool, uint32 pixfmt, uint32 width, uint32 height)
+{
+	TSMF_FRAME* frame;
+
+	if (pixfmt != RDP_PIXFMT_I420 && pixfmt != RDP_PIXFMT_YV12)
+		return NULL;
+	if (width == 0 || height == 0)
+		return NULL;
+
+	freerdp_mutex_lock(pool->mutex);
+
+	if (pixfmt != pool->pixfmt || width != pool->width || height != pool->height)
+	{
+		pool->pixfmt = pixfmt;
+		pool->width = width;
+		pool->height = height;
+		pool->generation++;
+		tsmf_frame_pool_set_packed(pool);
+		tsmf_frame_pool_discard(pool);
+	}
+
+	frame = (TSMF_FRAME*) list_dequeue(pool->frames);
+
+	if (frame == NULL)
+	{
+		frame = xnew(TSMF_FRAME);
+		frame->pool = pool;
+		frame->size = pool->size;
+		frame->shmid = shmget(IPC_PRIVATE, frame->size, IPC_CREAT | 0777);
+
+		if (frame->shmid != -1)
+		{
+			frame->data = shmat(frame->shmid, NULL, 0);
+
+			if (frame->data == (uint8*) -1)
+				shmctl(frame->shmid, IPC_RMID, NULL);
+			else
+				frame->shm = true;
+		}
+
+		if (!frame->shm)
+		{
+			DEBUG_DVC("no shared memory, using a heap frame.");
+			frame->shmid = -1;
+			frame->data = xmalloc(frame->size);
+		}
+	}
+
+	frame->generation = pool->generation;
+	memcpy(frame->offsets, pool->offsets, sizeof(frame->offsets));
+	memcpy(frame->pitches, pool->pitches, sizeof(frame->pitches));
+	pool->refs++;
+
+	freerdp_mutex_unlock(pool->mutex);
+
+	return frame;
+}
+
+/**
+ * Give a frame back to its pool. Frames of an older layout, or beyond what
+ * the pool keeps, are freed instead.
+ */
+void tsmf_frame_release(TSMF_FRAME* frame)
+{
+	TSMF_FRAME_POOL* pool = frame->pool;
+
+	freerdp_mutex_lock(pool->mutex);
+
+	if (!pool->closed && frame->generation == pool->generation &&
+		pool->frames->count < TSMF_FRAME_POOL_SIZE)
+	{
+		list_enqueue(pool->frames, frame);
+		frame = NULL;
+	}
+
+	freerdp_mutex_unlock(pool->mutex);
+
+	if (frame)
+		tsmf_frame_free(frame);
+
+	tsmf_frame_pool_unref(pool);
+}
+
+/**
+ * Hand a frame over to a video frame event. The frame belongs to the event
+ * until tsmf_frame_detach_event is called from the event free callback.
+ */
+void tsmf_frame_attach_event(TSMF_FRAME* frame, RDP_VIDEO_FRAME_EVENT* vevent)
+{
+	vevent->frame_data = frame->data;
+	vevent->frame_size = frame->size;
+	vevent->frame_shm = frame->shm;
+	vevent->frame_shmid = frame->shmid;
+	memcpy(vevent->frame_offsets, frame->offsets, sizeof(vevent->frame_offsets));
+	memcpy(vevent->frame_pitches, frame->pitches, sizeof(vevent->frame_pitches));
+}
+
+/**
+ * Take a frame back from an event the renderer is done with, and return it
+ * to the pool along with the layout the renderer prefers. Runs in the
+ * renderer thread.
+ */
+void tsmf_frame_detach_event(TSMF_FRAME* frame, RDP_VIDEO_FRAME_EVENT* vevent)
+{
+	TSMF_FRAME_POOL* pool = frame->pool;
+
+	freerdp_mutex_lock(pool->mutex);
+
+	if (frame->generation == pool->generation && vevent->render_size > 0 &&
+		(vevent->render_size != pool->size ||
+		memcmp(vevent->render_offsets, pool->offsets, sizeof(pool->offsets)) != 0 ||
+		memcmp(vevent->render_pitches, pool->pitches, sizeof(pool->pitches)) != 0))
+	{
+		if (tsmf_frame_pool_check_layout(pool, vevent->render_size,
+			vevent->render_offsets, vevent->render_pitches))
+		{
+			DEBUG_DVC("renderer layout size %d pitches %d %d %d", vevent->render_size,
+				vevent->render_pitches[0], vevent->render_pitches[1], vevent->render_pitches[2]);
+
+			pool->generation++;
+			pool->size = vevent->render_size;
+			memcpy(pool->offsets, vevent->render_offsets, sizeof(pool->offsets));
+			memcpy(pool->pitches, vevent->render_pitches, sizeof(pool->pitches));
+			tsmf_frame_pool_discard(pool);
+		}
+	}
+
+	freerdp_mutex_unlock(pool->mutex);
+
+	/* The frame data belongs to the pool, not to the event */
+	vevent->frame_data = NULL;
+
+	tsmf_frame_release(frame);
+}
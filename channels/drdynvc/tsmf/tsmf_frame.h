@@ -0,0 +1,54 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol client.
+ * Video Redirection Virtual Channel - Video Frame Pool
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __TSMF_FRAME_H
+#define __TSMF_FRAME_H
+
+#include "drdynvc_types.h"
+#include <freerdp/plugins/tsmf.h>
+
+typedef struct _TSMF_FRAME TSMF_FRAME;
+typedef struct _TSMF_FRAME_POOL TSMF_FRAME_POOL;
+
+/**
+ * A decoded video frame in shared memory. The decoder writes the planes at
+ * the given offsets and pitches, which follow the layout the renderer asked
+ * for, so the renderer can hand the segment to the video driver as is.
+ */
+struct _TSMF_FRAME
+{
+	TSMF_FRAME_POOL* pool;
+	uint32 generation;
+
+	uint8* data;
+	uint32 size;
+	boolean shm;
+	int shmid;
+
+	uint32 offsets[3];
+	uint32 pitches[3];
+};
+
+TSMF_FRAME_POOL* tsmf_frame_pool_new(void);
+void tsmf_frame_pool_free(TSMF_FRAME_POOL* pool);
+
+TSMF_FRAME* tsmf_frame_pool_get(TSMF_FRAME_POOL* pool, uint32 pixfmt, uint32 width, uint32 height);
+void tsmf_frame_release(TSMF_FRAME* frame);
+void tsmf_frame_attach_event(TSMF_FRAME* frame, RDP_VIDEO_FRAME_EVENT* vevent);
+void tsmf_frame_detach_event(TSMF_FRAME* frame, RDP_VIDEO_FRAME_EVENT* vevent);
+
+#endif
@@ -34,6 +34,7 @@
 #include "tsmf_constants.h"
 #include "tsmf_types.h"
 #include "tsmf_decoder.h"
+#include "tsmf_frame.h"
 #include "tsmf_audio.h"
 #include "tsmf_main.h"
 #include "tsmf_codec.h"
@@ -41,6 +42,21 @@
 
 #define AUDIO_TOLERANCE 10000000LL
 
+/* Decoded video frames queued ahead of their presentation time */
+#define VIDEO_QUEUE_SIZE 3
+
+/* Without audio, video drives the clock and restarts it after a jump of more than this */
+#define VIDEO_RESYNC_TIME 10000000LL
+
+/* Visible rects of the video window, shared by the frame events drawn with them */
+typedef struct _TSMF_REGION
+{
+	freerdp_mutex mutex;
+	int refs;
+	uint16 num_rects;
+	RDP_RECT* rects;
+} TSMF_REGION;
+
 struct _TSMF_PRESENTATION
 {
 	uint8 presentation_id[GUID_SIZE];
@@ -53,8 +69,7 @@ struct _TSMF_PRESENTATION
 	uint32 last_y;
 	uint32 last_width;
 	uint32 last_height;
-	uint16 last_num_rects;
-	RDP_RECT* last_rects;
+	TSMF_REGION* last_region;
 
 	uint32 output_x;
 	uint32 output_y;
@@ -65,8 +80,14 @@ struct _TSMF_PRESENTATION
 
 	IWTSVirtualChannelCallback* channel_callback;
 
-	uint64 audio_start_time;
-	uint64 audio_end_time;
+	/* The presentation clock: media time clock_media is due at system time
+	   clock_system. Audio streams drive it, video only when there is no audio. */
+	boolean clock_set;
+	boolean clock_audio;
+	uint64 clock_media;
+	uint64 clock_system;
+
+	TSMF_PLAYBACK_STATS stats;
 
 	/* The stream list could be accessed by differnt threads and need to be protected. */
 	freerdp_mutex mutex;
@@ -94,11 +115,15 @@ struct _TSMF_STREAM
 
 	/* The end_time of last played sample */
 	uint64 last_end_time;
-	/* Next sample should not start before this system time. */
-	uint64 next_start_time;
 
 	freerdp_thread* thread;
 
+	/* Decoded video samples waiting for their presentation time */
+	LIST* frame_list;
+
+	/* Shared memory frames that decoded video is written into */
+	TSMF_FRAME_POOL* frame_pool;
+
 	LIST* sample_list;
 
 	/* The sample ack response queue will be accessed only by the stream thread. */
@@ -116,6 +141,10 @@ struct _TSMF_SAMPLE
 	uint8* data;
 	uint32 decoded_size;
 	uint32 pixfmt;
+	uint32 width;
+	uint32 height;
+	TSMF_FRAME* frame;
+	TSMF_REGION* region;
 
 	TSMF_STREAM* stream;
 	IWTSVirtualChannelCallback* channel_callback;
@@ -164,13 +193,6 @@ static TSMF_SAMPLE* tsmf_stream_pop_sample(TSMF_STREAM* stream, int sync)
 				freerdp_mutex_unlock(presentation->mutex);
 			}
 		}
-		else
-		{
-			if (stream->last_end_time > presentation->audio_end_time)
-			{
-				pending = true;
-			}
-		}
 	}
 	if (pending)
 		return NULL;
@@ -185,10 +207,108 @@ static TSMF_SAMPLE* tsmf_stream_pop_sample(TSMF_STREAM* stream, int sync)
 	return sample;
 }
 
+static TSMF_REGION* tsmf_region_new(uint16 num_rects, RDP_RECT* rects)
+{
+	TSMF_REGION* region;
+
+	region = xnew(TSMF_REGION);
+	region->mutex = freerdp_mutex_new();
+	region->refs = 1;
+	region->num_rects = num_rects;
+	region->rects = (RDP_RECT*) xmalloc(num_rects * sizeof(RDP_RECT));
+	memcpy(region->rects, rects, num_rects * sizeof(RDP_RECT));
+
+	return region;
+}
+
+static TSMF_REGION* tsmf_region_ref(TSMF_REGION* region)
+{
+	freerdp_mutex_lock(region->mutex);
+	region->refs++;
+	freerdp_mutex_unlock(region->mutex);
+
+	return region;
+}
+
+static void tsmf_region_unref(TSMF_REGION* region)
+{
+	boolean last;
+
+	freerdp_mutex_lock(region->mutex);
+	last = (--region->refs == 0);
+	freerdp_mutex_unlock(region->mutex);
+
+	if (last)
+	{
+		freerdp_mutex_free(region->mutex);
+		xfree(region->rects);
+		xfree(region);
+	}
+}
+
+static boolean tsmf_region_equals(TSMF_REGION* region, uint16 num_rects, RDP_RECT* rects)
+{
+	if (region == NULL)
+		return (num_rects == 0);
+
+	return (region->num_rects == num_rects &&
+		memcmp(region->rects, rects, num_rects * sizeof(RDP_RECT)) == 0);
+}
+
+/**
+ * Map the media time of a video frame to the system time it is due at.
+ * If no audio drives the clock, the first frame, or a frame far off the
+ * clock after a seek or a stall, (re)starts it.
+ */
+static uint64 tsmf_presentation_get_due_time(TSMF_PRESENTATION* presentation, uint64 media_time, uint64 now)
+{
+	uint64 due;
+
+	freerdp_mutex_lock(presentation->mutex);
+
+	due = presentation->clock_system + (media_time - presentation->clock_media);
+
+	if (!presentation->clock_set || (!presentation->clock_audio &&
+		(due > now + VIDEO_RESYNC_TIME || due + VIDEO_RESYNC_TIME < now)))
+	{
+		presentation->clock_set = true;
+		presentation->clock_media = media_time;
+		presentation->clock_system = now;
+		due = now;
+	}
+
+	freerdp_mutex_unlock(presentation->mutex);
+
+	return due;
+}
+
+/* Media time media_time is heard at system time system_time */
+static void tsmf_presentation_set_audio_clock(TSMF_PRESENTATION* presentation, uint64 media_time, uint64 system_time)
+{
+	freerdp_mutex_lock(presentation->mutex);
+	presentation->clock_set = true;
+	presentation->clock_audio = true;
+	presentation->clock_media = media_time;
+	presentation->clock_system = system_time;
+	freerdp_mutex_unlock(presentation->mutex);
+}
+
+static void tsmf_presentation_reset_clock(TSMF_PRESENTATION* presentation)
+{
+	freerdp_mutex_lock(presentation->mutex);
+	presentation->clock_set = false;
+	presentation->clock_audio = false;
+	freerdp_mutex_unlock(presentation->mutex);
+}
+
 static void tsmf_sample_free(TSMF_SAMPLE* sample)
 {
 	if (sample->data)
 		xfree(sample->data);
+	if (sample->frame)
+		tsmf_frame_release(sample->frame);
+	if (sample->region)
+		tsmf_region_unref(sample->region);
 	xfree(sample);
 }
 
@@ -283,9 +403,26 @@ static void tsmf_presentation_restore_last_video_frame(TSMF_PRESENTATION* presen
 	}
 }
 
+/* The client is done with a video frame event; the sample it carried goes with it */
+static void tsmf_video_event_free(RDP_EVENT* event)
+{
+	RDP_VIDEO_FRAME_EVENT* vevent = (RDP_VIDEO_FRAME_EVENT*) event;
+	TSMF_SAMPLE* sample = (TSMF_SAMPLE*) event->user_data;
+
+	if (sample->frame)
+	{
+		tsmf_frame_detach_event(sample->frame, vevent);
+		sample->frame = NULL;
+	}
+
+	/* The rects belong to the region */
+	vevent->visible_rects = NULL;
+
+	tsmf_sample_free(sample);
+}
+
 static void tsmf_sample_playback_video(TSMF_SAMPLE* sample)
 {
-	uint64 t;
 	RDP_VIDEO_FRAME_EVENT* vevent;
 	TSMF_STREAM* stream = sample->stream;
 	TSMF_PRESENTATION* presentation = stream->presentation;
@@ -293,101 +430,169 @@ static void tsmf_sample_playback_video(TSMF_SAMPLE* sample)
 	DEBUG_DVC("MessageId %d EndTime %d data_size %d consumed.",
 		sample->sample_id, (int)sample->end_time, sample->data_size);
 
-	if (sample->data)
+	tsmf_sample_ack(sample);
+
+	if (!sample->data && !sample->frame)
 	{
-		t = get_current_time();
-		if (stream->next_start_time > t &&
-			(sample->end_time >= presentation->audio_start_time ||
-			sample->end_time < stream->last_end_time))
-		{
-			freerdp_usleep((stream->next_start_time - t) / 10);
-		}
-		stream->next_start_time = t + sample->duration - 50000;
-
-		if (presentation->last_x != presentation->output_x ||
-			presentation->last_y != presentation->output_y ||
-			presentation->last_width != presentation->output_width ||
-			presentation->last_height != presentation->output_height ||
-			presentation->last_num_rects != presentation->output_num_rects ||
-			(presentation->last_rects && presentation->output_rects &&
-			memcmp(presentation->last_rects, presentation->output_rects,
-			presentation->last_num_rects * sizeof(RDP_RECT)) != 0))
-		{
-			tsmf_presentation_restore_last_video_frame(presentation);
+		tsmf_sample_free(sample);
+		return;
+	}
 
-			presentation->last_x = presentation->output_x;
-			presentation->last_y = presentation->output_y;
-			presentation->last_width = presentation->output_width;
-			presentation->last_height = presentation->output_height;
+	if (presentation->last_x != presentation->output_x ||
+		presentation->last_y != presentation->output_y ||
+		presentation->last_width != presentation->output_width ||
+		presentation->last_height != presentation->output_height ||
+		!tsmf_region_equals(presentation->last_region,
+		presentation->output_num_rects, presentation->output_rects))
+	{
+		tsmf_presentation_restore_last_video_frame(presentation);
 
-			if (presentation->last_rects)
-			{
-				xfree(presentation->last_rects);
-				presentation->last_rects = NULL;
-			}
-			presentation->last_num_rects = presentation->output_num_rects;
-			if (presentation->last_num_rects > 0)
-			{
-				presentation->last_rects = xzalloc(presentation->last_num_rects * sizeof(RDP_RECT));
-				memcpy(presentation->last_rects, presentation->output_rects,
-					presentation->last_num_rects * sizeof(RDP_RECT));
-			}
-		}
+		presentation->last_x = presentation->output_x;
+		presentation->last_y = presentation->output_y;
+		presentation->last_width = presentation->output_width;
+		presentation->last_height = presentation->output_height;
 
-		vevent = (RDP_VIDEO_FRAME_EVENT*) freerdp_event_new(RDP_EVENT_CLASS_TSMF, RDP_EVENT_TYPE_TSMF_VIDEO_FRAME,
-			NULL, NULL);
-		vevent->frame_data = sample->data;
-		vevent->frame_size = sample->decoded_size;
-		vevent->frame_pixfmt = sample->pixfmt;
-		vevent->frame_width = sample->stream->width;
-		vevent->frame_height = sample->stream->height;
-		vevent->x = presentation->output_x;
-		vevent->y = presentation->output_y;
-		vevent->width = presentation->output_width;
-		vevent->height = presentation->output_height;
+		if (presentation->last_region)
+		{
+			tsmf_region_unref(presentation->last_region);
+			presentation->last_region = NULL;
+		}
 		if (presentation->output_num_rects > 0)
 		{
-			vevent->num_visible_rects = presentation->output_num_rects;
-			vevent->visible_rects = (RDP_RECT*) xzalloc(presentation->output_num_rects * sizeof(RDP_RECT));
-			memcpy(vevent->visible_rects, presentation->output_rects,
-				presentation->output_num_rects * sizeof(RDP_RECT));
+			presentation->last_region = tsmf_region_new(presentation->output_num_rects,
+				presentation->output_rects);
 		}
+	}
 
-		/* The frame data ownership is passed to the event object, and is freed after the event is processed. */
+	/* The sample, and the frame data it holds, belong to the event from now on */
+	vevent = (RDP_VIDEO_FRAME_EVENT*) freerdp_event_new(RDP_EVENT_CLASS_TSMF, RDP_EVENT_TYPE_TSMF_VIDEO_FRAME,
+		tsmf_video_event_free, sample);
+	if (sample->frame)
+	{
+		tsmf_frame_attach_event(sample->frame, vevent);
+	}
+	else
+	{
+		vevent->frame_data = sample->data;
+		vevent->frame_size = sample->decoded_size;
 		sample->data = NULL;
 		sample->decoded_size = 0;
+	}
+	vevent->frame_pixfmt = sample->pixfmt;
+	vevent->frame_width = sample->width;
+	vevent->frame_height = sample->height;
+	vevent->x = presentation->output_x;
+	vevent->y = presentation->output_y;
+	vevent->width = presentation->output_width;
+	vevent->height = presentation->output_height;
+	if (presentation->last_region)
+	{
+		sample->region = tsmf_region_ref(presentation->last_region);
+		vevent->num_visible_rects = sample->region->num_rects;
+		vevent->visible_rects = sample->region->rects;
+	}
+
+	if (!tsmf_push_event(sample->channel_callback, (RDP_EVENT*) vevent))
+	{
+		freerdp_event_free((RDP_EVENT*) vevent);
+	}
+}
 
-		if (!tsmf_push_event(sample->channel_callback, (RDP_EVENT*) vevent))
+/**
+ * Present the queued video frames that are due. A due frame is dropped when
+ * the frame after it is due as well, so a late stream catches up instead of
+ * falling further behind. Returns the time until the next frame is due, in
+ * 100ns, or 0 when the queue is empty.
+ */
+static uint64 tsmf_stream_present_video(TSMF_STREAM* stream)
+{
+	uint64 now;
+	uint64 due;
+	sint64 skew;
+	boolean drop;
+	boolean has_next;
+	uint64 start_time;
+	uint64 next_start_time;
+	TSMF_SAMPLE* sample;
+	TSMF_SAMPLE* next;
+	TSMF_PRESENTATION* presentation = stream->presentation;
+
+	while (1)
+	{
+		/* the samples may be flushed by the channel thread as soon as the lock is released */
+		freerdp_thread_lock(stream->thread);
+		sample = (TSMF_SAMPLE*) list_peek(stream->frame_list);
+		next = (sample ? (TSMF_SAMPLE*) list_next(stream->frame_list, sample) : NULL);
+		start_time = (sample ? sample->start_time : 0);
+		has_next = (next != NULL);
+		next_start_time = (next ? next->start_time : 0);
+		freerdp_thread_unlock(stream->thread);
+
+		if (sample == NULL)
+			return 0;
+
+		now = get_current_time();
+		due = tsmf_presentation_get_due_time(presentation, start_time, now);
+		if (due > now)
+			return due - now;
+
+		drop = (has_next && tsmf_presentation_get_due_time(presentation, next_start_time, now) <= now);
+
+		/* only take the sample if it is still the one looked at */
+		freerdp_thread_lock(stream->thread);
+		if (list_peek(stream->frame_list) == sample)
+			list_dequeue(stream->frame_list);
+		else
+			sample = NULL;
+		freerdp_thread_unlock(stream->thread);
+
+		if (sample == NULL)
+			continue;
+
+		freerdp_mutex_lock(presentation->mutex);
+		if (drop)
 		{
-			freerdp_event_free((RDP_EVENT*) vevent);
+			presentation->stats.frames_dropped++;
 		}
+		else
+		{
+			skew = (sint64) (now - due);
+			presentation->stats.frames_presented++;
+			presentation->stats.av_skew = skew;
+			if (skew > presentation->stats.av_skew_max)
+				presentation->stats.av_skew_max = skew;
+		}
+		freerdp_mutex_unlock(presentation->mutex);
 
-#if 0
-		/* Dump a .ppm image for every 30 frames. Assuming the frame is in YUV format, we
-		   extract the Y values to create a grayscale image. */
-		static int frame_id = 0;
-		char buf[100];
-		FILE * fp;
-		if ((frame_id % 30) == 0)
+		if (drop)
+		{
+			DEBUG_DVC("MessageId %d late by %d, dropped.", sample->sample_id, (int) (now - due));
+			tsmf_sample_ack(sample);
+			tsmf_sample_free(sample);
+		}
+		else
 		{
-			snprintf(buf, sizeof(buf), "/tmp/FreeRDP_Frame_%d.ppm", frame_id);
-			fp = fopen(buf, "wb");
-			fwrite("P5\n", 1, 3, fp);
-			snprintf(buf, sizeof(buf), "%d %d\n", sample->stream->width, sample->stream->height);
-			fwrite(buf, 1, strlen(buf), fp);
-			fwrite("255\n", 1, 4, fp);
-			fwrite(sample->data, 1, sample->stream->width * sample->stream->height, fp);
-			fflush(fp);
-			fclose(fp);
+			tsmf_sample_playback_video(sample);
 		}
-		frame_id++;
-#endif
 	}
 }
 
+static int tsmf_stream_frame_count(TSMF_STREAM* stream)
+{
+	int count;
+
+	freerdp_thread_lock(stream->thread);
+	count = stream->frame_list->count;
+	freerdp_thread_unlock(stream->thread);
+
+	return count;
+}
+
 static void tsmf_sample_playback_audio(TSMF_SAMPLE* sample)
 {
+	uint64 now;
 	uint64 latency = 0;
+	boolean played = false;
 	TSMF_STREAM* stream = sample->stream;
 
 	DEBUG_DVC("MessageId %d EndTime %d consumed.",
@@ -399,6 +604,7 @@ static void tsmf_sample_playback_audio(TSMF_SAMPLE* sample)
 			sample->data, sample->decoded_size);
 		sample->data = NULL;
 		sample->decoded_size = 0;
+		played = true;
 
 		if (stream->audio && stream->audio->GetLatency)
 			latency = stream->audio->GetLatency(stream->audio);
@@ -408,10 +614,13 @@ static void tsmf_sample_playback_audio(TSMF_SAMPLE* sample)
 		latency = 0;
 	}
 
-	sample->ack_time = latency + get_current_time();
+	now = get_current_time();
+	sample->ack_time = latency + now;
 	stream->last_end_time = sample->end_time + latency;
-	stream->presentation->audio_start_time = sample->start_time + latency;
-	stream->presentation->audio_end_time = sample->end_time + latency;
+
+	/* The end of this sample is heard once the device latency has passed */
+	if (played)
+		tsmf_presentation_set_audio_clock(stream->presentation, sample->end_time, now + latency);
 }
 
 static void tsmf_sample_playback(TSMF_SAMPLE* sample)
@@ -458,7 +667,18 @@ static void tsmf_sample_playback(TSMF_SAMPLE* sample)
 		}
 	}
 
-	if (stream->decoder->GetDecodedData)
+	if (stream->major_type == TSMF_MAJOR_TYPE_VIDEO && stream->decoder->GetDecodedPicture)
+	{
+		sample->frame = tsmf_frame_pool_get(stream->frame_pool, sample->pixfmt, stream->width, stream->height);
+		if (sample->frame && !stream->decoder->GetDecodedPicture(stream->decoder,
+			sample->frame->data, sample->frame->offsets, sample->frame->pitches))
+		{
+			tsmf_frame_release(sample->frame);
+			sample->frame = NULL;
+		}
+	}
+
+	if (!sample->frame && stream->decoder->GetDecodedData)
 	{
 		sample->data = stream->decoder->GetDecodedData(stream->decoder, &sample->decoded_size);
 	}
@@ -466,9 +686,12 @@ static void tsmf_sample_playback(TSMF_SAMPLE* sample)
 	switch (sample->stream->major_type)
 	{
 		case TSMF_MAJOR_TYPE_VIDEO:
-			tsmf_sample_playback_video(sample);
-			tsmf_sample_ack(sample);
-			tsmf_sample_free(sample);
+			/* Presented by tsmf_stream_present_video once it is due */
+			sample->width = stream->width;
+			sample->height = stream->height;
+			freerdp_thread_lock(stream->thread);
+			list_enqueue(stream->frame_list, sample);
+			freerdp_thread_unlock(stream->thread);
 			break;
 		case TSMF_MAJOR_TYPE_AUDIO:
 			tsmf_sample_playback_audio(sample);
@@ -479,6 +702,7 @@ static void tsmf_sample_playback(TSMF_SAMPLE* sample)
 
 static void* tsmf_stream_playback_func(void* arg)
 {
+	uint64 wait;
 	TSMF_SAMPLE* sample;
 	TSMF_STREAM* stream = (TSMF_STREAM*) arg;
 	TSMF_PRESENTATION* presentation = stream->presentation;
@@ -500,16 +724,36 @@ static void* tsmf_stream_playback_func(void* arg)
 	while (!freerdp_thread_is_stopped(stream->thread))
 	{
 		tsmf_stream_process_ack(stream);
-		sample = tsmf_stream_pop_sample(stream, 1);
-		if (sample)
+
+		/* Presenting comes first, decoding runs ahead while the queue has room */
+		wait = tsmf_stream_present_video(stream);
+
+		if (tsmf_stream_frame_count(stream) < VIDEO_QUEUE_SIZE &&
+			(sample = tsmf_stream_pop_sample(stream, 1)) != NULL)
+		{
 			tsmf_sample_playback(sample);
-		else
-			freerdp_usleep(5000);
+			continue;
+		}
+
+		freerdp_usleep(wait > 0 && wait < 50000 ? wait / 10 : 5000);
 	}
 	if (stream->eos || presentation->eos)
 	{
-		while ((sample = tsmf_stream_pop_sample(stream, 1)) != NULL)
-			tsmf_sample_playback(sample);
+		while (1)
+		{
+			wait = tsmf_stream_present_video(stream);
+
+			if (tsmf_stream_frame_count(stream) < VIDEO_QUEUE_SIZE &&
+				(sample = tsmf_stream_pop_sample(stream, 1)) != NULL)
+			{
+				tsmf_sample_playback(sample);
+				continue;
+			}
+			if (tsmf_stream_frame_count(stream) == 0)
+				break;
+
+			freerdp_usleep(wait / 10);
+		}
 	}
 	if (stream->audio)
 	{
@@ -565,13 +809,16 @@ void tsmf_presentation_stop(TSMF_PRESENTATION* presentation)
 		tsmf_stream_stop(stream);
 	}
 
+	DEBUG_DVC("frames presented %d dropped %d, skew %d max %d",
+		presentation->stats.frames_presented, presentation->stats.frames_dropped,
+		(int) presentation->stats.av_skew, (int) presentation->stats.av_skew_max);
+
 	tsmf_presentation_restore_last_video_frame(presentation);
-	if (presentation->last_rects)
+	if (presentation->last_region)
 	{
-		xfree(presentation->last_rects);
-		presentation->last_rects = NULL;
+		tsmf_region_unref(presentation->last_region);
+		presentation->last_region = NULL;
 	}
-	presentation->last_num_rects = 0;
 	if (presentation->output_rects)
 	{
 		xfree(presentation->output_rects);
@@ -600,6 +847,13 @@ void tsmf_presentation_set_audio_device(TSMF_PRESENTATION* presentation, const c
 	presentation->audio_device = device;
 }
 
+void tsmf_presentation_get_stats(TSMF_PRESENTATION* presentation, TSMF_PLAYBACK_STATS* stats)
+{
+	freerdp_mutex_lock(presentation->mutex);
+	memcpy(stats, &presentation->stats, sizeof(TSMF_PLAYBACK_STATS));
+	freerdp_mutex_unlock(presentation->mutex);
+}
+
 static void tsmf_stream_flush(TSMF_STREAM* stream)
 {
 	TSMF_SAMPLE* sample;
@@ -610,17 +864,18 @@ static void tsmf_stream_flush(TSMF_STREAM* stream)
 	while ((sample = list_dequeue(stream->sample_ack_list)) != NULL)
 		tsmf_sample_free(sample);
 
+	freerdp_thread_lock(stream->thread);
+	while ((sample = list_dequeue(stream->frame_list)) != NULL)
+		tsmf_sample_free(sample);
+	freerdp_thread_unlock(stream->thread);
+
 	if (stream->audio)
 		stream->audio->Flush(stream->audio);
 
 	stream->eos = 0;
 	stream->last_end_time = 0;
-	stream->next_start_time = 0;
 	if (stream->major_type == TSMF_MAJOR_TYPE_AUDIO)
-	{
-		stream->presentation->audio_start_time = 0;
-		stream->presentation->audio_end_time = 0;
-	}
+		tsmf_presentation_reset_clock(stream->presentation);
 }
 
 void tsmf_presentation_flush(TSMF_PRESENTATION* presentation)
@@ -635,8 +890,7 @@ void tsmf_presentation_flush(TSMF_PRESENTATION* presentation)
 	}
 
 	presentation->eos = 0;
-	presentation->audio_start_time = 0;
-	presentation->audio_end_time = 0;
+	tsmf_presentation_reset_clock(presentation);
 }
 
 void tsmf_presentation_free(TSMF_PRESENTATION* presentation)
@@ -674,6 +928,8 @@ TSMF_STREAM* tsmf_stream_new(TSMF_PRESENTATION* presentation, uint32 stream_id)
 	stream->stream_id = stream_id;
 	stream->presentation = presentation;
 	stream->thread = freerdp_thread_new();
+	stream->frame_pool = tsmf_frame_pool_new();
+	stream->frame_list = list_new();
 	stream->sample_list = list_new();
 	stream->sample_ack_list = list_new();
 
@@ -754,12 +1010,15 @@ void tsmf_stream_free(TSMF_STREAM* stream)
 
 	list_free(stream->sample_list);
 	list_free(stream->sample_ack_list);
+	list_free(stream->frame_list);
 
 	if (stream->decoder)
 		stream->decoder->Free(stream->decoder);
 
 	freerdp_thread_free(stream->thread);
 
+	tsmf_frame_pool_free(stream->frame_pool);
+
 	xfree(stream);
 }
 
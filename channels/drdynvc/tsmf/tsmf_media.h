@@ -31,6 +31,17 @@ typedef struct _TSMF_STREAM TSMF_STREAM;
 
 typedef struct _TSMF_SAMPLE TSMF_SAMPLE;
 
+/* Video playback counters of a presentation */
+typedef struct _TSMF_PLAYBACK_STATS
+{
+	uint32 frames_presented;
+	uint32 frames_dropped;
+	/* How late the last and the latest video frame were against the
+	   presentation clock, which follows the audio when there is any; in 100ns */
+	sint64 av_skew;
+	sint64 av_skew_max;
+} TSMF_PLAYBACK_STATS;
+
 TSMF_PRESENTATION* tsmf_presentation_new(const uint8* guid, IWTSVirtualChannelCallback* pChannelCallback);
 TSMF_PRESENTATION* tsmf_presentation_find_by_id(const uint8* guid);
 void tsmf_presentation_start(TSMF_PRESENTATION* presentation);
@@ -41,6 +52,7 @@ void tsmf_presentation_set_geometry_info(TSMF_PRESENTATION* presentation,
 void tsmf_presentation_set_audio_device(TSMF_PRESENTATION* presentation,
 	const char* name, const char* device);
 void tsmf_presentation_flush(TSMF_PRESENTATION* presentation);
+void tsmf_presentation_get_stats(TSMF_PRESENTATION* presentation, TSMF_PLAYBACK_STATS* stats);
 void tsmf_presentation_free(TSMF_PRESENTATION* presentation);
 
 TSMF_STREAM* tsmf_stream_new(TSMF_PRESENTATION* presentation, uint32 stream_id);
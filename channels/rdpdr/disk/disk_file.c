@@ -59,30 +59,39 @@
 static boolean disk_file_wildcard_match(const char* pattern, const char* filename)
 {
 	const char *p = pattern, *f = filename;
-	char c;
+	const char *star = NULL, *mark = NULL;
 
 	/*
-	 * TODO: proper wildcard rules per msft's File System Behavior Overview
-	 * Simple cases for now.
+	 * '*' matches any run of characters and '?' any single one, backtracking
+	 * to the last '*' on mismatch. DOS wildcards ('<', '>', '"') are not handled.
 	 */
-	f = filename;
-	while ((c = *p++))
+	while (*f)
 	{
-		if (c == '*')
+		if (*p == '*')
 		{
-			c = *p++;
-			if (!c)	/* shortcut */
-				return true;
-			/* TODO: skip to tail comparison */
+			star = ++p;
+			mark = f;
+		}
+		else if (*p == '?' || *p == *f)
+		{
+			p++;
+			f++;
+		}
+		else if (star != NULL)
+		{
+			p = star;
+			f = ++mark;
 		}
-		if (c != *f++)
+		else
+		{
 			return false;
+		}
 	}
 
-	if (!*f)
-		return true;
+	while (*p == '*')
+		p++;
 
-	return false;
+	return (*p == '\0');
 }
 
 static void disk_file_fix_path(char* path)
@@ -270,6 +279,19 @@ static boolean disk_file_init(DISK_FILE* file, uint32 DesiredAccess, uint32 Crea
 	return true;
 }
 
+static void disk_file_free_dirents(DISK_FILE* file)
+{
+	int i;
+
+	for (i = 0; i < file->num_dirents; i++)
+		xfree(file->dirents[i].name);
+
+	xfree(file->dirents);
+	file->dirents = NULL;
+	file->num_dirents = 0;
+	file->next_dirent = 0;
+}
+
 DISK_FILE* disk_file_new(const char* base_path, const char* path, uint32 id,
 	uint32 DesiredAccess, uint32 CreateDisposition, uint32 CreateOptions)
 {
@@ -305,51 +327,104 @@ void disk_file_free(DISK_FILE* file)
 			unlink(file->fullpath);
 	}
 
+	disk_file_free_dirents(file);
+	xfree(file->readahead);
 	xfree(file->pattern);
 	xfree(file->fullpath);
 	xfree(file);
 }
 
-boolean disk_file_seek(DISK_FILE* file, uint64 Offset)
+static boolean disk_file_pread(DISK_FILE* file, uint8* buffer, uint32* Length, uint64 Offset)
 {
-	if (file->is_dir || file->fd == -1)
-		return false;
+	ssize_t r;
+
+	do
+	{
+		r = pread(file->fd, buffer, *Length, (off_t) Offset);
+	}
+	while (r < 0 && errno == EINTR);
 
-	if (lseek(file->fd, Offset, SEEK_SET) == (off_t)-1)
+	if (r < 0)
 		return false;
+	*Length = (uint32)r;
 
 	return true;
 }
 
-boolean disk_file_read(DISK_FILE* file, uint8* buffer, uint32* Length)
+void disk_file_check_generation(DISK_FILE* file, uint32 generation)
 {
-	ssize_t r;
+	if (file->readahead_generation != generation)
+	{
+		file->readahead_length = 0;
+		file->readahead_generation = generation;
+	}
+}
+
+/**
+ * Read Length bytes at Offset directly into buffer.
+ * Once two reads in a row continue where the previous one ended, small
+ * requests are served from a DISK_READAHEAD_SIZE window instead, which is
+ * refilled with a single pread when the access leaves it.
+ */
+
+boolean disk_file_read(DISK_FILE* file, uint8* buffer, uint32* Length, uint64 Offset)
+{
+	uint32 length;
+	boolean sequential;
 
 	if (file->is_dir || file->fd == -1)
 		return false;
 
-	r = read(file->fd, buffer, *Length);
-	if (r < 0)
-		return false;
-	*Length = (uint32)r;
+	sequential = (Offset == file->next_offset && Offset > 0);
+	file->next_offset = Offset + *Length;
+
+	if (!sequential || *Length >= DISK_READAHEAD_SIZE)
+		return disk_file_pread(file, buffer, Length, Offset);
+
+	if (Offset < file->readahead_offset ||
+		Offset + *Length > file->readahead_offset + file->readahead_length)
+	{
+		if (file->readahead == NULL)
+			file->readahead = (uint8*) xmalloc(DISK_READAHEAD_SIZE);
+
+		length = DISK_READAHEAD_SIZE;
+		file->readahead_length = 0;
+
+		if (!disk_file_pread(file, file->readahead, &length, Offset))
+			return false;
+
+		file->readahead_offset = Offset;
+		file->readahead_length = length;
+	}
+
+	length = (uint32) (file->readahead_offset + file->readahead_length - Offset);
+	*Length = MIN(*Length, length);
+	memcpy(buffer, file->readahead + (Offset - file->readahead_offset), *Length);
 
 	return true;
 }
 
-boolean disk_file_write(DISK_FILE* file, uint8* buffer, uint32 Length)
+boolean disk_file_write(DISK_FILE* file, uint8* buffer, uint32 Length, uint64 Offset)
 {
 	ssize_t r;
 
 	if (file->is_dir || file->fd == -1)
 		return false;
 
+	file->readahead_length = 0;
+
 	while (Length > 0)
 	{
-		r = write(file->fd, buffer, Length);
+		r = pwrite(file->fd, buffer, Length, (off_t) Offset);
 		if (r == -1)
+		{
+			if (errno == EINTR)
+				continue;
 			return false;
+		}
 		Length -= r;
 		buffer += r;
+		Offset += r;
 	}
 
 	return true;
@@ -455,6 +530,7 @@ boolean disk_file_set_information(DISK_FILE* file, uint32 FsInformationClass, ui
 		case FileAllocationInformation:
 			/* http://msdn.microsoft.com/en-us/library/cc232076.aspx */
 			stream_read_uint64(input, size);
+			file->readahead_length = 0;
 			if (ftruncate(file->fd, size) != 0)
 				return false;
 			break;
@@ -502,15 +578,129 @@ boolean disk_file_set_information(DISK_FILE* file, uint32 FsInformationClass, ui
 	return true;
 }
 
-boolean disk_file_query_directory(DISK_FILE* file, uint32 FsInformationClass, uint8 InitialQuery,
-	const char* path, STREAM* output)
+/**
+ * Read the whole directory once, keeping only the entries that match the
+ * pattern, with their attributes and UTF-16 names ready to be sent.
+ */
+
+static void disk_file_snapshot_dir(DISK_FILE* file, UNICONV* uniconv)
 {
 	struct dirent* ent;
-	char* ent_path;
-	struct stat st;
-	UNICONV* uniconv;
-	size_t len;
-	boolean ret;
+	DISK_DIRENT* dirent;
+	int max_dirents;
+	int fd;
+
+	disk_file_free_dirents(file);
+
+	fd = dirfd(file->dir);
+	rewinddir(file->dir);
+	max_dirents = 0;
+
+	while ((ent = readdir(file->dir)) != NULL)
+	{
+		if (file->pattern && !disk_file_wildcard_match(file->pattern, ent->d_name))
+			continue;
+
+		if (file->dirents == NULL)
+		{
+			max_dirents = 64;
+			file->dirents = (DISK_DIRENT*) xmalloc(max_dirents * sizeof(DISK_DIRENT));
+		}
+		else if (file->num_dirents == max_dirents)
+		{
+			max_dirents *= 2;
+			file->dirents = (DISK_DIRENT*) xrealloc(file->dirents, max_dirents * sizeof(DISK_DIRENT));
+		}
+
+		dirent = &file->dirents[file->num_dirents++];
+		memset(&dirent->st, 0, sizeof(struct stat));
+
+		if (fstatat(fd, ent->d_name, &dirent->st, 0) != 0)
+			DEBUG_WARN("stat %s/%s failed.", file->fullpath, ent->d_name);
+
+		dirent->hidden = (ent->d_name[0] == '.');
+		dirent->name = freerdp_uniconv_out(uniconv, ent->d_name, &dirent->length);
+	}
+
+	DEBUG_SVC("  pattern %s matched %d entries", file->pattern, file->num_dirents);
+}
+
+static uint32 disk_file_dirent_size(uint32 FsInformationClass, DISK_DIRENT* dirent)
+{
+	switch (FsInformationClass)
+	{
+		case FileDirectoryInformation:
+			return 64 + dirent->length;
+
+		case FileFullDirectoryInformation:
+			return 68 + dirent->length;
+
+		case FileBothDirectoryInformation:
+			return 93 + dirent->length;
+
+		case FileNamesInformation:
+			return 12 + dirent->length;
+
+		default:
+			return 0;
+	}
+}
+
+static void disk_file_write_dirent(uint32 FsInformationClass, DISK_DIRENT* dirent,
+	uint32 NextEntryOffset, STREAM* output)
+{
+	struct stat* st = &dirent->st;
+	uint32 attributes;
+
+	attributes = (S_ISDIR(st->st_mode) ? FILE_ATTRIBUTE_DIRECTORY : 0) |
+		(dirent->hidden ? FILE_ATTRIBUTE_HIDDEN : 0) |
+		(st->st_mode & S_IWUSR ? 0 : FILE_ATTRIBUTE_READONLY);
+
+	stream_write_uint32(output, NextEntryOffset); /* NextEntryOffset */
+	stream_write_uint32(output, 0); /* FileIndex */
+
+	if (FsInformationClass == FileNamesInformation)
+	{
+		/* http://msdn.microsoft.com/en-us/library/cc232077.aspx */
+		stream_write_uint32(output, dirent->length); /* FileNameLength */
+		stream_write(output, dirent->name, dirent->length);
+		return;
+	}
+
+	/* http://msdn.microsoft.com/en-us/library/cc232097.aspx */
+	/* http://msdn.microsoft.com/en-us/library/cc232068.aspx */
+	/* http://msdn.microsoft.com/en-us/library/cc232095.aspx */
+	stream_write_uint64(output, FILE_TIME_SYSTEM_TO_RDP(st->st_mtime)); /* CreationTime */
+	stream_write_uint64(output, FILE_TIME_SYSTEM_TO_RDP(st->st_atime)); /* LastAccessTime */
+	stream_write_uint64(output, FILE_TIME_SYSTEM_TO_RDP(st->st_mtime)); /* LastWriteTime */
+	stream_write_uint64(output, FILE_TIME_SYSTEM_TO_RDP(st->st_ctime)); /* ChangeTime */
+	stream_write_uint64(output, st->st_size); /* EndOfFile */
+	stream_write_uint64(output, st->st_size); /* AllocationSize */
+	stream_write_uint32(output, attributes); /* FileAttributes */
+	stream_write_uint32(output, dirent->length); /* FileNameLength */
+
+	if (FsInformationClass != FileDirectoryInformation)
+		stream_write_uint32(output, 0); /* EaSize */
+
+	if (FsInformationClass == FileBothDirectoryInformation)
+	{
+		stream_write_uint8(output, 0); /* ShortNameLength */
+		/* Reserved(1), MUST NOT be added! */
+		stream_write_zero(output, 24); /* ShortName */
+	}
+
+	stream_write(output, dirent->name, dirent->length);
+}
+
+boolean disk_file_query_directory(DISK_FILE* file, uint32 FsInformationClass, uint8 InitialQuery,
+	const char* path, STREAM* output, UNICONV* uniconv)
+{
+	DISK_DIRENT* dirent;
+	uint32 length;
+	uint32 size;
+	uint32 total;
+	int count;
+	int i;
 
 	DEBUG_SVC("path %s FsInformationClass %d InitialQuery %d", path, FsInformationClass, InitialQuery);
 
@@ -523,7 +713,6 @@ boolean disk_file_query_directory(DISK_FILE* file, uint32 FsInformationClass, ui
 
 	if (InitialQuery != 0)
 	{
-		rewinddir(file->dir);
 		xfree(file->pattern);
 
 		if (path[0])
@@ -532,24 +721,10 @@ boolean disk_file_query_directory(DISK_FILE* file, uint32 FsInformationClass, ui
 			file->pattern = NULL;
 	}
 
-	if (file->pattern)
-	{
-		do
-		{
-			ent = readdir(file->dir);
-			if (ent == NULL)
-				continue;
+	if (InitialQuery != 0 || file->dirents == NULL)
+		disk_file_snapshot_dir(file, uniconv);
 
-			if (disk_file_wildcard_match(file->pattern, ent->d_name))
-				break;
-		} while (ent);
-	}
-	else
-	{
-		ent = readdir(file->dir);
-	}
-
-	if (ent == NULL)
+	if (file->next_dirent >= file->num_dirents)
 	{
 		DEBUG_SVC("  pattern %s not found.", file->pattern);
 		stream_write_uint32(output, 0); /* Length */
@@ -557,99 +732,43 @@ boolean disk_file_query_directory(DISK_FILE* file, uint32 FsInformationClass, ui
 		return false;
 	}
 
-	memset(&st, 0, sizeof(struct stat));
-	ent_path = xmalloc(strlen(file->fullpath) + strlen(ent->d_name) + 2);
-	sprintf(ent_path, "%s/%s", file->fullpath, ent->d_name);
-	if (stat(ent_path, &st) != 0)
+	if (disk_file_dirent_size(FsInformationClass, &file->dirents[file->next_dirent]) == 0)
 	{
-		DEBUG_WARN("stat %s failed.", ent_path);
+		stream_write_uint32(output, 0); /* Length */
+		stream_write_uint8(output, 0); /* Padding */
+		DEBUG_WARN("invalid FsInformationClass %d", FsInformationClass);
+		return false;
 	}
-	xfree(ent_path);
 
-	DEBUG_SVC("  pattern %s matched %s\n", file->pattern, ent_path);
+	/* pack consecutive entries, each 8-byte aligned, up to DISK_QUERY_DIRECTORY_SIZE */
+	total = 0;
+	count = 0;
 
-	uniconv = freerdp_uniconv_new();
-	ent_path = freerdp_uniconv_out(uniconv, ent->d_name, &len);
-	freerdp_uniconv_free(uniconv);
-
-	ret = true;
-	switch (FsInformationClass)
+	for (i = file->next_dirent; i < file->num_dirents; i++)
 	{
-		case FileDirectoryInformation:
-			/* http://msdn.microsoft.com/en-us/library/cc232097.aspx */
-			stream_write_uint32(output, 64 + len); /* Length */
-			stream_check_size(output, 64 + len);
-			stream_write_uint32(output, 0); /* NextEntryOffset */
-			stream_write_uint32(output, 0); /* FileIndex */
-			stream_write_uint64(output, FILE_TIME_SYSTEM_TO_RDP(st.st_mtime)); /* CreationTime */
-			stream_write_uint64(output, FILE_TIME_SYSTEM_TO_RDP(st.st_atime)); /* LastAccessTime */
-			stream_write_uint64(output, FILE_TIME_SYSTEM_TO_RDP(st.st_mtime)); /* LastWriteTime */
-			stream_write_uint64(output, FILE_TIME_SYSTEM_TO_RDP(st.st_ctime)); /* ChangeTime */
-			stream_write_uint64(output, st.st_size); /* EndOfFile */
-			stream_write_uint64(output, st.st_size); /* AllocationSize */
-			stream_write_uint32(output, FILE_ATTR_SYSTEM_TO_RDP(file, st)); /* FileAttributes */
-			stream_write_uint32(output, len); /* FileNameLength */
-			stream_write(output, ent_path, len);
-			break;
+		size = disk_file_dirent_size(FsInformationClass, &file->dirents[i]);
 
-		case FileFullDirectoryInformation:
-			/* http://msdn.microsoft.com/en-us/library/cc232068.aspx */
-			stream_write_uint32(output, 68 + len); /* Length */
-			stream_check_size(output, 68 + len);
-			stream_write_uint32(output, 0); /* NextEntryOffset */
-			stream_write_uint32(output, 0); /* FileIndex */
-			stream_write_uint64(output, FILE_TIME_SYSTEM_TO_RDP(st.st_mtime)); /* CreationTime */
-			stream_write_uint64(output, FILE_TIME_SYSTEM_TO_RDP(st.st_atime)); /* LastAccessTime */
-			stream_write_uint64(output, FILE_TIME_SYSTEM_TO_RDP(st.st_mtime)); /* LastWriteTime */
-			stream_write_uint64(output, FILE_TIME_SYSTEM_TO_RDP(st.st_ctime)); /* ChangeTime */
-			stream_write_uint64(output, st.st_size); /* EndOfFile */
-			stream_write_uint64(output, st.st_size); /* AllocationSize */
-			stream_write_uint32(output, FILE_ATTR_SYSTEM_TO_RDP(file, st)); /* FileAttributes */
-			stream_write_uint32(output, len); /* FileNameLength */
-			stream_write_uint32(output, 0); /* EaSize */
-			stream_write(output, ent_path, len);
+		if (count > 0 && ((total + 7) & ~7) + size > DISK_QUERY_DIRECTORY_SIZE)
 			break;
 
-		case FileBothDirectoryInformation:
-			/* http://msdn.microsoft.com/en-us/library/cc232095.aspx */
-			stream_write_uint32(output, 93 + len); /* Length */
-			stream_check_size(output, 93 + len);
-			stream_write_uint32(output, 0); /* NextEntryOffset */
-			stream_write_uint32(output, 0); /* FileIndex */
-			stream_write_uint64(output, FILE_TIME_SYSTEM_TO_RDP(st.st_mtime)); /* CreationTime */
-			stream_write_uint64(output, FILE_TIME_SYSTEM_TO_RDP(st.st_atime)); /* LastAccessTime */
-			stream_write_uint64(output, FILE_TIME_SYSTEM_TO_RDP(st.st_mtime)); /* LastWriteTime */
-			stream_write_uint64(output, FILE_TIME_SYSTEM_TO_RDP(st.st_ctime)); /* ChangeTime */
-			stream_write_uint64(output, st.st_size); /* EndOfFile */
-			stream_write_uint64(output, st.st_size); /* AllocationSize */
-			stream_write_uint32(output, FILE_ATTR_SYSTEM_TO_RDP(file, st)); /* FileAttributes */
-			stream_write_uint32(output, len); /* FileNameLength */
-			stream_write_uint32(output, 0); /* EaSize */
-			stream_write_uint8(output, 0); /* ShortNameLength */
-			/* Reserved(1), MUST NOT be added! */
-			stream_write_zero(output, 24); /* ShortName */
-			stream_write(output, ent_path, len);
-			break;
+		total = (count > 0 ? ((total + 7) & ~7) : 0) + size;
+		count++;
+	}
 
-		case FileNamesInformation:
-			/* http://msdn.microsoft.com/en-us/library/cc232077.aspx */
-			stream_write_uint32(output, 12 + len); /* Length */
-			stream_check_size(output, 12 + len);
-			stream_write_uint32(output, 0); /* NextEntryOffset */
-			stream_write_uint32(output, 0); /* FileIndex */
-			stream_write_uint32(output, len); /* FileNameLength */
-			stream_write(output, ent_path, len);
-			break;
+	stream_write_uint32(output, total); /* Length */
+	stream_check_size(output, total);
 
-		default:
-			stream_write_uint32(output, 0); /* Length */
-			stream_write_uint8(output, 0); /* Padding */
-			DEBUG_WARN("invalid FsInformationClass %d", FsInformationClass);
-			ret = false;
-			break;
-	}
+	for (i = 0; i < count; i++)
+	{
+		dirent = &file->dirents[file->next_dirent++];
+		size = disk_file_dirent_size(FsInformationClass, dirent);
+		length = (i < count - 1) ? ((size + 7) & ~7) : 0;
 
-	xfree(ent_path);
+		disk_file_write_dirent(FsInformationClass, dirent, length, output);
 
-	return ret;
+		if (length > 0)
+			stream_write_zero(output, length - size); /* Padding */
+	}
+
+	return true;
 }
@@ -24,6 +24,19 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <dirent.h>
+#include <freerdp/utils/unicode.h>
+
+#define DISK_READAHEAD_SIZE	(256 * 1024)
+#define DISK_QUERY_DIRECTORY_SIZE	4096
+
+typedef struct _DISK_DIRENT DISK_DIRENT;
+struct _DISK_DIRENT
+{
+	struct stat st;
+	boolean hidden;
+	char* name;
+	size_t length;
+};
 
 typedef struct _DISK_FILE DISK_FILE;
 struct _DISK_FILE
@@ -38,18 +51,33 @@ struct _DISK_FILE
 	char* filename;
 	char* pattern;
 	boolean delete_pending;
+
+	DISK_DIRENT* dirents;
+	int num_dirents;
+	int next_dirent;
+
+	uint64 next_offset;
+	uint8* readahead;
+	uint64 readahead_offset;
+	uint32 readahead_length;
+	uint32 readahead_generation;
+
+	/* owned by disk_main.c: FileId bucket chain and IRP ordering */
+	DISK_FILE* next;
+	IRP* active;
+	LIST* pending;
 };
 
 DISK_FILE* disk_file_new(const char* base_path, const char* path, uint32 id,
 	uint32 DesiredAccess, uint32 CreateDisposition, uint32 CreateOptions);
 void disk_file_free(DISK_FILE* file);
 
-boolean disk_file_seek(DISK_FILE* file, uint64 Offset);
-boolean disk_file_read(DISK_FILE* file, uint8* buffer, uint32* Length);
-boolean disk_file_write(DISK_FILE* file, uint8* buffer, uint32 Length);
+void disk_file_check_generation(DISK_FILE* file, uint32 generation);
+boolean disk_file_read(DISK_FILE* file, uint8* buffer, uint32* Length, uint64 Offset);
+boolean disk_file_write(DISK_FILE* file, uint8* buffer, uint32 Length, uint64 Offset);
 boolean disk_file_query_information(DISK_FILE* file, uint32 FsInformationClass, STREAM* output);
 boolean disk_file_set_information(DISK_FILE* file, uint32 FsInformationClass, uint32 Length, STREAM* input);
 boolean disk_file_query_directory(DISK_FILE* file, uint32 FsInformationClass, uint8 InitialQuery,
-	const char* path, STREAM* output);
+	const char* path, STREAM* output, UNICONV* uniconv);
 
 #endif /* __DISK_FILE_H */
@@ -27,6 +27,7 @@
 #include <freerdp/utils/stream.h>
 #include <freerdp/utils/unicode.h>
 #include <freerdp/utils/list.h>
+#include <freerdp/utils/mutex.h>
 #include <freerdp/utils/thread.h>
 #include <freerdp/utils/svc_plugin.h>
 
@@ -34,16 +35,45 @@
 #include "rdpdr_types.h"
 #include "disk_file.h"
 
+/**
+ * IRPs are processed by a small pool of workers. Requests on the same FileId
+ * are serialized through the file's pending list, so a bulk copy on one handle
+ * occupies one worker while the others keep serving the remaining handles.
+ */
+
+#define DISK_WORKER_THREADS	4
+#define DISK_FILE_BUCKETS	64
+
+/* a read is answered in a single response, a larger request is served in part */
+#define DISK_MAX_READ_LENGTH	(1024 * 1024)
+
 typedef struct _DISK_DEVICE DISK_DEVICE;
+
+typedef struct _DISK_WORKER DISK_WORKER;
+struct _DISK_WORKER
+{
+	DISK_DEVICE* disk;
+	freerdp_thread* thread;
+	UNICONV* uniconv;
+	boolean idle;
+};
+
 struct _DISK_DEVICE
 {
 	DEVICE device;
 
 	char* path;
-	LIST* files;
+	uint32 id_sequence;
+	uint32 generation;
+	DISK_FILE* files[DISK_FILE_BUCKETS];
 
+	freerdp_mutex mutex;
 	LIST* irp_list;
-	freerdp_thread* thread;
+	DISK_WORKER workers[DISK_WORKER_THREADS];
+
+	LIST* completed;
+	boolean flushing;
+	pcIRPResponse Complete;
 };
 
 
@@ -80,28 +110,55 @@ disk_map_posix_err(int fs_errno)
 	return rc;
 }
 
-static DISK_FILE* disk_get_file_by_id(DISK_DEVICE* disk, uint32 id)
+#define DISK_FILE_BUCKET(_id) ((_id) % DISK_FILE_BUCKETS)
+
+/* must be called with the disk mutex held */
+static DISK_FILE* disk_find_file(DISK_DEVICE* disk, uint32 id)
 {
-	LIST_ITEM* item;
 	DISK_FILE* file;
 
-	for (item = disk->files->head; item; item = item->next)
+	for (file = disk->files[DISK_FILE_BUCKET(id)]; file; file = file->next)
 	{
-		file = (DISK_FILE*)item->data;
 		if (file->id == id)
 			return file;
 	}
 	return NULL;
 }
 
-static void disk_process_irp_create(DISK_DEVICE* disk, IRP* irp)
+static DISK_FILE* disk_get_file_by_id(DISK_DEVICE* disk, uint32 id)
+{
+	DISK_FILE* file;
+
+	freerdp_mutex_lock(disk->mutex);
+	file = disk_find_file(disk, id);
+	freerdp_mutex_unlock(disk->mutex);
+
+	return file;
+}
+
+/* must be called with the disk mutex held */
+static void disk_wake_worker(DISK_DEVICE* disk)
+{
+	int i;
+
+	for (i = 0; i < DISK_WORKER_THREADS; i++)
+	{
+		if (disk->workers[i].idle)
+		{
+			disk->workers[i].idle = false;
+			freerdp_thread_signal(disk->workers[i].thread);
+			break;
+		}
+	}
+}
+
+static void disk_process_irp_create(DISK_DEVICE* disk, IRP* irp, UNICONV* uniconv)
 {
 	DISK_FILE* file;
 	uint32 DesiredAccess;
 	uint32 CreateDisposition;
 	uint32 CreateOptions;
 	uint32 PathLength;
-	UNICONV* uniconv;
 	char* path;
 	uint32 FileId;
 	uint8 Information;
@@ -112,11 +169,12 @@ static void disk_process_irp_create(DISK_DEVICE* disk, IRP* irp)
 	stream_read_uint32(irp->input, CreateOptions);
 	stream_read_uint32(irp->input, PathLength);
 
-	uniconv = freerdp_uniconv_new();
 	path = freerdp_uniconv_in(uniconv, stream_get_tail(irp->input), PathLength);
-	freerdp_uniconv_free(uniconv);
 
-	FileId = irp->devman->id_sequence++;
+	freerdp_mutex_lock(disk->mutex);
+	FileId = disk->id_sequence++;
+	freerdp_mutex_unlock(disk->mutex);
+
 	file = disk_file_new(disk->path, path, FileId,
 		DesiredAccess, CreateDisposition, CreateOptions);
 
@@ -140,7 +198,12 @@ static void disk_process_irp_create(DISK_DEVICE* disk, IRP* irp)
 	}
 	else
 	{
-		list_enqueue(disk->files, file);
+		file->pending = list_new();
+
+		freerdp_mutex_lock(disk->mutex);
+		file->next = disk->files[DISK_FILE_BUCKET(FileId)];
+		disk->files[DISK_FILE_BUCKET(FileId)] = file;
+		freerdp_mutex_unlock(disk->mutex);
 
 		switch (CreateDisposition)
 		{
@@ -174,8 +237,32 @@ static void disk_process_irp_create(DISK_DEVICE* disk, IRP* irp)
 static void disk_process_irp_close(DISK_DEVICE* disk, IRP* irp)
 {
 	DISK_FILE* file;
+	DISK_FILE** link;
+	IRP* pending;
 
-	file = disk_get_file_by_id(disk, irp->FileId);
+	freerdp_mutex_lock(disk->mutex);
+
+	for (link = &disk->files[DISK_FILE_BUCKET(irp->FileId)]; *link; link = &(*link)->next)
+	{
+		if ((*link)->id == irp->FileId)
+			break;
+	}
+
+	file = *link;
+
+	if (file != NULL)
+	{
+		*link = file->next;
+
+		/* anything queued behind the close now refers to an invalid FileId */
+		while ((pending = (IRP*) list_dequeue(file->pending)) != NULL)
+		{
+			list_enqueue(disk->irp_list, pending);
+			disk_wake_worker(disk);
+		}
+	}
+
+	freerdp_mutex_unlock(disk->mutex);
 
 	if (file == NULL)
 	{
@@ -187,7 +274,7 @@ static void disk_process_irp_close(DISK_DEVICE* disk, IRP* irp)
 	{
 		DEBUG_SVC("%s(%d) closed.", file->fullpath, file->id);
 
-		list_remove(disk->files, file);
+		list_free(file->pending);
 		disk_file_free(file);
 	}
 
@@ -201,12 +288,24 @@ static void disk_process_irp_read(DISK_DEVICE* disk, IRP* irp)
 	DISK_FILE* file;
 	uint32 Length;
 	uint64 Offset;
-	uint8* buffer = NULL;
+	uint32 generation;
+	int pos;
 
 	stream_read_uint32(irp->input, Length);
 	stream_read_uint64(irp->input, Offset);
 
-	file = disk_get_file_by_id(disk, irp->FileId);
+	freerdp_mutex_lock(disk->mutex);
+	file = disk_find_file(disk, irp->FileId);
+	generation = disk->generation;
+	freerdp_mutex_unlock(disk->mutex);
+
+	if (Length > DISK_MAX_READ_LENGTH)
+		Length = DISK_MAX_READ_LENGTH;
+
+	/* read straight into the response, after the Length field */
+	pos = stream_get_pos(irp->output);
+	stream_check_size(irp->output, 4 + Length);
+	stream_seek(irp->output, 4);
 
 	if (file == NULL)
 	{
@@ -215,21 +314,13 @@ static void disk_process_irp_read(DISK_DEVICE* disk, IRP* irp)
 
 		DEBUG_WARN("FileId %d not valid.", irp->FileId);
 	}
-	else if (!disk_file_seek(file, Offset))
-	{
-		irp->IoStatus = STATUS_UNSUCCESSFUL;
-		Length = 0;
-
-		DEBUG_WARN("seek %s(%d) failed.", file->fullpath, file->id);
-	}
 	else
 	{
-		buffer = (uint8*)xmalloc(Length);
-		if (!disk_file_read(file, buffer, &Length))
+		disk_file_check_generation(file, generation);
+
+		if (!disk_file_read(file, stream_get_tail(irp->output), &Length, Offset))
 		{
 			irp->IoStatus = STATUS_UNSUCCESSFUL;
-			xfree(buffer);
-			buffer = NULL;
 			Length = 0;
 
 			DEBUG_WARN("read %s(%d) failed.", file->fullpath, file->id);
@@ -240,17 +331,21 @@ static void disk_process_irp_read(DISK_DEVICE* disk, IRP* irp)
 		}
 	}
 
+	stream_set_pos(irp->output, pos);
 	stream_write_uint32(irp->output, Length);
-	if (Length > 0)
-	{
-		stream_check_size(irp->output, Length);
-		stream_write(irp->output, buffer, Length);
-	}
-	xfree(buffer);
+	stream_seek(irp->output, Length);
 
 	irp->Complete(irp);
 }
 
+/* writes through any handle invalidate the read-ahead windows of all others */
+static void disk_bump_generation(DISK_DEVICE* disk)
+{
+	freerdp_mutex_lock(disk->mutex);
+	disk->generation++;
+	freerdp_mutex_unlock(disk->mutex);
+}
+
 static void disk_process_irp_write(DISK_DEVICE* disk, IRP* irp)
 {
 	DISK_FILE* file;
@@ -270,14 +365,7 @@ static void disk_process_irp_write(DISK_DEVICE* disk, IRP* irp)
 
 		DEBUG_WARN("FileId %d not valid.", irp->FileId);
 	}
-	else if (!disk_file_seek(file, Offset))
-	{
-		irp->IoStatus = STATUS_UNSUCCESSFUL;
-		Length = 0;
-
-		DEBUG_WARN("seek %s(%d) failed.", file->fullpath, file->id);
-	}
-	else if (!disk_file_write(file, stream_get_tail(irp->input), Length))
+	else if (!disk_file_write(file, stream_get_tail(irp->input), Length, Offset))
 	{
 		irp->IoStatus = STATUS_UNSUCCESSFUL;
 		Length = 0;
@@ -289,6 +377,9 @@ static void disk_process_irp_write(DISK_DEVICE* disk, IRP* irp)
 		DEBUG_SVC("write %llu-%llu to %s(%d).", Offset, Offset + Length, file->fullpath, file->id);
 	}
 
+	if (file != NULL)
+		disk_bump_generation(disk);
+
 	stream_write_uint32(irp->output, Length);
 	stream_write_uint8(irp->output, 0); /* Padding */
 
@@ -353,6 +444,9 @@ static void disk_process_irp_set_information(DISK_DEVICE* disk, IRP* irp)
 		DEBUG_SVC("FsInformationClass %d on %s(%d) ok.", FsInformationClass, file->fullpath, file->id);
 	}
 
+	if (file != NULL)
+		disk_bump_generation(disk);
+
 	stream_write_uint32(irp->output, Length);
 
 	irp->Complete(irp);
@@ -431,13 +525,12 @@ static void disk_process_irp_query_volume_information(DISK_DEVICE* disk, IRP* ir
 	irp->Complete(irp);
 }
 
-static void disk_process_irp_query_directory(DISK_DEVICE* disk, IRP* irp)
+static void disk_process_irp_query_directory(DISK_DEVICE* disk, IRP* irp, UNICONV* uniconv)
 {
 	DISK_FILE* file;
 	uint32 FsInformationClass;
 	uint8 InitialQuery;
 	uint32 PathLength;
-	UNICONV* uniconv;
 	char* path;
 
 	stream_read_uint32(irp->input, FsInformationClass);
@@ -445,9 +538,7 @@ static void disk_process_irp_query_directory(DISK_DEVICE* disk, IRP* irp)
 	stream_read_uint32(irp->input, PathLength);
 	stream_seek(irp->input, 23); /* Padding */
 
-	uniconv = freerdp_uniconv_new();
 	path = freerdp_uniconv_in(uniconv, stream_get_tail(irp->input), PathLength);
-	freerdp_uniconv_free(uniconv);
 
 	file = disk_get_file_by_id(disk, irp->FileId);
 
@@ -457,7 +548,7 @@ static void disk_process_irp_query_directory(DISK_DEVICE* disk, IRP* irp)
 		stream_write_uint32(irp->output, 0); /* Length */
 		DEBUG_WARN("FileId %d not valid.", irp->FileId);
 	}
-	else if (!disk_file_query_directory(file, FsInformationClass, InitialQuery, path, irp->output))
+	else if (!disk_file_query_directory(file, FsInformationClass, InitialQuery, path, irp->output, uniconv))
 	{
 		irp->IoStatus = STATUS_NO_MORE_FILES;
 	}
@@ -467,12 +558,12 @@ static void disk_process_irp_query_directory(DISK_DEVICE* disk, IRP* irp)
 	irp->Complete(irp);
 }
 
-static void disk_process_irp_directory_control(DISK_DEVICE* disk, IRP* irp)
+static void disk_process_irp_directory_control(DISK_DEVICE* disk, IRP* irp, UNICONV* uniconv)
 {
 	switch (irp->MinorFunction)
 	{
 		case IRP_MN_QUERY_DIRECTORY:
-			disk_process_irp_query_directory(disk, irp);
+			disk_process_irp_query_directory(disk, irp, uniconv);
 			break;
 
 		case IRP_MN_NOTIFY_CHANGE_DIRECTORY: /* TODO */
@@ -494,12 +585,12 @@ static void disk_process_irp_device_control(DISK_DEVICE* disk, IRP* irp)
 	irp->Complete(irp);
 }
 
-static void disk_process_irp(DISK_DEVICE* disk, IRP* irp)
+static void disk_process_irp(DISK_DEVICE* disk, IRP* irp, UNICONV* uniconv)
 {
 	switch (irp->MajorFunction)
 	{
 		case IRP_MJ_CREATE:
-			disk_process_irp_create(disk, irp);
+			disk_process_irp_create(disk, irp, uniconv);
 			break;
 
 		case IRP_MJ_CLOSE:
@@ -527,7 +618,7 @@ static void disk_process_irp(DISK_DEVICE* disk, IRP* irp)
 			break;
 
 		case IRP_MJ_DIRECTORY_CONTROL:
-			disk_process_irp_directory_control(disk, irp);
+			disk_process_irp_directory_control(disk, irp, uniconv);
 			break;
 
 		case IRP_MJ_DEVICE_CONTROL:
@@ -542,42 +633,119 @@ static void disk_process_irp(DISK_DEVICE* disk, IRP* irp)
 	}
 }
 
-static void disk_process_irp_list(DISK_DEVICE* disk)
+/**
+ * Completions are collected from all workers and sent by whichever worker finds
+ * no flush in progress, so a burst of completions reaches the channel in one
+ * pass instead of each worker contending for it separately.
+ */
+
+static void disk_irp_complete(IRP* irp)
+{
+	DISK_DEVICE* disk = (DISK_DEVICE*) irp->device;
+	LIST* batch;
+
+	freerdp_mutex_lock(disk->mutex);
+	list_enqueue(disk->completed, irp);
+
+	if (disk->flushing)
+	{
+		freerdp_mutex_unlock(disk->mutex);
+		return;
+	}
+
+	disk->flushing = true;
+
+	while (list_size(disk->completed) > 0)
+	{
+		batch = disk->completed;
+		disk->completed = list_new();
+		freerdp_mutex_unlock(disk->mutex);
+
+		while ((irp = (IRP*) list_dequeue(batch)) != NULL)
+			disk->Complete(irp);
+		list_free(batch);
+
+		freerdp_mutex_lock(disk->mutex);
+	}
+
+	disk->flushing = false;
+	freerdp_mutex_unlock(disk->mutex);
+}
+
+static void disk_process_irp_list(DISK_WORKER* worker)
 {
+	DISK_DEVICE* disk = worker->disk;
+	DISK_FILE* file;
+	boolean owner;
+	uint32 FileId;
 	IRP* irp;
 
 	while (1)
 	{
-		if (freerdp_thread_is_stopped(disk->thread))
+		if (freerdp_thread_is_stopped(worker->thread))
 			break;
 
-		freerdp_thread_lock(disk->thread);
-		irp = (IRP*)list_dequeue(disk->irp_list);
-		freerdp_thread_unlock(disk->thread);
+		freerdp_mutex_lock(disk->mutex);
+		irp = (IRP*) list_dequeue(disk->irp_list);
 
 		if (irp == NULL)
+		{
+			worker->idle = true;
+			freerdp_mutex_unlock(disk->mutex);
 			break;
+		}
+
+		file = disk_find_file(disk, irp->FileId);
+		owner = (file != NULL && file->active == irp);
+		freerdp_mutex_unlock(disk->mutex);
+
+		/* keep draining the file's own queue to preserve request order */
+		while (irp != NULL)
+		{
+			FileId = irp->FileId;
+			disk_process_irp(disk, irp, worker->uniconv);
+
+			if (!owner)
+				break;
 
-		disk_process_irp(disk, irp);
+			freerdp_mutex_lock(disk->mutex);
+			file = disk_find_file(disk, FileId);
+			irp = NULL;
+
+			if (file != NULL)
+			{
+				irp = (IRP*) list_dequeue(file->pending);
+				file->active = irp;
+			}
+
+			freerdp_mutex_unlock(disk->mutex);
+
+			if (freerdp_thread_is_stopped(worker->thread))
+			{
+				if (irp != NULL)
+					irp->Discard(irp);
+				break;
+			}
+		}
 	}
 }
 
 static void* disk_thread_func(void* arg)
 {
-	DISK_DEVICE* disk = (DISK_DEVICE*)arg;
+	DISK_WORKER* worker = (DISK_WORKER*) arg;
 
 	while (1)
 	{
-		freerdp_thread_wait(disk->thread);
+		freerdp_thread_wait(worker->thread);
 
-		if (freerdp_thread_is_stopped(disk->thread))
+		if (freerdp_thread_is_stopped(worker->thread))
 			break;
 
-		freerdp_thread_reset(disk->thread);
-		disk_process_irp_list(disk);
+		freerdp_thread_reset(worker->thread);
+		disk_process_irp_list(worker);
 	}
 
-	freerdp_thread_quit(disk->thread);
+	freerdp_thread_quit(worker->thread);
 
 	return NULL;
 }
@@ -585,12 +753,30 @@ static void* disk_thread_func(void* arg)
 static void disk_irp_request(DEVICE* device, IRP* irp)
 {
 	DISK_DEVICE* disk = (DISK_DEVICE*)device;
+	DISK_FILE* file;
+
+	freerdp_mutex_lock(disk->mutex);
+
+	if (disk->Complete == NULL)
+		disk->Complete = irp->Complete;
+	irp->Complete = disk_irp_complete;
 
-	freerdp_thread_lock(disk->thread);
-	list_enqueue(disk->irp_list, irp);
-	freerdp_thread_unlock(disk->thread);
+	file = disk_find_file(disk, irp->FileId);
 
-	freerdp_thread_signal(disk->thread);
+	if (file != NULL && file->active != NULL)
+	{
+		list_enqueue(file->pending, irp);
+	}
+	else
+	{
+		if (file != NULL)
+			file->active = irp;
+
+		list_enqueue(disk->irp_list, irp);
+		disk_wake_worker(disk);
+	}
+
+	freerdp_mutex_unlock(disk->mutex);
 }
 
 static void disk_free(DEVICE* device)
@@ -598,17 +784,41 @@ static void disk_free(DEVICE* device)
 	DISK_DEVICE* disk = (DISK_DEVICE*)device;
 	IRP* irp;
 	DISK_FILE* file;
+	int i;
+
+	for (i = 0; i < DISK_WORKER_THREADS; i++)
+		wait_obj_set(disk->workers[i].thread->signals[0]);
+
+	for (i = 0; i < DISK_WORKER_THREADS; i++)
+	{
+		freerdp_thread_stop(disk->workers[i].thread);
+		freerdp_thread_free(disk->workers[i].thread);
+		freerdp_uniconv_free(disk->workers[i].uniconv);
+	}
 
-	freerdp_thread_stop(disk->thread);
-	freerdp_thread_free(disk->thread);
-	
 	while ((irp = (IRP*)list_dequeue(disk->irp_list)) != NULL)
 		irp->Discard(irp);
 	list_free(disk->irp_list);
 
-	while ((file = (DISK_FILE*)list_dequeue(disk->files)) != NULL)
-		disk_file_free(file);
-	list_free(disk->files);
+	while ((irp = (IRP*)list_dequeue(disk->completed)) != NULL)
+		irp->Discard(irp);
+	list_free(disk->completed);
+
+	for (i = 0; i < DISK_FILE_BUCKETS; i++)
+	{
+		while ((file = disk->files[i]) != NULL)
+		{
+			disk->files[i] = file->next;
+
+			while ((irp = (IRP*)list_dequeue(file->pending)) != NULL)
+				irp->Discard(irp);
+			list_free(file->pending);
+
+			disk_file_free(file);
+		}
+	}
+
+	freerdp_mutex_free(disk->mutex);
 	xfree(disk);
 }
 
@@ -637,14 +847,24 @@ int DeviceServiceEntry(PDEVICE_SERVICE_ENTRY_POINTS pEntryPoints)
 			stream_write_uint8(disk->device.data, name[i] < 0 ? '_' : name[i]);
 
 		disk->path = path;
-		disk->files = list_new();
+		disk->id_sequence = 1;
 
+		disk->mutex = freerdp_mutex_new();
 		disk->irp_list = list_new();
-		disk->thread = freerdp_thread_new();
+		disk->completed = list_new();
+
+		for (i = 0; i < DISK_WORKER_THREADS; i++)
+		{
+			disk->workers[i].disk = disk;
+			disk->workers[i].thread = freerdp_thread_new();
+			disk->workers[i].uniconv = freerdp_uniconv_new();
+			disk->workers[i].idle = true;
+		}
 
 		pEntryPoints->RegisterDevice(pEntryPoints->devman, (DEVICE*)disk);
 
-		freerdp_thread_start(disk->thread, disk_thread_func, disk);
+		for (i = 0; i < DISK_WORKER_THREADS; i++)
+			freerdp_thread_start(disk->workers[i].thread, disk_thread_func, &disk->workers[i]);
 	}
 
 	return 0;
@@ -46,6 +46,9 @@ struct rdpsnd_alsa_plugin
 	int block_size;
 	int latency;
 	ADPCM adpcm;
+	DSP_RESAMPLER* resampler;
+	uint8* resample_buffer;
+	int resample_buffer_size;
 };
 
 static void rdpsnd_alsa_set_params(rdpsndAlsaPlugin* alsa)
@@ -109,6 +112,20 @@ static void rdpsnd_alsa_set_params(rdpsndAlsaPlugin* alsa)
 		DEBUG_SVC("actual rate %d / channel %d is different from source rate %d / channel %d, resampling required.",
 			alsa->actual_rate, alsa->actual_channels, alsa->source_rate, alsa->source_channels);
 	}
+
+	if (alsa->resampler != NULL)
+	{
+		dsp_resampler_free(alsa->resampler);
+		alsa->resampler = NULL;
+	}
+
+	if ((alsa->actual_rate != alsa->source_rate) ||
+		(alsa->actual_channels != alsa->source_channels))
+	{
+		alsa->resampler = dsp_resampler_new(alsa->bytes_per_channel,
+			alsa->source_channels, alsa->source_rate,
+			alsa->actual_channels, alsa->actual_rate);
+	}
 }
 
 static void rdpsnd_alsa_set_format(rdpsndDevicePlugin* device, rdpsndFormat* format, int latency)
@@ -192,6 +209,9 @@ static void rdpsnd_alsa_free(rdpsndDevicePlugin* device)
 	rdpsndAlsaPlugin* alsa = (rdpsndAlsaPlugin*)device;
 
 	rdpsnd_alsa_close(device);
+	if (alsa->resampler != NULL)
+		dsp_resampler_free(alsa->resampler);
+	xfree(alsa->resample_buffer);
 	xfree(alsa->device_name);
 	xfree(alsa);
 }
@@ -232,7 +252,6 @@ static void rdpsnd_alsa_play(rdpsndDevicePlugin* device, uint8* data, int size)
 	uint8* decoded_data;
 	int decoded_size;
 	uint8* src;
-	uint8* resampled_data;
 	int len;
 	int error;
 	int frames;
@@ -265,20 +284,22 @@ static void rdpsnd_alsa_play(rdpsndDevicePlugin* device, uint8* data, int size)
 		return;
 	}
 
-	if ((alsa->source_rate == alsa->actual_rate) &&
-		(alsa->source_channels == alsa->actual_channels))
-	{
-		resampled_data = NULL;
-	}
-	else
+	if (alsa->resampler != NULL)
 	{
-		resampled_data = dsp_resample(src, alsa->bytes_per_channel,
-			alsa->source_channels, alsa->source_rate, size / sbytes_per_frame,
-			alsa->actual_channels, alsa->actual_rate, &frames);
+		frames = dsp_resampler_get_max_frames(alsa->resampler, size / sbytes_per_frame);
+		if (frames * rbytes_per_frame > alsa->resample_buffer_size)
+		{
+			xfree(alsa->resample_buffer);
+			alsa->resample_buffer_size = frames * rbytes_per_frame;
+			alsa->resample_buffer = (uint8*) xmalloc(alsa->resample_buffer_size);
+		}
+
+		frames = dsp_resampler_process(alsa->resampler, src, size / sbytes_per_frame,
+			alsa->resample_buffer, frames);
 		DEBUG_SVC("resampled %d frames at %d to %d frames at %d",
 			size / sbytes_per_frame, alsa->source_rate, frames, alsa->actual_rate);
 		size = frames * rbytes_per_frame;
-		src = resampled_data;
+		src = alsa->resample_buffer;
 	}
 
 	pindex = src;
@@ -304,12 +325,24 @@ static void rdpsnd_alsa_play(rdpsndDevicePlugin* device, uint8* data, int size)
 		pindex += error * rbytes_per_frame;
 	}
 
-	if (resampled_data)
-		xfree(resampled_data);
 	if (decoded_data)
 		xfree(decoded_data);
 }
 
+static uint32 rdpsnd_alsa_get_latency(rdpsndDevicePlugin* device)
+{
+	rdpsndAlsaPlugin* alsa = (rdpsndAlsaPlugin*)device;
+	snd_pcm_sframes_t frames = 0;
+
+	if (alsa->out_handle == 0 || alsa->actual_rate == 0)
+		return 0;
+
+	if (snd_pcm_delay(alsa->out_handle, &frames) < 0 || frames < 0)
+		return 0;
+
+	return (uint32) ((uint64) frames * 1000 / alsa->actual_rate);
+}
+
 static void rdpsnd_alsa_start(rdpsndDevicePlugin* device)
 {
 	rdpsndAlsaPlugin* alsa = (rdpsndAlsaPlugin*)device;
@@ -333,6 +366,7 @@ int FreeRDPRdpsndDeviceEntry(PFREERDP_RDPSND_DEVICE_ENTRY_POINTS pEntryPoints)
 	alsa->device.SetVolume = rdpsnd_alsa_set_volume;
 	alsa->device.Play = rdpsnd_alsa_play;
 	alsa->device.Start = rdpsnd_alsa_start;
+	alsa->device.GetLatency = rdpsnd_alsa_get_latency;
 	alsa->device.Close = rdpsnd_alsa_close;
 	alsa->device.Free = rdpsnd_alsa_free;
 
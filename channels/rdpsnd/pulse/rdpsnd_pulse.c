@@ -445,6 +445,26 @@ static void rdpsnd_pulse_play(rdpsndDevicePlugin* device, uint8* data, int size)
 		xfree(decoded_data);
 }
 
+static uint32 rdpsnd_pulse_get_latency(rdpsndDevicePlugin* device)
+{
+	rdpsndPulsePlugin* pulse = (rdpsndPulsePlugin*)device;
+	pa_usec_t usec = 0;
+	int negative = 0;
+	int ret;
+
+	if (!pulse->stream)
+		return 0;
+
+	pa_threaded_mainloop_lock(pulse->mainloop);
+	ret = pa_stream_get_latency(pulse->stream, &usec, &negative);
+	pa_threaded_mainloop_unlock(pulse->mainloop);
+
+	if (ret != 0 || negative)
+		return 0;
+
+	return (uint32) (usec / 1000);
+}
+
 static void rdpsnd_pulse_start(rdpsndDevicePlugin* device)
 {
 	rdpsndPulsePlugin* pulse = (rdpsndPulsePlugin*)device;
@@ -468,6 +488,7 @@ int FreeRDPRdpsndDeviceEntry(PFREERDP_RDPSND_DEVICE_ENTRY_POINTS pEntryPoints)
 	pulse->device.SetVolume = rdpsnd_pulse_set_volume;
 	pulse->device.Play = rdpsnd_pulse_play;
 	pulse->device.Start = rdpsnd_pulse_start;
+	pulse->device.GetLatency = rdpsnd_pulse_get_latency;
 	pulse->device.Close = rdpsnd_pulse_close;
 	pulse->device.Free = rdpsnd_pulse_free;
 
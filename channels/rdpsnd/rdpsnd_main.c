@@ -30,6 +30,7 @@
 #include <freerdp/utils/memory.h>
 #include <freerdp/utils/stream.h>
 #include <freerdp/utils/list.h>
+#include <freerdp/utils/thread.h>
 #include <freerdp/utils/load_plugin.h>
 #include <freerdp/utils/svc_plugin.h>
 
@@ -56,30 +57,49 @@
 #define MEDIUM_QUALITY   0x0001
 #define HIGH_QUALITY     0x0002
 
+#define RDPSND_JITTER_MS        80
+#define RDPSND_CLOSE_DELAY_MS   2000
+
+/**
+ * Waves are handed to a playback thread, which owns the device. After each
+ * stream start or underrun it holds waves back until jitter_ms worth of
+ * audio is queued (or the oldest wave has waited that long), then plays
+ * them and confirms each one when the device reports it has been played out.
+ */
+
 struct rdpsnd_plugin
 {
 	rdpSvcPlugin plugin;
 
+	/* playback thread only */
 	LIST* data_out_list;
+	boolean is_open;
+	int current_format;
+	uint32 close_timestamp;
+	uint32 playout_timestamp;
+	boolean prebuffering;
+
+	/* protected by the thread lock */
+	freerdp_thread* thread;
+	LIST* wave_list;
+	uint32 queued_ms;
 
 	uint8 cBlockNo;
 	rdpsndFormat* supported_formats;
 	int n_supported_formats;
-	int current_format;
 
 	boolean expectingWave;
 	uint8 waveData[4];
 	uint16 waveDataSize;
+	uint16 wFormatNo;
 	uint32 wTimeStamp; /* server timestamp */
 	uint32 wave_timestamp; /* client timestamp */
 
-	boolean is_open;
-	uint32 close_timestamp;
-
 	uint16 fixed_format;
 	uint16 fixed_channel;
 	uint32 fixed_rate;
 	int latency;
+	int jitter;
 
 	/* Device plugin */
 	rdpsndDevicePlugin* device;
@@ -91,6 +111,17 @@ struct data_out_item
 	uint32 out_timestamp;
 };
 
+struct rdpsnd_wave
+{
+	STREAM* data; /* NULL for a close request */
+	rdpsndFormat format;
+	uint16 wFormatNo;
+	uint16 wTimeStamp;
+	uint8 cBlockNo;
+	uint32 arrival;
+	uint32 duration;
+};
+
 /* get time in milliseconds */
 static uint32 get_mstime(void)
 {
@@ -100,45 +131,227 @@ static uint32 get_mstime(void)
 	return (tp.tv_sec * 1000) + (tp.tv_usec / 1000);
 }
 
-/* process the linked list of data that has queued to be sent */
-static void rdpsnd_process_interval(rdpSvcPlugin* plugin)
+/* playing time of size bytes of audio in the given format, in milliseconds */
+static uint32 rdpsnd_wave_duration(rdpsndFormat* format, int size)
+{
+	uint64 samples;
+
+	if (format->nSamplesPerSec == 0 || format->nChannels == 0)
+		return 0;
+
+	if (format->wFormatTag == 0x11 && format->nBlockAlign > 4 * format->nChannels)
+	{
+		/* IMA ADPCM: one header sample plus two samples per byte per channel */
+		samples = (uint64) (size / format->nBlockAlign) *
+			((format->nBlockAlign - 4 * format->nChannels) * 2 / format->nChannels + 1);
+	}
+	else if (format->wBitsPerSample >= 8)
+	{
+		samples = size / (format->nChannels * (format->wBitsPerSample / 8));
+	}
+	else
+	{
+		return 0;
+	}
+
+	return (uint32) (samples * 1000 / format->nSamplesPerSec);
+}
+
+static void rdpsnd_free_wave(struct rdpsnd_wave* wave)
+{
+	if (wave->data)
+		stream_free(wave->data);
+	xfree(wave);
+}
+
+/* send the wave confirms whose playout time has come */
+static void rdpsnd_send_confirms(rdpsndPlugin* rdpsnd, uint32 cur_time)
 {
-	rdpsndPlugin* rdpsnd = (rdpsndPlugin*)plugin;
 	struct data_out_item* item;
-	uint32 cur_time;
 
 	while (rdpsnd->data_out_list->head)
 	{
 		item = (struct data_out_item*)rdpsnd->data_out_list->head->data;
-		cur_time = get_mstime();
-		if (cur_time <= item->out_timestamp)
+		if (cur_time < item->out_timestamp)
 			break;
 
 		item = (struct data_out_item*)list_dequeue(rdpsnd->data_out_list);
-		svc_plugin_send(plugin, item->data_out);
+		svc_plugin_send((rdpSvcPlugin*)rdpsnd, item->data_out);
 		xfree(item);
 
 		DEBUG_SVC("processed data_out");
 	}
+}
 
-	if (rdpsnd->is_open && rdpsnd->close_timestamp > 0)
+static void rdpsnd_play_wave(rdpsndPlugin* rdpsnd, struct rdpsnd_wave* wave)
+{
+	struct data_out_item* item;
+	uint32 latency;
+	uint32 cur_time;
+	uint16 wTimeStamp;
+
+	rdpsnd->close_timestamp = 0;
+
+	if (!rdpsnd->is_open)
+	{
+		rdpsnd->current_format = wave->wFormatNo;
+		rdpsnd->is_open = true;
+		if (rdpsnd->device)
+			IFCALL(rdpsnd->device->Open, rdpsnd->device, &wave->format, rdpsnd->latency);
+	}
+	else if (wave->wFormatNo != rdpsnd->current_format)
+	{
+		rdpsnd->current_format = wave->wFormatNo;
+		if (rdpsnd->device)
+			IFCALL(rdpsnd->device->SetFormat, rdpsnd->device, &wave->format, rdpsnd->latency);
+	}
+
+	if (rdpsnd->device)
+		IFCALL(rdpsnd->device->Play, rdpsnd->device, stream_get_head(wave->data), stream_get_size(wave->data));
+
+	/* without a latency report, assume the wave is the only thing queued */
+	latency = wave->duration;
+	if (rdpsnd->device && rdpsnd->device->GetLatency)
+		latency = rdpsnd->device->GetLatency(rdpsnd->device);
+
+	cur_time = get_mstime();
+	rdpsnd->playout_timestamp = cur_time + latency;
+	wTimeStamp = wave->wTimeStamp + (rdpsnd->playout_timestamp - wave->arrival);
+
+	DEBUG_SVC("duration_ms %u latency_ms %u total_ms %u", wave->duration, latency,
+		rdpsnd->playout_timestamp - wave->arrival);
+
+	item = xnew(struct data_out_item);
+	item->data_out = stream_new(8);
+	stream_write_uint8(item->data_out, SNDC_WAVECONFIRM);
+	stream_write_uint8(item->data_out, 0);
+	stream_write_uint16(item->data_out, 4);
+	stream_write_uint16(item->data_out, wTimeStamp);
+	stream_write_uint8(item->data_out, wave->cBlockNo); /* cConfirmedBlockNo */
+	stream_write_uint8(item->data_out, 0); /* bPad */
+	item->out_timestamp = rdpsnd->playout_timestamp;
+
+	list_enqueue(rdpsnd->data_out_list, item);
+}
+
+/* play what is due and return how long to sleep, -1 if until signaled */
+static int rdpsnd_process_playback(rdpsndPlugin* rdpsnd)
+{
+	struct rdpsnd_wave* wave;
+	struct data_out_item* item;
+	uint32 cur_time;
+	uint32 deadline;
+	int timeout;
+
+	deadline = 0;
+
+	while (1)
 	{
 		cur_time = get_mstime();
-		if (cur_time > rdpsnd->close_timestamp)
+		rdpsnd_send_confirms(rdpsnd, cur_time);
+
+		freerdp_thread_lock(rdpsnd->thread);
+		wave = (struct rdpsnd_wave*) list_peek(rdpsnd->wave_list);
+
+		if (wave == NULL)
 		{
-			if (rdpsnd->device)
-				IFCALL(rdpsnd->device->Close, rdpsnd->device);
-			rdpsnd->is_open = false;
-			rdpsnd->close_timestamp = 0;
+			freerdp_thread_unlock(rdpsnd->thread);
 
-			DEBUG_SVC("processed close");
+			/* the device ran dry, rebuild the jitter buffer before resuming */
+			if (cur_time >= rdpsnd->playout_timestamp)
+				rdpsnd->prebuffering = true;
+			break;
+		}
+
+		if (wave->data && rdpsnd->prebuffering)
+		{
+			if (rdpsnd->queued_ms < (uint32) rdpsnd->jitter &&
+				cur_time - wave->arrival < (uint32) rdpsnd->jitter)
+			{
+				freerdp_thread_unlock(rdpsnd->thread);
+				deadline = wave->arrival + rdpsnd->jitter;
+				break;
+			}
+			rdpsnd->prebuffering = false;
+		}
+
+		list_dequeue(rdpsnd->wave_list);
+		rdpsnd->queued_ms -= wave->duration;
+		freerdp_thread_unlock(rdpsnd->thread);
+
+		if (wave->data == NULL)
+		{
+			if (rdpsnd->device)
+				IFCALL(rdpsnd->device->Start, rdpsnd->device);
+			rdpsnd->close_timestamp = cur_time + RDPSND_CLOSE_DELAY_MS;
+		}
+		else
+		{
+			rdpsnd_play_wave(rdpsnd, wave);
 		}
+
+		rdpsnd_free_wave(wave);
+	}
+
+	if (rdpsnd->is_open && rdpsnd->close_timestamp > 0 && cur_time >= rdpsnd->close_timestamp)
+	{
+		if (rdpsnd->device)
+			IFCALL(rdpsnd->device->Close, rdpsnd->device);
+		rdpsnd->is_open = false;
+		rdpsnd->close_timestamp = 0;
+
+		DEBUG_SVC("processed close");
+	}
+
+	if (rdpsnd->data_out_list->head)
+	{
+		item = (struct data_out_item*)rdpsnd->data_out_list->head->data;
+		if (deadline == 0 || item->out_timestamp < deadline)
+			deadline = item->out_timestamp;
+	}
+
+	if (rdpsnd->is_open && rdpsnd->close_timestamp > 0)
+	{
+		if (deadline == 0 || rdpsnd->close_timestamp < deadline)
+			deadline = rdpsnd->close_timestamp;
 	}
 
-	if (rdpsnd->data_out_list->head == NULL && !rdpsnd->is_open)
+	if (deadline == 0)
+		return -1;
+
+	timeout = (int) (deadline - cur_time);
+	return MAX(timeout, 1);
+}
+
+static void* rdpsnd_thread_func(void* arg)
+{
+	rdpsndPlugin* rdpsnd = (rdpsndPlugin*)arg;
+	int timeout;
+
+	while (1)
 	{
-		rdpsnd->plugin.interval_ms = 0;
+		timeout = rdpsnd_process_playback(rdpsnd);
+		freerdp_thread_wait_timeout(rdpsnd->thread, timeout);
+
+		if (freerdp_thread_is_stopped(rdpsnd->thread))
+			break;
+
+		freerdp_thread_reset(rdpsnd->thread);
 	}
+
+	freerdp_thread_quit(rdpsnd->thread);
+
+	return NULL;
+}
+
+static void rdpsnd_queue_wave(rdpsndPlugin* rdpsnd, struct rdpsnd_wave* wave)
+{
+	freerdp_thread_lock(rdpsnd->thread);
+	list_enqueue(rdpsnd->wave_list, wave);
+	rdpsnd->queued_ms += wave->duration;
+	freerdp_thread_unlock(rdpsnd->thread);
+
+	freerdp_thread_signal(rdpsnd->thread);
 }
 
 static void rdpsnd_free_supported_formats(rdpsndPlugin* rdpsnd)
@@ -297,10 +510,8 @@ static void rdpsnd_process_message_training(rdpsndPlugin* rdpsnd, STREAM* data_i
 
 static void rdpsnd_process_message_wave_info(rdpsndPlugin* rdpsnd, STREAM* data_in, uint16 BodySize)
 {
-	uint16 wFormatNo;
-
 	stream_read_uint16(data_in, rdpsnd->wTimeStamp);
-	stream_read_uint16(data_in, wFormatNo);
+	stream_read_uint16(data_in, rdpsnd->wFormatNo);
 	stream_read_uint8(data_in, rdpsnd->cBlockNo);
 	stream_seek(data_in, 3); /* bPad */
 	stream_read(data_in, rdpsnd->waveData, 4);
@@ -308,72 +519,48 @@ static void rdpsnd_process_message_wave_info(rdpsndPlugin* rdpsnd, STREAM* data_
 	rdpsnd->wave_timestamp = get_mstime();
 	rdpsnd->expectingWave = true;
 
-	DEBUG_SVC("waveDataSize %d wFormatNo %d", rdpsnd->waveDataSize, wFormatNo);
-
-	rdpsnd->close_timestamp = 0;
-	if (!rdpsnd->is_open)
-	{
-		rdpsnd->current_format = wFormatNo;
-		rdpsnd->is_open = true;
-		if (rdpsnd->device)
-			IFCALL(rdpsnd->device->Open, rdpsnd->device, &rdpsnd->supported_formats[wFormatNo],
-				rdpsnd->latency);
-	}
-	else if (wFormatNo != rdpsnd->current_format)
-	{
-		rdpsnd->current_format = wFormatNo;
-		if (rdpsnd->device)
-			IFCALL(rdpsnd->device->SetFormat, rdpsnd->device, &rdpsnd->supported_formats[wFormatNo],
-				rdpsnd->latency);
-	}
+	DEBUG_SVC("waveDataSize %d wFormatNo %d", rdpsnd->waveDataSize, rdpsnd->wFormatNo);
 }
 
-/* header is not removed from data in this function */
+/* header is not removed from data in this function, which takes ownership of data_in */
 static void rdpsnd_process_message_wave(rdpsndPlugin* rdpsnd, STREAM* data_in)
 {
-	uint16 wTimeStamp;
-	uint32 delay_ms;
-	uint32 process_ms;
-	struct data_out_item* item;
+	struct rdpsnd_wave* wave;
 
 	rdpsnd->expectingWave = 0;
 	memcpy(stream_get_head(data_in), rdpsnd->waveData, 4);
 	if (stream_get_size(data_in) != rdpsnd->waveDataSize)
 	{
 		DEBUG_WARN("size error");
+		stream_free(data_in);
+		return;
+	}
+	if (rdpsnd->wFormatNo >= rdpsnd->n_supported_formats)
+	{
+		DEBUG_WARN("invalid wFormatNo %d", rdpsnd->wFormatNo);
+		stream_free(data_in);
 		return;
 	}
-	if (rdpsnd->device)
-		IFCALL(rdpsnd->device->Play, rdpsnd->device, stream_get_head(data_in), stream_get_size(data_in));
-
-	process_ms = get_mstime() - rdpsnd->wave_timestamp;
-	delay_ms = 250;
-	wTimeStamp = rdpsnd->wTimeStamp + delay_ms;
 
-	DEBUG_SVC("data_size %d delay_ms %u process_ms %u",
-		stream_get_size(data_in), delay_ms, process_ms);
+	wave = xnew(struct rdpsnd_wave);
+	wave->data = data_in;
+	wave->format = rdpsnd->supported_formats[rdpsnd->wFormatNo];
+	wave->format.data = NULL;
+	wave->wFormatNo = rdpsnd->wFormatNo;
+	wave->wTimeStamp = rdpsnd->wTimeStamp;
+	wave->cBlockNo = rdpsnd->cBlockNo;
+	wave->arrival = rdpsnd->wave_timestamp;
+	wave->duration = rdpsnd_wave_duration(&wave->format, stream_get_size(data_in));
 
-	item = xnew(struct data_out_item);
-	item->data_out = stream_new(8);
-	stream_write_uint8(item->data_out, SNDC_WAVECONFIRM);
-	stream_write_uint8(item->data_out, 0);
-	stream_write_uint16(item->data_out, 4);
-	stream_write_uint16(item->data_out, wTimeStamp);
-	stream_write_uint8(item->data_out, rdpsnd->cBlockNo); /* cConfirmedBlockNo */
-	stream_write_uint8(item->data_out, 0); /* bPad */
-	item->out_timestamp = rdpsnd->wave_timestamp + delay_ms;
+	DEBUG_SVC("data_size %d duration_ms %u", stream_get_size(data_in), wave->duration);
 
-	list_enqueue(rdpsnd->data_out_list, item);
-	rdpsnd->plugin.interval_ms = 10;
+	rdpsnd_queue_wave(rdpsnd, wave);
 }
 
 static void rdpsnd_process_message_close(rdpsndPlugin* rdpsnd)
 {
 	DEBUG_SVC("server closes.");
-	if (rdpsnd->device)
-		IFCALL(rdpsnd->device->Start, rdpsnd->device);
-	rdpsnd->close_timestamp = get_mstime() + 2000;
-	rdpsnd->plugin.interval_ms = 10;
+	rdpsnd_queue_wave(rdpsnd, xnew(struct rdpsnd_wave));
 }
 
 static void rdpsnd_process_message_setvolume(rdpsndPlugin* rdpsnd, STREAM* data_in)
@@ -395,7 +582,6 @@ static void rdpsnd_process_receive(rdpSvcPlugin* plugin, STREAM* data_in)
 	if (rdpsnd->expectingWave)
 	{
 		rdpsnd_process_message_wave(rdpsnd, data_in);
-		stream_free(data_in);
 		return;
 	}
 
@@ -490,6 +676,10 @@ static void rdpsnd_process_plugin_data(rdpsndPlugin* rdpsnd, RDP_PLUGIN_DATA* da
 	{
 		rdpsnd->latency = atoi(data->data[1]);
 	}
+	else if (strcmp((char*)data->data[0], "jitter") == 0)
+	{
+		rdpsnd->jitter = atoi(data->data[1]);
+	}
 	else
 	{
 		rdpsnd_load_device_plugin(rdpsnd, (char*)data->data[0], data);
@@ -504,10 +694,11 @@ static void rdpsnd_process_connect(rdpSvcPlugin* plugin)
 
 	DEBUG_SVC("connecting");
 
-	plugin->interval_callback = rdpsnd_process_interval;
-
 	rdpsnd->data_out_list = list_new();
+	rdpsnd->wave_list = list_new();
+	rdpsnd->prebuffering = true;
 	rdpsnd->latency = -1;
+	rdpsnd->jitter = RDPSND_JITTER_MS;
 
 	data = (RDP_PLUGIN_DATA*)plugin->channel_entry_points.pExtendedData;
 	while (data && data->size > 0)
@@ -532,6 +723,9 @@ static void rdpsnd_process_connect(rdpSvcPlugin* plugin)
 	{
 		DEBUG_WARN("no sound device.");
 	}
+
+	rdpsnd->thread = freerdp_thread_new();
+	freerdp_thread_start(rdpsnd->thread, rdpsnd_thread_func, rdpsnd);
 }
 
 static void rdpsnd_process_event(rdpSvcPlugin* plugin, RDP_EVENT* event)
@@ -543,10 +737,21 @@ static void rdpsnd_process_terminate(rdpSvcPlugin* plugin)
 {
 	rdpsndPlugin* rdpsnd = (rdpsndPlugin*)plugin;
 	struct data_out_item* item;
+	struct rdpsnd_wave* wave;
+
+	if (rdpsnd->thread)
+	{
+		freerdp_thread_stop(rdpsnd->thread);
+		freerdp_thread_free(rdpsnd->thread);
+	}
 
 	if (rdpsnd->device)
 		IFCALL(rdpsnd->device->Free, rdpsnd->device);
 
+	while ((wave = list_dequeue(rdpsnd->wave_list)) != NULL)
+		rdpsnd_free_wave(wave);
+	list_free(rdpsnd->wave_list);
+
 	while ((item = list_dequeue(rdpsnd->data_out_list)) != NULL)
 	{
 		stream_free(item->data_out);
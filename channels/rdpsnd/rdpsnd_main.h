@@ -42,6 +42,7 @@ typedef void (*pcSetFormat) (rdpsndDevicePlugin* device, rdpsndFormat* format, i
 typedef void (*pcSetVolume) (rdpsndDevicePlugin* device, uint32 value);
 typedef void (*pcPlay) (rdpsndDevicePlugin* device, uint8* data, int size);
 typedef void (*pcStart) (rdpsndDevicePlugin* device);
+typedef uint32 (*pcGetLatency) (rdpsndDevicePlugin* device);
 typedef void (*pcClose) (rdpsndDevicePlugin* device);
 typedef void (*pcFree) (rdpsndDevicePlugin* device);
 
@@ -53,6 +54,7 @@ struct rdpsnd_device_plugin
 	pcSetVolume SetVolume;
 	pcPlay Play;
 	pcStart Start;
+	pcGetLatency GetLatency; /* milliseconds of audio queued in the device, optional */
 	pcClose Close;
 	pcFree Free;
 };
@@ -64,6 +64,8 @@ void df_end_paint(rdpContext* context)
 	gdi = context->gdi;
 	dfi = ((dfContext*) context)->dfi;
 
+	gdi_flush(gdi);
+
 	if (gdi->primary->hdc->hwnd->invalid->null)
 		return;
 
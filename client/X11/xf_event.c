@@ -85,6 +85,9 @@ boolean xf_event_Expose(xfInfo* xfi, XEvent* event, boolean app)
 
 	if (app != true)
 	{
+		if (xfi->shm_primary)
+			xf_shm_image_read(xfi->primary_image, x, y, w, h);
+
 		XCopyArea(xfi->display, xfi->primary, xfi->window->handle, xfi->gc, x, y, w, h, x, y);
 	}
 	else
@@ -305,15 +305,8 @@ void xf_gdi_dstblt(rdpContext* context, DSTBLT_ORDER* dstblt)
 			dstblt->nWidth, dstblt->nHeight);
 
 	if (xfi->drawing == xfi->primary)
-	{
-		if (xfi->remote_app != true)
-		{
-			XFillRectangle(xfi->display, xfi->drawable, xfi->gc,
-				dstblt->nLeftRect, dstblt->nTopRect, dstblt->nWidth, dstblt->nHeight);
-		}
-
 		gdi_InvalidateRegion(xfi->hdc, dstblt->nLeftRect, dstblt->nTopRect, dstblt->nWidth, dstblt->nHeight);
-	}
+
 	XSetFunction(xfi->display, xfi->gc, GXcopy);
 }
 
@@ -378,17 +371,7 @@ void xf_gdi_patblt(rdpContext* context, PATBLT_ORDER* patblt)
 	}
 
 	if (xfi->drawing == xfi->primary)
-	{
-		XSetFunction(xfi->display, xfi->gc, GXcopy);
-
-		if (xfi->remote_app != true)
-		{
-			XCopyArea(xfi->display, xfi->primary, xfi->drawable, xfi->gc, patblt->nLeftRect, patblt->nTopRect,
-				patblt->nWidth, patblt->nHeight, patblt->nLeftRect, patblt->nTopRect);
-		}
-
 		gdi_InvalidateRegion(xfi->hdc, patblt->nLeftRect, patblt->nTopRect, patblt->nWidth, patblt->nHeight);
-	}
 
 	XSetFunction(xfi->display, xfi->gc, GXcopy);
 }
@@ -403,26 +386,7 @@ void xf_gdi_scrblt(rdpContext* context, SCRBLT_ORDER* scrblt)
 			scrblt->nWidth, scrblt->nHeight, scrblt->nLeftRect, scrblt->nTopRect);
 
 	if (xfi->drawing == xfi->primary)
-	{
-		if (xfi->remote_app != true)
-		{
-			if (xfi->unobscured)
-			{
-				XCopyArea(xfi->display, xfi->drawable, xfi->drawable, xfi->gc,
-						scrblt->nXSrc, scrblt->nYSrc, scrblt->nWidth, scrblt->nHeight,
-						scrblt->nLeftRect, scrblt->nTopRect);
-			}
-			else
-			{
-				XSetFunction(xfi->display, xfi->gc, GXcopy);
-				XCopyArea(xfi->display, xfi->primary, xfi->drawable, xfi->gc,
-						scrblt->nLeftRect, scrblt->nTopRect, scrblt->nWidth, scrblt->nHeight,
-						scrblt->nLeftRect, scrblt->nTopRect);
-			}
-		}
-
 		gdi_InvalidateRegion(xfi->hdc, scrblt->nLeftRect, scrblt->nTopRect, scrblt->nWidth, scrblt->nHeight);
-	}
 
 	XSetFunction(xfi->display, xfi->gc, GXcopy);
 }
@@ -444,12 +408,6 @@ void xf_gdi_opaque_rect(rdpContext* context, OPAQUE_RECT_ORDER* opaque_rect)
 
 	if (xfi->drawing == xfi->primary)
 	{
-		if (xfi->remote_app != true)
-		{
-			XFillRectangle(xfi->display, xfi->drawable, xfi->gc,
-				opaque_rect->nLeftRect, opaque_rect->nTopRect, opaque_rect->nWidth, opaque_rect->nHeight);
-		}
-
 		gdi_InvalidateRegion(xfi->hdc, opaque_rect->nLeftRect, opaque_rect->nTopRect,
 				opaque_rect->nWidth, opaque_rect->nHeight);
 	}
@@ -477,15 +435,7 @@ void xf_gdi_multi_opaque_rect(rdpContext* context, MULTI_OPAQUE_RECT_ORDER* mult
 				rectangle->width, rectangle->height);
 
 		if (xfi->drawing == xfi->primary)
-		{
-			if (xfi->remote_app != true)
-			{
-				XFillRectangle(xfi->display, xfi->drawable, xfi->gc,
-					rectangle->left, rectangle->top, rectangle->width, rectangle->height);
-			}
-
 			gdi_InvalidateRegion(xfi->hdc, rectangle->left, rectangle->top, rectangle->width, rectangle->height);
-		}
 	}
 }
 
@@ -505,13 +455,12 @@ void xf_gdi_line_to(rdpContext* context, LINE_TO_ORDER* line_to)
 
 	if (xfi->drawing == xfi->primary)
 	{
+		int x, y;
 		int width, height;
 
-		if (xfi->remote_app != true)
-		{
-			XDrawLine(xfi->display, xfi->drawable, xfi->gc,
-				line_to->nXStart, line_to->nYStart, line_to->nXEnd, line_to->nYEnd);
-		}
+		/* The window is only updated from the invalid region, so it has to cover both ends */
+		x = (line_to->nXStart < line_to->nXEnd) ? line_to->nXStart : line_to->nXEnd;
+		y = (line_to->nYStart < line_to->nYEnd) ? line_to->nYStart : line_to->nYEnd;
 
 		width = line_to->nXStart - line_to->nXEnd;
 		height = line_to->nYStart - line_to->nYEnd;
@@ -522,8 +471,7 @@ void xf_gdi_line_to(rdpContext* context, LINE_TO_ORDER* line_to)
 		if (height < 0)
 			height *= (-1);
 
-		gdi_InvalidateRegion(xfi->hdc, line_to->nXStart, line_to->nYStart, width, height);
-
+		gdi_InvalidateRegion(xfi->hdc, x, y, width + 1, height + 1);
 	}
 
 	XSetFunction(xfi->display, xfi->gc, GXcopy);
@@ -563,9 +511,6 @@ void xf_gdi_polyline(rdpContext* context, POLYLINE_ORDER* polyline)
 
 	if (xfi->drawing == xfi->primary)
 	{
-		if (xfi->remote_app != true)
-			XDrawLines(xfi->display, xfi->drawable, xfi->gc, points, npoints, CoordModePrevious);
-
 		x1 = points[0].x;
 		y1 = points[0].y;
 
@@ -583,7 +528,7 @@ void xf_gdi_polyline(rdpContext* context, POLYLINE_ORDER* polyline)
 			x1 = x2;
 			y1 = y2;
 
-			gdi_InvalidateRegion(xfi->hdc, x, y, width, height);
+			gdi_InvalidateRegion(xfi->hdc, x, y, width + 1, height + 1);
 		}
 	}
 
@@ -604,16 +549,7 @@ void xf_gdi_memblt(rdpContext* context, MEMBLT_ORDER* memblt)
 			memblt->nLeftRect, memblt->nTopRect);
 
 	if (xfi->drawing == xfi->primary)
-	{
-		if (xfi->remote_app != true)
-		{
-			XCopyArea(xfi->display, bitmap->pixmap, xfi->drawable, xfi->gc,
-				memblt->nXSrc, memblt->nYSrc, memblt->nWidth, memblt->nHeight,
-				memblt->nLeftRect, memblt->nTopRect);
-		}
-
 		gdi_InvalidateRegion(xfi->hdc, memblt->nLeftRect, memblt->nTopRect, memblt->nWidth, memblt->nHeight);
-	}
 
 	XSetFunction(xfi->display, xfi->gc, GXcopy);
 }
@@ -628,6 +564,19 @@ void xf_gdi_surface_frame_marker(rdpContext* context, SURFACE_FRAME_MARKER* surf
 
 }
 
+/* Stage a bottom-up 32bpp surface bitmap and put it on the primary surface */
+static void xf_gdi_stage_bottom_up(xfInfo* xfi, uint8* data, SURFACE_BITS_COMMAND* surface_bits_command)
+{
+	int width = surface_bits_command->width;
+	int height = surface_bits_command->height;
+
+	xf_shm_image_copy(xfi, xfi->staging, data + (height - 1) * width * 4, -width * 4,
+			surface_bits_command->destLeft, surface_bits_command->destTop, width, height);
+
+	xf_shm_image_put(xfi, xfi->staging, xfi->primary, xfi->gc,
+			surface_bits_command->destLeft, surface_bits_command->destTop, width, height);
+}
+
 void xf_gdi_surface_bits(rdpContext* context, SURFACE_BITS_COMMAND* surface_bits_command)
 {
 	int i, tx, ty;
@@ -645,39 +594,57 @@ void xf_gdi_surface_bits(rdpContext* context, SURFACE_BITS_COMMAND* surface_bits
 		XSetFunction(xfi->display, xfi->gc, GXcopy);
 		XSetFillStyle(xfi->display, xfi->gc, FillSolid);
 
-		XSetClipRectangles(xfi->display, xfi->gc,
-				surface_bits_command->destLeft, surface_bits_command->destTop,
-				(XRectangle*) message->rects, message->num_rects, YXBanded);
+		if (xfi->staging)
+		{
+			/* Stage the tiles, each is 64x64, and put only the updated region */
+			for (i = 0; i < message->num_tiles; i++)
+			{
+				tx = message->tiles[i]->x + surface_bits_command->destLeft;
+				ty = message->tiles[i]->y + surface_bits_command->destTop;
+
+				xf_shm_image_copy(xfi, xfi->staging, message->tiles[i]->data, 64 * 4, tx, ty, 64, 64);
+			}
 
-		/* Draw the tiles to primary surface, each is 64x64. */
-		for (i = 0; i < message->num_tiles; i++)
+			for (i = 0; i < message->num_rects; i++)
+			{
+				tx = message->rects[i].x + surface_bits_command->destLeft;
+				ty = message->rects[i].y + surface_bits_command->destTop;
+
+				xf_shm_image_put(xfi, xfi->staging, xfi->primary, xfi->gc,
+						tx, ty, message->rects[i].width, message->rects[i].height);
+			}
+		}
+		else
 		{
-			image = XCreateImage(xfi->display, xfi->visual, 24, ZPixmap, 0,
-				(char*) message->tiles[i]->data, 64, 64, 32, 0);
+			XSetClipRectangles(xfi->display, xfi->gc,
+					surface_bits_command->destLeft, surface_bits_command->destTop,
+					(XRectangle*) message->rects, message->num_rects, YXBanded);
 
-			tx = message->tiles[i]->x + surface_bits_command->destLeft;
-			ty = message->tiles[i]->y + surface_bits_command->destTop;
+			/* Draw the tiles to primary surface, each is 64x64. */
+			for (i = 0; i < message->num_tiles; i++)
+			{
+				image = XCreateImage(xfi->display, xfi->visual, 24, ZPixmap, 0,
+					(char*) message->tiles[i]->data, 64, 64, 32, 0);
 
-			XPutImage(xfi->display, xfi->primary, xfi->gc, image, 0, 0, tx, ty, 64, 64);
-			XFree(image);
+				tx = message->tiles[i]->x + surface_bits_command->destLeft;
+				ty = message->tiles[i]->y + surface_bits_command->destTop;
+
+				XPutImage(xfi->display, xfi->primary, xfi->gc, image, 0, 0, tx, ty, 64, 64);
+				XFree(image);
+			}
+
+			XSetClipMask(xfi->display, xfi->gc, None);
 		}
 
-		/* Copy the updated region from backstore to the window. */
+		/* The updated region is copied to the window at the end of the update */
 		for (i = 0; i < message->num_rects; i++)
 		{
 			tx = message->rects[i].x + surface_bits_command->destLeft;
 			ty = message->rects[i].y + surface_bits_command->destTop;
 
-			if (xfi->remote_app != true)
-			{
-				XCopyArea(xfi->display, xfi->primary, xfi->drawable, xfi->gc,
-						tx, ty, message->rects[i].width, message->rects[i].height, tx, ty);
-			}
-
 			gdi_InvalidateRegion(xfi->hdc, tx, ty, message->rects[i].width, message->rects[i].height);
 		}
 
-		XSetClipMask(xfi->display, xfi->gc, None);
 		rfx_message_free(rfx_context, message);
 	}
 	else if (surface_bits_command->codecID == CODEC_ID_NSCODEC)
@@ -688,25 +655,25 @@ void xf_gdi_surface_bits(rdpContext* context, SURFACE_BITS_COMMAND* surface_bits
 		XSetFunction(xfi->display, xfi->gc, GXcopy);
 		XSetFillStyle(xfi->display, xfi->gc, FillSolid);
 
-		xfi->bmp_codec_nsc = (uint8*) xrealloc(xfi->bmp_codec_nsc,
-				surface_bits_command->width * surface_bits_command->height * 4);
-
-		freerdp_image_flip(nsc_context->bmpdata, xfi->bmp_codec_nsc,
-				surface_bits_command->width, surface_bits_command->height, 32);
+		if (xfi->staging)
+		{
+			xf_gdi_stage_bottom_up(xfi, nsc_context->bmpdata, surface_bits_command);
+		}
+		else
+		{
+			xfi->bmp_codec_nsc = (uint8*) xrealloc(xfi->bmp_codec_nsc,
+					surface_bits_command->width * surface_bits_command->height * 4);
 
-		image = XCreateImage(xfi->display, xfi->visual, 24, ZPixmap, 0,
-			(char*) xfi->bmp_codec_nsc, surface_bits_command->width, surface_bits_command->height, 32, 0);
+			freerdp_image_flip(nsc_context->bmpdata, xfi->bmp_codec_nsc,
+					surface_bits_command->width, surface_bits_command->height, 32);
 
-		XPutImage(xfi->display, xfi->primary, xfi->gc, image, 0, 0,
-				surface_bits_command->destLeft, surface_bits_command->destTop,
-				surface_bits_command->width, surface_bits_command->height);
+			image = XCreateImage(xfi->display, xfi->visual, 24, ZPixmap, 0,
+				(char*) xfi->bmp_codec_nsc, surface_bits_command->width, surface_bits_command->height, 32, 0);
 
-		if (xfi->remote_app != true)
-		{
-			XCopyArea(xfi->display, xfi->primary, xfi->window->handle, xfi->gc,
-				surface_bits_command->destLeft, surface_bits_command->destTop,
-				surface_bits_command->width, surface_bits_command->height,
-				surface_bits_command->destLeft, surface_bits_command->destTop);
+			XPutImage(xfi->display, xfi->primary, xfi->gc, image, 0, 0,
+					surface_bits_command->destLeft, surface_bits_command->destTop,
+					surface_bits_command->width, surface_bits_command->height);
+			XFree(image);
 		}
 
 		gdi_InvalidateRegion(xfi->hdc, surface_bits_command->destLeft, surface_bits_command->destTop,
@@ -720,25 +687,25 @@ void xf_gdi_surface_bits(rdpContext* context, SURFACE_BITS_COMMAND* surface_bits
 		XSetFunction(xfi->display, xfi->gc, GXcopy);
 		XSetFillStyle(xfi->display, xfi->gc, FillSolid);
 
-		xfi->bmp_codec_none = (uint8*) xrealloc(xfi->bmp_codec_none,
-				surface_bits_command->width * surface_bits_command->height * 4);
-
-		freerdp_image_flip(surface_bits_command->bitmapData, xfi->bmp_codec_none,
-				surface_bits_command->width, surface_bits_command->height, 32);
+		if (xfi->staging)
+		{
+			xf_gdi_stage_bottom_up(xfi, surface_bits_command->bitmapData, surface_bits_command);
+		}
+		else
+		{
+			xfi->bmp_codec_none = (uint8*) xrealloc(xfi->bmp_codec_none,
+					surface_bits_command->width * surface_bits_command->height * 4);
 
-		image = XCreateImage(xfi->display, xfi->visual, 24, ZPixmap, 0,
-			(char*) xfi->bmp_codec_none, surface_bits_command->width, surface_bits_command->height, 32, 0);
+			freerdp_image_flip(surface_bits_command->bitmapData, xfi->bmp_codec_none,
+					surface_bits_command->width, surface_bits_command->height, 32);
 
-		XPutImage(xfi->display, xfi->primary, xfi->gc, image, 0, 0,
-				surface_bits_command->destLeft, surface_bits_command->destTop,
-				surface_bits_command->width, surface_bits_command->height);
+			image = XCreateImage(xfi->display, xfi->visual, 24, ZPixmap, 0,
+				(char*) xfi->bmp_codec_none, surface_bits_command->width, surface_bits_command->height, 32, 0);
 
-		if (xfi->remote_app != true)
-		{
-			XCopyArea(xfi->display, xfi->primary, xfi->window->handle, xfi->gc,
-				surface_bits_command->destLeft, surface_bits_command->destTop,
-				surface_bits_command->width, surface_bits_command->height,
-				surface_bits_command->destLeft, surface_bits_command->destTop);
+			XPutImage(xfi->display, xfi->primary, xfi->gc, image, 0, 0,
+					surface_bits_command->destLeft, surface_bits_command->destTop,
+					surface_bits_command->width, surface_bits_command->height);
+			XFree(image);
 		}
 
 		gdi_InvalidateRegion(xfi->hdc, surface_bits_command->destLeft, surface_bits_command->destTop,
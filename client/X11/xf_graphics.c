@@ -38,7 +38,12 @@ void xf_Bitmap_New(rdpContext* context, rdpBitmap* bitmap)
 	xfInfo* xfi = ((xfContext*) context)->xfi;
 
 	XSetFunction(xfi->display, xfi->gc, GXcopy);
-	pixmap = XCreatePixmap(xfi->display, xfi->drawable, bitmap->width, bitmap->height, xfi->depth);
+
+	/* an ephemeral bitmap is painted straight from its data, it has no use for a pixmap */
+	if (bitmap->ephemeral != true)
+		pixmap = XCreatePixmap(xfi->display, xfi->drawable, bitmap->width, bitmap->height, xfi->depth);
+	else
+		pixmap = 0;
 
 	if (bitmap->data != NULL)
 	{
@@ -66,6 +71,7 @@ void xf_Bitmap_New(rdpContext* context, rdpBitmap* bitmap)
 	}
 
 	((xfBitmap*) bitmap)->pixmap = pixmap;
+	((xfBitmap*) bitmap)->scratch = NULL;
 }
 
 void xf_Bitmap_Free(rdpContext* context, rdpBitmap* bitmap)
@@ -74,6 +80,9 @@ void xf_Bitmap_Free(rdpContext* context, rdpBitmap* bitmap)
 
 	if (((xfBitmap*) bitmap)->pixmap != 0)
 		XFreePixmap(xfi->display, ((xfBitmap*) bitmap)->pixmap);
+
+	xfree(((xfBitmap*) bitmap)->scratch);
+	((xfBitmap*) bitmap)->scratch = NULL;
 }
 
 void xf_Bitmap_Paint(rdpContext* context, rdpBitmap* bitmap)
@@ -87,18 +96,26 @@ void xf_Bitmap_Paint(rdpContext* context, rdpBitmap* bitmap)
 
 	XSetFunction(xfi->display, xfi->gc, GXcopy);
 
-	image = XCreateImage(xfi->display, xfi->visual, xfi->depth,
-			ZPixmap, 0, (char*) bitmap->data, bitmap->width, bitmap->height, xfi->scanline_pad, 0);
-
-	XPutImage(xfi->display, xfi->primary, xfi->gc,
-			image, 0, 0, bitmap->left, bitmap->top, width, height);
+	if (xfi->staging)
+	{
+		width = MIN(width, bitmap->width);
+		height = MIN(height, bitmap->height);
 
-	XFree(image);
+		xf_shm_image_copy(xfi, xfi->staging, bitmap->data, bitmap->width * 4,
+				bitmap->left, bitmap->top, width, height);
 
-	if (xfi->remote_app != true)
+		xf_shm_image_put(xfi, xfi->staging, xfi->primary, xfi->gc,
+				bitmap->left, bitmap->top, width, height);
+	}
+	else
 	{
-		XCopyArea(xfi->display, xfi->primary, xfi->drawable, xfi->gc,
-				bitmap->left, bitmap->top, width, height, bitmap->left, bitmap->top);
+		image = XCreateImage(xfi->display, xfi->visual, xfi->depth,
+				ZPixmap, 0, (char*) bitmap->data, bitmap->width, bitmap->height, xfi->scanline_pad, 0);
+
+		XPutImage(xfi->display, xfi->primary, xfi->gc,
+				image, 0, 0, bitmap->left, bitmap->top, width, height);
+
+		XFree(image);
 	}
 
 	gdi_InvalidateRegion(xfi->hdc, bitmap->left, bitmap->top, width, height);
@@ -107,7 +124,7 @@ void xf_Bitmap_Paint(rdpContext* context, rdpBitmap* bitmap)
 void xf_Bitmap_Decompress(rdpContext* context, rdpBitmap* bitmap,
 		uint8* data, int width, int height, int bpp, int length, boolean compressed)
 {
-	uint16 size;
+	uint32 size;
 
 	size = width * height * (bpp + 7) / 8;
 
@@ -137,6 +154,37 @@ void xf_Bitmap_Decompress(rdpContext* context, rdpBitmap* bitmap,
 	bitmap->bpp = bpp;
 }
 
+/**
+ * Convert the decompressed data to the window format, swapping bitmap->data
+ * with a second buffer so neither is reallocated for every rectangle.
+ * Does not call into Xlib, the bitmap decoding threads run it.
+ */
+
+void xf_Bitmap_Convert(rdpContext* context, rdpBitmap* bitmap)
+{
+	int size;
+	uint8* data;
+	xfBitmap* xf_bitmap = (xfBitmap*) bitmap;
+	xfInfo* xfi = ((xfContext*) context)->xfi;
+
+	size = bitmap->width * bitmap->height * ((xfi->bpp + 7) / 8);
+
+	if (xf_bitmap->scratch == NULL)
+		xf_bitmap->scratch = (uint8*) xmalloc(size);
+	else
+		xf_bitmap->scratch = (uint8*) xrealloc(xf_bitmap->scratch, size);
+
+	data = freerdp_image_convert(bitmap->data, xf_bitmap->scratch,
+			bitmap->width, bitmap->height, xfi->srcBpp, xfi->bpp, xfi->clrconv);
+
+	/* already in the window format */
+	if (data != xf_bitmap->scratch)
+		return;
+
+	xf_bitmap->scratch = bitmap->data;
+	bitmap->data = data;
+}
+
 void xf_Bitmap_SetSurface(rdpContext* context, rdpBitmap* bitmap, boolean primary)
 {
 	xfInfo* xfi = ((xfContext*) context)->xfi;
@@ -266,14 +314,7 @@ void xf_Glyph_EndDraw(rdpContext* context, int x, int y, int width, int height,
 	xfInfo* xfi = ((xfContext*) context)->xfi;
 
 	if (xfi->drawing == xfi->primary)
-	{
-		if (xfi->remote_app != true)
-		{
-			XCopyArea(xfi->display, xfi->primary, xfi->drawable, xfi->gc, x, y, width, height, x, y);
-		}
-
 		gdi_InvalidateRegion(xfi->hdc, x, y, width, height);
-	}
 }
 
 /* Graphics Module */
@@ -292,6 +333,7 @@ void xf_register_graphics(rdpGraphics* graphics)
 	bitmap->Paint = xf_Bitmap_Paint;
 	bitmap->Decompress = xf_Bitmap_Decompress;
 	bitmap->SetSurface = xf_Bitmap_SetSurface;
+	bitmap->Convert = xf_Bitmap_Convert;
 
 	graphics_register_bitmap(graphics, bitmap);
 	xfree(bitmap);
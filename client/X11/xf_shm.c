@@ -0,0 +1,331 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * X11 Shared Memory Images
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <freerdp/utils/memory.h>
+
+#include "xf_shm.h"
+
+#ifdef WITH_XEXT
+
+static boolean xf_shm_error = false;
+
+static int xf_shm_error_handler(Display* display, XErrorEvent* event)
+{
+	xf_shm_error = true;
+	return 0;
+}
+
+/* Attaching fails asynchronously on a remote display, wait for the outcome */
+static boolean xf_shm_attach(xfInfo* xfi, XShmSegmentInfo* shminfo)
+{
+	int (*handler)(Display*, XErrorEvent*);
+
+	XSync(xfi->display, false);
+	xf_shm_error = false;
+	handler = XSetErrorHandler(xf_shm_error_handler);
+
+	XShmAttach(xfi->display, shminfo);
+	XSync(xfi->display, false);
+
+	XSetErrorHandler(handler);
+
+	return (xf_shm_error != true) ? true : false;
+}
+
+static XImage* xf_shm_create_image(xfInfo* xfi, XShmSegmentInfo* shminfo, int width, int height)
+{
+	XImage* image;
+
+	image = XShmCreateImage(xfi->display, xfi->visual, xfi->depth, ZPixmap, NULL, shminfo, width, height);
+
+	if (image == NULL)
+		return NULL;
+
+	shminfo->shmid = shmget(IPC_PRIVATE, image->bytes_per_line * image->height, IPC_CREAT | 0600);
+
+	if (shminfo->shmid == -1)
+	{
+		XDestroyImage(image);
+		return NULL;
+	}
+
+	shminfo->shmaddr = image->data = shmat(shminfo->shmid, NULL, 0);
+	shminfo->readOnly = false;
+
+	if (shminfo->shmaddr == (char*) -1)
+	{
+		shmctl(shminfo->shmid, IPC_RMID, NULL);
+		image->data = NULL;
+		XDestroyImage(image);
+		return NULL;
+	}
+
+	if (xf_shm_attach(xfi, shminfo) != true)
+	{
+		printf("xf_shm_create_image: XShmAttach failed, not using shared memory\n");
+		xfi->xshm = false;
+
+		shmdt(shminfo->shmaddr);
+		shmctl(shminfo->shmid, IPC_RMID, NULL);
+		image->data = NULL;
+		XDestroyImage(image);
+		return NULL;
+	}
+
+	/* The segment goes away once both sides have detached */
+	shmctl(shminfo->shmid, IPC_RMID, NULL);
+
+	return image;
+}
+
+#endif
+
+/**
+ * Check for the MIT-SHM extension, and whether the server can back
+ * pixmaps with our segments.
+ */
+
+boolean xf_shm_init(xfInfo* xfi)
+{
+	xfi->xshm = false;
+	xfi->xshm_pixmaps = false;
+
+#ifdef WITH_XEXT
+	{
+		int major, minor;
+		Bool pixmaps;
+
+		if (XShmQueryVersion(xfi->display, &major, &minor, &pixmaps))
+		{
+			xfi->xshm = true;
+			xfi->xshm_pixmaps = (pixmaps && XShmPixmapFormat(xfi->display) == ZPixmap) ? true : false;
+		}
+	}
+#endif
+
+	return xfi->xshm;
+}
+
+/**
+ * Create an image the size of the given area, in the pixmap format of the
+ * window. The image is zeroed.
+ */
+
+xfShmImage* xf_shm_image_new(xfInfo* xfi, int width, int height)
+{
+	xfShmImage* shm;
+
+	shm = xnew(xfShmImage);
+
+#ifdef WITH_XEXT
+	if (xfi->xshm)
+	{
+		shm->image = xf_shm_create_image(xfi, &shm->shminfo, width, height);
+		shm->shm = (shm->image != NULL) ? true : false;
+	}
+#endif
+
+	if (shm->image == NULL)
+	{
+		shm->image = XCreateImage(xfi->display, xfi->visual, xfi->depth, ZPixmap, 0,
+				NULL, width, height, xfi->scanline_pad, 0);
+
+		if (shm->image == NULL)
+		{
+			xfree(shm);
+			return NULL;
+		}
+
+		shm->image->data = (char*) xzalloc(shm->image->bytes_per_line * height);
+	}
+
+	return shm;
+}
+
+void xf_shm_image_free(xfInfo* xfi, xfShmImage* shm)
+{
+	if (shm == NULL)
+		return;
+
+#ifdef WITH_XEXT
+	if (shm->shm)
+	{
+		XShmDetach(xfi->display, &shm->shminfo);
+		XSync(xfi->display, false);
+		shmdt(shm->shminfo.shmaddr);
+		shm->image->data = NULL;
+	}
+#endif
+
+	XDestroyImage(shm->image);
+	xfree(shm);
+}
+
+/**
+ * Create a pixmap sharing the image memory, or return 0 when the server
+ * cannot do that. Drawing to either shows in the other.
+ */
+
+Pixmap xf_shm_image_create_pixmap(xfInfo* xfi, xfShmImage* shm)
+{
+#ifdef WITH_XEXT
+	if (shm->shm && xfi->xshm_pixmaps)
+	{
+		return XShmCreatePixmap(xfi->display, xfi->drawable, shm->shminfo.shmaddr, &shm->shminfo,
+				shm->image->width, shm->image->height, xfi->depth);
+	}
+#endif
+
+	return 0;
+}
+
+/* Wait for the server to be done with every request reading the image */
+void xf_shm_image_wait(xfInfo* xfi, xfShmImage* shm)
+{
+	if (shm->pending_all || shm->num_pending > 0)
+	{
+		XSync(xfi->display, false);
+		shm->pending_all = false;
+		shm->num_pending = 0;
+	}
+}
+
+/* Note an area that requests queued for the server read from the image */
+void xf_shm_image_read(xfShmImage* shm, int x, int y, int width, int height)
+{
+	XRectangle* rect;
+
+	if (shm->shm != true || shm->pending_all)
+		return;
+
+	if (shm->num_pending >= XF_SHM_MAX_PENDING)
+	{
+		shm->pending_all = true;
+		return;
+	}
+
+	rect = &shm->pending[shm->num_pending++];
+	rect->x = x;
+	rect->y = y;
+	rect->width = width;
+	rect->height = height;
+}
+
+/**
+ * Get ready to write an area of the image, waiting for the server first if
+ * it may still have to read from there.
+ */
+
+void xf_shm_image_write(xfInfo* xfi, xfShmImage* shm, int x, int y, int width, int height)
+{
+	int i;
+	XRectangle* rect;
+
+	if (shm->pending_all)
+	{
+		xf_shm_image_wait(xfi, shm);
+		return;
+	}
+
+	for (i = 0; i < shm->num_pending; i++)
+	{
+		rect = &shm->pending[i];
+
+		if (x < rect->x + rect->width && rect->x < x + width &&
+			y < rect->y + rect->height && rect->y < y + height)
+		{
+			xf_shm_image_wait(xfi, shm);
+			return;
+		}
+	}
+}
+
+static boolean xf_shm_image_clip(xfShmImage* shm, int* x, int* y, int* width, int* height)
+{
+	if (*x < 0)
+	{
+		*width += *x;
+		*x = 0;
+	}
+
+	if (*y < 0)
+	{
+		*height += *y;
+		*y = 0;
+	}
+
+	if (*x + *width > shm->image->width)
+		*width = shm->image->width - *x;
+
+	if (*y + *height > shm->image->height)
+		*height = shm->image->height - *y;
+
+	return (*width > 0 && *height > 0) ? true : false;
+}
+
+/**
+ * Copy 32bpp pixels into the image at the given position, clipped to the
+ * image. The source rows are step bytes apart, a negative step copies a
+ * bottom-up bitmap.
+ */
+
+void xf_shm_image_copy(xfInfo* xfi, xfShmImage* shm, uint8* src, int step,
+		int x, int y, int width, int height)
+{
+	int i;
+	uint8* dst;
+	int cx = x, cy = y;
+
+	if (xf_shm_image_clip(shm, &cx, &cy, &width, &height) != true)
+		return;
+
+	xf_shm_image_write(xfi, shm, cx, cy, width, height);
+
+	src += (cy - y) * step + (cx - x) * 4;
+	dst = (uint8*) shm->image->data + cy * shm->image->bytes_per_line + cx * 4;
+
+	for (i = 0; i < height; i++)
+	{
+		memcpy(dst, src, width * 4);
+		dst += shm->image->bytes_per_line;
+		src += step;
+	}
+}
+
+/* Put an area of the image at the same position in a drawable */
+void xf_shm_image_put(xfInfo* xfi, xfShmImage* shm, Drawable drawable, GC gc,
+		int x, int y, int width, int height)
+{
+	if (xf_shm_image_clip(shm, &x, &y, &width, &height) != true)
+		return;
+
+#ifdef WITH_XEXT
+	if (shm->shm)
+	{
+		XShmPutImage(xfi->display, drawable, gc, shm->image, x, y, x, y, width, height, False);
+		xf_shm_image_read(shm, x, y, width, height);
+		return;
+	}
+#endif
+
+	XPutImage(xfi->display, drawable, gc, shm->image, x, y, x, y, width, height);
+}
@@ -0,0 +1,69 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * X11 Shared Memory Images
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __XF_SHM_H
+#define __XF_SHM_H
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#ifdef WITH_XEXT
+#include <X11/extensions/XShm.h>
+#endif
+
+typedef struct xf_shm_image xfShmImage;
+
+#include "xfreerdp.h"
+
+/* Areas written since the server last caught up, before it has to be waited for */
+#define XF_SHM_MAX_PENDING	128
+
+/**
+ * A ZPixmap image in a shared memory segment, or in plain memory when the
+ * server cannot share it. The server reads the segment while processing
+ * the requests that use it, so areas it may not have read yet are tracked
+ * and waited for before they are written again.
+ */
+struct xf_shm_image
+{
+	XImage* image;
+	boolean shm;
+#ifdef WITH_XEXT
+	XShmSegmentInfo shminfo;
+#endif
+
+	/* The whole image, or the listed areas, may still be read by the server */
+	boolean pending_all;
+	int num_pending;
+	XRectangle pending[XF_SHM_MAX_PENDING];
+};
+
+boolean xf_shm_init(xfInfo* xfi);
+
+xfShmImage* xf_shm_image_new(xfInfo* xfi, int width, int height);
+void xf_shm_image_free(xfInfo* xfi, xfShmImage* shm);
+Pixmap xf_shm_image_create_pixmap(xfInfo* xfi, xfShmImage* shm);
+
+void xf_shm_image_wait(xfInfo* xfi, xfShmImage* shm);
+void xf_shm_image_read(xfShmImage* shm, int x, int y, int width, int height);
+void xf_shm_image_write(xfInfo* xfi, xfShmImage* shm, int x, int y, int width, int height);
+void xf_shm_image_copy(xfInfo* xfi, xfShmImage* shm, uint8* src, int step,
+		int x, int y, int width, int height);
+void xf_shm_image_put(xfInfo* xfi, xfShmImage* shm, Drawable drawable, GC gc,
+		int x, int y, int width, int height);
+
+#endif /* __XF_SHM_H */
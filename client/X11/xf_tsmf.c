@@ -37,16 +37,42 @@
 #include <X11/extensions/Xv.h>
 #include <X11/extensions/Xvlib.h>
 
+/* Images kept attached to the segments of the channel's frame pool */
+#define XV_SHM_IMAGES	8
+
+typedef struct xf_xv_image xfXvImage;
+
+struct xf_xv_image
+{
+	XvImage* image;
+	XShmSegmentInfo shminfo;
+	uint32 stamp;
+};
+
 typedef struct xf_xv_context xfXvContext;
 
 struct xf_xv_context
 {
 	long xv_port;
 	Atom xv_colorkey_atom;
-	int xv_image_size;
+	uint32* xv_pixfmts;
+
+	/* Driver layout of the current frames, in the frame's plane order */
+	uint32 xv_pixfmt;
+	int xv_width;
+	int xv_height;
+	int xv_image_id;
+	uint32 xv_image_size;
+	uint32 xv_offsets[3];
+	uint32 xv_pitches[3];
+
+	/* Our own segment, for frames that have to be copied */
+	xfXvImage xv_copy;
 	int xv_shmid;
 	char* xv_shmaddr;
-	uint32* xv_pixfmts;
+
+	xfXvImage xv_images[XV_SHM_IMAGES];
+	uint32 xv_stamp;
 };
 
 #ifdef WITH_DEBUG_XV
@@ -75,6 +101,7 @@ void xf_tsmf_init(xfInfo* xfi, long xv_port)
 
 	xv->xv_colorkey_atom = None;
 	xv->xv_image_size = 0;
+	xv->xv_shmid = -1;
 	xv->xv_port = xv_port;
 
 	if (!XShmQueryExtension(xfi->display))
@@ -152,17 +179,39 @@ void xf_tsmf_init(xfInfo* xfi, long xv_port)
 #endif
 }
 
+static void xf_tsmf_free_image(xfInfo* xfi, xfXvImage* xvi)
+{
+	if (xvi->image)
+	{
+		XShmDetach(xfi->display, &xvi->shminfo);
+		XFree(xvi->image);
+		xvi->image = NULL;
+	}
+}
+
+static void xf_tsmf_free_copy_image(xfInfo* xfi, xfXvContext* xv)
+{
+	xf_tsmf_free_image(xfi, &xv->xv_copy);
+
+	if (xv->xv_shmid != -1)
+	{
+		XSync(xfi->display, false);
+		shmdt(xv->xv_shmaddr);
+		shmctl(xv->xv_shmid, IPC_RMID, NULL);
+		xv->xv_shmid = -1;
+	}
+}
+
 void xf_tsmf_uninit(xfInfo* xfi)
 {
+	int i;
 	xfXvContext* xv = (xfXvContext*) xfi->xv_context;
 
 	if (xv)
 	{
-		if (xv->xv_image_size > 0)
-		{
-			shmdt(xv->xv_shmaddr);
-			shmctl(xv->xv_shmid, IPC_RMID, NULL);
-		}
+		for (i = 0; i < XV_SHM_IMAGES; i++)
+			xf_tsmf_free_image(xfi, &xv->xv_images[i]);
+		xf_tsmf_free_copy_image(xfi, xv);
 		if (xv->xv_pixfmts)
 		{
 			xfree(xv->xv_pixfmts);
@@ -190,15 +239,205 @@ xf_tsmf_is_format_supported(xfXvContext* xv, uint32 pixfmt)
 	return false;
 }
 
+/**
+ * Look up how the video driver lays out an image of the frame's format and
+ * size. I420 and YV12 only differ in the order of the chroma planes, so one
+ * can be shown as the other with the planes swapped. The layout is kept in
+ * the frame's own plane order.
+ */
+static boolean xf_tsmf_update_layout(xfInfo* xfi, RDP_VIDEO_FRAME_EVENT* vevent)
+{
+	int i;
+	int id;
+	uint32 t;
+	XvImage* image;
+	boolean swap = false;
+	XShmSegmentInfo shminfo;
+	xfXvContext* xv = (xfXvContext*) xfi->xv_context;
+
+	if (vevent->frame_pixfmt == xv->xv_pixfmt &&
+		vevent->frame_width == xv->xv_width && vevent->frame_height == xv->xv_height)
+	{
+		return (xv->xv_image_size > 0);
+	}
+
+	for (i = 0; i < XV_SHM_IMAGES; i++)
+		xf_tsmf_free_image(xfi, &xv->xv_images[i]);
+	xf_tsmf_free_copy_image(xfi, xv);
+
+	xv->xv_pixfmt = vevent->frame_pixfmt;
+	xv->xv_width = vevent->frame_width;
+	xv->xv_height = vevent->frame_height;
+	xv->xv_image_size = 0;
+
+	id = vevent->frame_pixfmt;
+	if ((id == RDP_PIXFMT_I420 || id == RDP_PIXFMT_YV12) && !xf_tsmf_is_format_supported(xv, id))
+	{
+		id = (id == RDP_PIXFMT_I420 ? RDP_PIXFMT_YV12 : RDP_PIXFMT_I420);
+		swap = true;
+
+		if (!xf_tsmf_is_format_supported(xv, id))
+		{
+			DEBUG_XV("pixel format 0x%X not supported by hardware.", vevent->frame_pixfmt);
+			return false;
+		}
+	}
+
+	image = XvShmCreateImage(xfi->display, xv->xv_port, id, NULL,
+		vevent->frame_width, vevent->frame_height, &shminfo);
+	if (!image)
+		return false;
+
+	xv->xv_image_id = id;
+	xv->xv_image_size = image->data_size;
+	for (i = 0; i < 3; i++)
+	{
+		xv->xv_offsets[i] = (i < image->num_planes ? image->offsets[i] : 0);
+		xv->xv_pitches[i] = (i < image->num_planes ? image->pitches[i] : 0);
+	}
+	XFree(image);
+
+	if (swap)
+	{
+		t = xv->xv_offsets[1]; xv->xv_offsets[1] = xv->xv_offsets[2]; xv->xv_offsets[2] = t;
+		t = xv->xv_pitches[1]; xv->xv_pitches[1] = xv->xv_pitches[2]; xv->xv_pitches[2] = t;
+	}
+
+	DEBUG_XV("image 0x%X size %d pitches %d %d %d", id, xv->xv_image_size,
+		xv->xv_pitches[0], xv->xv_pitches[1], xv->xv_pitches[2]);
+
+	return true;
+}
+
+/**
+ * Get an image on the segment the frame was decoded into. The segments come
+ * from the channel's frame pool and are reused frame after frame, so they
+ * stay attached to the X server instead of being attached for every frame.
+ */
+static xfXvImage* xf_tsmf_get_shm_image(xfInfo* xfi, RDP_VIDEO_FRAME_EVENT* vevent)
+{
+	int i;
+	xfXvImage* xvi;
+	xfXvImage* lru = NULL;
+	xfXvContext* xv = (xfXvContext*) xfi->xv_context;
+
+	for (i = 0; i < XV_SHM_IMAGES; i++)
+	{
+		xvi = &xv->xv_images[i];
+
+		if (!xvi->image)
+		{
+			if (!lru || lru->image)
+				lru = xvi;
+			continue;
+		}
+
+		if (xvi->shminfo.shmid == vevent->frame_shmid &&
+			xvi->shminfo.shmaddr == (char*) vevent->frame_data)
+		{
+			xvi->stamp = ++xv->xv_stamp;
+			return xvi;
+		}
+
+		if (!lru || (lru->image && xvi->stamp < lru->stamp))
+			lru = xvi;
+	}
+
+	xf_tsmf_free_image(xfi, lru);
+
+	lru->image = XvShmCreateImage(xfi->display, xv->xv_port, xv->xv_image_id,
+		(char*) vevent->frame_data, vevent->frame_width, vevent->frame_height, &lru->shminfo);
+	if (!lru->image)
+		return NULL;
+
+	lru->shminfo.shmid = vevent->frame_shmid;
+	lru->shminfo.shmaddr = (char*) vevent->frame_data;
+	lru->shminfo.readOnly = true;
+
+	if (!XShmAttach(xfi->display, &lru->shminfo))
+	{
+		DEBUG_XV("XShmAttach failed.");
+		XFree(lru->image);
+		lru->image = NULL;
+		return NULL;
+	}
+
+	lru->stamp = ++xv->xv_stamp;
+	return lru;
+}
+
+/* Get the image on our own segment, for frames that cannot be shown in place */
+static XvImage* xf_tsmf_get_copy_image(xfInfo* xfi)
+{
+	XvImage* image;
+	xfXvContext* xv = (xfXvContext*) xfi->xv_context;
+
+	if (xv->xv_copy.image)
+		return xv->xv_copy.image;
+
+	xv->xv_shmid = shmget(IPC_PRIVATE, xv->xv_image_size, IPC_CREAT | 0777);
+	if (xv->xv_shmid == -1)
+		return NULL;
+
+	xv->xv_shmaddr = shmat(xv->xv_shmid, 0, 0);
+	if (xv->xv_shmaddr == (char*) -1)
+	{
+		shmctl(xv->xv_shmid, IPC_RMID, NULL);
+		xv->xv_shmid = -1;
+		return NULL;
+	}
+
+	image = XvShmCreateImage(xfi->display, xv->xv_port, xv->xv_image_id,
+		xv->xv_shmaddr, xv->xv_width, xv->xv_height, &xv->xv_copy.shminfo);
+
+	if (image)
+	{
+		xv->xv_copy.shminfo.shmid = xv->xv_shmid;
+		xv->xv_copy.shminfo.shmaddr = image->data = xv->xv_shmaddr;
+		xv->xv_copy.shminfo.readOnly = false;
+
+		if (!XShmAttach(xfi->display, &xv->xv_copy.shminfo))
+		{
+			DEBUG_XV("XShmAttach failed.");
+			XFree(image);
+			image = NULL;
+		}
+	}
+
+	xv->xv_copy.image = image;
+
+	if (!image)
+		xf_tsmf_free_copy_image(xfi, xv);
+
+	return image;
+}
+
+static void xf_tsmf_copy_plane(uint8* dst, uint32 dst_pitch, uint8* src, uint32 src_pitch,
+	uint32 width, uint32 height)
+{
+	uint32 i;
+
+	if (dst_pitch == width && src_pitch == width)
+	{
+		memcpy(dst, src, width * height);
+		return;
+	}
+
+	for (i = 0; i < height; i++)
+		memcpy(dst + i * dst_pitch, src + i * src_pitch, width);
+}
+
 static void xf_process_tsmf_video_frame_event(xfInfo* xfi, RDP_VIDEO_FRAME_EVENT* vevent)
 {
 	int i;
-	uint8* data1;
-	uint8* data2;
-	uint32 pixfmt;
-	XvImage * image;
+	uint32 width;
+	uint32 height;
+	uint32 offsets[3];
+	uint32 pitches[3];
+	boolean planar;
+	XvImage* image;
+	xfXvImage* xvi;
 	int colorkey = 0;
-	XShmSegmentInfo shminfo;
 	xfXvContext* xv = (xfXvContext*) xfi->xv_context;
 
 	if (xv->xv_port == 0)
@@ -224,110 +463,85 @@ static void xf_process_tsmf_video_frame_event(xfInfo* xfi, RDP_VIDEO_FRAME_EVENT
 		}
 	}
 
-	pixfmt = vevent->frame_pixfmt;
-	image = XvShmCreateImage(xfi->display, xv->xv_port,
-		pixfmt, 0, vevent->frame_width, vevent->frame_height, &shminfo);
-	if (xv->xv_image_size != image->data_size)
+	if (!xf_tsmf_update_layout(xfi, vevent))
+		return;
+
+	planar = (vevent->frame_pixfmt == RDP_PIXFMT_I420 || vevent->frame_pixfmt == RDP_PIXFMT_YV12);
+
+	if (planar)
 	{
-		if (xv->xv_image_size > 0)
+		/* Ask for the next frames in the driver's layout, so they can be shown in place */
+		vevent->render_size = xv->xv_image_size;
+		memcpy(vevent->render_offsets, xv->xv_offsets, sizeof(vevent->render_offsets));
+		memcpy(vevent->render_pitches, xv->xv_pitches, sizeof(vevent->render_pitches));
+
+		if (vevent->frame_shm && vevent->frame_size >= xv->xv_image_size &&
+			memcmp(vevent->frame_offsets, xv->xv_offsets, sizeof(xv->xv_offsets)) == 0 &&
+			memcmp(vevent->frame_pitches, xv->xv_pitches, sizeof(xv->xv_pitches)) == 0)
 		{
-			shmdt(xv->xv_shmaddr);
-			shmctl(xv->xv_shmid, IPC_RMID, NULL);
+			xvi = xf_tsmf_get_shm_image(xfi, vevent);
+
+			if (xvi)
+			{
+				/* The segment goes back to the pool when the event is freed, right
+				   after this returns, so the X server has to be done reading it. */
+				XvShmPutImage(xfi->display, xv->xv_port, xfi->window->handle, xfi->gc, xvi->image,
+					0, 0, xvi->image->width, xvi->image->height,
+					vevent->x, vevent->y, vevent->width, vevent->height, false);
+				XSync(xfi->display, false);
+				return;
+			}
 		}
-		xv->xv_image_size = image->data_size;
-		xv->xv_shmid = shmget(IPC_PRIVATE, image->data_size, IPC_CREAT | 0777);
-		xv->xv_shmaddr = shmat(xv->xv_shmid, 0, 0);
 	}
-	shminfo.shmid = xv->xv_shmid;
-	shminfo.shmaddr = image->data = xv->xv_shmaddr;
-	shminfo.readOnly = false;
 
-	if (!XShmAttach(xfi->display, &shminfo))
-	{
-		XFree(image);
-		DEBUG_XV("XShmAttach failed.");
+	image = xf_tsmf_get_copy_image(xfi);
+	if (!image)
 		return;
-	}
 
-	/* The video driver may align each line to a different size
-	   and we need to convert our original image data. */
-	switch (pixfmt)
+	if (planar)
 	{
-		case RDP_PIXFMT_I420:
-		case RDP_PIXFMT_YV12:
-			if (!xf_tsmf_is_format_supported(xv, RDP_PIXFMT_I420) &&
-				!xf_tsmf_is_format_supported(xv, RDP_PIXFMT_YV12))
-			{
-				DEBUG_XV("pixel format 0x%X not supported by hardware.", pixfmt);
-				break;
-			}
-			/* Y */
-			if (image->pitches[0] == vevent->frame_width)
-			{
-				memcpy(image->data + image->offsets[0],
-					vevent->frame_data,
-					vevent->frame_width * vevent->frame_height);
-			}
-			else
-			{
-				for (i = 0; i < vevent->frame_height; i++)
-				{
-					memcpy(image->data + image->offsets[0] + i * image->pitches[0],
-						vevent->frame_data + i * vevent->frame_width,
-						vevent->frame_width);
-				}
-			}
-			/* UV */
-			/* Conversion between I420 and YV12 is to simply swap U and V */
-			if (xf_tsmf_is_format_supported(xv, pixfmt))
-			{
-				data1 = vevent->frame_data + vevent->frame_width * vevent->frame_height;
-				data2 = vevent->frame_data + vevent->frame_width * vevent->frame_height +
-					vevent->frame_width * vevent->frame_height / 4;
-			}
-			else
-			{
-				data2 = vevent->frame_data + vevent->frame_width * vevent->frame_height;
-				data1 = vevent->frame_data + vevent->frame_width * vevent->frame_height +
-					vevent->frame_width * vevent->frame_height / 4;
-				image->id = pixfmt == RDP_PIXFMT_I420 ? RDP_PIXFMT_YV12 : RDP_PIXFMT_I420;
-			}
-			if (image->pitches[1] * 2 == vevent->frame_width)
-			{
-				memcpy(image->data + image->offsets[1],
-					data1,
-					vevent->frame_width * vevent->frame_height / 4);
-				memcpy(image->data + image->offsets[2],
-					data2,
-					vevent->frame_width * vevent->frame_height / 4);
-			}
-			else
-			{
-				for (i = 0; i < vevent->frame_height / 2; i++)
-				{
-					memcpy(image->data + image->offsets[1] + i * image->pitches[1],
-						data1 + i * vevent->frame_width / 2,
-						vevent->frame_width / 2);
-					memcpy(image->data + image->offsets[2] + i * image->pitches[2],
-						data2 + i * vevent->frame_width / 2,
-						vevent->frame_width / 2);
-				}
-			}
-			break;
+		width = vevent->frame_width;
+		height = vevent->frame_height;
 
-		default:
-			memcpy(image->data, vevent->frame_data, image->data_size <= vevent->frame_size ?
-				image->data_size : vevent->frame_size);
-			break;
+		if (vevent->frame_pitches[0] != 0)
+		{
+			memcpy(offsets, vevent->frame_offsets, sizeof(offsets));
+			memcpy(pitches, vevent->frame_pitches, sizeof(pitches));
+		}
+		else
+		{
+			offsets[0] = 0;
+			offsets[1] = width * height;
+			offsets[2] = offsets[1] + ((width + 1) / 2) * ((height + 1) / 2);
+			pitches[0] = width;
+			pitches[1] = pitches[2] = (width + 1) / 2;
+		}
+
+		if (offsets[2] + pitches[2] * ((height + 1) / 2) > vevent->frame_size)
+		{
+			DEBUG_XV("frame_size %d too small.", vevent->frame_size);
+			return;
+		}
+
+		for (i = 0; i < 3; i++)
+		{
+			xf_tsmf_copy_plane((uint8*) image->data + xv->xv_offsets[i], xv->xv_pitches[i],
+				vevent->frame_data + offsets[i], pitches[i],
+				i == 0 ? width : (width + 1) / 2, i == 0 ? height : (height + 1) / 2);
+		}
+	}
+	else
+	{
+		memcpy(image->data, vevent->frame_data, image->data_size <= vevent->frame_size ?
+			image->data_size : vevent->frame_size);
 	}
 
 	XvShmPutImage(xfi->display, xv->xv_port, xfi->window->handle, xfi->gc, image,
 		0, 0, image->width, image->height,
 		vevent->x, vevent->y, vevent->width, vevent->height, false);
-	XSync(xfi->display, false);
 
-	XShmDetach(xfi->display, &shminfo);
-	XFree(image);
+	/* Our segment is written again by the next frame */
+	XSync(xfi->display, false);
 }
 
 static void xf_process_tsmf_redraw_event(xfInfo* xfi, RDP_REDRAW_EVENT* revent)
@@ -591,6 +591,7 @@ void xf_MoveWindow(xfInfo* xfi, xfWindow* window, int x, int y, int width, int h
 		XMoveWindow(xfi->display, window->handle, x, y);
 
 	xf_UpdateWindowArea(xfi, window, 0, 0, width, height);
+	XFlush(xfi->display);
 }
 
 void xf_ShowWindow(xfInfo* xfi, xfWindow* window, uint8 state)
@@ -712,15 +713,10 @@ void xf_UpdateWindowArea(xfInfo* xfi, xfWindow* window, int x, int y, int width,
 		height = (wnd->windowOffsetY + wnd->windowHeight - 1) - ay;
 
 	if (xfi->sw_gdi)
-	{
-		XPutImage(xfi->display, xfi->primary, window->gc, xfi->image,
-			ax, ay, ax, ay, width, height);
-	}
+		xf_sw_update_primary(xfi, window->gc, ax, ay, width, height);
 
 	XCopyArea(xfi->display, xfi->primary, window->handle, window->gc,
 			ax, ay, width, height, x, y);
-
-	XFlush(xfi->display);
 }
 
 boolean xf_IsWindowBorder(xfInfo* xfi, xfWindow* xfw, int x, int y)
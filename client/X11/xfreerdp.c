@@ -90,76 +90,183 @@ void xf_context_free(freerdp* instance, rdpContext* context)
 
 }
 
+/**
+ * Bring an area of the primary pixmap up to date with what the software gdi
+ * drew into the primary buffer, before it is copied from the pixmap.
+ */
+
+void xf_sw_update_primary(xfInfo* xfi, GC gc, int x, int y, int w, int h)
+{
+	if (xfi->shm_primary)
+	{
+		/* The pixmap is the primary buffer, only note the copy that follows */
+		xf_shm_image_read(xfi->primary_image, x, y, w, h);
+	}
+	else if (xfi->primary_image)
+	{
+		xf_shm_image_put(xfi, xfi->primary_image, xfi->primary, gc, x, y, w, h);
+	}
+	else
+	{
+		XPutImage(xfi->display, xfi->primary, gc, xfi->image, x, y, x, y, w, h);
+	}
+}
+
+/**
+ * Copy what was drawn during an update from the primary pixmap to the
+ * window, as the bounding box of the invalid region or as its rectangles,
+ * and flush once for the whole update.
+ */
+
+static void xf_present(xfInfo* xfi, HGDI_WND hwnd)
+{
+	int i;
+	sint32 x, y;
+	uint32 w, h;
+	int ninvalid;
+	HGDI_RGN cinvalid;
+
+	if (hwnd->invalid->null)
+		return;
+
+	if (xfi->complex_regions)
+	{
+		ninvalid = hwnd->ninvalid;
+		cinvalid = hwnd->cinvalid;
+	}
+	else
+	{
+		ninvalid = 1;
+		cinvalid = hwnd->invalid;
+	}
+
+	for (i = 0; i < ninvalid; i++)
+	{
+		x = cinvalid[i].x;
+		y = cinvalid[i].y;
+		w = cinvalid[i].w;
+		h = cinvalid[i].h;
+
+		if (xfi->sw_gdi)
+			xf_sw_update_primary(xfi, xfi->gc, x, y, w, h);
+
+		XCopyArea(xfi->display, xfi->primary, xfi->window->handle, xfi->gc, x, y, w, h, x, y);
+	}
+
+	XFlush(xfi->display);
+}
+
+static void xf_present_rail(xfInfo* xfi, rdpRail* rail, HGDI_WND hwnd)
+{
+	sint32 x, y;
+	uint32 w, h;
+
+	if (hwnd->invalid->null)
+		return;
+
+	x = hwnd->invalid->x;
+	y = hwnd->invalid->y;
+	w = hwnd->invalid->w;
+	h = hwnd->invalid->h;
+
+	xf_rail_paint(xfi, rail, x, y, x + w - 1, y + h - 1);
+
+	XFlush(xfi->display);
+}
+
 void xf_sw_begin_paint(rdpContext* context)
 {
+	xfInfo* xfi;
 	rdpGdi* gdi = context->gdi;
+
+	xfi = ((xfContext*) context)->xfi;
+
 	gdi->primary->hdc->hwnd->invalid->null = 1;
 	gdi->primary->hdc->hwnd->ninvalid = 0;
+
+	/* The gdi may draw anywhere, the server has to be done reading first */
+	if (xfi->primary_image)
+		xf_shm_image_wait(xfi, xfi->primary_image);
 }
 
 void xf_sw_end_paint(rdpContext* context)
 {
 	rdpGdi* gdi;
 	xfInfo* xfi;
-	sint32 x, y;
-	uint32 w, h;
 
 	xfi = ((xfContext*) context)->xfi;
 	gdi = context->gdi;
 
+	gdi_flush(gdi);
+
 	if (xfi->remote_app != true)
-	{
-		if (xfi->complex_regions != true)
-		{
-			if (gdi->primary->hdc->hwnd->invalid->null)
-				return;
+		xf_present(xfi, gdi->primary->hdc->hwnd);
+	else
+		xf_present_rail(xfi, context->rail, gdi->primary->hdc->hwnd);
+}
 
-			x = gdi->primary->hdc->hwnd->invalid->x;
-			y = gdi->primary->hdc->hwnd->invalid->y;
-			w = gdi->primary->hdc->hwnd->invalid->w;
-			h = gdi->primary->hdc->hwnd->invalid->h;
+/* The gdi can only draw into an image laid out like its own buffer */
+static boolean xf_primary_image_fits(xfInfo* xfi, xfShmImage* image, int width)
+{
+	if (image == NULL)
+		return false;
 
-			XPutImage(xfi->display, xfi->primary, xfi->gc, xfi->image, x, y, x, y, w, h);
-			XCopyArea(xfi->display, xfi->primary, xfi->window->handle, xfi->gc, x, y, w, h, x, y);
-		}
-		else
-		{
-			int i;
-			int ninvalid;
-			HGDI_RGN cinvalid;
+	return (image->image->bits_per_pixel == ((xfi->bpp > 16) ? 32 : 16) &&
+		image->image->bytes_per_line == width * xfi->bpp / 8) ? true : false;
+}
 
-			if (gdi->primary->hdc->hwnd->ninvalid < 1)
-				return;
+static void xf_sw_resize_primary(xfInfo* xfi, rdpGdi* gdi)
+{
+	boolean same;
+	xfShmImage* image;
 
-			ninvalid = gdi->primary->hdc->hwnd->ninvalid;
-			cinvalid = gdi->primary->hdc->hwnd->cinvalid;
+	if (gdi->width == xfi->width && gdi->height == xfi->height)
+		return;
 
-			for (i = 0; i < ninvalid; i++)
-			{
-				x = cinvalid[i].x;
-				y = cinvalid[i].y;
-				w = cinvalid[i].w;
-				h = cinvalid[i].h;
+	image = xf_shm_image_new(xfi, xfi->width, xfi->height);
 
-				XPutImage(xfi->display, xfi->primary, xfi->gc, xfi->image, x, y, x, y, w, h);
-				XCopyArea(xfi->display, xfi->primary, xfi->window->handle, xfi->gc, x, y, w, h, x, y);
-			}
+	if (!xf_primary_image_fits(xfi, image, xfi->width))
+	{
+		/* padded rows, the gdi gets a buffer of its own put through an ordinary image */
+		xf_shm_image_free(xfi, image);
+		image = NULL;
+
+		gdi_resize(gdi, xfi->width, xfi->height);
 
-			XFlush(xfi->display);
+		if (xfi->image)
+		{
+			xfi->image->data = NULL;
+			XDestroyImage(xfi->image);
 		}
+
+		xfi->image = XCreateImage(xfi->display, xfi->visual, xfi->depth, ZPixmap, 0,
+				(char*) gdi->primary_buffer, gdi->width, gdi->height, xfi->scanline_pad, 0);
 	}
 	else
 	{
-		if (gdi->primary->hdc->hwnd->invalid->null)
-			return;
+		gdi_resize_ex(gdi, xfi->width, xfi->height, (uint8*) image->image->data);
+	}
+
+	if (xfi->primary)
+	{
+		same = (xfi->primary == xfi->drawing) ? true : false;
 
-		x = gdi->primary->hdc->hwnd->invalid->x;
-		y = gdi->primary->hdc->hwnd->invalid->y;
-		w = gdi->primary->hdc->hwnd->invalid->w;
-		h = gdi->primary->hdc->hwnd->invalid->h;
+		XFreePixmap(xfi->display, xfi->primary);
+		xfi->primary = (image != NULL) ? xf_shm_image_create_pixmap(xfi, image) : 0;
+		xfi->shm_primary = (xfi->primary != 0) ? true : false;
+
+		if (xfi->primary == 0)
+		{
+			xfi->primary = XCreatePixmap(xfi->display, xfi->drawable,
+					xfi->width, xfi->height, xfi->depth);
+		}
 
-		xf_rail_paint(xfi, context->rail, x, y, x + w - 1, y + h - 1);
+		if (same)
+			xfi->drawing = xfi->primary;
 	}
+
+	xf_shm_image_free(xfi, xfi->primary_image);
+	xfi->primary_image = image;
 }
 
 void xf_sw_desktop_resize(rdpContext* context)
@@ -173,15 +280,25 @@ void xf_sw_desktop_resize(rdpContext* context)
 	if (xfi->fullscreen != true)
 	{
 		rdpGdi* gdi = context->gdi;
-		gdi_resize(gdi, xfi->width, xfi->height);
 
-		if (xfi->image)
+		if (xfi->primary_image)
 		{
-			xfi->image->data = NULL;
-			XDestroyImage(xfi->image);
-			xfi->image = XCreateImage(xfi->display, xfi->visual, xfi->depth, ZPixmap, 0,
-					(char*) gdi->primary_buffer, gdi->width, gdi->height, xfi->scanline_pad, 0);
+			xf_sw_resize_primary(xfi, gdi);
 		}
+		else
+		{
+			gdi_resize(gdi, xfi->width, xfi->height);
+
+			if (xfi->image)
+			{
+				xfi->image->data = NULL;
+				XDestroyImage(xfi->image);
+				xfi->image = XCreateImage(xfi->display, xfi->visual, xfi->depth, ZPixmap, 0,
+						(char*) gdi->primary_buffer, gdi->width, gdi->height, xfi->scanline_pad, 0);
+			}
+		}
+
+		xfi->primary_buffer = gdi->primary_buffer;
 	}
 }
 
@@ -196,23 +313,13 @@ void xf_hw_begin_paint(rdpContext* context)
 void xf_hw_end_paint(rdpContext* context)
 {
 	xfInfo* xfi;
-	sint32 x, y;
-	uint32 w, h;
 
 	xfi = ((xfContext*) context)->xfi;
 
-	if (xfi->remote_app)
-	{
-		if (xfi->hdc->hwnd->invalid->null)
-			return;
-
-		x = xfi->hdc->hwnd->invalid->x;
-		y = xfi->hdc->hwnd->invalid->y;
-		w = xfi->hdc->hwnd->invalid->w;
-		h = xfi->hdc->hwnd->invalid->h;
-
-		xf_rail_paint(xfi, context->rail, x, y, x + w - 1, y + h - 1);
-	}
+	if (xfi->remote_app != true)
+		xf_present(xfi, xfi->hdc->hwnd);
+	else
+		xf_present_rail(xfi, context->rail, xfi->hdc->hwnd);
 }
 
 void xf_hw_desktop_resize(rdpContext* context)
@@ -244,6 +351,18 @@ void xf_hw_desktop_resize(rdpContext* context)
 			if (same)
 				xfi->drawing = xfi->primary;
 		}
+
+		if (xfi->staging)
+		{
+			xf_shm_image_free(xfi, xfi->staging);
+			xfi->staging = xf_shm_image_new(xfi, xfi->width, xfi->height);
+
+			if ((xfi->staging != NULL) && (xfi->staging->shm != true))
+			{
+				xf_shm_image_free(xfi, xfi->staging);
+				xfi->staging = NULL;
+			}
+		}
 	}
 }
 
@@ -262,15 +381,23 @@ boolean xf_check_fds(freerdp* instance, fd_set* set)
 	XEvent xevent;
 	xfInfo* xfi = ((xfContext*) instance->context)->xfi;
 
+	/* input generated by the pending events is sent together */
+	IFCALL(instance->input->BeginBatch, instance->input);
+
 	while (XPending(xfi->display))
 	{
 		memset(&xevent, 0, sizeof(xevent));
 		XNextEvent(xfi->display, &xevent);
 
 		if (xf_event_process(instance, &xevent) != true)
+		{
+			IFCALL(instance->input->EndBatch, instance->input);
 			return false;
+		}
 	}
 
+	IFCALL(instance->input->EndBatch, instance->input);
+
 	return true;
 }
 
@@ -602,15 +729,33 @@ void cpuid(unsigned info, unsigned *eax, unsigned *ebx, unsigned *ecx, unsigned
 		"xchg %%rbx, %%rsi;"
 #endif
 		: "=a" (*eax), "=S" (*ebx), "=c" (*ecx), "=d" (*edx)
-		: "0" (info)
+		: "0" (info), "2" (0)
 	);
 #endif
 #endif
 }
 
+uint32 xgetbv(unsigned index)
+{
+	unsigned int eax = 0, edx = 0;
+
+#ifdef __GNUC__
+#if defined(__i386__) || defined(__x86_64__)
+	__asm volatile
+	(
+		".byte 0x0f, 0x01, 0xd0" /* xgetbv */
+		: "=a" (eax), "=d" (edx)
+		: "c" (index)
+	);
+#endif
+#endif
+
+	return eax;
+}
+
 uint32 xf_detect_cpu()
 {
-	unsigned int eax, ebx, ecx, edx = 0;
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
 	uint32 cpu_opt = 0;
 
 	cpuid(1, &eax, &ebx, &ecx, &edx);
@@ -621,6 +766,18 @@ uint32 xf_detect_cpu()
 		cpu_opt |= CPU_SSE2;
 	}
 
+	/* AVX2 also needs the OS to save the YMM registers (OSXSAVE, XCR0 bits 1-2) */
+	if ((ecx & (1<<27)) && (ecx & (1<<28)) && ((xgetbv(0) & 0x6) == 0x6))
+	{
+		cpuid(7, &eax, &ebx, &ecx, &edx);
+
+		if (ebx & (1<<5))
+		{
+			DEBUG("AVX2 detected");
+			cpu_opt |= CPU_AVX2;
+		}
+	}
+
 	return cpu_opt;
 }
 
@@ -643,6 +800,7 @@ boolean xf_post_connect(freerdp* instance)
 		return false;
 
 	xf_register_graphics(instance->context->graphics);
+	xf_shm_init(xfi);
 
 	if (xfi->sw_gdi)
 	{
@@ -656,7 +814,16 @@ boolean xf_post_connect(freerdp* instance)
 		else
 			flags |= CLRBUF_16BPP;
 
-		gdi_init(instance, flags, NULL);
+		/* Let the gdi draw straight into the image that is put on screen */
+		xfi->primary_image = xf_shm_image_new(xfi, instance->settings->width, instance->settings->height);
+
+		if (!xf_primary_image_fits(xfi, xfi->primary_image, instance->settings->width))
+		{
+			xf_shm_image_free(xfi, xfi->primary_image);
+			xfi->primary_image = NULL;
+		}
+
+		gdi_init(instance, flags, xfi->primary_image ? (uint8*) xfi->primary_image->image->data : NULL);
 		gdi = instance->context->gdi;
 		xfi->primary_buffer = gdi->primary_buffer;
 
@@ -679,6 +846,13 @@ boolean xf_post_connect(freerdp* instance)
 			xfi->nsc_context = (void*) nsc_context_new();
 	}
 
+#if defined(WITH_SSE2) || defined(WITH_AVX2)
+	freerdp_image_convert_set_cpu_opt(xf_detect_cpu());
+#endif
+#ifdef WITH_SSE2
+	gdi_set_cpu_opt(xf_detect_cpu());
+#endif
+
 	if (rfx_context)
 	{
 #ifdef WITH_SSE2
@@ -696,17 +870,45 @@ boolean xf_post_connect(freerdp* instance)
 	xfi->modifier_map = XGetModifierMapping(xfi->display);
 
 	xfi->gc = XCreateGC(xfi->display, xfi->drawable, GCGraphicsExposures, &gcv);
-	xfi->primary = XCreatePixmap(xfi->display, xfi->drawable, xfi->width, xfi->height, xfi->depth);
+
+	if (xfi->primary_image)
+	{
+		xfi->primary = xf_shm_image_create_pixmap(xfi, xfi->primary_image);
+		xfi->shm_primary = (xfi->primary != 0) ? true : false;
+	}
+
+	if (xfi->primary == 0)
+		xfi->primary = XCreatePixmap(xfi->display, xfi->drawable, xfi->width, xfi->height, xfi->depth);
+
 	xfi->drawing = xfi->primary;
 
 	xfi->bitmap_mono = XCreatePixmap(xfi->display, xfi->drawable, 8, 8, 1);
 	xfi->gc_mono = XCreateGC(xfi->display, xfi->bitmap_mono, GCGraphicsExposures, &gcv);
 
-	XSetForeground(xfi->display, xfi->gc, BlackPixelOfScreen(xfi->screen));
-	XFillRectangle(xfi->display, xfi->primary, xfi->gc, 0, 0, xfi->width, xfi->height);
+	/* A shared primary is the zeroed gdi buffer, which is black already */
+	if (xfi->shm_primary != true)
+	{
+		XSetForeground(xfi->display, xfi->gc, BlackPixelOfScreen(xfi->screen));
+		XFillRectangle(xfi->display, xfi->primary, xfi->gc, 0, 0, xfi->width, xfi->height);
+	}
+
+	if (xfi->primary_image == NULL)
+	{
+		xfi->image = XCreateImage(xfi->display, xfi->visual, xfi->depth, ZPixmap, 0,
+				(char*) xfi->primary_buffer, xfi->width, xfi->height, xfi->scanline_pad, 0);
+	}
+
+	/* Decoded surface bits and bitmaps are staged here and put from shared memory */
+	if (xfi->sw_gdi != true && xfi->xshm && xfi->bpp == 32)
+	{
+		xfi->staging = xf_shm_image_new(xfi, xfi->width, xfi->height);
 
-	xfi->image = XCreateImage(xfi->display, xfi->visual, xfi->depth, ZPixmap, 0,
-			(char*) xfi->primary_buffer, xfi->width, xfi->height, xfi->scanline_pad, 0);
+		if ((xfi->staging != NULL) && (xfi->staging->shm != true))
+		{
+			xf_shm_image_free(xfi, xfi->staging);
+			xfi->staging = NULL;
+		}
+	}
 
 	xfi->bmp_codec_none = (uint8*) xmalloc(64 * 64 * 4);
 
@@ -920,6 +1122,19 @@ void xf_window_free(xfInfo* xfi)
 		xfi->image = NULL;
 	}
 
+	if (xfi->primary_image)
+	{
+		xf_shm_image_free(xfi, xfi->primary_image);
+		xfi->primary_image = NULL;
+		xfi->shm_primary = false;
+	}
+
+	if (xfi->staging)
+	{
+		xf_shm_image_free(xfi, xfi->staging);
+		xfi->staging = NULL;
+	}
+
 	if (context != NULL)
 	{
 			cache_free(context->cache);
@@ -30,6 +30,7 @@
 
 typedef struct xf_info xfInfo;
 
+#include "xf_shm.h"
 #include "xf_window.h"
 #include "xf_monitor.h"
 
@@ -53,6 +54,7 @@ struct xf_bitmap
 {
 	rdpBitmap bitmap;
 	Pixmap pixmap;
+	uint8* scratch;
 };
 typedef struct xf_bitmap xfBitmap;
 
@@ -115,6 +117,12 @@ struct xf_info
 	boolean sw_gdi;
 	uint8* primary_buffer;
 
+	boolean xshm;
+	boolean xshm_pixmaps;
+	boolean shm_primary;
+	xfShmImage* primary_image;
+	xfShmImage* staging;
+
 	boolean focused;
 	boolean mouse_active;
 	boolean mouse_motion;
@@ -157,6 +165,7 @@ struct xf_info
 };
 
 void xf_toggle_fullscreen(xfInfo* xfi);
+void xf_sw_update_primary(xfInfo* xfi, GC gc, int x, int y, int w, int h);
 boolean xf_post_connect(freerdp* instance);
 
 enum XF_EXIT_CODE
@@ -84,6 +84,8 @@ void tf_end_paint(rdpContext* context)
 {
 	rdpGdi* gdi = context->gdi;
 
+	gdi_flush(gdi);
+
 	if (gdi->primary->hdc->hwnd->invalid->null)
 		return;
 }
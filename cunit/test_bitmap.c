@@ -18,6 +18,7 @@
  */
 
 #include <freerdp/freerdp.h>
+#include <freerdp/utils/memory.h>
 #include <freerdp/utils/hexdump.h>
 #include <freerdp/utils/stream.h>
 #include <freerdp/codec/bitmap.h>
@@ -1141,6 +1142,7 @@ int add_bitmap_suite(void)
 	add_test_suite(bitmap);
 
 	add_test_function(bitmap);
+	add_test_function(bitmap_compress);
 
 	return 0;
 }
@@ -1248,3 +1250,118 @@ void test_bitmap(void)
 
 	free(t);
 }
+
+static void fill_test_bitmap(uint8* data, int width, int height, int Bpp, uint32 seed)
+{
+	int x, y, i;
+	uint32 pixel;
+
+	for (y = 0; y < height; y++)
+	{
+		for (x = 0; x < width; x++)
+		{
+			seed = seed * 1103515245 + 12345;
+
+			if (y < height / 4)
+				pixel = 0x00C0C0C0; /* flat background */
+			else if (y < height / 2)
+				pixel = ((x / 3 + y) % 5 == 0) ? 0x00101010 : 0x00FFFFFF; /* text-like strokes */
+			else if (y < (height * 3) / 4)
+				pixel = (x * 4) | (y << 10) | ((x + y) << 17); /* gradient */
+			else
+				pixel = seed >> 8; /* noise */
+
+			for (i = 0; i < Bpp; i++)
+				data[(y * width + x) * Bpp + i] = (pixel >> (i * 8)) & 0xFF;
+		}
+	}
+}
+
+static boolean test_bitmap_round_trip(int width, int height, int bpp, uint32 seed)
+{
+	int Bpp;
+	STREAM* s;
+	uint8* src;
+	uint8* dst;
+	boolean status;
+
+	Bpp = (bpp + 7) / 8;
+	src = (uint8*) xmalloc(width * height * Bpp);
+	dst = (uint8*) xzalloc(width * height * Bpp);
+	fill_test_bitmap(src, width, height, Bpp, seed);
+
+	s = stream_new(64);
+	status = bitmap_compress(src, s, width, height, width * Bpp, bpp);
+
+	if (status)
+		status = bitmap_decompress(stream_get_head(s), dst, width, height, stream_get_length(s), bpp, bpp);
+
+	if (status)
+		status = (memcmp(src, dst, width * height * Bpp) == 0) ? true : false;
+
+	stream_free(s);
+	xfree(src);
+	xfree(dst);
+
+	return status;
+}
+
+static int test_planar_round_trip(int width, int height, uint8 flags, uint32 seed)
+{
+	int i;
+	int diff;
+	int max_diff;
+	STREAM* s;
+	uint8* src;
+	uint8* dst;
+
+	src = (uint8*) xmalloc(width * height * 4);
+	dst = (uint8*) xzalloc(width * height * 4);
+	fill_test_bitmap(src, width, height, 4, seed);
+
+	s = stream_new(64);
+	max_diff = -1;
+
+	if (bitmap_planar_compress(src, s, width, height, width * 4, flags) &&
+		bitmap_decompress(stream_get_head(s), dst, width, height, stream_get_length(s), 32, 32))
+	{
+		max_diff = 0;
+
+		for (i = 0; i < width * height * 4; i++)
+		{
+			if ((i % 4) == 3 && (flags & PLANAR_FORMAT_HEADER_NA))
+				diff = (dst[i] == 0xFF) ? 0 : 256;
+			else
+				diff = abs(src[i] - dst[i]);
+
+			max_diff = MAX(max_diff, diff);
+		}
+	}
+
+	stream_free(s);
+	xfree(src);
+	xfree(dst);
+
+	return max_diff;
+}
+
+void test_bitmap_compress(void)
+{
+	int max_diff;
+
+	CU_ASSERT(test_bitmap_round_trip(64, 64, 8, 1) == true);
+	CU_ASSERT(test_bitmap_round_trip(64, 64, 15, 2) == true);
+	CU_ASSERT(test_bitmap_round_trip(64, 64, 16, 3) == true);
+	CU_ASSERT(test_bitmap_round_trip(64, 64, 24, 4) == true);
+	CU_ASSERT(test_bitmap_round_trip(13, 7, 16, 5) == true);
+	CU_ASSERT(test_bitmap_round_trip(1, 1, 24, 6) == true);
+	CU_ASSERT(test_bitmap_round_trip(300, 260, 8, 7) == true);
+
+	CU_ASSERT(test_bitmap_round_trip(64, 64, 32, 8) == true);
+	CU_ASSERT(test_bitmap_round_trip(13, 7, 32, 9) == true);
+	CU_ASSERT(test_planar_round_trip(64, 64, PLANAR_FORMAT_HEADER_NA, 10) == 0);
+
+	/* color loss only affects the chroma planes, bound the error accordingly */
+	max_diff = test_planar_round_trip(64, 64, 3, 11);
+	CU_ASSERT(max_diff >= 0 && max_diff <= 8);
+}
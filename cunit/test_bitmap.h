@@ -24,3 +24,4 @@ int clean_bitmap_suite(void);
 int add_bitmap_suite(void);
 
 void test_bitmap(void);
+void test_bitmap_compress(void);
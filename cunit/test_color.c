@@ -19,7 +19,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <freerdp/freerdp.h>
+#include <freerdp/constants.h>
 #include <freerdp/gdi/gdi.h>
 #include <freerdp/codec/color.h>
 #include "test_color.h"
@@ -44,6 +46,8 @@ int add_color_suite(void)
 	add_test_function(color_GetRGB16);
 	add_test_function(color_GetBGR_565);
 	add_test_function(color_GetBGR16);
+	add_test_function(color_image_convert);
+	add_test_function(color_image_convert_simd);
 
 	return 0;
 }
@@ -150,3 +154,131 @@ void test_color_GetBGR16(void)
 	CU_ASSERT(b == 0xEF);
 }
 
+
+void test_color_image_convert(void)
+{
+	uint32 dst32[4];
+	uint16 src16[4] = { 0xAE7D, 0xAE7D, 0x0000, 0xFFFF };
+	uint8 src24[12] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C };
+	uint32 src32[4] = { 0x00ADCFEF, 0x12345678, 0x00000000, 0xFFFFFFFF };
+	HCLRCONV clrconv = freerdp_clrconv_new(0);
+
+	freerdp_image_convert_set_cpu_opt(0);
+
+	/* flip the two scanlines while converting */
+	freerdp_image_convert_ex((uint8*) src16, (uint8*) dst32, 2, 2, 16, 32, 0, true, clrconv);
+	CU_ASSERT(dst32[0] == 0x00000000);
+	CU_ASSERT(dst32[1] == 0x00FFFFFF);
+	CU_ASSERT(dst32[2] == 0x00ADCFEF);
+	CU_ASSERT(dst32[3] == 0x00ADCFEF);
+
+	clrconv->invert = true;
+	freerdp_image_convert((uint8*) src16, (uint8*) dst32, 4, 1, 16, 32, clrconv);
+	CU_ASSERT(dst32[0] == 0x00EFCFAD);
+	clrconv->invert = false;
+
+	freerdp_image_convert(src24, (uint8*) dst32, 4, 1, 24, 32, clrconv);
+	CU_ASSERT(dst32[0] == 0xFF030201);
+	CU_ASSERT(dst32[3] == 0xFF0C0B0A);
+
+	/* destination stride wider than the image leaves the padding alone */
+	memset(dst32, 0xCC, sizeof(dst32));
+	freerdp_image_convert_ex((uint8*) src32, (uint8*) dst32, 1, 2, 32, 32, 8, false, clrconv);
+	CU_ASSERT(dst32[0] == 0x00ADCFEF);
+	CU_ASSERT(dst32[1] == 0xCCCCCCCC);
+	CU_ASSERT(dst32[2] == 0x12345678);
+	CU_ASSERT(dst32[3] == 0xCCCCCCCC);
+
+	/* in-place flip of three scanlines with alpha forced */
+	clrconv->alpha = true;
+	memcpy(dst32, src32, sizeof(src32));
+	freerdp_image_convert_ex((uint8*) dst32, (uint8*) dst32, 1, 3, 32, 32, 0, true, clrconv);
+	CU_ASSERT(dst32[0] == 0xFF000000);
+	CU_ASSERT(dst32[1] == 0xFF345678);
+	CU_ASSERT(dst32[2] == 0xFFADCFEF);
+	CU_ASSERT(dst32[3] == 0xFFFFFFFF);
+
+	freerdp_clrconv_free(clrconv);
+}
+
+static boolean test_image_convert_matches(uint8* srcData, int width, int height,
+		int srcBpp, int dstBpp, HCLRCONV clrconv, uint32 cpu_opt)
+{
+	int y;
+	int size;
+	int scanline;
+	boolean match;
+	uint8* expected;
+	uint8* actual;
+	uint8* flipped;
+
+	scanline = width * ((dstBpp + 7) / 8);
+	size = scanline * height;
+
+	freerdp_image_convert_set_cpu_opt(0);
+	expected = freerdp_image_convert(srcData, NULL, width, height, srcBpp, dstBpp, clrconv);
+
+	freerdp_image_convert_set_cpu_opt(cpu_opt);
+	actual = freerdp_image_convert(srcData, NULL, width, height, srcBpp, dstBpp, clrconv);
+	flipped = freerdp_image_convert_ex(srcData, NULL, width, height, srcBpp, dstBpp, 0, true, clrconv);
+
+	match = (memcmp(expected, actual, size) == 0);
+
+	for (y = 0; y < height; y++)
+	{
+		if (memcmp(&expected[y * scanline], &flipped[(height - y - 1) * scanline], scanline) != 0)
+			match = false;
+	}
+
+	free(expected);
+	free(actual);
+	free(flipped);
+
+	return match;
+}
+
+void test_color_image_convert_simd(void)
+{
+	int i, j;
+	int width;
+	uint8* srcData;
+	uint32 cpu_opt;
+	HCLRCONV clrconv;
+	int pairs[][2] = { { 16, 32 }, { 24, 32 }, { 32, 32 }, { 15, 32 }, { 16, 24 }, { 32, 16 } };
+	int widths[] = { 1, 5, 8, 13, 16, 31, 64, 67 };
+
+	cpu_opt = CPU_SSE2;
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+	if (__builtin_cpu_supports("avx2"))
+		cpu_opt |= CPU_AVX2;
+#endif
+
+	clrconv = freerdp_clrconv_new(0);
+	srcData = (uint8*) malloc(67 * 3 * 4);
+
+	for (i = 0; i < 67 * 3 * 4; i++)
+		srcData[i] = (uint8) ((i * 73) ^ (i >> 3));
+
+	for (i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++)
+	{
+		for (j = 0; j < sizeof(widths) / sizeof(widths[0]); j++)
+		{
+			width = widths[j];
+
+			clrconv->alpha = false;
+			clrconv->invert = false;
+			CU_ASSERT(test_image_convert_matches(srcData, width, 3, pairs[i][0], pairs[i][1], clrconv, cpu_opt));
+
+			clrconv->invert = true;
+			CU_ASSERT(test_image_convert_matches(srcData, width, 3, pairs[i][0], pairs[i][1], clrconv, cpu_opt));
+
+			clrconv->alpha = true;
+			CU_ASSERT(test_image_convert_matches(srcData, width, 4, pairs[i][0], pairs[i][1], clrconv, cpu_opt));
+		}
+	}
+
+	freerdp_image_convert_set_cpu_opt(0);
+
+	free(srcData);
+	freerdp_clrconv_free(clrconv);
+}
@@ -0,0 +1,190 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * Disk Redirection Unit Tests
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <freerdp/freerdp.h>
+#include <freerdp/utils/memory.h>
+#include <freerdp/utils/sleep.h>
+#include <freerdp/utils/stream.h>
+
+#include "channels/rdpdr/rdpdr_types.h"
+#include "channels/rdpdr/rdpdr_constants.h"
+
+#include "test_disk.h"
+
+int DeviceServiceEntry(PDEVICE_SERVICE_ENTRY_POINTS pEntryPoints);
+
+static DEVICE* disk_device = NULL;
+static volatile int disk_completed = 0;
+static char disk_path[] = "/tmp/test_disk_XXXXXX";
+static char disk_file[64];
+static const char disk_data[] = "0123456789";
+
+int init_disk_suite(void)
+{
+	return 0;
+}
+
+int clean_disk_suite(void)
+{
+	return 0;
+}
+
+int add_disk_suite(void)
+{
+	add_test_suite(disk);
+
+	add_test_function(disk_read_length);
+
+	return 0;
+}
+
+static void test_register_device(DEVMAN* devman, DEVICE* device)
+{
+	disk_device = device;
+}
+
+static void test_irp_complete(IRP* irp)
+{
+	disk_completed++;
+}
+
+static void test_irp_discard(IRP* irp)
+{
+	stream_free(irp->input);
+	stream_free(irp->output);
+	xfree(irp);
+}
+
+static IRP* test_irp_new(uint32 MajorFunction, uint32 FileId)
+{
+	IRP* irp;
+
+	irp = xnew(IRP);
+	irp->device = disk_device;
+	irp->FileId = FileId;
+	irp->MajorFunction = MajorFunction;
+	irp->input = stream_new(256);
+	irp->output = stream_new(256);
+	irp->Complete = test_irp_complete;
+	irp->Discard = test_irp_discard;
+
+	return irp;
+}
+
+/* the IRP is completed by one of the device workers */
+static void test_irp_process(IRP* irp)
+{
+	int i;
+
+	disk_completed = 0;
+	stream_set_pos(irp->input, 0);
+	disk_device->IRPRequest(disk_device, irp);
+
+	for (i = 0; i < 500 && disk_completed == 0; i++)
+		freerdp_usleep(10000);
+
+	CU_ASSERT(disk_completed == 1);
+	stream_set_pos(irp->output, 0);
+}
+
+static uint32 test_disk_create(void)
+{
+	IRP* irp;
+	uint32 FileId;
+	const char* name = "\\test.bin";
+	int i, length = strlen(name);
+
+	irp = test_irp_new(IRP_MJ_CREATE, 0);
+	stream_write_uint32(irp->input, FILE_READ_DATA); /* DesiredAccess */
+	stream_write_zero(irp->input, 16);
+	stream_write_uint32(irp->input, FILE_OPEN); /* CreateDisposition */
+	stream_write_uint32(irp->input, 0); /* CreateOptions */
+	stream_write_uint32(irp->input, (length + 1) * 2); /* PathLength */
+
+	for (i = 0; i <= length; i++)
+		stream_write_uint16(irp->input, name[i]);
+
+	test_irp_process(irp);
+	CU_ASSERT(irp->IoStatus == 0);
+	stream_read_uint32(irp->output, FileId);
+	test_irp_discard(irp);
+
+	return FileId;
+}
+
+static void test_disk_read(uint32 FileId, uint32 Length)
+{
+	IRP* irp;
+	uint32 result;
+
+	irp = test_irp_new(IRP_MJ_READ, FileId);
+	stream_write_uint32(irp->input, Length);
+	stream_write_uint64(irp->input, 0); /* Offset */
+
+	test_irp_process(irp);
+	CU_ASSERT(irp->IoStatus == 0);
+	stream_read_uint32(irp->output, result);
+	CU_ASSERT(result == sizeof(disk_data) - 1);
+	CU_ASSERT(memcmp(stream_get_tail(irp->output), disk_data, sizeof(disk_data) - 1) == 0);
+	test_irp_discard(irp);
+}
+
+void test_disk_read_length(void)
+{
+	FILE* fp;
+	uint32 FileId;
+	RDP_PLUGIN_DATA plugin_data;
+	DEVICE_SERVICE_ENTRY_POINTS entry_points;
+
+	CU_ASSERT_FATAL(mkdtemp(disk_path) != NULL);
+	snprintf(disk_file, sizeof(disk_file), "%s/test.bin", disk_path);
+	fp = fopen(disk_file, "wb");
+	CU_ASSERT_FATAL(fp != NULL);
+	fwrite(disk_data, 1, sizeof(disk_data) - 1, fp);
+	fclose(fp);
+
+	memset(&plugin_data, 0, sizeof(plugin_data));
+	plugin_data.data[0] = "disk";
+	plugin_data.data[1] = "test";
+	plugin_data.data[2] = disk_path;
+
+	memset(&entry_points, 0, sizeof(entry_points));
+	entry_points.RegisterDevice = test_register_device;
+	entry_points.plugin_data = &plugin_data;
+
+	DeviceServiceEntry(&entry_points);
+	CU_ASSERT_FATAL(disk_device != NULL);
+
+	FileId = test_disk_create();
+	CU_ASSERT(FileId != 0);
+
+	/* lengths chosen by the server must not wrap or overrun the response */
+	test_disk_read(FileId, 0xFFFFFFFF);
+	test_disk_read(FileId, 0xFFFFFFFC);
+	test_disk_read(FileId, 0x80000000);
+	test_disk_read(FileId, 64);
+
+	disk_device->Free(disk_device);
+	disk_device = NULL;
+
+	unlink(disk_file);
+	rmdir(disk_path);
+}
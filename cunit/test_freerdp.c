@@ -34,6 +34,7 @@
 #include "test_channels.h"
 #include "test_cliprdr.h"
 #include "test_drdynvc.h"
+#include "test_disk.h"
 #include "test_librfx.h"
 #include "test_freerdp.h"
 #include "test_rail.h"
@@ -183,6 +184,10 @@ int main(int argc, char* argv[])
 			{
 				add_drdynvc_suite();
 			}
+			else if (strcmp("disk", argv[*pindex]) == 0)
+			{
+				add_disk_suite();
+			}
 			else if (strcmp("librfx", argv[*pindex]) == 0)
 			{
 				add_librfx_suite();
@@ -21,6 +21,8 @@
 #include <string.h>
 #include <stdlib.h>
 #include <freerdp/freerdp.h>
+#include <freerdp/constants.h>
+#include <freerdp/utils/memory.h>
 
 #include <freerdp/gdi/gdi.h>
 
@@ -34,8 +36,13 @@
 #include <freerdp/gdi/palette.h>
 #include <freerdp/gdi/drawing.h>
 #include <freerdp/gdi/clipping.h>
+#include <freerdp/gdi/16bpp.h>
 #include <freerdp/gdi/32bpp.h>
 
+#include "libfreerdp-gdi/gdi.h"
+#include "libfreerdp-gdi/glyph.h"
+#include "libfreerdp-gdi/display_list.h"
+
 #include "test_libgdi.h"
 
 int init_libgdi_suite(void)
@@ -72,8 +79,11 @@ int add_libgdi_suite(void)
 	add_test_function(gdi_BitBlt_32bpp);
 	add_test_function(gdi_BitBlt_16bpp);
 	add_test_function(gdi_BitBlt_8bpp);
+	add_test_function(gdi_BitBlt_cpu_opt);
+	add_test_function(gdi_GlyphRun);
 	add_test_function(gdi_ClipCoords);
 	add_test_function(gdi_InvalidateRegion);
+	add_test_function(gdi_DisplayList);
 
 	return 0;
 }
@@ -2724,6 +2734,199 @@ void test_gdi_BitBlt_8bpp(void)
 	CU_ASSERT(CompareBitmaps(hBmpDst, hBmp_SPna) == 1)
 }
 
+static const int cpu_opt_rops[] =
+{
+	GDI_NOTSRCCOPY, GDI_DSTINVERT, GDI_SRCERASE, GDI_NOTSRCERASE,
+	GDI_SRCINVERT, GDI_SRCAND, GDI_SRCPAINT, GDI_DSna, GDI_MERGEPAINT,
+	GDI_SPna, GDI_MERGECOPY, GDI_PATPAINT, GDI_DPa, GDI_PDxn,
+	GDI_PATINVERT, GDI_PATCOPY
+};
+
+static HGDI_BITMAP test_gdi_cpu_opt_bitmap(int width, int height, int bpp, int seed)
+{
+	int i;
+	uint8* data;
+	int size = width * height * ((bpp + 7) / 8);
+
+	data = (uint8*) malloc(size);
+
+	for (i = 0; i < size; i++)
+		data[i] = (uint8) ((i * 7 + seed) ^ (i >> 3));
+
+	return gdi_CreateBitmap(width, height, bpp, data);
+}
+
+void test_gdi_BitBlt_cpu_opt(void)
+{
+	int i, j;
+	int bpp;
+	int size;
+	HGDI_DC hdcSrc;
+	HGDI_DC hdcDst;
+	HGDI_BRUSH hBrush;
+	HGDI_BITMAP hBmpSrc;
+	HGDI_BITMAP hBmpPat;
+	HGDI_BITMAP hBmpDst;
+	HGDI_BITMAP hBmpRef;
+	HGDI_BITMAP hBmpDstOriginal;
+
+	/* odd sizes and offsets leave a remainder after the wide kernels */
+	for (bpp = 8; bpp <= 32; bpp *= 2)
+	{
+		hdcSrc = gdi_GetDC();
+		hdcSrc->bytesPerPixel = bpp / 8;
+		hdcSrc->bitsPerPixel = bpp;
+
+		hdcDst = gdi_GetDC();
+		hdcDst->bytesPerPixel = bpp / 8;
+		hdcDst->bitsPerPixel = bpp;
+
+		hBmpSrc = test_gdi_cpu_opt_bitmap(37, 9, bpp, 1);
+		hBmpDstOriginal = test_gdi_cpu_opt_bitmap(37, 9, bpp, 2);
+		hBmpPat = test_gdi_cpu_opt_bitmap(8, 8, bpp, 3);
+		hBmpDst = test_gdi_cpu_opt_bitmap(37, 9, bpp, 0);
+		hBmpRef = test_gdi_cpu_opt_bitmap(37, 9, bpp, 0);
+		size = 37 * 9 * (bpp / 8);
+
+		hBrush = gdi_CreatePatternBrush(hBmpPat);
+		gdi_SelectObject(hdcDst, (HGDIOBJECT) hBrush);
+		gdi_SelectObject(hdcSrc, (HGDIOBJECT) hBmpSrc);
+
+		for (i = 0; i < sizeof(cpu_opt_rops) / sizeof(int); i++)
+		{
+			for (j = 0; j < 2; j++)
+			{
+				memcpy(hBmpDst->data, hBmpDstOriginal->data, size);
+				gdi_SelectObject(hdcDst, (HGDIOBJECT) hBmpDst);
+
+				gdi_set_cpu_opt(j ? CPU_SSE2 : 0);
+
+				if ((cpu_opt_rops[i] == GDI_DPa) || (cpu_opt_rops[i] == GDI_PDxn))
+					gdi_PatBlt(hdcDst, 1, 1, 35, 7, cpu_opt_rops[i]);
+				else
+					gdi_BitBlt(hdcDst, 1, 1, 35, 7, hdcSrc, 2, 0, cpu_opt_rops[i]);
+
+				if (j == 0)
+					memcpy(hBmpRef->data, hBmpDst->data, size);
+			}
+
+			CU_ASSERT(memcmp(hBmpDst->data, hBmpRef->data, size) == 0);
+		}
+
+		gdi_set_cpu_opt(0);
+
+		gdi_DeleteObject((HGDIOBJECT) hBrush);
+		gdi_DeleteObject((HGDIOBJECT) hBmpSrc);
+		gdi_DeleteObject((HGDIOBJECT) hBmpDst);
+		gdi_DeleteObject((HGDIOBJECT) hBmpRef);
+		gdi_DeleteObject((HGDIOBJECT) hBmpDstOriginal);
+		gdi_DeleteDC(hdcSrc);
+		gdi_DeleteDC(hdcDst);
+	}
+}
+
+static const uint8 glyph_run_mask[] =
+{
+	0xFF, 0xE0,
+	0x80, 0x20,
+	0xA5, 0xA0,
+	0x5A, 0x40,
+	0xC3, 0x60
+};
+
+void test_gdi_GlyphRun(void)
+{
+	int i, j;
+	int x, y;
+	int gx, gy;
+	int bpp;
+	int size;
+	uint8* dstp;
+	uint32 color;
+	rdpGlyph glyph;
+	HGDI_DC hdc;
+	HGDI_BITMAP hBmp;
+	HGDI_BITMAP hBmpRef;
+	HGDI_BITMAP hBmpOriginal;
+	GDI_GLYPH_RUN* run;
+	int positions[3][2] = { { -3, 1 }, { 9, 2 }, { 30, 5 } };
+
+	memset(&glyph, 0, sizeof(rdpGlyph));
+	glyph.cx = 11;
+	glyph.cy = 5;
+	glyph.aj = (uint8*) glyph_run_mask;
+
+	/* glyphs clipped on the left, right and bottom of the surface */
+	for (bpp = 16; bpp <= 32; bpp *= 2)
+	{
+		hdc = gdi_GetDC();
+		hdc->bytesPerPixel = bpp / 8;
+		hdc->bitsPerPixel = bpp;
+		hdc->alpha = 1;
+		gdi_SetTextColor(hdc, 0x00123456);
+
+		hBmp = test_gdi_cpu_opt_bitmap(37, 8, bpp, 4);
+		hBmpRef = test_gdi_cpu_opt_bitmap(37, 8, bpp, 4);
+		hBmpOriginal = test_gdi_cpu_opt_bitmap(37, 8, bpp, 4);
+		size = 37 * 8 * (bpp / 8);
+		gdi_SelectObject(hdc, (HGDIOBJECT) hBmp);
+
+		if (bpp == 16)
+			color = gdi_get_color_16bpp(hdc, hdc->textColor);
+		else
+			color = gdi_get_color_32bpp(hdc, hdc->textColor);
+
+		for (i = 0; i < 3; i++)
+		{
+			for (y = 0; y < glyph.cy; y++)
+			{
+				for (x = 0; x < glyph.cx; x++)
+				{
+					gx = positions[i][0] + x;
+					gy = positions[i][1] + y;
+
+					if ((gx < 0) || (gx >= 37) || (gy >= 8))
+						continue;
+
+					if (!gdi_is_mono_pixel_set(glyph.aj, x, y, glyph.cx))
+						continue;
+
+					dstp = &hBmpRef->data[(gy * 37 + gx) * (bpp / 8)];
+
+					if (bpp == 16)
+						*((uint16*) dstp) = (uint16) color;
+					else
+						*((uint32*) dstp) = (*((uint32*) dstp) & 0xFF000000) | (color & 0x00FFFFFF);
+				}
+			}
+		}
+
+		run = gdi_glyph_run_new();
+
+		for (j = 0; j < 2; j++)
+		{
+			gdi_set_cpu_opt(j ? CPU_SSE2 : 0);
+			memcpy(hBmp->data, hBmpOriginal->data, size);
+
+			for (i = 0; i < 3; i++)
+				gdi_glyph_run_add(run, hdc, &glyph, positions[i][0], positions[i][1]);
+
+			gdi_glyph_run_draw(run, hdc);
+
+			CU_ASSERT(run->count == 0);
+			CU_ASSERT(memcmp(hBmp->data, hBmpRef->data, size) == 0);
+		}
+
+		gdi_set_cpu_opt(0);
+
+		gdi_glyph_run_free(run);
+		gdi_DeleteObject((HGDIOBJECT) hBmp);
+		gdi_DeleteObject((HGDIOBJECT) hBmpRef);
+		gdi_DeleteObject((HGDIOBJECT) hBmpOriginal);
+		gdi_DeleteDC(hdc);
+	}
+}
+
 void test_gdi_ClipCoords(void)
 {
 	HGDI_DC hdc;
@@ -2870,6 +3073,7 @@ void test_gdi_InvalidateRegion(void)
 	invalid = hdc->hwnd->invalid;
 	
 	hdc->hwnd->count = 16;
+	hdc->hwnd->ninvalid = 0;
 	hdc->hwnd->cinvalid = (HGDI_RGN) malloc(sizeof(GDI_RGN) * hdc->hwnd->count);
 
 	rgn1 = gdi_CreateRectRgn(0, 0, 0, 0);
@@ -2989,3 +3193,131 @@ void test_gdi_InvalidateRegion(void)
 	gdi_InvalidateRegion(hdc, rgn1->x, rgn1->y, rgn1->w, rgn1->h);
 	CU_ASSERT(gdi_EqualRgn(invalid, rgn2) == 1);
 }
+
+static void test_gdi_display_list_draw(rdpContext* context)
+{
+	OPAQUE_RECT_ORDER opaque_rect;
+	SCRBLT_ORDER scrblt;
+	DSTBLT_ORDER dstblt;
+
+	/* painted over by the fill that follows */
+	opaque_rect.nLeftRect = 0;
+	opaque_rect.nTopRect = 0;
+	opaque_rect.nWidth = 8;
+	opaque_rect.nHeight = 8;
+	opaque_rect.color = 0x0000FF;
+	gdi_opaque_rect(context, &opaque_rect);
+
+	opaque_rect.nWidth = 16;
+	opaque_rect.color = 0xFF0000;
+	gdi_opaque_rect(context, &opaque_rect);
+
+	/* two halves of the same fill */
+	opaque_rect.nLeftRect = 0;
+	opaque_rect.nTopRect = 8;
+	opaque_rect.nWidth = 8;
+	opaque_rect.nHeight = 8;
+	opaque_rect.color = 0x00FF00;
+	gdi_opaque_rect(context, &opaque_rect);
+
+	opaque_rect.nLeftRect = 8;
+	gdi_opaque_rect(context, &opaque_rect);
+
+	/* read by the screen blit, kept even though it is painted over after */
+	opaque_rect.nLeftRect = 0;
+	opaque_rect.nTopRect = 16;
+	opaque_rect.nWidth = 8;
+	opaque_rect.nHeight = 8;
+	opaque_rect.color = 0x123456;
+	gdi_opaque_rect(context, &opaque_rect);
+
+	scrblt.nLeftRect = 8;
+	scrblt.nTopRect = 16;
+	scrblt.nWidth = 8;
+	scrblt.nHeight = 8;
+	scrblt.bRop = 0xCC;
+	scrblt.nXSrc = 0;
+	scrblt.nYSrc = 16;
+	gdi_scrblt(context, &scrblt);
+
+	opaque_rect.color = 0x654321;
+	gdi_opaque_rect(context, &opaque_rect);
+
+	/* inverted, then painted over along with what it inverted */
+	opaque_rect.nLeftRect = 0;
+	opaque_rect.nTopRect = 24;
+	opaque_rect.nWidth = 8;
+	opaque_rect.nHeight = 8;
+	opaque_rect.color = 0x00FFFF;
+	gdi_opaque_rect(context, &opaque_rect);
+
+	dstblt.nLeftRect = 0;
+	dstblt.nTopRect = 24;
+	dstblt.nWidth = 16;
+	dstblt.nHeight = 8;
+	dstblt.bRop = 0x55;
+	gdi_dstblt(context, &dstblt);
+
+	opaque_rect.color = 0xFF00FF;
+	gdi_opaque_rect(context, &opaque_rect);
+}
+
+void test_gdi_DisplayList(void)
+{
+	int size;
+	rdpGdi gdi;
+	uint8* reference;
+	rdpContext context;
+	GDI_DISPLAY_LIST_STATS stats;
+
+	memset(&gdi, 0, sizeof(rdpGdi));
+	memset(&context, 0, sizeof(rdpContext));
+
+	context.gdi = &gdi;
+	gdi.context = &context;
+	gdi.width = 16;
+	gdi.height = 32;
+	gdi.srcBpp = 32;
+	gdi.dstBpp = 32;
+	gdi.bytesPerPixel = 4;
+	gdi.clrconv = (HCLRCONV) xzalloc(sizeof(CLRCONV));
+	gdi.hdc = gdi_GetDC();
+	gdi.primary = gdi_bitmap_new_ex(&gdi, gdi.width, gdi.height, gdi.dstBpp, NULL);
+	gdi.drawing = gdi.primary;
+
+	size = gdi.width * gdi.height * gdi.bytesPerPixel;
+	reference = (uint8*) xmalloc(size);
+
+	/* drawn straight away */
+	memset(gdi.primary->bitmap->data, 0, size);
+	test_gdi_display_list_draw(&context);
+	memcpy(reference, gdi.primary->bitmap->data, size);
+
+	CU_ASSERT(gdi_get_display_list_stats(&gdi, &stats) == false);
+
+	/* recorded, then played back */
+	gdi.display_list = gdi_display_list_new();
+	memset(gdi.primary->bitmap->data, 0, size);
+	test_gdi_display_list_draw(&context);
+
+	CU_ASSERT(((GDI_DISPLAY_LIST*) gdi.display_list)->count == 10);
+
+	gdi_flush(&gdi);
+
+	CU_ASSERT(((GDI_DISPLAY_LIST*) gdi.display_list)->count == 0);
+	CU_ASSERT(memcmp(gdi.primary->bitmap->data, reference, size) == 0);
+
+	CU_ASSERT(gdi_get_display_list_stats(&gdi, &stats) == true);
+	CU_ASSERT(stats.orders_recorded == 10);
+	CU_ASSERT(stats.orders_culled == 2);
+	CU_ASSERT(stats.orders_merged == 1);
+	CU_ASSERT(stats.orders_rasterized == 7);
+	CU_ASSERT(stats.pixels_culled == 64 + 64);
+	CU_ASSERT(stats.pixels_touched == 128 + 128 + 64 * 3 + 128 + 64);
+
+	gdi_display_list_free((GDI_DISPLAY_LIST*) gdi.display_list);
+	gdi_bitmap_free_ex(gdi.primary);
+	gdi_DeleteDC(gdi.hdc);
+	xfree(gdi.clrconv);
+	xfree(reference);
+}
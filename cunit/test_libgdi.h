@@ -43,5 +43,8 @@ void test_gdi_FillRect(void);
 void test_gdi_BitBlt_32bpp(void);
 void test_gdi_BitBlt_16bpp(void);
 void test_gdi_BitBlt_8bpp(void);
+void test_gdi_BitBlt_cpu_opt(void);
+void test_gdi_GlyphRun(void);
 void test_gdi_ClipCoords(void);
 void test_gdi_InvalidateRegion(void);
+void test_gdi_DisplayList(void);
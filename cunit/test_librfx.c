@@ -38,6 +38,7 @@
 #include "rfx_dwt.h"
 #include "rfx_decode.h"
 #include "rfx_encode.h"
+#include "rfx_rate.h"
 
 #include "test_librfx.h"
 
@@ -182,6 +183,7 @@ int add_librfx_suite(void)
 	add_test_function(decode);
 	add_test_function(encode);
 	add_test_function(message);
+	add_test_function(rate_control);
 
 	return 0;
 }
@@ -408,3 +410,78 @@ void test_message(void)
 	rfx_context_free(context);
 	free(rgb_data);
 }
+
+void test_rate_control(void)
+{
+	int i;
+	uint32 seed;
+	STREAM* s;
+	RFX_RECT rect = {0, 0, 128, 64};
+	RFX_MESSAGE* message;
+	RFX_CONTEXT* encoder;
+	RFX_CONTEXT* decoder;
+
+	/* left tile flat like a text background, right tile noise like a photo */
+	rgb_data = (uint8*) malloc(128 * 64 * 3);
+	memset(rgb_data, 0xFF, 128 * 64 * 3);
+	seed = 1;
+
+	for (i = 0; i < 64 * 64 * 3; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		rgb_data[(i / 192) * 128 * 3 + 64 * 3 + (i % 192)] = (uint8) (seed >> 16);
+	}
+
+	CU_ASSERT(rfx_rate_classify_tile(rgb_data, 64, 64, 128 * 3, 3) == RFX_TILE_TEXT);
+	CU_ASSERT(rfx_rate_classify_tile(rgb_data + 64 * 3, 64, 64, 128 * 3, 3) == RFX_TILE_NATURAL);
+
+	encoder = rfx_context_new();
+	encoder->mode = RLGR3;
+	encoder->width = 128;
+	encoder->height = 64;
+	rfx_context_set_pixel_format(encoder, RFX_PIXEL_FORMAT_RGB);
+
+	decoder = rfx_context_new();
+	decoder->mode = RLGR3;
+	decoder->width = 128;
+	decoder->height = 64;
+	rfx_context_set_pixel_format(decoder, RFX_PIXEL_FORMAT_RGB);
+
+	/* a starved link ends up with the coarsest photo tiles and readable text */
+	rfx_context_set_rate_control(encoder, 1000);
+
+	for (i = 0; i < 8; i++)
+	{
+		s = stream_new(65536);
+		rfx_compose_message(encoder, s, &rect, 1, rgb_data, 128, 64, 128 * 3);
+		stream_seal(s);
+		stream_set_pos(s, 0);
+
+		message = rfx_process_message(decoder, s->p, s->size);
+		CU_ASSERT(message->num_tiles == 2);
+		CU_ASSERT(decoder->num_quants == RFX_QUANT_LEVELS);
+
+		rfx_message_free(decoder, message);
+		stream_free(s);
+	}
+
+	CU_ASSERT(rfx_context_get_quality(encoder) == RFX_QUANT_LEVELS - 1);
+	CU_ASSERT(rfx_rate_tile_level(encoder->priv->rate, 0) == RFX_QUANT_LEVEL_TEXT);
+	CU_ASSERT(rfx_rate_tile_level(encoder->priv->rate, 1) == RFX_QUANT_LEVELS - 1);
+
+	/* a fast link recovers one level per frame up to the finest */
+	rfx_context_set_rate_control(encoder, 1 << 24);
+
+	for (i = 0; i < RFX_QUANT_LEVELS; i++)
+	{
+		s = stream_new(65536);
+		rfx_compose_message(encoder, s, &rect, 1, rgb_data, 128, 64, 128 * 3);
+		stream_free(s);
+	}
+
+	CU_ASSERT(rfx_context_get_quality(encoder) == 0);
+
+	rfx_context_free(encoder);
+	rfx_context_free(decoder);
+	free(rgb_data);
+}
@@ -32,3 +32,4 @@ void test_dwt(void);
 void test_decode(void);
 void test_encode(void);
 void test_message(void);
+void test_rate_control(void);
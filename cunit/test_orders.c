@@ -19,6 +19,7 @@
 
 #include <freerdp/freerdp.h>
 #include <freerdp/utils/hexdump.h>
+#include <freerdp/utils/memory.h>
 #include <freerdp/utils/stream.h>
 
 #include "test_orders.h"
@@ -65,6 +66,8 @@ int add_orders_suite(void)
 	add_test_function(read_switch_surface_order);
 
 	add_test_function(update_recv_orders);
+	add_test_function(write_primary_orders);
+	add_test_function(write_secondary_orders);
 
 	return 0;
 }
@@ -770,3 +773,404 @@ void test_update_recv_orders(void)
 	free(update->context);
 }
 
+
+OPAQUE_RECT_ORDER opaque_rect_read;
+SCRBLT_ORDER scrblt_read;
+PATBLT_ORDER patblt_read;
+MULTI_OPAQUE_RECT_ORDER multi_opaque_rect_read;
+POLYLINE_ORDER polyline_read;
+MEMBLT_ORDER memblt_read;
+rdpBounds bounds_read;
+int bounds_count;
+
+void test_read_opaque_rect(rdpContext* context, OPAQUE_RECT_ORDER* opaque_rect)
+{
+	opaque_rect_read = *opaque_rect;
+	opaque_rect_count++;
+}
+
+void test_read_scrblt(rdpContext* context, SCRBLT_ORDER* scrblt)
+{
+	scrblt_read = *scrblt;
+}
+
+void test_read_patblt(rdpContext* context, PATBLT_ORDER* patblt)
+{
+	patblt_read = *patblt;
+}
+
+void test_read_multi_opaque_rect(rdpContext* context, MULTI_OPAQUE_RECT_ORDER* multi_opaque_rect)
+{
+	multi_opaque_rect_read = *multi_opaque_rect;
+}
+
+void test_read_polyline(rdpContext* context, POLYLINE_ORDER* polyline)
+{
+	polyline_read = *polyline;
+}
+
+void test_read_memblt(rdpContext* context, MEMBLT_ORDER* memblt)
+{
+	memblt_read = *memblt;
+}
+
+void test_set_bounds(rdpContext* context, rdpBounds* bounds)
+{
+	if (bounds != NULL)
+	{
+		bounds_read = *bounds;
+		bounds_count++;
+	}
+}
+
+void test_write_primary_orders(void)
+{
+	int i;
+	int length;
+	STREAM* s;
+	rdpUpdate* update;
+	rdpPrimaryUpdate* primary;
+	rdpBounds bounds;
+	OPAQUE_RECT_ORDER opaque_rect;
+	SCRBLT_ORDER scrblt;
+	PATBLT_ORDER patblt;
+	MULTI_OPAQUE_RECT_ORDER multi_opaque_rect;
+	POLYLINE_ORDER polyline;
+	MEMBLT_ORDER memblt;
+	DELTA_POINT points[3] = { { 10, 0 }, { 0, -300 }, { -5, 5 } };
+
+	s = stream_new(1024);
+	primary = xnew(rdpPrimaryUpdate);
+	primary->order_info.orderType = ORDER_TYPE_PATBLT;
+
+	update = xnew(rdpUpdate);
+	update->primary = xnew(rdpPrimaryUpdate);
+	update->primary->order_info.orderType = ORDER_TYPE_PATBLT;
+	update->primary->OpaqueRect = test_read_opaque_rect;
+	update->primary->ScrBlt = test_read_scrblt;
+	update->primary->PatBlt = test_read_patblt;
+	update->primary->MultiOpaqueRect = test_read_multi_opaque_rect;
+	update->primary->Polyline = test_read_polyline;
+	update->primary->MemBlt = test_read_memblt;
+	update->SetBounds = test_set_bounds;
+	opaque_rect_count = 0;
+	bounds_count = 0;
+
+	/* a full order, then one only moved a little */
+	memset(&opaque_rect, 0, sizeof(OPAQUE_RECT_ORDER));
+	opaque_rect.nLeftRect = 10;
+	opaque_rect.nTopRect = 500;
+	opaque_rect.nWidth = 100;
+	opaque_rect.nHeight = 50;
+	opaque_rect.color = 0x123456;
+	update_write_primary_order(s, primary, ORDER_TYPE_OPAQUE_RECT, &opaque_rect, NULL);
+	CU_ASSERT(stream_get_length(s) == 14);
+
+	stream_set_pos(s, 0);
+	update_recv_order(update, s);
+	CU_ASSERT(memcmp(&opaque_rect_read, &opaque_rect, sizeof(OPAQUE_RECT_ORDER)) == 0);
+
+	stream_set_pos(s, 0);
+	opaque_rect.nLeftRect = 12;
+	opaque_rect.nTopRect = 380;
+	update_write_primary_order(s, primary, ORDER_TYPE_OPAQUE_RECT, &opaque_rect, NULL);
+	CU_ASSERT(stream_get_length(s) == 4);
+
+	stream_set_pos(s, 0);
+	update_recv_order(update, s);
+	CU_ASSERT(memcmp(&opaque_rect_read, &opaque_rect, sizeof(OPAQUE_RECT_ORDER)) == 0);
+	CU_ASSERT(opaque_rect_count == 2);
+
+	/* the other orders in one stream, clipped to the same bounds */
+	stream_set_pos(s, 0);
+	bounds.left = 0;
+	bounds.top = 0;
+	bounds.right = 1023;
+	bounds.bottom = 767;
+
+	memset(&scrblt, 0, sizeof(SCRBLT_ORDER));
+	scrblt.nLeftRect = 0;
+	scrblt.nTopRect = 0;
+	scrblt.nWidth = 1024;
+	scrblt.nHeight = 700;
+	scrblt.bRop = 0xCC;
+	scrblt.nXSrc = 0;
+	scrblt.nYSrc = 68;
+	update_write_primary_order(s, primary, ORDER_TYPE_SCRBLT, &scrblt, &bounds);
+
+	memset(&patblt, 0, sizeof(PATBLT_ORDER));
+	patblt.nLeftRect = 5;
+	patblt.nTopRect = 6;
+	patblt.nWidth = 7;
+	patblt.nHeight = 8;
+	patblt.bRop = 0xF0;
+	patblt.backColor = 0xFFFFFF;
+	patblt.foreColor = 0x00FF00;
+	patblt.brush.style = BS_PATTERN;
+	patblt.brush.hatch = 0xAA;
+	for (i = 1; i < 8; i++)
+		patblt.brush.p8x8[i] = (i & 1) ? 0x55 : 0xAA;
+	update_write_primary_order(s, primary, ORDER_TYPE_PATBLT, &patblt, &bounds);
+
+	memset(&multi_opaque_rect, 0, sizeof(MULTI_OPAQUE_RECT_ORDER));
+	multi_opaque_rect.nLeftRect = 0;
+	multi_opaque_rect.nTopRect = 0;
+	multi_opaque_rect.nWidth = 1024;
+	multi_opaque_rect.nHeight = 768;
+	multi_opaque_rect.color = 0x00FF00;
+	multi_opaque_rect.numRectangles = 3;
+	for (i = 1; i <= 3; i++)
+	{
+		multi_opaque_rect.rectangles[i].left = 100 * i;
+		multi_opaque_rect.rectangles[i].top = 20;
+		multi_opaque_rect.rectangles[i].width = 50;
+		multi_opaque_rect.rectangles[i].height = 10 * i;
+	}
+	update_write_primary_order(s, primary, ORDER_TYPE_MULTI_OPAQUE_RECT, &multi_opaque_rect, &bounds);
+
+	memset(&polyline, 0, sizeof(POLYLINE_ORDER));
+	polyline.xStart = 300;
+	polyline.yStart = 400;
+	polyline.bRop2 = 0x0D;
+	polyline.penColor = 0x0000FF;
+	polyline.numPoints = 3;
+	polyline.points = points;
+	update_write_primary_order(s, primary, ORDER_TYPE_POLYLINE, &polyline, NULL);
+
+	memset(&memblt, 0, sizeof(MEMBLT_ORDER));
+	memblt.cacheId = 2;
+	memblt.colorIndex = 1;
+	memblt.nLeftRect = 64;
+	memblt.nTopRect = 64;
+	memblt.nWidth = 64;
+	memblt.nHeight = 64;
+	memblt.bRop = 0xCC;
+	memblt.cacheIndex = 300;
+	update_write_primary_order(s, primary, ORDER_TYPE_MEMBLT, &memblt, &bounds);
+
+	length = stream_get_length(s);
+	stream_set_pos(s, 0);
+
+	for (i = 0; i < 5; i++)
+		update_recv_order(update, s);
+
+	CU_ASSERT(stream_get_pos(s) == length);
+	CU_ASSERT(bounds_count == 4);
+	CU_ASSERT(memcmp(&bounds_read, &bounds, sizeof(rdpBounds)) == 0);
+	CU_ASSERT(memcmp(&scrblt_read, &scrblt, sizeof(SCRBLT_ORDER)) == 0);
+
+	CU_ASSERT(patblt_read.nLeftRect == 5);
+	CU_ASSERT(patblt_read.nHeight == 8);
+	CU_ASSERT(patblt_read.foreColor == 0x00FF00);
+	CU_ASSERT(patblt_read.brush.style == BS_PATTERN);
+	CU_ASSERT(memcmp(&patblt_read.brush.data[1], &patblt.brush.p8x8[1], 7) == 0);
+
+	CU_ASSERT(multi_opaque_rect_read.numRectangles == 3);
+	CU_ASSERT(memcmp(&multi_opaque_rect_read.rectangles[1], &multi_opaque_rect.rectangles[1],
+			sizeof(DELTA_RECT) * 3) == 0);
+
+	CU_ASSERT(polyline_read.xStart == 300);
+	CU_ASSERT(polyline_read.numPoints == 3);
+	CU_ASSERT(memcmp(polyline_read.points, points, sizeof(points)) == 0);
+
+	CU_ASSERT(memblt_read.cacheId == 2);
+	CU_ASSERT(memblt_read.colorIndex == 1);
+	CU_ASSERT(memblt_read.cacheIndex == 300);
+	CU_ASSERT(memblt_read.nXSrc == 0);
+
+	xfree(update->primary->polyline.points);
+	xfree(update->primary);
+	xfree(update);
+	xfree(primary);
+	stream_free(s);
+}
+
+CACHE_BITMAP_V2_ORDER cache_bitmap_v2_read;
+CACHE_GLYPH_ORDER cache_glyph_read;
+CACHE_GLYPH_V2_ORDER cache_glyph_v2_read;
+CACHE_BRUSH_ORDER cache_brush_read;
+
+void test_read_cache_bitmap_v2(rdpContext* context, CACHE_BITMAP_V2_ORDER* cache_bitmap_v2)
+{
+	cache_bitmap_v2_read = *cache_bitmap_v2;
+}
+
+void test_read_cache_glyph(rdpContext* context, CACHE_GLYPH_ORDER* cache_glyph)
+{
+	cache_glyph_read = *cache_glyph;
+}
+
+void test_read_cache_glyph_v2(rdpContext* context, CACHE_GLYPH_V2_ORDER* cache_glyph_v2)
+{
+	cache_glyph_v2_read = *cache_glyph_v2;
+}
+
+void test_read_cache_brush(rdpContext* context, CACHE_BRUSH_ORDER* cache_brush)
+{
+	cache_brush_read = *cache_brush;
+}
+
+void test_write_secondary_orders(void)
+{
+	int i;
+	int length;
+	STREAM* s;
+	rdpUpdate* update;
+	uint8 bitmap[300];
+	uint8 aj[2][8];
+	uint8 pattern[8 * 8 * 3];
+	GLYPH_DATA glyphs[2];
+	GLYPH_DATA_V2 glyph_v2;
+	CACHE_BITMAP_V2_ORDER cache_bitmap_v2;
+	CACHE_GLYPH_ORDER cache_glyph;
+	CACHE_GLYPH_V2_ORDER cache_glyph_v2;
+	CACHE_BRUSH_ORDER cache_brush;
+
+	s = stream_new(64);
+
+	update = xnew(rdpUpdate);
+	update->secondary = xnew(rdpSecondaryUpdate);
+	update->secondary->CacheBitmapV2 = test_read_cache_bitmap_v2;
+	update->secondary->CacheGlyph = test_read_cache_glyph;
+	update->secondary->CacheGlyphV2 = test_read_cache_glyph_v2;
+	update->secondary->CacheBrush = test_read_cache_brush;
+
+	for (i = 0; i < (int) sizeof(bitmap); i++)
+		bitmap[i] = i & 0xFF;
+
+	memset(&cache_bitmap_v2, 0, sizeof(CACHE_BITMAP_V2_ORDER));
+	cache_bitmap_v2.cacheId = 1;
+	cache_bitmap_v2.cacheIndex = 200;
+	cache_bitmap_v2.bitmapBpp = 16;
+	cache_bitmap_v2.bitmapWidth = 32;
+	cache_bitmap_v2.bitmapHeight = 20;
+	cache_bitmap_v2.compressed = true;
+	cache_bitmap_v2.bitmapLength = sizeof(bitmap);
+	cache_bitmap_v2.bitmapDataStream = bitmap;
+	update_write_cache_bitmap_v2_order(s, &cache_bitmap_v2);
+
+	/* padded the way the reader expects them */
+	for (i = 0; i < 8; i++)
+	{
+		aj[0][i] = 0x80 >> i;
+		aj[1][i] = ~aj[0][i];
+	}
+
+	memset(glyphs, 0, sizeof(glyphs));
+	glyphs[0].cacheIndex = 3;
+	glyphs[0].x = 0;
+	glyphs[0].y = -7;
+	glyphs[0].cx = 5;
+	glyphs[0].cy = 7;
+	glyphs[0].aj = aj[0];
+	glyphs[1].cacheIndex = 4;
+	glyphs[1].x = -1;
+	glyphs[1].y = -8;
+	glyphs[1].cx = 8;
+	glyphs[1].cy = 8;
+	glyphs[1].aj = aj[1];
+
+	memset(&cache_glyph, 0, sizeof(CACHE_GLYPH_ORDER));
+	cache_glyph.cacheId = 7;
+	cache_glyph.cGlyphs = 2;
+	cache_glyph.glyphData[0] = &glyphs[0];
+	cache_glyph.glyphData[1] = &glyphs[1];
+	update_write_cache_glyph_order(s, &cache_glyph);
+
+	for (i = 0; i < (int) sizeof(pattern); i++)
+		pattern[i] = (i * 7) & 0xFF;
+
+	memset(&cache_brush, 0, sizeof(CACHE_BRUSH_ORDER));
+	cache_brush.index = 9;
+	cache_brush.bpp = 24;
+	cache_brush.length = 8 * 8 * 3;
+	cache_brush.data = pattern;
+	update_write_cache_brush_order(s, &cache_brush);
+
+	length = stream_get_length(s);
+	stream_set_pos(s, 0);
+
+	for (i = 0; i < 3; i++)
+		update_recv_order(update, s);
+
+	CU_ASSERT(stream_get_pos(s) == length);
+
+	CU_ASSERT(cache_bitmap_v2_read.cacheId == 1);
+	CU_ASSERT(cache_bitmap_v2_read.cacheIndex == 200);
+	CU_ASSERT(cache_bitmap_v2_read.bitmapBpp == 16);
+	CU_ASSERT(cache_bitmap_v2_read.bitmapWidth == 32);
+	CU_ASSERT(cache_bitmap_v2_read.bitmapHeight == 20);
+	CU_ASSERT(cache_bitmap_v2_read.bitmapLength == sizeof(bitmap));
+	CU_ASSERT(memcmp(cache_bitmap_v2_read.bitmapDataStream, bitmap, sizeof(bitmap)) == 0);
+
+	CU_ASSERT(cache_glyph_read.cacheId == 7);
+	CU_ASSERT(cache_glyph_read.cGlyphs == 2);
+	CU_ASSERT(cache_glyph_read.glyphData[1]->cacheIndex == 4);
+	CU_ASSERT(cache_glyph_read.glyphData[1]->x == -1);
+	CU_ASSERT(cache_glyph_read.glyphData[1]->y == -8);
+	CU_ASSERT(memcmp(cache_glyph_read.glyphData[0]->aj, aj[0], 8) == 0);
+	CU_ASSERT(memcmp(cache_glyph_read.glyphData[1]->aj, aj[1], 8) == 0);
+
+	CU_ASSERT(cache_brush_read.index == 9);
+	CU_ASSERT(cache_brush_read.bpp == 24);
+	CU_ASSERT(memcmp(cache_brush_read.data, pattern, sizeof(pattern)) == 0);
+	xfree(cache_brush_read.data);
+
+	/* glyph cache revision 2, and a brush of two colors sent as indices */
+	stream_set_pos(s, 0);
+
+	memset(&glyph_v2, 0, sizeof(GLYPH_DATA_V2));
+	glyph_v2.cacheIndex = 200;
+	glyph_v2.x = -100;
+	glyph_v2.y = 3;
+	glyph_v2.cx = 5;
+	glyph_v2.cy = 7;
+	glyph_v2.aj = aj[0];
+
+	memset(&cache_glyph_v2, 0, sizeof(CACHE_GLYPH_V2_ORDER));
+	cache_glyph_v2.cacheId = 9;
+	cache_glyph_v2.cGlyphs = 1;
+	cache_glyph_v2.glyphData[0] = &glyph_v2;
+	update_write_cache_glyph_v2_order(s, &cache_glyph_v2);
+
+	for (i = 0; i < 8 * 8 * 2; i++)
+		pattern[i] = ((i / 2) % 3 == 0) ? 0x1F : 0xE0;
+
+	cache_brush.index = 10;
+	cache_brush.bpp = 16;
+	cache_brush.length = 16 + 4 * 2;
+	update_write_cache_brush_order(s, &cache_brush);
+
+	length = stream_get_length(s);
+	stream_set_pos(s, 0);
+	update->secondary->glyph_v2 = true;
+
+	for (i = 0; i < 2; i++)
+		update_recv_order(update, s);
+
+	CU_ASSERT(stream_get_pos(s) == length);
+
+	CU_ASSERT(cache_glyph_v2_read.cacheId == 9);
+	CU_ASSERT(cache_glyph_v2_read.cGlyphs == 1);
+	CU_ASSERT(cache_glyph_v2_read.glyphData[0]->cacheIndex == 200);
+	CU_ASSERT(cache_glyph_v2_read.glyphData[0]->x == -100);
+	CU_ASSERT(cache_glyph_v2_read.glyphData[0]->y == 3);
+	CU_ASSERT(memcmp(cache_glyph_v2_read.glyphData[0]->aj, aj[0], 8) == 0);
+
+	CU_ASSERT(cache_brush_read.index == 10);
+	CU_ASSERT(cache_brush_read.length == 24);
+	CU_ASSERT(memcmp(cache_brush_read.data, pattern, 8 * 8 * 2) == 0);
+	xfree(cache_brush_read.data);
+
+	for (i = 0; i < 2; i++)
+	{
+		xfree(update->secondary->cache_glyph_order.glyphData[i]->aj);
+		xfree(update->secondary->cache_glyph_order.glyphData[i]);
+	}
+
+	xfree(update->secondary->cache_glyph_v2_order.glyphData[0]->aj);
+	xfree(update->secondary->cache_glyph_v2_order.glyphData[0]);
+	xfree(update->secondary);
+	xfree(update);
+	stream_free(s);
+}
@@ -45,4 +45,6 @@ void test_read_create_offscreen_bitmap_order(void);
 void test_read_switch_surface_order(void);
 
 void test_update_recv_orders(void);
+void test_write_primary_orders(void);
+void test_write_secondary_orders(void);
 
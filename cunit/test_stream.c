@@ -41,6 +41,7 @@ int add_stream_suite(void)
 	add_test_suite(stream);
 
 	add_test_function(stream);
+	add_test_function(stream_pool);
 
 	return 0;
 }
@@ -74,3 +75,67 @@ void test_stream(void)
 
 	stream_free(stream);
 }
+
+void test_stream_pool(void)
+{
+	STREAM* s1;
+	STREAM* s2;
+	uint8* data;
+	STREAM_POOL* pool;
+
+	pool = stream_pool_new();
+
+	s1 = stream_pool_acquire(pool, 3000);
+	CU_ASSERT(stream_get_size(s1) == 3000);
+	CU_ASSERT(s1->capacity == 4096);
+	CU_ASSERT(pool->allocated == 1);
+
+	/* a sealed stream goes back to the class of its buffer */
+	stream_write_uint32(s1, 0x01020304);
+	stream_seal(s1);
+	data = s1->data;
+	stream_pool_release(pool, s1);
+	CU_ASSERT(pool->bytes_held == 4096);
+
+	s2 = stream_pool_acquire(pool, 4096);
+	CU_ASSERT(s2 == s1);
+	CU_ASSERT(s2->data == data);
+	CU_ASSERT(stream_get_pos(s2) == 0);
+	CU_ASSERT(stream_get_size(s2) == 4096);
+	CU_ASSERT(pool->reused == 1);
+	CU_ASSERT(pool->bytes_held == 0);
+
+	/* grown past its class, the buffer is kept for the larger one */
+	stream_seek(s2, 4096);
+	stream_check_size(s2, 16);
+	stream_pool_release(pool, s2);
+	CU_ASSERT(pool->count[2] == 0);
+	CU_ASSERT(pool->count[3] == 1);
+
+	s1 = stream_pool_acquire(pool, 2 << STREAM_POOL_MAX_SHIFT);
+	CU_ASSERT(s1->capacity == (2 << STREAM_POOL_MAX_SHIFT));
+	stream_pool_release(pool, s1);
+	CU_ASSERT(pool->discarded == 1);
+
+	/* an empty stream still has a buffer, extending it must not lose it */
+	s1 = stream_pool_acquire(pool, 0);
+	data = s1->data;
+	CU_ASSERT(stream_get_size(s1) == 0);
+	stream_check_size(s1, 16);
+	stream_write_uint32(s1, 0x01020304);
+	CU_ASSERT(s1->data == data);
+	CU_ASSERT(s1->capacity == 1024);
+	stream_pool_release(pool, s1);
+
+	s2 = stream_pool_acquire(NULL, 0);
+	stream_check_size(s2, 16);
+	stream_write_uint32(s2, 0x01020304);
+	CU_ASSERT(stream_get_size(s2) >= 16);
+	CU_ASSERT(s2->capacity == stream_get_size(s2));
+	stream_pool_release(NULL, s2);
+
+	CU_ASSERT(pool->acquired == 4);
+	CU_ASSERT(pool->released == 4);
+
+	stream_pool_free(pool);
+}
@@ -24,3 +24,4 @@ int clean_stream_suite(void);
 int add_stream_suite(void);
 
 void test_stream(void);
+void test_stream_pool(void);
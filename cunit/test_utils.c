@@ -36,6 +36,7 @@
 #include <freerdp/utils/args.h>
 #include <freerdp/utils/passphrase.h>
 #include <freerdp/utils/signal.h>
+#include <freerdp/utils/dsp.h>
 
 #include "test_utils.h"
 
@@ -60,6 +61,7 @@ int add_utils_suite(void)
 	add_test_function(args);
 	add_test_function(passphrase_read);
 	add_test_function(handle_signals);
+	add_test_function(dsp_resampler);
 
 	return 0;
 }
@@ -670,3 +672,60 @@ void test_handle_signals(void)
 {
 	handle_signals_resets_terminal();
 }
+
+void test_dsp_resampler(void)
+{
+	int i, n;
+	int frames;
+	int chunk;
+	sint16 src[2 * 441];
+	sint16 whole[2 * 482];
+	sint16 split[2 * 482];
+	uint8 mono[4];
+	uint8 stereo[4];
+	DSP_RESAMPLER* resampler;
+
+	for (i = 0; i < 441; i++)
+	{
+		src[2 * i] = (sint16) (i * 64);
+		src[2 * i + 1] = (sint16) (-i * 64);
+	}
+
+	/* 44.1 kHz to 48 kHz, all at once */
+	resampler = dsp_resampler_new(2, 2, 44100, 2, 48000);
+	CU_ASSERT(resampler != NULL);
+	frames = dsp_resampler_process(resampler, (uint8*) src, 441, (uint8*) whole,
+		dsp_resampler_get_max_frames(resampler, 441));
+	CU_ASSERT(frames >= 479 && frames <= 480);
+
+	/* the same stream in uneven blocks must give the same samples */
+	dsp_resampler_reset(resampler);
+	n = 0;
+	for (i = 0; i < 441; i += chunk)
+	{
+		chunk = MIN(37, 441 - i);
+		n += dsp_resampler_process(resampler, (uint8*) (src + 2 * i), chunk,
+			(uint8*) (split + 2 * n), dsp_resampler_get_max_frames(resampler, chunk));
+	}
+	CU_ASSERT(n == frames);
+	CU_ASSERT(memcmp(whole, split, frames * 4) == 0);
+
+	/* interpolated values stay between their neighbours */
+	for (i = 1; i < frames; i++)
+	{
+		CU_ASSERT(whole[2 * i] >= whole[2 * (i - 1)]);
+		CU_ASSERT(whole[2 * i + 1] <= whole[2 * (i - 1) + 1]);
+	}
+	dsp_resampler_free(resampler);
+
+	/* 8-bit stereo downmixed to mono at the same rate */
+	stereo[0] = 100; stereo[1] = 200;
+	stereo[2] = 0; stereo[3] = 255;
+	resampler = dsp_resampler_new(1, 2, 8000, 1, 8000);
+	frames = dsp_resampler_process(resampler, stereo, 2, mono, 4);
+	CU_ASSERT(frames == 1);
+	CU_ASSERT(mono[0] == 150);
+	dsp_resampler_free(resampler);
+
+	CU_ASSERT(dsp_resampler_new(2, 9, 8000, 2, 8000) == NULL);
+}
@@ -30,3 +30,4 @@ void test_wait_obj(void);
 void test_args(void);
 void test_passphrase_read(void);
 void test_handle_signals(void);
+void test_dsp_resampler(void);
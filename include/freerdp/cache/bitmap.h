@@ -25,9 +25,11 @@
 #include <freerdp/update.h>
 #include <freerdp/freerdp.h>
 #include <freerdp/utils/stream.h>
+#include <freerdp/cache/persistent.h>
 
 typedef struct _BITMAP_V2_CELL BITMAP_V2_CELL;
 typedef struct rdp_bitmap_cache rdpBitmapCache;
+typedef struct _BITMAP_DECODE_POOL BITMAP_DECODE_POOL;
 
 #include <freerdp/cache/cache.h>
 
@@ -35,6 +37,7 @@ struct _BITMAP_V2_CELL
 {
 	uint32 number;
 	rdpBitmap** entries;
+	sint32* slots;
 };
 
 struct rdp_bitmap_cache
@@ -53,10 +56,13 @@ struct rdp_bitmap_cache
 
 	/* internal */
 
-	rdpBitmap* bitmap;
+	rdpBitmap** bitmaps;
+	uint32 maxBitmaps;
+	BITMAP_DECODE_POOL* pool;
 	rdpUpdate* update;
 	rdpContext* context;
 	rdpSettings* settings;
+	rdpPersistentCache* persistent;
 };
 
 FREERDP_API rdpBitmap* bitmap_cache_get(rdpBitmapCache* bitmap_cache, uint32 id, uint32 index);
@@ -0,0 +1,86 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * Persistent Bitmap Cache
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __PERSISTENT_CACHE_H
+#define __PERSISTENT_CACHE_H
+
+#include <freerdp/api.h>
+#include <freerdp/types.h>
+#include <freerdp/freerdp.h>
+#include <freerdp/graphics.h>
+
+typedef struct _PERSISTENT_CACHE_HEADER PERSISTENT_CACHE_HEADER;
+typedef struct _PERSISTENT_CACHE_ENTRY PERSISTENT_CACHE_ENTRY;
+typedef struct rdp_persistent_cache rdpPersistentCache;
+
+#define PERSISTENT_CACHE_MAGIC		0x43425246 /* FRBC */
+#define PERSISTENT_CACHE_VERSION	1
+#define PERSISTENT_CACHE_SLOT_SIZE	(64 * 64 * 4)
+
+struct _PERSISTENT_CACHE_HEADER
+{
+	uint32 magic;
+	uint32 version;
+	uint32 slots;
+	uint32 slotSize;
+	uint32 stamp;
+	uint32 reserved[3];
+};
+
+struct _PERSISTENT_CACHE_ENTRY
+{
+	uint64 key;
+	uint16 width;
+	uint16 height;
+	uint8 bpp;
+	uint8 cellId;
+	uint16 valid;
+	uint32 length;
+	uint32 stamp;
+};
+
+struct rdp_persistent_cache
+{
+	int fd;
+	uint8* map;
+	uint32 size;
+	uint32 slots;
+	uint8* data;
+	PERSISTENT_CACHE_HEADER* header;
+	PERSISTENT_CACHE_ENTRY* entries;
+
+	/* key lookup, chained through next */
+	uint32 buckets;
+	sint32* heads;
+	sint32* next;
+	uint32 cursor;
+
+	/* slots announced to the server, kept until first used */
+	uint8* pinned;
+};
+
+FREERDP_API sint32 persistent_cache_find(rdpPersistentCache* persistent, uint64 key);
+FREERDP_API boolean persistent_cache_put(rdpPersistentCache* persistent, uint32 cellId, uint64 key, rdpBitmap* bitmap);
+FREERDP_API void persistent_cache_pin(rdpPersistentCache* persistent, sint32 slot, boolean pinned);
+FREERDP_API rdpBitmap* persistent_cache_load(rdpPersistentCache* persistent, rdpContext* context, sint32 slot);
+FREERDP_API uint32 persistent_cache_get_keys(rdpPersistentCache* persistent, uint32 cellId,
+		uint64* keys, sint32* slots, uint32 count);
+
+FREERDP_API rdpPersistentCache* persistent_cache_open(char* filename, uint32 slots);
+FREERDP_API void persistent_cache_close(rdpPersistentCache* persistent);
+
+#endif /* __PERSISTENT_CACHE_H */
@@ -0,0 +1,95 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * Server Cache Manager
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __SERVER_CACHE_H
+#define __SERVER_CACHE_H
+
+#include <freerdp/api.h>
+#include <freerdp/types.h>
+#include <freerdp/freerdp.h>
+#include <freerdp/peer.h>
+#include <freerdp/update.h>
+#include <freerdp/utils/stream.h>
+
+typedef struct _SERVER_CACHE_ENTRY SERVER_CACHE_ENTRY;
+typedef struct _SERVER_CACHE_CELL SERVER_CACHE_CELL;
+typedef struct rdp_server_cache rdpServerCache;
+
+/* Largest bitmap a cached MEMBLT is drawn from */
+#define SERVER_BITMAP_CACHE_TILE_SIZE		64
+
+/* Glyphs drawn by one GLYPH_INDEX order */
+#define SERVER_GLYPH_CACHE_RUN_SIZE		63
+
+/* Color brushes the client keeps */
+#define SERVER_BRUSH_CACHE_ENTRIES		64
+
+/**
+ * What the client holds at one cache index: the hash of the content the
+ * server sent there, and its place in the cell's least recently used list.
+ */
+struct _SERVER_CACHE_ENTRY
+{
+	uint64 key;
+	int prev; /* more recently used */
+	int next; /* less recently used */
+	int chain; /* next entry in the same hash bucket */
+};
+
+struct _SERVER_CACHE_CELL
+{
+	int number;
+	int maxSize;
+	int count;
+	int head;
+	int tail;
+	int mask;
+	int* buckets;
+	SERVER_CACHE_ENTRY* entries;
+};
+
+struct rdp_server_cache
+{
+	rdpContext* context;
+	rdpUpdate* update;
+	rdpSettings* settings;
+
+	int numBitmapCells;
+	SERVER_CACHE_CELL bitmap[5];
+	int numGlyphCells;
+	SERVER_CACHE_CELL glyph[10];
+	SERVER_CACHE_CELL brush;
+
+	uint32 hits;
+	uint32 misses;
+
+	STREAM* data;
+	uint8* tile;
+};
+
+FREERDP_API boolean server_cache_memblt(rdpServerCache* cache, MEMBLT_ORDER* memblt,
+		uint8* data, int width, int height, int rowstride, int bpp);
+FREERDP_API boolean server_cache_glyph_index(rdpServerCache* cache, GLYPH_INDEX_ORDER* glyph_index,
+		GLYPH_DATA* glyphs, sint32* origins, int count);
+FREERDP_API boolean server_cache_brush(rdpServerCache* cache, rdpBrush* brush);
+
+FREERDP_API void server_cache_reset(rdpServerCache* cache);
+
+FREERDP_API rdpServerCache* server_cache_new(freerdp_peer* client);
+FREERDP_API void server_cache_free(rdpServerCache* cache);
+
+#endif /* __SERVER_CACHE_H */
@@ -20,8 +20,19 @@
 #ifndef __BITMAP_H
 #define __BITMAP_H
 
+#include <freerdp/api.h>
 #include <freerdp/types.h>
+#include <freerdp/utils/stream.h>
+
+/* Planar Bitmap Format Header (RDP6_BITMAP_STREAM) */
+#define PLANAR_FORMAT_HEADER_CLL_MASK	0x07
+#define PLANAR_FORMAT_HEADER_CS		0x08
+#define PLANAR_FORMAT_HEADER_RLE	0x10
+#define PLANAR_FORMAT_HEADER_NA		0x20
 
 FREERDP_API boolean bitmap_decompress(uint8* srcData, uint8* dstData, int width, int height, int size, int srcBpp, int dstBpp);
 
+FREERDP_API boolean bitmap_compress(uint8* srcData, STREAM* s, int width, int height, int rowstride, int bpp);
+FREERDP_API boolean bitmap_planar_compress(uint8* srcData, STREAM* s, int width, int height, int rowstride, uint8 flags);
+
 #endif /* __BITMAP_H */
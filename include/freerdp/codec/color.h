@@ -238,6 +238,9 @@ typedef CLRCONV* HCLRCONV;
 typedef uint8* (*p_freerdp_image_convert)(uint8* srcData, uint8* dstData, int width, int height, int srcBpp, int dstBpp, HCLRCONV clrconv);
 
 FREERDP_API uint8* freerdp_image_convert(uint8* srcData, uint8 *dstData, int width, int height, int srcBpp, int dstBpp, HCLRCONV clrconv);
+FREERDP_API uint8* freerdp_image_convert_ex(uint8* srcData, uint8* dstData, int width, int height,
+		int srcBpp, int dstBpp, int dstStride, boolean flip, HCLRCONV clrconv);
+FREERDP_API void freerdp_image_convert_set_cpu_opt(uint32 cpu_opt);
 FREERDP_API uint8* freerdp_glyph_convert(int width, int height, uint8* data);
 FREERDP_API void   freerdp_bitmap_flip(uint8 * src, uint8 * dst, int scanLineSz, int height);
 FREERDP_API uint8* freerdp_image_flip(uint8* srcData, uint8* dstData, int width, int height, int bpp);
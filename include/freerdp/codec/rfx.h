@@ -87,6 +87,16 @@ typedef struct _RFX_MESSAGE RFX_MESSAGE;
 
 typedef struct _RFX_CONTEXT_PRIV RFX_CONTEXT_PRIV;
 
+/**
+ * Quantization sets the encoder picks from under rate control, from the
+ * finest to the coarsest. Each tile is encoded with the set of the frame
+ * quality level, tiles that look like text or drawings are kept at
+ * RFX_QUANT_LEVEL_TEXT or finer.
+ */
+
+#define RFX_QUANT_LEVELS		6
+#define RFX_QUANT_LEVEL_TEXT		1
+
 struct _RFX_CONTEXT
 {
 	uint16 flags;
@@ -130,6 +140,10 @@ FREERDP_API void rfx_context_free(RFX_CONTEXT* context);
 FREERDP_API void rfx_context_set_cpu_opt(RFX_CONTEXT* context, uint32 cpu_opt);
 FREERDP_API void rfx_context_set_pixel_format(RFX_CONTEXT* context, RFX_PIXEL_FORMAT pixel_format);
 FREERDP_API void rfx_context_reset(RFX_CONTEXT* context);
+FREERDP_API void rfx_context_set_quantization(RFX_CONTEXT* context, const uint32* quants, int num_quants,
+	int quant_idx_y, int quant_idx_cb, int quant_idx_cr);
+FREERDP_API void rfx_context_set_rate_control(RFX_CONTEXT* context, uint32 frame_budget);
+FREERDP_API int rfx_context_get_quality(RFX_CONTEXT* context);
 
 FREERDP_API RFX_MESSAGE* rfx_process_message(RFX_CONTEXT* context, uint8* data, uint32 length);
 FREERDP_API uint16 rfx_message_get_tile_count(RFX_MESSAGE* message);
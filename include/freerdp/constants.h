@@ -87,6 +87,7 @@ enum RDP_SVC_CHANNEL_EVENT
  * CPU Optimization flags
  */
 #define CPU_SSE2			0x1
+#define CPU_AVX2			0x2
 
 /**
  * OSMajorType
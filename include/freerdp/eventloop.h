@@ -0,0 +1,62 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol client.
+ * Server Event Loop
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __FREERDP_EVENT_LOOP_H
+#define __FREERDP_EVENT_LOOP_H
+
+typedef struct rdp_event_loop rdpEventLoop;
+typedef struct rdp_event_source rdpEventSource;
+
+#include <freerdp/api.h>
+#include <freerdp/types.h>
+#include <freerdp/peer.h>
+#include <freerdp/listener.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A source is a set of file descriptors with a check callback, typically a
+ * listener or a peer. The callback is run on a worker thread whenever one of
+ * the descriptors is readable, never concurrently for the same source.
+ * Returning false removes the source, after which the closed callback is run.
+ */
+
+typedef boolean (*psEventSourceCheck)(rdpEventSource* source, void* param);
+typedef void (*psEventSourceClosed)(rdpEventSource* source, void* param);
+
+#define EVENT_SOURCE_MAX_FDS	8
+
+FREERDP_API rdpEventSource* freerdp_event_loop_add(rdpEventLoop* loop, void** rfds, int rcount,
+		psEventSourceCheck Check, psEventSourceClosed Closed, void* param);
+FREERDP_API rdpEventSource* freerdp_event_loop_add_listener(rdpEventLoop* loop, freerdp_listener* instance);
+FREERDP_API rdpEventSource* freerdp_event_loop_add_peer(rdpEventLoop* loop, freerdp_peer* client,
+		void** rfds, int rcount, psEventSourceCheck Check, psEventSourceClosed Closed);
+FREERDP_API rdpEventLoop* freerdp_event_source_get_loop(rdpEventSource* source);
+
+FREERDP_API void freerdp_event_loop_run(rdpEventLoop* loop);
+FREERDP_API void freerdp_event_loop_stop(rdpEventLoop* loop);
+
+FREERDP_API rdpEventLoop* freerdp_event_loop_new(int workers);
+FREERDP_API void freerdp_event_loop_free(rdpEventLoop* loop);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FREERDP_EVENT_LOOP_H */
@@ -234,14 +234,23 @@ typedef struct gdi_bitmap gdiBitmap;
 
 struct gdi_glyph
 {
-	rdpBitmap _p;
+	rdpGlyph _p;
 
-	HGDI_DC hdc;
-	HGDI_BITMAP bitmap;
-	HGDI_BITMAP org_bitmap;
+	int scanline;
 };
 typedef struct gdi_glyph gdiGlyph;
 
+struct _GDI_DISPLAY_LIST_STATS
+{
+	uint32 orders_recorded;
+	uint32 orders_rasterized;
+	uint32 orders_culled;
+	uint32 orders_merged;
+	uint64 pixels_touched;
+	uint64 pixels_culled;
+};
+typedef struct _GDI_DISPLAY_LIST_STATS GDI_DISPLAY_LIST_STATS;
+
 struct rdp_gdi
 {
 	rdpContext* context;
@@ -262,8 +271,11 @@ struct rdp_gdi
 	GDI_COLOR textColor;
 	void* rfx_context;
 	void* nsc_context;
+	void* glyph_run;
 	gdiBitmap* tile;
 	gdiBitmap* image;
+	boolean primary_buffer_external;
+	void* display_list;
 };
 
 FREERDP_API uint32 gdi_rop3_code(uint8 code);
@@ -271,6 +283,10 @@ FREERDP_API uint8* gdi_get_bitmap_pointer(HGDI_DC hdcBmp, int x, int y);
 FREERDP_API uint8* gdi_get_brush_pointer(HGDI_DC hdcBrush, int x, int y);
 FREERDP_API int gdi_is_mono_pixel_set(uint8* data, int x, int y, int width);
 FREERDP_API void gdi_resize(rdpGdi* gdi, int width, int height);
+FREERDP_API void gdi_resize_ex(rdpGdi* gdi, int width, int height, uint8* buffer);
+FREERDP_API void gdi_set_cpu_opt(uint32 cpu_opt);
+FREERDP_API void gdi_flush(rdpGdi* gdi);
+FREERDP_API boolean gdi_get_display_list_stats(rdpGdi* gdi, GDI_DISPLAY_LIST_STATS* stats);
 
 FREERDP_API int gdi_init(freerdp* instance, uint32 flags, uint8* buffer);
 FREERDP_API void gdi_free(freerdp* instance);
@@ -38,6 +38,10 @@ typedef void (*pBitmap_Decompress)(rdpContext* context, rdpBitmap* bitmap,
 		uint8* data, int width, int height, int bpp, int length, boolean compressed);
 typedef void (*pBitmap_SetSurface)(rdpContext* context, rdpBitmap* bitmap, boolean primary);
 
+/* Convert the decompressed data of an ephemeral bitmap for painting, without
+ * calling into the display: it may run on a bitmap decoding thread. */
+typedef void (*pBitmap_Convert)(rdpContext* context, rdpBitmap* bitmap);
+
 struct rdp_bitmap
 {
 	size_t size; /* 0 */
@@ -46,7 +50,8 @@ struct rdp_bitmap
 	pBitmap_Paint Paint; /* 3 */
 	pBitmap_Decompress Decompress; /* 4 */
 	pBitmap_SetSurface SetSurface; /* 5 */
-	uint32 paddingA[16 - 6];  /* 6 */
+	pBitmap_Convert Convert; /* 6 */
+	uint32 paddingA[16 - 7];  /* 7 */
 
 	uint32 left; /* 16 */
 	uint32 top; /* 17 */
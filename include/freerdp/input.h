@@ -27,6 +27,7 @@
 typedef struct rdp_input rdpInput;
 
 #include <freerdp/freerdp.h>
+#include <freerdp/utils/stream.h>
 
 /* keyboard Flags */
 #define KBD_FLAGS_EXTENDED		0x0100
@@ -77,6 +78,8 @@ typedef void (*pUnicodeKeyboardEvent)(rdpInput* input, uint16 flags, uint16 code
 typedef void (*pMouseEvent)(rdpInput* input, uint16 flags, uint16 x, uint16 y);
 typedef void (*pExtendedMouseEvent)(rdpInput* input, uint16 flags, uint16 x, uint16 y);
 typedef void (*pKeyboardImeStatusEvent)(rdpInput* input, uint32 imeState, uint32 imeConvMode);
+typedef void (*pBeginBatch)(rdpInput* input);
+typedef void (*pEndBatch)(rdpInput* input);
 
 struct rdp_input
 {
@@ -90,7 +93,17 @@ struct rdp_input
 	pMouseEvent MouseEvent; /* 19 */
 	pExtendedMouseEvent ExtendedMouseEvent; /* 20 */
 	pKeyboardImeStatusEvent KeyboardImeStatusEvent; /* 21 */
-	uint32 paddingB[32 - 22]; /* 22 */
+	pBeginBatch BeginBatch; /* 22 */
+	pEndBatch EndBatch; /* 23 */
+	uint32 paddingB[32 - 24]; /* 24 */
+
+	/* internal */
+
+	/* fast-path input events gathered between BeginBatch and EndBatch */
+	STREAM* events;
+	uint8 number_events;
+	boolean batch_events;
+	int last_move; /* where the last event starts when it is a mouse move, or -1 */
 };
 
 #endif /* __INPUT_API_H */
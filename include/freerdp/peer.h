@@ -26,6 +26,14 @@
 #include <freerdp/input.h>
 #include <freerdp/update.h>
 
+struct rdp_peer_send_status
+{
+	int backlog; /* bytes accepted by the socket but not sent yet, -1 if unknown */
+	uint32 stalls; /* writes that had to wait for the socket */
+	uint64 stall_time; /* time spent waiting for the socket, in microseconds */
+};
+typedef struct rdp_peer_send_status PEER_SEND_STATUS;
+
 typedef void (*psPeerContextNew)(freerdp_peer* client, rdpContext* context);
 typedef void (*psPeerContextFree)(freerdp_peer* client, rdpContext* context);
 
@@ -33,6 +41,7 @@ typedef boolean (*psPeerInitialize)(freerdp_peer* client);
 typedef boolean (*psPeerGetFileDescriptor)(freerdp_peer* client, void** rfds, int* rcount);
 typedef boolean (*psPeerCheckFileDescriptor)(freerdp_peer* client);
 typedef void (*psPeerDisconnect)(freerdp_peer* client);
+typedef void (*psPeerGetSendStatus)(freerdp_peer* client, PEER_SEND_STATUS* status);
 typedef boolean (*psPeerCapabilities)(freerdp_peer* client);
 typedef boolean (*psPeerPostConnect)(freerdp_peer* client);
 typedef boolean (*psPeerActivate)(freerdp_peer* client);
@@ -58,6 +67,7 @@ struct rdp_freerdp_peer
 	psPeerGetFileDescriptor GetFileDescriptor;
 	psPeerCheckFileDescriptor CheckFileDescriptor;
 	psPeerDisconnect Disconnect;
+	psPeerGetSendStatus GetSendStatus;
 
 	psPeerCapabilities Capabilities;
 	psPeerPostConnect PostConnect;
@@ -43,6 +43,18 @@ struct _RDP_VIDEO_FRAME_EVENT
 	sint16 height;
 	uint16 num_visible_rects;
 	RDP_RECT* visible_rects;
+
+	/* frame_data is the start of System V segment frame_shmid */
+	boolean frame_shm;
+	int frame_shmid;
+	/* Plane layout of frame_data, all zero for tightly packed planes */
+	uint32 frame_offsets[3];
+	uint32 frame_pitches[3];
+
+	/* Set by the renderer: the plane layout it can display without a copy */
+	uint32 render_size;
+	uint32 render_offsets[3];
+	uint32 render_pitches[3];
 };
 typedef struct _RDP_VIDEO_FRAME_EVENT RDP_VIDEO_FRAME_EVENT;
 
@@ -102,6 +102,11 @@
 #define GLYPH_SUPPORT_FULL			0x0002
 #define GLYPH_SUPPORT_ENCODE			0x0003
 
+/* Brush Support Level */
+#define BRUSH_DEFAULT				0x00000000
+#define BRUSH_COLOR_8x8				0x00000001
+#define BRUSH_COLOR_FULL			0x00000002
+
 /* SYSTEM_TIME */
 typedef struct
 {
@@ -211,6 +216,8 @@ struct _BITMAP_CACHE_V2_CELL_INFO
 {
 	uint32 numEntries;
 	boolean persistent;
+	uint32 numPersistentKeys;
+	uint64* persistentKeys;
 };
 typedef struct _BITMAP_CACHE_V2_CELL_INFO BITMAP_CACHE_V2_CELL_INFO;
 
@@ -360,7 +367,7 @@ struct rdp_settings
 	boolean disable_theming; /* 244 */
 	uint32 connection_type; /* 245 */
 	uint32 multifrag_max_request_size; /* 246 */
-	uint32 paddingK[248 - 247]; /* 247 */
+	uint32 brush_support_level; /* 247 */
 
 	/* Certificate */
 	char* cert_file; /* 248 */
@@ -383,7 +390,8 @@ struct rdp_settings
 	uint32 ns_codec_id; /* 283 */
 	uint32 rfx_codec_mode; /* 284 */
 	boolean frame_acknowledge; /* 285 */
-	uint32 paddingM[296 - 286]; /* 286 */
+	uint32 max_unacknowledged_frames; /* 286 */
+	uint32 paddingM[296 - 287]; /* 287 */
 
 	/* Recording */
 	boolean dump_rfx; /* 296 */
@@ -411,7 +419,11 @@ struct rdp_settings
 	boolean persistent_bitmap_cache; /* 330 */
 	uint32 bitmapCacheV2NumCells; /* 331 */
 	BITMAP_CACHE_V2_CELL_INFO* bitmapCacheV2CellInfo; /* 332 */
-	uint32 paddingQ[344 - 333]; /* 333 */
+	boolean bitmap_cache_persist_enabled; /* 333 */
+	char* bitmap_cache_persist_file; /* 334 */
+	uint32 bitmap_decode_threads; /* 335 */
+	boolean gdi_display_list; /* 336 */
+	uint32 paddingQ[344 - 337]; /* 337 */
 
 	/* Offscreen Bitmap Cache */
 	boolean offscreen_bitmap_cache; /* 344 */
@@ -116,6 +116,12 @@ struct _SURFACE_BITS_COMMAND
 };
 typedef struct _SURFACE_BITS_COMMAND SURFACE_BITS_COMMAND;
 
+enum SURFCMD_FRAMEACTION
+{
+	SURFACECMD_FRAMEACTION_BEGIN = 0x0000,
+	SURFACECMD_FRAMEACTION_END = 0x0001
+};
+
 struct _SURFACE_FRAME_MARKER
 {
 	uint32 frameAction;
@@ -141,6 +147,7 @@ typedef void (*pSuppressOutput)(rdpContext* context, uint8 allow, RECTANGLE_16*
 typedef void (*pSurfaceCommand)(rdpContext* context, STREAM* s);
 typedef void (*pSurfaceBits)(rdpContext* context, SURFACE_BITS_COMMAND* surface_bits_command);
 typedef void (*pSurfaceFrameMarker)(rdpContext* context, SURFACE_FRAME_MARKER* surface_frame_marker);
+typedef void (*pSurfaceFrameAcknowledge)(rdpContext* context, uint32 frameId);
 
 struct rdp_update
 {
@@ -171,7 +178,8 @@ struct rdp_update
 	pSurfaceCommand SurfaceCommand; /* 64 */
 	pSurfaceBits SurfaceBits; /* 65 */
 	pSurfaceFrameMarker SurfaceFrameMarker; /* 66 */
-	uint32 paddingE[80 - 67]; /* 67 */
+	pSurfaceFrameAcknowledge SurfaceFrameAcknowledge; /* 67 */
+	uint32 paddingE[80 - 68]; /* 68 */
 
 	/* internal */
 
@@ -185,6 +193,17 @@ struct rdp_update
 
 	SURFACE_BITS_COMMAND surface_bits_command;
 	SURFACE_FRAME_MARKER surface_frame_marker;
+
+	/* last frame ended by the update being received, acknowledged once presented */
+	boolean acknowledge_frame;
+	uint32 acknowledge_frame_id;
+
+	/* drawing orders sent by a server, batched between BeginPaint and EndPaint */
+	STREAM* orders;
+	uint16 number_orders;
+	boolean batch_orders;
+	boolean use_bounds;
+	rdpBounds bounds;
 };
 
 #endif /* __UPDATE_API_H */
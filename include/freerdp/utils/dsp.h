@@ -21,6 +21,7 @@
 #define __DSP_UTILS_H
 
 #include <freerdp/api.h>
+#include <freerdp/types.h>
 
 struct _ADPCM
 {
@@ -29,6 +30,33 @@ struct _ADPCM
 };
 typedef struct _ADPCM ADPCM;
 
+#define DSP_MAX_CHANNELS	8
+
+struct _DSP_RESAMPLER
+{
+	int bytes_per_sample;
+	uint32 schan;
+	uint32 srate;
+	uint32 rchan;
+	uint32 rrate;
+
+	uint64 step;
+	uint64 phase;
+	uint32 pending;
+	boolean primed;
+	sint32 x0[DSP_MAX_CHANNELS];
+	sint32 x1[DSP_MAX_CHANNELS];
+};
+typedef struct _DSP_RESAMPLER DSP_RESAMPLER;
+
+FREERDP_API DSP_RESAMPLER* dsp_resampler_new(int bytes_per_sample,
+	uint32 schan, uint32 srate, uint32 rchan, uint32 rrate);
+FREERDP_API void dsp_resampler_free(DSP_RESAMPLER* resampler);
+FREERDP_API void dsp_resampler_reset(DSP_RESAMPLER* resampler);
+FREERDP_API int dsp_resampler_get_max_frames(DSP_RESAMPLER* resampler, int sframes);
+FREERDP_API int dsp_resampler_process(DSP_RESAMPLER* resampler, uint8* src, int sframes,
+	uint8* dst, int max_rframes);
+
 FREERDP_API uint8* dsp_resample(uint8* src, int bytes_per_sample,
 	uint32 schan, uint32 srate, int sframes,
 	uint32 rchan, uint32 rrate, int * prframes);
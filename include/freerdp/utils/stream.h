@@ -30,6 +30,7 @@ struct _STREAM
 	int size;
 	uint8* p;
 	uint8* data;
+	int capacity; /* allocated, size is lowered by stream_seal */
 };
 typedef struct _STREAM STREAM;
 
@@ -38,6 +39,7 @@ FREERDP_API void stream_free(STREAM* stream);
 
 #define stream_attach(_s, _buf, _size) do { \
 	_s->size = _size; \
+	_s->capacity = _size; \
 	_s->data = _buf; \
 	_s->p = _buf; } while (0)
 #define stream_detach(_s) memset(_s, 0, sizeof(STREAM))
@@ -48,6 +50,37 @@ FREERDP_API void stream_extend(STREAM* stream, int request_size);
 	while (_s->p - _s->data + (_n) > _s->size) \
 		stream_extend(_s, _n)
 
+/**
+ * Streams kept for reuse, by size class. A pool is not locked, it belongs
+ * to the thread that acquires and releases its streams. The buffer of an
+ * acquired stream is not cleared.
+ */
+
+#define STREAM_POOL_MIN_SHIFT	10 /* 1 KB */
+#define STREAM_POOL_MAX_SHIFT	20 /* 1 MB */
+#define STREAM_POOL_CLASSES	(STREAM_POOL_MAX_SHIFT - STREAM_POOL_MIN_SHIFT + 1)
+#define STREAM_POOL_DEPTH	4
+
+struct _STREAM_POOL
+{
+	STREAM* streams[STREAM_POOL_CLASSES][STREAM_POOL_DEPTH];
+	int count[STREAM_POOL_CLASSES];
+
+	/* counters */
+	uint32 acquired;
+	uint32 reused;
+	uint32 allocated;
+	uint32 released;
+	uint32 discarded;
+	uint32 bytes_held;
+};
+typedef struct _STREAM_POOL STREAM_POOL;
+
+FREERDP_API STREAM_POOL* stream_pool_new(void);
+FREERDP_API void stream_pool_free(STREAM_POOL* pool);
+FREERDP_API STREAM* stream_pool_acquire(STREAM_POOL* pool, int size);
+FREERDP_API void stream_pool_release(STREAM_POOL* pool, STREAM* stream);
+
 #define stream_get_pos(_s) (_s->p - _s->data)
 #define stream_set_pos(_s,_m) _s->p = _s->data + (_m)
 #define stream_seek(_s,_offset) _s->p += (_offset)
@@ -17,12 +17,59 @@
  * limitations under the License.
  */
 
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
 #include <freerdp/freerdp.h>
 #include <freerdp/utils/stream.h>
+#include <freerdp/utils/file.h>
 #include <freerdp/utils/memory.h>
+#include <freerdp/utils/mutex.h>
+#include <freerdp/utils/thread.h>
+#include <freerdp/utils/semaphore.h>
 
 #include <freerdp/cache/bitmap.h>
 
+/* Decoding threads used when the setting leaves it to the number of processors */
+#define BITMAP_DECODE_MAX_THREADS	4
+
+/* Rectangles decoded at once, and so ephemeral bitmaps kept, however large the update */
+#define BITMAP_DECODE_BATCH		16
+
+typedef struct _BITMAP_DECODE_WORKER BITMAP_DECODE_WORKER;
+
+struct _BITMAP_DECODE_WORKER
+{
+	BITMAP_DECODE_POOL* pool;
+	freerdp_thread* thread;
+};
+
+/**
+ * Threads decoding the rectangles of a bitmap update along with the thread
+ * the update came in on. Each rectangle has its own ephemeral bitmap, which
+ * is decompressed and converted by whichever thread takes it; painting is
+ * left to the update thread, in the order of the update.
+ */
+
+struct _BITMAP_DECODE_POOL
+{
+	rdpContext* context;
+
+	int num_workers;
+	BITMAP_DECODE_WORKER* workers;
+	freerdp_sem start;
+	freerdp_sem done;
+	boolean stopping;
+
+	/* the batch being decoded, rectangles are taken in order */
+	freerdp_mutex mutex;
+	BITMAP_DATA* rectangles;
+	int number;
+	rdpBitmap** bitmaps;
+	int next;
+};
+
 void update_gdi_memblt(rdpContext* context, MEMBLT_ORDER* memblt)
 {
 	rdpBitmap* bitmap;
@@ -95,6 +142,13 @@ void update_gdi_cache_bitmap_v2(rdpContext* context, CACHE_BITMAP_V2_ORDER* cach
 			cache_bitmap_v2->bitmapDataStream, cache_bitmap_v2->bitmapWidth, cache_bitmap_v2->bitmapHeight,
 			cache_bitmap_v2->bitmapBpp, cache_bitmap_v2->bitmapLength, cache_bitmap_v2->compressed);
 
+	if ((cache->bitmap->persistent != NULL) && (cache_bitmap_v2->flags & CBR2_PERSISTENT_KEY_PRESENT) &&
+			(cache->bitmap->cells[cache_bitmap_v2->cacheId].slots != NULL))
+	{
+		persistent_cache_put(cache->bitmap->persistent, cache_bitmap_v2->cacheId,
+				cache_bitmap_v2->key1 | ((uint64) cache_bitmap_v2->key2 << 32), bitmap);
+	}
+
 	bitmap->New(context, bitmap);
 
 	prevBitmap = bitmap_cache_get(cache->bitmap, cache_bitmap_v2->cacheId, cache_bitmap_v2->cacheIndex);
@@ -105,54 +159,258 @@ void update_gdi_cache_bitmap_v2(rdpContext* context, CACHE_BITMAP_V2_ORDER* cach
 	bitmap_cache_put(cache->bitmap, cache_bitmap_v2->cacheId, cache_bitmap_v2->cacheIndex, bitmap);
 }
 
-void update_gdi_bitmap_update(rdpContext* context, BITMAP_UPDATE* bitmap_update)
+static void bitmap_update_decode(rdpContext* context, rdpBitmap* bitmap, BITMAP_DATA* bitmap_data)
+{
+	bitmap->bpp = bitmap_data->bitsPerPixel;
+	bitmap->length = bitmap_data->bitmapLength;
+	bitmap->compressed = bitmap_data->compressed;
+
+	Bitmap_SetRectangle(context, bitmap,
+			bitmap_data->destLeft, bitmap_data->destTop,
+			bitmap_data->destRight, bitmap_data->destBottom);
+
+	Bitmap_SetDimensions(context, bitmap, bitmap_data->width, bitmap_data->height);
+
+	bitmap->Decompress(context, bitmap,
+			bitmap_data->bitmapDataStream, bitmap_data->width, bitmap_data->height,
+			bitmap_data->bitsPerPixel, bitmap_data->bitmapLength, bitmap_data->compressed);
+
+	if (bitmap->Convert != NULL)
+		bitmap->Convert(context, bitmap);
+}
+
+static void bitmap_update_paint(rdpContext* context, rdpBitmap* bitmap)
+{
+	/* without a Convert the bitmap has to be made again from its new data */
+	if (bitmap->Convert == NULL)
+	{
+		bitmap->Free(context, bitmap);
+		bitmap->New(context, bitmap);
+	}
+
+	bitmap->Paint(context, bitmap);
+}
+
+/* Decode the next rectangle nobody has taken yet, false once they are all taken */
+static boolean bitmap_decode_pool_step(BITMAP_DECODE_POOL* pool)
+{
+	int index;
+
+	freerdp_mutex_lock(pool->mutex);
+
+	if (pool->next < pool->number)
+		index = pool->next++;
+	else
+		index = -1;
+
+	freerdp_mutex_unlock(pool->mutex);
+
+	if (index < 0)
+		return false;
+
+	bitmap_update_decode(pool->context, pool->bitmaps[index], &pool->rectangles[index]);
+
+	return true;
+}
+
+static void* bitmap_decode_thread_func(void* arg)
+{
+	BITMAP_DECODE_WORKER* worker = (BITMAP_DECODE_WORKER*) arg;
+	BITMAP_DECODE_POOL* pool = worker->pool;
+
+	while (1)
+	{
+		freerdp_sem_wait(pool->start);
+
+		if (pool->stopping)
+			break;
+
+		while (bitmap_decode_pool_step(pool))
+			;
+
+		freerdp_sem_signal(pool->done);
+	}
+
+	freerdp_thread_quit(worker->thread);
+	freerdp_sem_signal(pool->done);
+
+	return NULL;
+}
+
+static BITMAP_DECODE_POOL* bitmap_decode_pool_new(rdpContext* context, int num_workers)
 {
 	int i;
-	rdpBitmap* bitmap;
-	BITMAP_DATA* bitmap_data;
-	boolean reused = true;
-	rdpCache* cache = context->cache;
+	BITMAP_DECODE_POOL* pool;
+
+	pool = xnew(BITMAP_DECODE_POOL);
+	pool->context = context;
+	pool->mutex = freerdp_mutex_new();
+	pool->start = freerdp_sem_new(0);
+	pool->done = freerdp_sem_new(0);
 
-	if (cache->bitmap->bitmap == NULL)
+	pool->num_workers = num_workers;
+	pool->workers = (BITMAP_DECODE_WORKER*) xzalloc(sizeof(BITMAP_DECODE_WORKER) * num_workers);
+
+	for (i = 0; i < num_workers; i++)
 	{
-		cache->bitmap->bitmap = Bitmap_Alloc(context);
-		cache->bitmap->bitmap->ephemeral = true;
-		reused = false;
+		pool->workers[i].pool = pool;
+		pool->workers[i].thread = freerdp_thread_new();
+		freerdp_thread_start(pool->workers[i].thread, bitmap_decode_thread_func, &pool->workers[i]);
 	}
 
-	bitmap = cache->bitmap->bitmap;
+	return pool;
+}
+
+static void bitmap_decode_pool_free(BITMAP_DECODE_POOL* pool)
+{
+	int i;
+
+	if (pool == NULL)
+		return;
+
+	pool->stopping = true;
+
+	for (i = 0; i < pool->num_workers; i++)
+		freerdp_sem_signal(pool->start);
+
+	for (i = 0; i < pool->num_workers; i++)
+		freerdp_sem_wait(pool->done);
+
+	for (i = 0; i < pool->num_workers; i++)
+		freerdp_thread_free(pool->workers[i].thread);
+
+	xfree(pool->workers);
+	freerdp_sem_free(pool->start);
+	freerdp_sem_free(pool->done);
+	freerdp_mutex_free(pool->mutex);
+	xfree(pool);
+}
+
+/* Decode a batch of rectangles into as many bitmaps, returning once they are done */
+static void bitmap_decode_pool_run(BITMAP_DECODE_POOL* pool, BITMAP_DATA* rectangles, int number, rdpBitmap** bitmaps)
+{
+	int i;
+	int num_workers;
+
+	pool->rectangles = rectangles;
+	pool->number = number;
+	pool->bitmaps = bitmaps;
+	pool->next = 0;
+
+	/* the calling thread takes its share, wake no more workers than there are rectangles left */
+	num_workers = MIN(pool->num_workers, number - 1);
+
+	for (i = 0; i < num_workers; i++)
+		freerdp_sem_signal(pool->start);
+
+	while (bitmap_decode_pool_step(pool))
+		;
 
-	for (i = 0; i < (int) bitmap_update->number; i++)
+	for (i = 0; i < num_workers; i++)
+		freerdp_sem_wait(pool->done);
+}
+
+static int bitmap_decode_threads(rdpSettings* settings)
+{
+	int threads = (int) settings->bitmap_decode_threads;
+
+	if (threads < 1)
 	{
-		bitmap_data = &bitmap_update->rectangles[i];
+#ifndef _WIN32
+		threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+		threads = MIN(threads, BITMAP_DECODE_MAX_THREADS);
+	}
 
-		bitmap->bpp = bitmap_data->bitsPerPixel;
-		bitmap->length = bitmap_data->bitmapLength;
-		bitmap->compressed = bitmap_data->compressed;
+	return threads;
+}
 
-		Bitmap_SetRectangle(context, bitmap,
-				bitmap_data->destLeft, bitmap_data->destTop,
-				bitmap_data->destRight, bitmap_data->destBottom);
+/* Make sure there is an ephemeral bitmap for each of count rectangles */
+static void bitmap_cache_reserve_bitmaps(rdpBitmapCache* bitmap_cache, uint32 count)
+{
+	uint32 i;
+	rdpBitmap* bitmap;
+	rdpContext* context = bitmap_cache->context;
 
-		Bitmap_SetDimensions(context, bitmap, bitmap_data->width, bitmap_data->height);
+	if (count <= bitmap_cache->maxBitmaps)
+		return;
 
-		bitmap->Decompress(context, bitmap,
-				bitmap_data->bitmapDataStream, bitmap_data->width, bitmap_data->height,
-				bitmap_data->bitsPerPixel, bitmap_data->bitmapLength, bitmap_data->compressed);
+	if (bitmap_cache->bitmaps == NULL)
+		bitmap_cache->bitmaps = (rdpBitmap**) xmalloc(sizeof(rdpBitmap*) * count);
+	else
+		bitmap_cache->bitmaps = (rdpBitmap**) xrealloc(bitmap_cache->bitmaps, sizeof(rdpBitmap*) * count);
 
-		if (reused)
-			bitmap->Free(context, bitmap);
-		else
-			reused = true;
+	for (i = bitmap_cache->maxBitmaps; i < count; i++)
+	{
+		bitmap = Bitmap_Alloc(context);
+		bitmap->ephemeral = true;
 
+		/* made once with no data, Convert brings it up to date for each rectangle */
+		Bitmap_SetDimensions(context, bitmap, 64, 64);
 		bitmap->New(context, bitmap);
 
-		bitmap->Paint(context, bitmap);
+		bitmap_cache->bitmaps[i] = bitmap;
+	}
+
+	bitmap_cache->maxBitmaps = count;
+}
+
+/**
+ * Draw a bitmap update. With more than one decoding thread the rectangles
+ * are decompressed and converted a batch at a time, then painted in order.
+ */
+
+void update_gdi_bitmap_update(rdpContext* context, BITMAP_UPDATE* bitmap_update)
+{
+	int i;
+	int first;
+	int count;
+	int batch;
+	int threads;
+	rdpBitmap** bitmaps;
+	rdpCache* cache = context->cache;
+	rdpBitmapCache* bitmap_cache = cache->bitmap;
+
+	if (bitmap_update->number < 1)
+		return;
+
+	threads = bitmap_decode_threads(bitmap_cache->settings);
+
+	if (threads > 1 && bitmap_update->number > 1)
+	{
+		if (bitmap_cache->pool == NULL)
+			bitmap_cache->pool = bitmap_decode_pool_new(context, threads - 1);
+
+		batch = MIN((int) bitmap_update->number, BITMAP_DECODE_BATCH);
+		bitmap_cache_reserve_bitmaps(bitmap_cache, batch);
+		bitmaps = bitmap_cache->bitmaps;
+
+		for (first = 0; first < (int) bitmap_update->number; first += count)
+		{
+			count = MIN((int) bitmap_update->number - first, batch);
+
+			bitmap_decode_pool_run(bitmap_cache->pool, &bitmap_update->rectangles[first], count, bitmaps);
+
+			for (i = 0; i < count; i++)
+				bitmap_update_paint(context, bitmaps[i]);
+		}
+	}
+	else
+	{
+		bitmap_cache_reserve_bitmaps(bitmap_cache, 1);
+		bitmaps = bitmap_cache->bitmaps;
+
+		for (i = 0; i < (int) bitmap_update->number; i++)
+		{
+			bitmap_update_decode(context, bitmaps[0], &bitmap_update->rectangles[i]);
+			bitmap_update_paint(context, bitmaps[0]);
+		}
 	}
 }
 
 rdpBitmap* bitmap_cache_get(rdpBitmapCache* bitmap_cache, uint32 id, uint32 index)
 {
+	sint32 slot;
 	rdpBitmap* bitmap;
 
 	if (id > bitmap_cache->maxCells)
@@ -173,6 +431,20 @@ rdpBitmap* bitmap_cache_get(rdpBitmapCache* bitmap_cache, uint32 id, uint32 inde
 
 	bitmap = bitmap_cache->cells[id].entries[index];
 
+	if ((bitmap == NULL) && (bitmap_cache->cells[id].slots != NULL) &&
+			(bitmap_cache->cells[id].slots[index] != -1))
+	{
+		/* announced in the persistent key list, loaded on first use */
+		slot = bitmap_cache->cells[id].slots[index];
+
+		/* the slot stayed pinned since it was announced, so it still holds the key */
+		bitmap = persistent_cache_load(bitmap_cache->persistent, bitmap_cache->context, slot);
+
+		persistent_cache_pin(bitmap_cache->persistent, slot, false);
+		bitmap_cache->cells[id].slots[index] = -1;
+		bitmap_cache->cells[id].entries[index] = bitmap;
+	}
+
 	return bitmap;
 }
 
@@ -195,6 +467,13 @@ void bitmap_cache_put(rdpBitmapCache* bitmap_cache, uint32 id, uint32 index, rdp
 	}
 
 	bitmap_cache->cells[id].entries[index] = bitmap;
+
+	/* the server replaced an announced bitmap before using it */
+	if ((bitmap_cache->cells[id].slots != NULL) && (bitmap_cache->cells[id].slots[index] != -1))
+	{
+		persistent_cache_pin(bitmap_cache->persistent, bitmap_cache->cells[id].slots[index], false);
+		bitmap_cache->cells[id].slots[index] = -1;
+	}
 }
 
 void bitmap_cache_register_callbacks(rdpUpdate* update)
@@ -213,6 +492,63 @@ void bitmap_cache_register_callbacks(rdpUpdate* update)
 	update->BitmapUpdate = update_gdi_bitmap_update;
 }
 
+/**
+ * Open the on-disk store backing cells 3 and 4, and announce the bitmaps
+ * it holds for them in the settings, to be sent in the persistent key list.
+ */
+
+static void bitmap_cache_persistent_open(rdpBitmapCache* bitmap_cache)
+{
+	int i;
+	uint32 j;
+	char name[32];
+	char* filename;
+	uint32 slots = 0;
+	BITMAP_V2_CELL* cell;
+	BITMAP_CACHE_V2_CELL_INFO* cellInfo;
+	rdpSettings* settings = bitmap_cache->settings;
+
+	for (i = 3; i < 5; i++)
+		slots += settings->bitmapCacheV2CellInfo[i].numEntries;
+
+	if (settings->bitmap_cache_persist_file != NULL)
+	{
+		filename = xstrdup(settings->bitmap_cache_persist_file);
+	}
+	else
+	{
+		/* keys are only valid for the color depth they were sent at */
+		snprintf(name, sizeof(name), "bitmap_cache_%d.bin", settings->color_depth);
+		filename = freerdp_construct_path(settings->config_path, name);
+	}
+
+	bitmap_cache->persistent = persistent_cache_open(filename, slots);
+	xfree(filename);
+
+	if (bitmap_cache->persistent == NULL)
+		return;
+
+	for (i = 3; i < 5; i++)
+	{
+		cell = &bitmap_cache->cells[i];
+		cellInfo = &settings->bitmapCacheV2CellInfo[i];
+
+		cell->slots = (sint32*) xmalloc(sizeof(sint32) * (cell->number + 1));
+
+		for (j = 0; j < cell->number + 1; j++)
+			cell->slots[j] = -1;
+
+		cellInfo->persistent = true;
+		cellInfo->persistentKeys = (uint64*) xmalloc(sizeof(uint64) * cellInfo->numEntries);
+		cellInfo->numPersistentKeys = persistent_cache_get_keys(bitmap_cache->persistent, i,
+				cellInfo->persistentKeys, cell->slots, cellInfo->numEntries);
+
+		/* an announced index must keep resolving to its bitmap until it is used */
+		for (j = 0; j < cellInfo->numPersistentKeys; j++)
+			persistent_cache_pin(bitmap_cache->persistent, cell->slots[j], true);
+	}
+}
+
 rdpBitmapCache* bitmap_cache_new(rdpSettings* settings)
 {
 	int i;
@@ -249,6 +585,9 @@ rdpBitmapCache* bitmap_cache_new(rdpSettings* settings)
 			/* allocate an extra entry for BITMAP_CACHE_WAITING_LIST_INDEX */
 			bitmap_cache->cells[i].entries = (rdpBitmap**) xzalloc(sizeof(rdpBitmap*) * (bitmap_cache->cells[i].number + 1));
 		}
+
+		if (settings->bitmap_cache_persist_enabled)
+			bitmap_cache_persistent_open(bitmap_cache);
 	}
 
 	return bitmap_cache;
@@ -274,10 +613,21 @@ void bitmap_cache_free(rdpBitmapCache* bitmap_cache)
 			}
 
 			xfree(bitmap_cache->cells[i].entries);
+			xfree(bitmap_cache->cells[i].slots);
+
+			xfree(bitmap_cache->settings->bitmapCacheV2CellInfo[i].persistentKeys);
+			bitmap_cache->settings->bitmapCacheV2CellInfo[i].persistentKeys = NULL;
+			bitmap_cache->settings->bitmapCacheV2CellInfo[i].numPersistentKeys = 0;
 		}
 
-		if (bitmap_cache->bitmap != NULL)
-			Bitmap_Free(bitmap_cache->context, bitmap_cache->bitmap);
+		persistent_cache_close(bitmap_cache->persistent);
+
+		bitmap_decode_pool_free(bitmap_cache->pool);
+
+		for (i = 0; i < (int) bitmap_cache->maxBitmaps; i++)
+			Bitmap_Free(bitmap_cache->context, bitmap_cache->bitmaps[i]);
+
+		xfree(bitmap_cache->bitmaps);
 
 		xfree(bitmap_cache->cells);
 		xfree(bitmap_cache);
@@ -0,0 +1,360 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * Persistent Bitmap Cache
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <freerdp/freerdp.h>
+#include <freerdp/utils/memory.h>
+
+#include <freerdp/cache/persistent.h>
+
+/**
+ * The store is a single file mapped in memory: a header, a table of entries
+ * and one fixed size slot of bitmap data per entry. Its size is set when it
+ * is created, entries are replaced first-in first-out once it is full.
+ * Entries announced to the server are pinned and skipped until they are
+ * used, as the server may refer to them at any time.
+ */
+
+#define PERSISTENT_CACHE_ALIGN		4096
+
+static uint32 persistent_cache_hash(rdpPersistentCache* persistent, uint64 key)
+{
+	return (uint32) ((key ^ (key >> 29)) * 0x9E3779B1) & (persistent->buckets - 1);
+}
+
+static void persistent_cache_link(rdpPersistentCache* persistent, sint32 slot)
+{
+	uint32 bucket;
+
+	bucket = persistent_cache_hash(persistent, persistent->entries[slot].key);
+	persistent->next[slot] = persistent->heads[bucket];
+	persistent->heads[bucket] = slot;
+}
+
+static void persistent_cache_unlink(rdpPersistentCache* persistent, sint32 slot)
+{
+	sint32* link;
+
+	link = &persistent->heads[persistent_cache_hash(persistent, persistent->entries[slot].key)];
+
+	while (*link != -1)
+	{
+		if (*link == slot)
+		{
+			*link = persistent->next[slot];
+			break;
+		}
+
+		link = &persistent->next[*link];
+	}
+}
+
+/**
+ * Look up a bitmap by its 64-bit key (key1 in the low half, key2 in the high half).
+ * @return slot, or -1 if the key is not in the store
+ */
+
+sint32 persistent_cache_find(rdpPersistentCache* persistent, uint64 key)
+{
+	sint32 slot;
+
+	slot = persistent->heads[persistent_cache_hash(persistent, key)];
+
+	while (slot != -1)
+	{
+		if (persistent->entries[slot].key == key)
+			return slot;
+
+		slot = persistent->next[slot];
+	}
+
+	return -1;
+}
+
+/**
+ * Keep a slot from being replaced, or let it be replaced again.
+ */
+
+void persistent_cache_pin(rdpPersistentCache* persistent, sint32 slot, boolean pinned)
+{
+	if ((slot >= 0) && ((uint32) slot < persistent->slots))
+		persistent->pinned[slot] = pinned ? 1 : 0;
+}
+
+/**
+ * Store the uncompressed data of a bitmap under its key.
+ * @return true if the bitmap was stored, false if it is too large or every slot is pinned
+ */
+
+boolean persistent_cache_put(rdpPersistentCache* persistent, uint32 cellId, uint64 key, rdpBitmap* bitmap)
+{
+	sint32 slot;
+	PERSISTENT_CACHE_ENTRY* entry;
+
+	if ((bitmap->data == NULL) || (bitmap->length > PERSISTENT_CACHE_SLOT_SIZE))
+		return false;
+
+	slot = persistent_cache_find(persistent, key);
+
+	if (slot == -1)
+	{
+		uint32 i;
+
+		for (i = 0; i < persistent->slots; i++)
+		{
+			slot = persistent->cursor;
+			persistent->cursor = (persistent->cursor + 1) % persistent->slots;
+
+			if (!persistent->pinned[slot])
+				break;
+		}
+
+		if (i == persistent->slots)
+			return false;
+
+		if (persistent->entries[slot].valid)
+			persistent_cache_unlink(persistent, slot);
+	}
+	else
+	{
+		persistent_cache_unlink(persistent, slot);
+	}
+
+	entry = &persistent->entries[slot];
+
+	/* the entry is only marked valid once its data is complete */
+	entry->valid = 0;
+	memcpy(&persistent->data[slot * PERSISTENT_CACHE_SLOT_SIZE], bitmap->data, bitmap->length);
+
+	entry->key = key;
+	entry->width = bitmap->width;
+	entry->height = bitmap->height;
+	entry->bpp = bitmap->bpp;
+	entry->cellId = cellId;
+	entry->length = bitmap->length;
+	entry->stamp = ++persistent->header->stamp;
+	entry->valid = 1;
+
+	persistent_cache_link(persistent, slot);
+
+	return true;
+}
+
+/**
+ * Create a bitmap from a slot of the store.
+ */
+
+rdpBitmap* persistent_cache_load(rdpPersistentCache* persistent, rdpContext* context, sint32 slot)
+{
+	rdpBitmap* bitmap;
+	PERSISTENT_CACHE_ENTRY* entry;
+
+	entry = &persistent->entries[slot];
+
+	if (!entry->valid)
+		return NULL;
+
+	bitmap = Bitmap_Alloc(context);
+
+	Bitmap_SetDimensions(context, bitmap, entry->width, entry->height);
+
+	bitmap->bpp = entry->bpp;
+	bitmap->length = entry->length;
+	bitmap->compressed = false;
+	bitmap->data = (uint8*) xmalloc(entry->length);
+	memcpy(bitmap->data, &persistent->data[slot * PERSISTENT_CACHE_SLOT_SIZE], entry->length);
+
+	bitmap->New(context, bitmap);
+
+	entry->stamp = ++persistent->header->stamp;
+
+	return bitmap;
+}
+
+struct _PERSISTENT_CACHE_MATCH
+{
+	uint32 stamp;
+	sint32 slot;
+};
+typedef struct _PERSISTENT_CACHE_MATCH PERSISTENT_CACHE_MATCH;
+
+static int persistent_cache_compare(const void* a, const void* b)
+{
+	uint32 stampA = ((PERSISTENT_CACHE_MATCH*) a)->stamp;
+	uint32 stampB = ((PERSISTENT_CACHE_MATCH*) b)->stamp;
+
+	return (stampA < stampB) ? 1 : ((stampA > stampB) ? -1 : 0);
+}
+
+/**
+ * Get the keys stored for a cell, most recently used first.
+ * @param keys receives up to count keys
+ * @param slots receives the slot of each key
+ * @return number of keys
+ */
+
+uint32 persistent_cache_get_keys(rdpPersistentCache* persistent, uint32 cellId,
+		uint64* keys, sint32* slots, uint32 count)
+{
+	uint32 i;
+	uint32 found = 0;
+	PERSISTENT_CACHE_MATCH* matches;
+
+	matches = (PERSISTENT_CACHE_MATCH*) xmalloc(sizeof(PERSISTENT_CACHE_MATCH) * persistent->slots);
+
+	for (i = 0; i < persistent->slots; i++)
+	{
+		if (persistent->entries[i].valid && (persistent->entries[i].cellId == cellId))
+		{
+			matches[found].stamp = persistent->entries[i].stamp;
+			matches[found].slot = i;
+			found++;
+		}
+	}
+
+	qsort(matches, found, sizeof(PERSISTENT_CACHE_MATCH), persistent_cache_compare);
+
+	found = MIN(found, count);
+
+	for (i = 0; i < found; i++)
+	{
+		keys[i] = persistent->entries[matches[i].slot].key;
+		slots[i] = matches[i].slot;
+	}
+
+	xfree(matches);
+
+	return found;
+}
+
+rdpPersistentCache* persistent_cache_open(char* filename, uint32 slots)
+{
+#ifndef _WIN32
+	uint32 i;
+	uint32 size;
+	uint32 table;
+	uint32 oldest;
+	boolean valid;
+	rdpPersistentCache* persistent;
+
+	table = sizeof(PERSISTENT_CACHE_HEADER) + sizeof(PERSISTENT_CACHE_ENTRY) * slots;
+	table = (table + PERSISTENT_CACHE_ALIGN - 1) & ~(PERSISTENT_CACHE_ALIGN - 1);
+	size = table + slots * PERSISTENT_CACHE_SLOT_SIZE;
+
+	persistent = xnew(rdpPersistentCache);
+	persistent->fd = open(filename, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+
+	if (persistent->fd == -1)
+	{
+		printf("persistent_cache_open: failed to open %s\n", filename);
+		xfree(persistent);
+		return NULL;
+	}
+
+	/* the data slots are left sparse until they are written */
+	if (ftruncate(persistent->fd, size) != 0)
+	{
+		close(persistent->fd);
+		xfree(persistent);
+		return NULL;
+	}
+
+	persistent->map = (uint8*) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, persistent->fd, 0);
+
+	if (persistent->map == MAP_FAILED)
+	{
+		close(persistent->fd);
+		xfree(persistent);
+		return NULL;
+	}
+
+	persistent->size = size;
+	persistent->slots = slots;
+	persistent->header = (PERSISTENT_CACHE_HEADER*) persistent->map;
+	persistent->entries = (PERSISTENT_CACHE_ENTRY*) &persistent->map[sizeof(PERSISTENT_CACHE_HEADER)];
+	persistent->data = &persistent->map[table];
+
+	valid = (persistent->header->magic == PERSISTENT_CACHE_MAGIC) &&
+			(persistent->header->version == PERSISTENT_CACHE_VERSION) &&
+			(persistent->header->slots == slots) &&
+			(persistent->header->slotSize == PERSISTENT_CACHE_SLOT_SIZE);
+
+	if (!valid)
+	{
+		/* new, or written with another layout: start over */
+		memset(persistent->map, 0, table);
+		persistent->header->magic = PERSISTENT_CACHE_MAGIC;
+		persistent->header->version = PERSISTENT_CACHE_VERSION;
+		persistent->header->slots = slots;
+		persistent->header->slotSize = PERSISTENT_CACHE_SLOT_SIZE;
+	}
+
+	for (persistent->buckets = 1; persistent->buckets < slots; persistent->buckets <<= 1);
+
+	persistent->heads = (sint32*) xmalloc(sizeof(sint32) * persistent->buckets);
+	persistent->next = (sint32*) xmalloc(sizeof(sint32) * slots);
+	persistent->pinned = (uint8*) xzalloc(slots);
+	memset(persistent->heads, 0xFF, sizeof(sint32) * persistent->buckets);
+
+	/* resume replacing entries from the free or the oldest one */
+	oldest = 0;
+
+	for (i = 0; i < slots; i++)
+	{
+		persistent->next[i] = -1;
+
+		if (persistent->entries[i].valid)
+			persistent_cache_link(persistent, i);
+
+		if (persistent->entries[oldest].valid && (!persistent->entries[i].valid ||
+				persistent->entries[i].stamp < persistent->entries[oldest].stamp))
+			oldest = i;
+	}
+
+	persistent->cursor = oldest;
+
+	return persistent;
+#else
+	return NULL;
+#endif
+}
+
+void persistent_cache_close(rdpPersistentCache* persistent)
+{
+	if (persistent != NULL)
+	{
+#ifndef _WIN32
+		msync(persistent->map, persistent->size, MS_ASYNC);
+		munmap(persistent->map, persistent->size);
+		close(persistent->fd);
+#endif
+		xfree(persistent->heads);
+		xfree(persistent->next);
+		xfree(persistent->pinned);
+		xfree(persistent);
+	}
+}
@@ -0,0 +1,686 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * Server Cache Manager
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <freerdp/freerdp.h>
+#include <freerdp/peer.h>
+#include <freerdp/codec/bitmap.h>
+#include <freerdp/utils/stream.h>
+#include <freerdp/utils/memory.h>
+
+#include <freerdp/cache/server.h>
+
+/**
+ * The client only keeps what the server tells it to, so the server mirrors
+ * each of its caches: for every index, the hash of what was sent there.
+ * Content already held is drawn by index, anything else takes the least
+ * recently used index of the smallest cell it fits in.
+ */
+
+/* Largest bitmap each bitmap cache cell holds, in pixels */
+static const int SERVER_BITMAP_CELL_SIZE[] =
+{
+	256, 1024, 4096, 4096, 4096
+};
+
+#define SERVER_CACHE_HASH_SEED		0xCBF29CE484222325ULL
+#define SERVER_CACHE_HASH_PRIME		0x100000001B3ULL
+
+static uint64 server_cache_hash(uint64 hash, uint8* data, int length)
+{
+	while (length-- > 0)
+	{
+		hash ^= *data++;
+		hash *= SERVER_CACHE_HASH_PRIME;
+	}
+
+	return hash;
+}
+
+static uint64 server_cache_hash_value(uint64 hash, uint32 value)
+{
+	uint8 bytes[4];
+
+	bytes[0] = value & 0xFF;
+	bytes[1] = (value >> 8) & 0xFF;
+	bytes[2] = (value >> 16) & 0xFF;
+	bytes[3] = (value >> 24) & 0xFF;
+
+	return server_cache_hash(hash, bytes, 4);
+}
+
+static void server_cache_cell_init(SERVER_CACHE_CELL* cell, int number, int maxSize)
+{
+	int i;
+	int buckets;
+
+	memset(cell, 0, sizeof(SERVER_CACHE_CELL));
+
+	if (number > 0x7FFF)
+		number = 0x7FFF;
+
+	if (number < 1)
+		return;
+
+	for (buckets = 1; buckets < number; buckets <<= 1);
+
+	cell->number = number;
+	cell->maxSize = maxSize;
+	cell->head = cell->tail = -1;
+	cell->mask = buckets - 1;
+	cell->buckets = (int*) xmalloc(sizeof(int) * buckets);
+	cell->entries = (SERVER_CACHE_ENTRY*) xzalloc(sizeof(SERVER_CACHE_ENTRY) * number);
+
+	for (i = 0; i < buckets; i++)
+		cell->buckets[i] = -1;
+}
+
+static void server_cache_cell_uninit(SERVER_CACHE_CELL* cell)
+{
+	xfree(cell->buckets);
+	xfree(cell->entries);
+	memset(cell, 0, sizeof(SERVER_CACHE_CELL));
+}
+
+static void server_cache_cell_unlink(SERVER_CACHE_CELL* cell, int index)
+{
+	SERVER_CACHE_ENTRY* entry = &cell->entries[index];
+
+	if (entry->prev >= 0)
+		cell->entries[entry->prev].next = entry->next;
+	else
+		cell->head = entry->next;
+
+	if (entry->next >= 0)
+		cell->entries[entry->next].prev = entry->prev;
+	else
+		cell->tail = entry->prev;
+}
+
+static void server_cache_cell_push(SERVER_CACHE_CELL* cell, int index, boolean front)
+{
+	SERVER_CACHE_ENTRY* entry = &cell->entries[index];
+
+	if (front)
+	{
+		entry->prev = -1;
+		entry->next = cell->head;
+
+		if (cell->head >= 0)
+			cell->entries[cell->head].prev = index;
+		else
+			cell->tail = index;
+
+		cell->head = index;
+	}
+	else
+	{
+		entry->next = -1;
+		entry->prev = cell->tail;
+
+		if (cell->tail >= 0)
+			cell->entries[cell->tail].next = index;
+		else
+			cell->head = index;
+
+		cell->tail = index;
+	}
+}
+
+/* Take an entry out of its hash bucket, it can no longer be found */
+static void server_cache_cell_unchain(SERVER_CACHE_CELL* cell, int index)
+{
+	int* link;
+
+	link = &cell->buckets[cell->entries[index].key & cell->mask];
+
+	while (*link >= 0)
+	{
+		if (*link == index)
+		{
+			*link = cell->entries[index].chain;
+			break;
+		}
+
+		link = &cell->entries[*link].chain;
+	}
+
+	cell->entries[index].chain = -1;
+}
+
+/**
+ * Find the index holding the given content and make it the most recently
+ * used one. When the client does not hold it yet, the index it is to be
+ * sent to is returned instead, evicting the least recently used content.
+ */
+
+static boolean server_cache_cell_lookup(SERVER_CACHE_CELL* cell, uint64 key, int* index)
+{
+	int i;
+	SERVER_CACHE_ENTRY* entry;
+
+	for (i = cell->buckets[key & cell->mask]; i >= 0; i = cell->entries[i].chain)
+	{
+		if (cell->entries[i].key == key)
+		{
+			if (cell->head != i)
+			{
+				server_cache_cell_unlink(cell, i);
+				server_cache_cell_push(cell, i, true);
+			}
+
+			*index = i;
+			return true;
+		}
+	}
+
+	if (cell->count < cell->number)
+	{
+		i = cell->count++;
+	}
+	else
+	{
+		i = cell->tail;
+		server_cache_cell_unlink(cell, i);
+		server_cache_cell_unchain(cell, i);
+	}
+
+	entry = &cell->entries[i];
+	entry->key = key;
+	entry->chain = cell->buckets[key & cell->mask];
+	cell->buckets[key & cell->mask] = i;
+	server_cache_cell_push(cell, i, true);
+
+	*index = i;
+	return false;
+}
+
+/* Forget content that could not be sent after all, its index goes first */
+static void server_cache_cell_remove(SERVER_CACHE_CELL* cell, int index)
+{
+	server_cache_cell_unchain(cell, index);
+	server_cache_cell_unlink(cell, index);
+	server_cache_cell_push(cell, index, false);
+}
+
+static boolean server_cache_lookup(rdpServerCache* cache, SERVER_CACHE_CELL* cell, uint64 key, int* index)
+{
+	if (server_cache_cell_lookup(cell, key, index))
+	{
+		cache->hits++;
+		return true;
+	}
+
+	cache->misses++;
+	return false;
+}
+
+/**
+ * Draw a bitmap of up to 64x64 pixels with a MEMBLT from the bitmap cache,
+ * sending it in a CACHE_BITMAP_V2 order first unless the client still has
+ * it. The caller fills in the destination, source offset and rop of the
+ * MEMBLT. Returns false when the bitmap cannot be cached, it then has to
+ * be sent in a bitmap update.
+ */
+
+boolean server_cache_memblt(rdpServerCache* cache, MEMBLT_ORDER* memblt,
+		uint8* data, int width, int height, int rowstride, int bpp)
+{
+	int x, y;
+	int Bpp;
+	int index;
+	int cellId;
+	int paddedWidth;
+	uint64 key;
+	uint8* src;
+	uint8* dst;
+	SERVER_CACHE_CELL* cell;
+	CACHE_BITMAP_V2_ORDER cache_bitmap_v2;
+	rdpContext* context = cache->context;
+
+	if (cache->numBitmapCells < 1 || cache->settings->order_support[NEG_MEMBLT_INDEX] != true)
+		return false;
+
+	if (width < 1 || height < 1 || width > SERVER_BITMAP_CACHE_TILE_SIZE || height > SERVER_BITMAP_CACHE_TILE_SIZE)
+		return false;
+
+	if (bpp != 8 && bpp != 15 && bpp != 16 && bpp != 24 && bpp != 32)
+		return false;
+
+	/* bitmap widths are sent as multiples of four */
+	paddedWidth = (width + 3) & ~3;
+
+	for (cellId = 0; cellId < cache->numBitmapCells; cellId++)
+	{
+		cell = &cache->bitmap[cellId];
+
+		if (cell->number > 0 && paddedWidth * height <= cell->maxSize)
+			break;
+	}
+
+	if (cellId >= cache->numBitmapCells)
+		return false;
+
+	Bpp = (bpp + 7) / 8;
+
+	key = server_cache_hash_value(SERVER_CACHE_HASH_SEED, width);
+	key = server_cache_hash_value(key, height);
+	key = server_cache_hash_value(key, bpp);
+
+	for (y = 0; y < height; y++)
+		key = server_cache_hash(key, &data[y * rowstride], width * Bpp);
+
+	if (server_cache_lookup(cache, cell, key, &index) != true)
+	{
+		/* pad by repeating the last column */
+		for (y = 0; y < height; y++)
+		{
+			src = &data[y * rowstride];
+			dst = &cache->tile[y * paddedWidth * Bpp];
+			memcpy(dst, src, width * Bpp);
+
+			for (x = width; x < paddedWidth; x++)
+				memcpy(&dst[x * Bpp], &src[(width - 1) * Bpp], Bpp);
+		}
+
+		stream_set_pos(cache->data, 0);
+
+		if (bitmap_compress(cache->tile, cache->data, paddedWidth, height, paddedWidth * Bpp, bpp) != true)
+		{
+			server_cache_cell_remove(cell, index);
+			return false;
+		}
+
+		memset(&cache_bitmap_v2, 0, sizeof(CACHE_BITMAP_V2_ORDER));
+		cache_bitmap_v2.cacheId = cellId;
+		cache_bitmap_v2.cacheIndex = index;
+		cache_bitmap_v2.bitmapBpp = bpp;
+		cache_bitmap_v2.bitmapWidth = paddedWidth;
+		cache_bitmap_v2.bitmapHeight = height;
+		cache_bitmap_v2.compressed = true;
+		cache_bitmap_v2.bitmapLength = stream_get_length(cache->data);
+		cache_bitmap_v2.bitmapDataStream = stream_get_head(cache->data);
+
+		IFCALL(cache->update->secondary->CacheBitmapV2, context, &cache_bitmap_v2);
+	}
+
+	memblt->cacheId = cellId;
+	memblt->colorIndex = 0;
+	memblt->cacheIndex = index;
+
+	IFCALL(cache->update->primary->MemBlt, context, memblt);
+
+	return true;
+}
+
+static INLINE uint32 server_cache_glyph_size(GLYPH_DATA* glyph)
+{
+	uint32 cb;
+
+	cb = ((glyph->cx + 7) / 8) * glyph->cy;
+	cb += ((cb % 4) > 0) ? 4 - (cb % 4) : 0;
+
+	return cb;
+}
+
+static void server_cache_send_glyphs(rdpServerCache* cache, int cacheId, GLYPH_DATA* glyphs, int count)
+{
+	int i;
+	rdpContext* context = cache->context;
+
+	if (cache->settings->glyphSupportLevel == GLYPH_SUPPORT_ENCODE)
+	{
+		CACHE_GLYPH_V2_ORDER cache_glyph_v2;
+		GLYPH_DATA_V2 glyphs_v2[SERVER_GLYPH_CACHE_RUN_SIZE];
+
+		memset(&cache_glyph_v2, 0, sizeof(CACHE_GLYPH_V2_ORDER));
+		cache_glyph_v2.cacheId = cacheId;
+		cache_glyph_v2.cGlyphs = count;
+
+		for (i = 0; i < count; i++)
+		{
+			glyphs_v2[i].cacheIndex = glyphs[i].cacheIndex;
+			glyphs_v2[i].x = glyphs[i].x;
+			glyphs_v2[i].y = glyphs[i].y;
+			glyphs_v2[i].cx = glyphs[i].cx;
+			glyphs_v2[i].cy = glyphs[i].cy;
+			glyphs_v2[i].cb = glyphs[i].cb;
+			glyphs_v2[i].aj = glyphs[i].aj;
+			cache_glyph_v2.glyphData[i] = &glyphs_v2[i];
+		}
+
+		IFCALL(cache->update->secondary->CacheGlyphV2, context, &cache_glyph_v2);
+	}
+	else
+	{
+		CACHE_GLYPH_ORDER cache_glyph;
+
+		memset(&cache_glyph, 0, sizeof(CACHE_GLYPH_ORDER));
+		cache_glyph.cacheId = cacheId;
+		cache_glyph.cGlyphs = count;
+
+		for (i = 0; i < count; i++)
+			cache_glyph.glyphData[i] = &glyphs[i];
+
+		IFCALL(cache->update->secondary->CacheGlyph, context, &cache_glyph);
+	}
+}
+
+/**
+ * Draw a string of glyphs with GLYPH_INDEX orders, sending the glyphs the
+ * client does not hold in CACHE_GLYPH orders first. The glyph bitmaps are
+ * padded the way the client reads them, their x and y are the offsets from
+ * the glyph origin. origins holds where each glyph origin goes, along the
+ * baseline. The caller fills in the colors, rectangles, brush and the other
+ * coordinate of the order. Returns false when the glyphs cannot be cached.
+ */
+
+boolean server_cache_glyph_index(rdpServerCache* cache, GLYPH_INDEX_ORDER* glyph_index,
+		GLYPH_DATA* glyphs, sint32* origins, int count)
+{
+	int i;
+	int run;
+	int first;
+	int index;
+	int cellId;
+	int cGlyphs;
+	uint32 size;
+	uint32 maxSize;
+	uint64 key;
+	sint32 delta;
+	sint32 position;
+	boolean vertical;
+	SERVER_CACHE_CELL* cell;
+	GLYPH_DATA cached[SERVER_GLYPH_CACHE_RUN_SIZE];
+	rdpContext* context = cache->context;
+
+	if (cache->numGlyphCells < 1 || cache->settings->order_support[NEG_GLYPH_INDEX_INDEX] != true)
+		return false;
+
+	if (count < 1)
+		return true;
+
+	maxSize = 0;
+
+	for (i = 0; i < count; i++)
+	{
+		size = server_cache_glyph_size(&glyphs[i]);
+		maxSize = MAX(maxSize, size);
+	}
+
+	/* all glyphs of an order come from the same cell */
+	for (cellId = 0; cellId < cache->numGlyphCells; cellId++)
+	{
+		cell = &cache->glyph[cellId];
+
+		if (cell->number > 0 && maxSize <= (uint32) cell->maxSize)
+			break;
+	}
+
+	if (cellId >= cache->numGlyphCells)
+		return false;
+
+	/* glyphs used by an order are not evicted by the same order */
+	run = MIN(SERVER_GLYPH_CACHE_RUN_SIZE, cell->number);
+
+	vertical = (glyph_index->flAccel & SO_VERTICAL) ? true : false;
+	glyph_index->cacheId = cellId;
+	glyph_index->ulCharInc = 0;
+	glyph_index->flAccel &= ~SO_CHAR_INC_EQUAL_BM_BASE;
+
+	for (first = 0; first < count; first += run)
+	{
+		cGlyphs = 0;
+		glyph_index->cbData = 0;
+		position = origins[first];
+
+		if (vertical)
+			glyph_index->y = position;
+		else
+			glyph_index->x = position;
+
+		for (i = first; i < first + run && i < count; i++)
+		{
+			key = server_cache_hash_value(SERVER_CACHE_HASH_SEED, glyphs[i].x);
+			key = server_cache_hash_value(key, glyphs[i].y);
+			key = server_cache_hash_value(key, glyphs[i].cx);
+			key = server_cache_hash_value(key, glyphs[i].cy);
+			key = server_cache_hash(key, glyphs[i].aj, server_cache_glyph_size(&glyphs[i]));
+
+			if (server_cache_lookup(cache, cell, key, &index) != true)
+			{
+				memcpy(&cached[cGlyphs], &glyphs[i], sizeof(GLYPH_DATA));
+				cached[cGlyphs].cacheIndex = index;
+				cached[cGlyphs].cb = server_cache_glyph_size(&glyphs[i]);
+				cGlyphs++;
+			}
+
+			/* each index is followed by the distance from the previous glyph origin */
+			delta = origins[i] - position;
+			position = origins[i];
+
+			glyph_index->data[glyph_index->cbData++] = index;
+
+			if (delta >= 0 && delta < 0x80)
+			{
+				glyph_index->data[glyph_index->cbData++] = delta;
+			}
+			else
+			{
+				glyph_index->data[glyph_index->cbData++] = 0x80;
+				glyph_index->data[glyph_index->cbData++] = delta & 0xFF;
+				glyph_index->data[glyph_index->cbData++] = (delta >> 8) & 0xFF;
+			}
+		}
+
+		if (cGlyphs > 0)
+			server_cache_send_glyphs(cache, cellId, cached, cGlyphs);
+
+		IFCALL(cache->update->primary->GlyphIndex, context, glyph_index);
+
+		/* the opaque rectangle is filled by the first order only */
+		glyph_index->fOpRedundant = 0;
+		glyph_index->opLeft = glyph_index->opTop = 0;
+		glyph_index->opRight = glyph_index->opBottom = 0;
+	}
+
+	return true;
+}
+
+/**
+ * Turn an 8x8 color pattern brush into a cached brush, sending it in a
+ * CACHE_BRUSH order first unless the client still has it. Monochrome and
+ * other brushes go along with their orders and are left alone. Returns
+ * false when the brush cannot be sent.
+ */
+
+boolean server_cache_brush(rdpServerCache* cache, rdpBrush* brush)
+{
+	int i, k;
+	int Bpp;
+	int index;
+	int colors;
+	uint8 iBitmapFormat;
+	uint64 key;
+	uint8* pixel;
+	uint32 length;
+	CACHE_BRUSH_ORDER cache_brush;
+	rdpContext* context = cache->context;
+
+	if (brush->style != BS_PATTERN || brush->bpp == 1)
+		return true;
+
+	if (cache->brush.number < 1)
+		return false;
+
+	switch (brush->bpp)
+	{
+		case 8:
+			iBitmapFormat = BMF_8BPP;
+			break;
+
+		case 16:
+			iBitmapFormat = BMF_16BPP;
+			break;
+
+		case 24:
+			iBitmapFormat = BMF_24BPP;
+			break;
+
+		case 32:
+			iBitmapFormat = BMF_32BPP;
+			break;
+
+		default:
+			return false;
+	}
+
+	if (brush->bpp > 8 && cache->settings->brush_support_level < BRUSH_COLOR_FULL)
+		return false;
+
+	Bpp = brush->bpp / 8;
+
+	/* brushes of at most four colors are sent as a palette and indices */
+	colors = 0;
+
+	for (i = 0; i < 64 && colors <= 4; i++)
+	{
+		pixel = &brush->data[i * Bpp];
+
+		for (k = 0; k < i; k++)
+		{
+			if (memcmp(&brush->data[k * Bpp], pixel, Bpp) == 0)
+				break;
+		}
+
+		if (k == i)
+			colors++;
+	}
+
+	if (colors <= 4 && brush->bpp != 24)
+		length = 16 + 4 * Bpp;
+	else if (64 * Bpp <= 0xFF)
+		length = 64 * Bpp;
+	else
+		return false;
+
+	key = server_cache_hash_value(SERVER_CACHE_HASH_SEED, brush->bpp);
+	key = server_cache_hash(key, brush->data, 64 * Bpp);
+
+	if (server_cache_lookup(cache, &cache->brush, key, &index) != true)
+	{
+		memset(&cache_brush, 0, sizeof(CACHE_BRUSH_ORDER));
+		cache_brush.index = index;
+		cache_brush.bpp = brush->bpp;
+		cache_brush.cx = 8;
+		cache_brush.cy = 8;
+		cache_brush.length = length;
+		cache_brush.data = brush->data;
+
+		IFCALL(cache->update->secondary->CacheBrush, context, &cache_brush);
+	}
+
+	brush->style = CACHED_BRUSH | iBitmapFormat;
+	brush->index = index;
+	brush->hatch = index;
+
+	return true;
+}
+
+/**
+ * Size the caches after what the client announced in its capabilities,
+ * forgetting everything sent before. Call it once the client is activated,
+ * and again whenever it is reactivated.
+ */
+
+void server_cache_reset(rdpServerCache* cache)
+{
+	int i;
+	rdpSettings* settings = cache->settings;
+
+	for (i = 0; i < 5; i++)
+		server_cache_cell_uninit(&cache->bitmap[i]);
+
+	for (i = 0; i < 10; i++)
+		server_cache_cell_uninit(&cache->glyph[i]);
+
+	server_cache_cell_uninit(&cache->brush);
+
+	cache->numBitmapCells = MIN(settings->bitmapCacheV2NumCells, 5);
+
+	for (i = 0; i < cache->numBitmapCells; i++)
+	{
+		server_cache_cell_init(&cache->bitmap[i],
+				settings->bitmapCacheV2CellInfo[i].numEntries, SERVER_BITMAP_CELL_SIZE[i]);
+	}
+
+	cache->numGlyphCells = (settings->glyphSupportLevel != GLYPH_SUPPORT_NONE) ? 10 : 0;
+
+	for (i = 0; i < cache->numGlyphCells; i++)
+	{
+		/* glyph cache indices are sent in a byte */
+		server_cache_cell_init(&cache->glyph[i], MIN(settings->glyphCache[i].cacheEntries, 254),
+				settings->glyphCache[i].cacheMaximumCellSize);
+	}
+
+	if (settings->brush_support_level >= BRUSH_COLOR_8x8)
+		server_cache_cell_init(&cache->brush, SERVER_BRUSH_CACHE_ENTRIES, 0);
+
+	cache->hits = 0;
+	cache->misses = 0;
+}
+
+rdpServerCache* server_cache_new(freerdp_peer* client)
+{
+	rdpServerCache* cache;
+
+	cache = (rdpServerCache*) xzalloc(sizeof(rdpServerCache));
+
+	if (cache != NULL)
+	{
+		cache->context = client->context;
+		cache->update = client->update;
+		cache->settings = client->settings;
+
+		cache->data = stream_new(SERVER_BITMAP_CACHE_TILE_SIZE * SERVER_BITMAP_CACHE_TILE_SIZE * 4);
+		cache->tile = (uint8*) xmalloc(SERVER_BITMAP_CACHE_TILE_SIZE * SERVER_BITMAP_CACHE_TILE_SIZE * 4);
+
+		server_cache_reset(cache);
+	}
+
+	return cache;
+}
+
+void server_cache_free(rdpServerCache* cache)
+{
+	int i;
+
+	if (cache != NULL)
+	{
+		for (i = 0; i < 5; i++)
+			server_cache_cell_uninit(&cache->bitmap[i]);
+
+		for (i = 0; i < 10; i++)
+			server_cache_cell_uninit(&cache->glyph[i]);
+
+		server_cache_cell_uninit(&cache->brush);
+
+		stream_free(cache->data);
+		xfree(cache->tile);
+		xfree(cache);
+	}
+}
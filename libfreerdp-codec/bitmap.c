@@ -376,30 +376,70 @@ static int process_raw_plane(uint8* srcData, int width, int height, uint8* dstDa
 	return (width * height);
 }
 
+/**
+ * convert YCoCg planes back to RGB
+ * the chroma planes were scaled down by the color loss level
+ */
+static void process_ycocg_planes(uint8* data, int width, int height, int cll)
+{
+	int i;
+	sint16 y, co, cg, t;
+	sint16 r, g, b;
+
+	for (i = 0; i < width * height; i++)
+	{
+		y = data[2];
+		co = ((sint16) ((sint8) data[1])) * (1 << cll);
+		cg = ((sint16) ((sint8) data[0])) * (1 << cll);
+
+		t = y - (cg >> 1);
+		g = cg + t;
+		b = t - (co >> 1);
+		r = b + co;
+
+		data[0] = (uint8) MAX(0, MIN(255, b));
+		data[1] = (uint8) MAX(0, MIN(255, g));
+		data[2] = (uint8) MAX(0, MIN(255, r));
+		data += 4;
+	}
+}
+
 /**
  * 4 byte bitmap decompress
  * RDP6_BITMAP_STREAM
  */
 static boolean bitmap_decompress4(uint8* srcData, uint8* dstData, int width, int height, int size)
 {
+	int i;
 	int RLE;
+	int cll;
 	int code;
 	int NoAlpha;
 	int bytes_processed;
 	int total_processed;
 
 	code = IN_UINT8_MV(srcData);
-	RLE = code & 0x10;
+	RLE = code & PLANAR_FORMAT_HEADER_RLE;
+	cll = code & PLANAR_FORMAT_HEADER_CLL_MASK;
 
 	total_processed = 1;
-	NoAlpha = code & 0x20;
+	NoAlpha = code & PLANAR_FORMAT_HEADER_NA;
 
 	if (NoAlpha == 0)
 	{
-		bytes_processed = process_rle_plane(srcData, width, height, dstData + 3, size - total_processed);
+		if (RLE != 0)
+			bytes_processed = process_rle_plane(srcData, width, height, dstData + 3, size - total_processed);
+		else
+			bytes_processed = process_raw_plane(srcData, width, height, dstData + 3, size - total_processed);
+
 		total_processed += bytes_processed;
 		srcData += bytes_processed;
 	}
+	else
+	{
+		for (i = 0; i < width * height; i++)
+			dstData[i * 4 + 3] = 0xFF;
+	}
 
 	if (RLE != 0)
 	{
@@ -428,6 +468,9 @@ static boolean bitmap_decompress4(uint8* srcData, uint8* dstData, int width, int
 		total_processed += bytes_processed + 1;
 	}
 
+	if (cll != 0)
+		process_ycocg_planes(dstData, width, height, cll);
+
 	return (size == total_processed) ? true : false;
 }
 
@@ -0,0 +1,653 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * Compressed Bitmap Encoder
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <freerdp/utils/stream.h>
+#include <freerdp/utils/memory.h>
+
+#include <freerdp/codec/bitmap.h>
+
+/*
+   Interleaved RLE Bitmap Encoder (RLE_BITMAP_STREAM)
+   http://msdn.microsoft.com/en-us/library/cc240895%28v=prot.10%29.aspx
+
+   The encoder emits the subset of compression orders that the decoder in
+   bitmap.c understands and that pay off on typical desktop content:
+   background runs, foreground runs, foreground/background images, color
+   runs and color images. Scanlines are written bottom-up, and no order
+   straddles the end of the first scanline since the decoder only checks
+   for it at order boundaries.
+*/
+
+#define REGULAR_BG_RUN              0x00
+#define MEGA_MEGA_BG_RUN            0xF0
+#define REGULAR_FG_RUN              0x01
+#define MEGA_MEGA_FG_RUN            0xF1
+#define LITE_SET_FG_FG_RUN          0x0C
+#define MEGA_MEGA_SET_FG_RUN        0xF6
+#define REGULAR_COLOR_RUN           0x03
+#define MEGA_MEGA_COLOR_RUN         0xF3
+#define REGULAR_FGBG_IMAGE          0x02
+#define MEGA_MEGA_FGBG_IMAGE        0xF2
+#define LITE_SET_FG_FGBG_IMAGE      0x0D
+#define MEGA_MEGA_SET_FGBG_IMAGE    0xF7
+#define REGULAR_COLOR_IMAGE         0x04
+#define MEGA_MEGA_COLOR_IMAGE       0xF4
+
+#define WHITE_PIXEL 0xFFFFFF
+
+#define RLE_MAX_RUN		0xFFFF
+#define RLE_MIN_RUN		3
+#define RLE_MIN_FGBG		16
+
+#define ABOVE(_p, _i, _w) ((_i) < (_w) ? 0 : (_p)[(_i) - (_w)])
+
+static INLINE uint32 rle_read_pixel(uint8* p, int Bpp)
+{
+	if (Bpp == 1)
+		return p[0];
+	else if (Bpp == 2)
+		return p[0] | (p[1] << 8);
+
+	return p[0] | (p[1] << 8) | (p[2] << 16);
+}
+
+static INLINE void rle_write_pixel(STREAM* s, uint32 pixel, int Bpp)
+{
+	stream_write_uint8(s, pixel & 0xFF);
+
+	if (Bpp > 1)
+		stream_write_uint8(s, (pixel >> 8) & 0xFF);
+
+	if (Bpp > 2)
+		stream_write_uint8(s, (pixel >> 16) & 0xFF);
+}
+
+/**
+ * Write a regular order header (5-bit run length, extended by one byte with a bias of 32).
+ */
+static void rle_write_regular_header(STREAM* s, uint8 code, uint8 megaCode, uint32 length)
+{
+	if (length < 32)
+	{
+		stream_write_uint8(s, (code << 5) | length);
+	}
+	else if (length < 32 + 256)
+	{
+		stream_write_uint8(s, code << 5);
+		stream_write_uint8(s, length - 32);
+	}
+	else
+	{
+		stream_write_uint8(s, megaCode);
+		stream_write_uint16(s, length);
+	}
+}
+
+/**
+ * Write a lite order header (4-bit run length, extended by one byte with a bias of 16).
+ */
+static void rle_write_lite_header(STREAM* s, uint8 code, uint8 megaCode, uint32 length)
+{
+	if (length < 16)
+	{
+		stream_write_uint8(s, (code << 4) | length);
+	}
+	else if (length < 16 + 256)
+	{
+		stream_write_uint8(s, code << 4);
+		stream_write_uint8(s, length - 16);
+	}
+	else
+	{
+		stream_write_uint8(s, megaCode);
+		stream_write_uint16(s, length);
+	}
+}
+
+/**
+ * Write a foreground/background image order header, where short lengths
+ * are expressed in units of 8 pixels and the extended form has a bias of 1.
+ */
+static void rle_write_fgbg_header(STREAM* s, uint8 header, uint8 megaCode, uint32 length, uint32 maxUnits)
+{
+	if ((length % 8) == 0 && (length / 8) <= maxUnits)
+	{
+		stream_write_uint8(s, header | (length / 8));
+	}
+	else if (length <= 256)
+	{
+		stream_write_uint8(s, header);
+		stream_write_uint8(s, length - 1);
+	}
+	else
+	{
+		stream_write_uint8(s, megaCode);
+		stream_write_uint16(s, length);
+	}
+}
+
+static int rle_bg_run(uint32* pixels, int index, int limit, int width)
+{
+	int i = index;
+
+	while (i < limit && (i - index) < RLE_MAX_RUN && pixels[i] == ABOVE(pixels, i, width))
+		i++;
+
+	return i - index;
+}
+
+static int rle_fg_run(uint32* pixels, int index, int limit, int width, uint32 fgPel)
+{
+	int i = index;
+
+	while (i < limit && (i - index) < RLE_MAX_RUN && pixels[i] == (ABOVE(pixels, i, width) ^ fgPel))
+		i++;
+
+	return i - index;
+}
+
+static int rle_fgbg_run(uint32* pixels, int index, int limit, int width, uint32 fgPel)
+{
+	uint32 above;
+	int i = index;
+
+	while (i < limit && (i - index) < RLE_MAX_RUN)
+	{
+		above = ABOVE(pixels, i, width);
+
+		if (pixels[i] != above && pixels[i] != (above ^ fgPel))
+			break;
+
+		i++;
+	}
+
+	return i - index;
+}
+
+static int rle_color_run(uint32* pixels, int index, int limit)
+{
+	int i = index;
+
+	while (i < limit && (i - index) < RLE_MAX_RUN && pixels[i] == pixels[index])
+		i++;
+
+	return i - index;
+}
+
+static void rle_write_color_image(STREAM* s, uint32* pixels, int index, int length, int Bpp)
+{
+	int i;
+
+	stream_check_size(s, 4 + length * Bpp);
+	rle_write_regular_header(s, REGULAR_COLOR_IMAGE, MEGA_MEGA_COLOR_IMAGE, length);
+
+	for (i = index; i < index + length; i++)
+		rle_write_pixel(s, pixels[i], Bpp);
+}
+
+static void rle_write_fgbg_image(STREAM* s, uint32* pixels, int index, int length,
+		int width, uint32 fgPel, boolean setFg, int Bpp)
+{
+	int i, bit;
+	uint8 bitmask;
+
+	stream_check_size(s, 8 + (length + 7) / 8);
+
+	if (setFg)
+	{
+		rle_write_fgbg_header(s, LITE_SET_FG_FGBG_IMAGE << 4, MEGA_MEGA_SET_FGBG_IMAGE, length, 15);
+		rle_write_pixel(s, fgPel, Bpp);
+	}
+	else
+	{
+		rle_write_fgbg_header(s, REGULAR_FGBG_IMAGE << 5, MEGA_MEGA_FGBG_IMAGE, length, 31);
+	}
+
+	for (i = index; i < index + length; i += 8)
+	{
+		bitmask = 0;
+
+		for (bit = 0; bit < 8 && (i + bit) < index + length; bit++)
+		{
+			if (pixels[i + bit] != ABOVE(pixels, i + bit, width))
+				bitmask |= (1 << bit);
+		}
+
+		stream_write_uint8(s, bitmask);
+	}
+}
+
+/**
+ * Compress an array of pixels given in scanline order (bottom-up).
+ */
+static void rle_compress(uint32* pixels, int width, int height, int Bpp, STREAM* s)
+{
+	int i;
+	int total;
+	int limit;
+	int image;
+	int bg, fg, nfg;
+	int fgbg, nfgbg;
+	int color, best;
+	uint32 fgPel;
+	uint32 newFgPel;
+	boolean insertFgPel;
+
+	total = width * height;
+	fgPel = WHITE_PIXEL & ((Bpp == 3) ? 0xFFFFFF : ((1 << (Bpp * 8)) - 1));
+	insertFgPel = false;
+	image = -1;
+	i = 0;
+
+	while (i < total)
+	{
+		if (i == width)
+		{
+			/* the decoder leaves first line mode at the first order past the first scanline */
+			if (image >= 0)
+			{
+				rle_write_color_image(s, pixels, image, i - image, Bpp);
+				image = -1;
+			}
+
+			insertFgPel = false;
+		}
+
+		limit = (i < width) ? width : total;
+
+		if (insertFgPel && image < 0)
+		{
+			/* a background run following a background run starts with a foreground pel */
+			if (pixels[i] == (ABOVE(pixels, i, width) ^ fgPel))
+				bg = 1 + rle_bg_run(pixels, i + 1, limit, width);
+			else
+				bg = 0;
+
+			if (bg > RLE_MAX_RUN)
+				bg = RLE_MAX_RUN;
+		}
+		else
+		{
+			bg = rle_bg_run(pixels, i, limit, width);
+		}
+
+		fgbg = rle_fgbg_run(pixels, i, limit, width, fgPel);
+
+		if (bg > 0)
+		{
+			if (image >= 0)
+			{
+				rle_write_color_image(s, pixels, image, i - image, Bpp);
+				image = -1;
+			}
+
+			if (bg < 8 && fgbg >= RLE_MIN_FGBG && fgbg >= bg + 8)
+			{
+				rle_write_fgbg_image(s, pixels, i, fgbg, width, fgPel, false, Bpp);
+				insertFgPel = false;
+				i += fgbg;
+			}
+			else
+			{
+				stream_check_size(s, 4);
+				rle_write_regular_header(s, REGULAR_BG_RUN, MEGA_MEGA_BG_RUN, bg);
+				insertFgPel = true;
+				i += bg;
+			}
+
+			continue;
+		}
+
+		color = rle_color_run(pixels, i, limit);
+		fg = rle_fg_run(pixels, i, limit, width, fgPel);
+
+		newFgPel = pixels[i] ^ ABOVE(pixels, i, width);
+
+		if (newFgPel != fgPel && newFgPel != 0)
+		{
+			nfg = rle_fg_run(pixels, i, limit, width, newFgPel);
+			nfgbg = rle_fgbg_run(pixels, i, limit, width, newFgPel);
+		}
+		else
+		{
+			nfg = 0;
+			nfgbg = 0;
+		}
+
+		best = MAX(color, MAX(fg, nfg));
+
+		if (best < RLE_MIN_RUN && fgbg < RLE_MIN_FGBG && nfgbg < RLE_MIN_FGBG)
+		{
+			/* nothing worth a run here, accumulate into a color image */
+			if (image < 0)
+				image = i;
+
+			i++;
+
+			if (i - image == RLE_MAX_RUN)
+			{
+				rle_write_color_image(s, pixels, image, i - image, Bpp);
+				insertFgPel = false;
+				image = -1;
+			}
+
+			continue;
+		}
+
+		if (image >= 0)
+		{
+			rle_write_color_image(s, pixels, image, i - image, Bpp);
+			image = -1;
+		}
+
+		insertFgPel = false;
+		stream_check_size(s, 8);
+
+		if (fgbg >= RLE_MIN_FGBG && fgbg > best + 8 && fgbg >= nfgbg)
+		{
+			rle_write_fgbg_image(s, pixels, i, fgbg, width, fgPel, false, Bpp);
+			i += fgbg;
+		}
+		else if (nfgbg >= RLE_MIN_FGBG && nfgbg > best + 8)
+		{
+			fgPel = newFgPel;
+			rle_write_fgbg_image(s, pixels, i, nfgbg, width, fgPel, true, Bpp);
+			i += nfgbg;
+		}
+		else if (fg >= RLE_MIN_RUN && fg >= color && fg >= nfg)
+		{
+			rle_write_regular_header(s, REGULAR_FG_RUN, MEGA_MEGA_FG_RUN, fg);
+			i += fg;
+		}
+		else if (color >= RLE_MIN_RUN && color >= nfg)
+		{
+			rle_write_regular_header(s, REGULAR_COLOR_RUN, MEGA_MEGA_COLOR_RUN, color);
+			rle_write_pixel(s, pixels[i], Bpp);
+			i += color;
+		}
+		else
+		{
+			fgPel = newFgPel;
+			rle_write_lite_header(s, LITE_SET_FG_FG_RUN, MEGA_MEGA_SET_FG_RUN, nfg);
+			rle_write_pixel(s, fgPel, Bpp);
+			i += nfg;
+		}
+	}
+
+	if (image >= 0)
+		rle_write_color_image(s, pixels, image, i - image, Bpp);
+}
+
+/*
+   Planar Bitmap Encoder (RDP6_BITMAP_STREAM)
+   http://msdn.microsoft.com/en-us/library/ee688913%28v=prot.10%29.aspx
+*/
+
+/**
+ * RLE encode one scanline of a color plane.
+ * A run repeats the last raw byte of the scanline (or zero at its start),
+ * runs of 16 to 47 bytes are only expressible without preceding raw bytes.
+ */
+static void planar_encode_rle_scanline(STREAM* s, uint8* bytes, int width)
+{
+	int p, start;
+	int raw, run;
+	uint8 value;
+	uint8 color;
+
+	color = 0;
+	p = start = 0;
+
+	while (p < width)
+	{
+		value = (p > start) ? bytes[p - 1] : color;
+
+		run = 0;
+		while (p + run < width && bytes[p + run] == value)
+			run++;
+
+		raw = p - start;
+
+		if (run >= 3)
+		{
+			if (raw > 0)
+			{
+				if (run > 15)
+					run = 15;
+
+				stream_write_uint8(s, (raw << 4) | run);
+				stream_write(s, &bytes[start], raw);
+			}
+			else
+			{
+				if (run > 47)
+					run = 47;
+
+				if (run > 15)
+					stream_write_uint8(s, ((run & 0x0F) << 4) | (run >> 4));
+				else
+					stream_write_uint8(s, run);
+			}
+
+			p += run;
+			start = p;
+			color = value;
+		}
+		else
+		{
+			p++;
+
+			if (p - start == 15)
+			{
+				stream_write_uint8(s, 15 << 4);
+				stream_write(s, &bytes[start], 15);
+				color = bytes[p - 1];
+				start = p;
+			}
+		}
+	}
+
+	if (p > start)
+	{
+		stream_write_uint8(s, (p - start) << 4);
+		stream_write(s, &bytes[start], p - start);
+	}
+}
+
+/**
+ * RLE encode a color plane given in scanline order (bottom-up).
+ * The first scanline is stored as is, every following one as the
+ * sign-magnitude encoded delta to the scanline before it.
+ */
+static void planar_encode_rle_plane(STREAM* s, uint8* plane, int width, int height, uint8* delta)
+{
+	int x, y;
+	sint8 d;
+	uint8* line;
+	uint8* prev;
+
+	for (y = 0; y < height; y++)
+	{
+		stream_check_size(s, width + (width / 15) + 2);
+		line = &plane[y * width];
+
+		if (y == 0)
+		{
+			planar_encode_rle_scanline(s, line, width);
+			continue;
+		}
+
+		prev = &plane[(y - 1) * width];
+
+		for (x = 0; x < width; x++)
+		{
+			d = (sint8) (line[x] - prev[x]);
+			delta[x] = (d >= 0) ? (d << 1) : (((-(d + 1)) << 1) | 1);
+		}
+
+		planar_encode_rle_scanline(s, delta, width);
+	}
+}
+
+/**
+ * Planar bitmap compression (32bpp, BGRA pixel layout).
+ * @param srcData top-down source pixels
+ * @param s output stream
+ * @param width bitmap width
+ * @param height bitmap height
+ * @param rowstride source scanline length in bytes
+ * @param flags PLANAR_FORMAT_HEADER_NA and color loss level, RLE is chosen automatically
+ */
+boolean bitmap_planar_compress(uint8* srcData, STREAM* s, int width, int height, int rowstride, uint8 flags)
+{
+	int x, y;
+	int cll;
+	int start;
+	int nplanes;
+	int planeSize;
+	uint8* src;
+	uint8* planes[4];
+	uint8* buffer;
+	uint8* delta;
+	boolean alpha;
+	sint16 r, g, b;
+	sint16 co, cg, t;
+
+	if (width < 1 || height < 1)
+		return false;
+
+	cll = flags & PLANAR_FORMAT_HEADER_CLL_MASK;
+	alpha = (flags & PLANAR_FORMAT_HEADER_NA) ? false : true;
+	flags &= (PLANAR_FORMAT_HEADER_CLL_MASK | PLANAR_FORMAT_HEADER_NA);
+
+	planeSize = width * height;
+	buffer = (uint8*) xmalloc(planeSize * 4 + width);
+	delta = &buffer[planeSize * 4];
+
+	/* alpha, red or luma, green or orange chroma, blue or green chroma */
+	for (x = 0; x < 4; x++)
+		planes[x] = &buffer[planeSize * x];
+
+	for (y = 0; y < height; y++)
+	{
+		src = &srcData[(height - y - 1) * rowstride];
+
+		for (x = 0; x < width; x++)
+		{
+			b = src[0];
+			g = src[1];
+			r = src[2];
+			planes[0][y * width + x] = src[3];
+
+			if (cll)
+			{
+				/* YCoCg-R, with chroma scaled down by the color loss level */
+				co = r - b;
+				t = b + (co >> 1);
+				cg = g - t;
+				planes[1][y * width + x] = (uint8) (t + (cg >> 1));
+				planes[2][y * width + x] = (uint8) (co >> cll);
+				planes[3][y * width + x] = (uint8) (cg >> cll);
+			}
+			else
+			{
+				planes[1][y * width + x] = (uint8) r;
+				planes[2][y * width + x] = (uint8) g;
+				planes[3][y * width + x] = (uint8) b;
+			}
+
+			src += 4;
+		}
+	}
+
+	nplanes = alpha ? 4 : 3;
+	start = stream_get_pos(s);
+
+	stream_check_size(s, 1);
+	stream_write_uint8(s, flags | PLANAR_FORMAT_HEADER_RLE);
+
+	for (x = 4 - nplanes; x < 4; x++)
+		planar_encode_rle_plane(s, planes[x], width, height, delta);
+
+	if (stream_get_pos(s) - start > 1 + nplanes * planeSize + 1)
+	{
+		/* RLE did not pay off, fall back to raw planes followed by a pad byte */
+		stream_set_pos(s, start);
+		stream_check_size(s, 2 + nplanes * planeSize);
+		stream_write_uint8(s, flags);
+
+		for (x = 4 - nplanes; x < 4; x++)
+			stream_write(s, planes[x], planeSize);
+
+		stream_write_uint8(s, 0);
+	}
+
+	xfree(buffer);
+
+	return true;
+}
+
+/**
+ * Bitmap compression routine, the counterpart of bitmap_decompress().
+ * 8, 15, 16 and 24 bpp bitmaps use interleaved RLE, 32 bpp bitmaps the planar codec.
+ * @param srcData top-down source pixels
+ * @param s output stream
+ * @param width bitmap width
+ * @param height bitmap height
+ * @param rowstride source scanline length in bytes
+ * @param bpp bits per pixel
+ */
+boolean bitmap_compress(uint8* srcData, STREAM* s, int width, int height, int rowstride, int bpp)
+{
+	int x, y;
+	int Bpp;
+	uint8* src;
+	uint32* pixels;
+
+	if (bpp == 32)
+		return bitmap_planar_compress(srcData, s, width, height, rowstride, 0);
+
+	if (bpp != 8 && bpp != 15 && bpp != 16 && bpp != 24)
+		return false;
+
+	if (width < 1 || height < 1)
+		return false;
+
+	Bpp = (bpp + 7) / 8;
+	pixels = (uint32*) xmalloc(width * height * sizeof(uint32));
+
+	for (y = 0; y < height; y++)
+	{
+		src = &srcData[(height - y - 1) * rowstride];
+
+		for (x = 0; x < width; x++)
+		{
+			pixels[y * width + x] = rle_read_pixel(src, Bpp);
+			src += Bpp;
+		}
+	}
+
+	rle_compress(pixels, width, height, Bpp, s);
+
+	xfree(pixels);
+
+	return true;
+}
@@ -22,9 +22,20 @@
 #include <stdlib.h>
 #include <freerdp/api.h>
 #include <freerdp/freerdp.h>
+#include <freerdp/constants.h>
 #include <freerdp/codec/color.h>
 #include <freerdp/utils/memory.h>
 
+#include "config.h"
+
+#ifdef WITH_SSE2
+#include "color_sse2.h"
+#endif
+
+#ifdef WITH_AVX2
+#include "color_avx2.h"
+#endif
+
 int freerdp_get_pixel(uint8 * data, int x, int y, int width, int height, int bpp)
 {
 	int start;
@@ -714,14 +725,432 @@ p_freerdp_image_convert freerdp_image_convert_[5] =
 	freerdp_image_convert_32bpp
 };
 
-uint8* freerdp_image_convert(uint8* srcData, uint8* dstData, int width, int height, int srcBpp, int dstBpp, HCLRCONV clrconv)
+/**
+ * Scanline conversion routines, one per (srcBpp, dstBpp, invert, alpha) combination.
+ * The invert flag is passed as a constant to an inline body so that each variant
+ * is compiled without any per-pixel branching.
+ */
+
+typedef void (*p_freerdp_image_convert_line)(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv);
+
+#define IMAGE_CONVERT_LINE_VARIANTS(_name) \
+static void image_convert_##_name(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv) \
+{ \
+	image_convert_##_name##_line(srcData, dstData, width, clrconv, false); \
+} \
+static void image_convert_##_name##_invert(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv) \
+{ \
+	image_convert_##_name##_line(srcData, dstData, width, clrconv, true); \
+}
+
+static void image_convert_copy_8(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv)
 {
-	p_freerdp_image_convert _p_freerdp_image_convert = freerdp_image_convert_[IBPP(srcBpp)];
+	if (srcData != dstData)
+		memcpy(dstData, srcData, width);
+}
 
-	if (_p_freerdp_image_convert != NULL)
-		return _p_freerdp_image_convert(srcData, dstData, width, height, srcBpp, dstBpp, clrconv);
-	else
-		return 0;
+static void image_convert_copy_16(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv)
+{
+	if (srcData != dstData)
+		memcpy(dstData, srcData, width * 2);
+}
+
+static void image_convert_copy_32(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv)
+{
+	if (srcData != dstData)
+		memcpy(dstData, srcData, width * 4);
+}
+
+static INLINE void image_convert_8_15_line(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv, boolean invert)
+{
+	int x;
+	PALETTE_ENTRY* entry;
+	uint16* dst16 = (uint16*) dstData;
+
+	for (x = 0; x < width; x++)
+	{
+		entry = &clrconv->palette->entries[srcData[x]];
+		dst16[x] = (invert) ? BGR15(entry->red, entry->green, entry->blue) :
+			RGB15(entry->red, entry->green, entry->blue);
+	}
+}
+IMAGE_CONVERT_LINE_VARIANTS(8_15)
+
+static INLINE void image_convert_8_16_line(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv, boolean invert)
+{
+	int x;
+	PALETTE_ENTRY* entry;
+	uint16* dst16 = (uint16*) dstData;
+
+	for (x = 0; x < width; x++)
+	{
+		entry = &clrconv->palette->entries[srcData[x]];
+		dst16[x] = (invert) ? BGR16(entry->red, entry->green, entry->blue) :
+			RGB16(entry->red, entry->green, entry->blue);
+	}
+}
+IMAGE_CONVERT_LINE_VARIANTS(8_16)
+
+static INLINE void image_convert_8_32_line(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv, boolean invert)
+{
+	int x;
+	PALETTE_ENTRY* entry;
+	uint32* dst32 = (uint32*) dstData;
+
+	for (x = 0; x < width; x++)
+	{
+		entry = &clrconv->palette->entries[srcData[x]];
+		dst32[x] = (invert) ? RGB32(entry->red, entry->green, entry->blue) :
+			BGR32(entry->red, entry->green, entry->blue);
+	}
+}
+IMAGE_CONVERT_LINE_VARIANTS(8_32)
+
+static INLINE void image_convert_15_16_line(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv, boolean invert)
+{
+	int x;
+	uint8 red, green, blue;
+	uint16* src16 = (uint16*) srcData;
+	uint16* dst16 = (uint16*) dstData;
+
+	for (x = 0; x < width; x++)
+	{
+		GetRGB_555(red, green, blue, src16[x]);
+		RGB_555_565(red, green, blue);
+		dst16[x] = (invert) ? BGR565(red, green, blue) : RGB565(red, green, blue);
+	}
+}
+IMAGE_CONVERT_LINE_VARIANTS(15_16)
+
+static INLINE void image_convert_15_32_line(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv, boolean invert)
+{
+	int x;
+	uint8 red, green, blue;
+	uint16* src16 = (uint16*) srcData;
+	uint32* dst32 = (uint32*) dstData;
+
+	for (x = 0; x < width; x++)
+	{
+		GetBGR15(red, green, blue, src16[x]);
+		dst32[x] = (invert) ? RGB32(red, green, blue) : BGR32(red, green, blue);
+	}
+}
+IMAGE_CONVERT_LINE_VARIANTS(15_32)
+
+static INLINE void image_convert_16_15_line(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv, boolean invert)
+{
+	int x;
+	uint8 red, green, blue;
+	uint16* src16 = (uint16*) srcData;
+	uint16* dst16 = (uint16*) dstData;
+
+	for (x = 0; x < width; x++)
+	{
+		GetRGB_565(red, green, blue, src16[x]);
+		RGB_565_555(red, green, blue);
+		dst16[x] = (invert) ? BGR555(red, green, blue) : RGB555(red, green, blue);
+	}
+}
+IMAGE_CONVERT_LINE_VARIANTS(16_15)
+
+static INLINE void image_convert_16_24_line(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv, boolean invert)
+{
+	int x;
+	uint8 red, green, blue;
+	uint16* src16 = (uint16*) srcData;
+
+	for (x = 0; x < width; x++)
+	{
+		GetBGR16(red, green, blue, src16[x]);
+
+		if (invert)
+		{
+			*dstData++ = blue;
+			*dstData++ = green;
+			*dstData++ = red;
+		}
+		else
+		{
+			*dstData++ = red;
+			*dstData++ = green;
+			*dstData++ = blue;
+		}
+	}
+}
+IMAGE_CONVERT_LINE_VARIANTS(16_24)
+
+static INLINE void image_convert_16_32_line(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv, boolean invert)
+{
+	int x;
+	uint8 red, green, blue;
+	uint16* src16 = (uint16*) srcData;
+	uint32* dst32 = (uint32*) dstData;
+
+	for (x = 0; x < width; x++)
+	{
+		GetBGR16(red, green, blue, src16[x]);
+		dst32[x] = (invert) ? RGB32(red, green, blue) : BGR32(red, green, blue);
+	}
+}
+IMAGE_CONVERT_LINE_VARIANTS(16_32)
+
+static void image_convert_24_32(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv)
+{
+	int x;
+
+	for (x = 0; x < width; x++)
+	{
+		*dstData++ = *srcData++;
+		*dstData++ = *srcData++;
+		*dstData++ = *srcData++;
+		*dstData++ = 0xFF;
+	}
+}
+
+static INLINE void image_convert_32_16_line(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv, boolean invert)
+{
+	int x;
+	uint8 red, green, blue;
+	uint32* src32 = (uint32*) srcData;
+	uint16* dst16 = (uint16*) dstData;
+
+	for (x = 0; x < width; x++)
+	{
+		GetBGR32(blue, green, red, src32[x]);
+		dst16[x] = (invert) ? BGR16(red, green, blue) : RGB16(red, green, blue);
+	}
+}
+IMAGE_CONVERT_LINE_VARIANTS(32_16)
+
+static INLINE void image_convert_32_24_line(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv, boolean invert)
+{
+	int x;
+
+	for (x = 0; x < width; x++)
+	{
+		if (invert)
+		{
+			*dstData++ = srcData[2];
+			*dstData++ = srcData[1];
+			*dstData++ = srcData[0];
+		}
+		else
+		{
+			*dstData++ = srcData[0];
+			*dstData++ = srcData[1];
+			*dstData++ = srcData[2];
+		}
+
+		srcData += 4;
+	}
+}
+IMAGE_CONVERT_LINE_VARIANTS(32_24)
+
+static void image_convert_32_32_alpha(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv)
+{
+	int x;
+	uint32* src32 = (uint32*) srcData;
+	uint32* dst32 = (uint32*) dstData;
+
+	for (x = 0; x < width; x++)
+		dst32[x] = src32[x] | 0xFF000000;
+}
+
+/* routines with SIMD implementations, replaced by freerdp_image_convert_set_cpu_opt() */
+
+static p_freerdp_image_convert_line image_convert_16_32_kernel = image_convert_16_32;
+static p_freerdp_image_convert_line image_convert_16_32_invert_kernel = image_convert_16_32_invert;
+static p_freerdp_image_convert_line image_convert_24_32_kernel = image_convert_24_32;
+static p_freerdp_image_convert_line image_convert_32_32_alpha_kernel = image_convert_32_32_alpha;
+
+void freerdp_image_convert_set_cpu_opt(uint32 cpu_opt)
+{
+	image_convert_16_32_kernel = image_convert_16_32;
+	image_convert_16_32_invert_kernel = image_convert_16_32_invert;
+	image_convert_24_32_kernel = image_convert_24_32;
+	image_convert_32_32_alpha_kernel = image_convert_32_32_alpha;
+
+#ifdef WITH_SSE2
+	if (cpu_opt & CPU_SSE2)
+	{
+		image_convert_16_32_kernel = image_convert_16_32_sse2;
+		image_convert_16_32_invert_kernel = image_convert_16_32_invert_sse2;
+		image_convert_24_32_kernel = image_convert_24_32_sse2;
+		image_convert_32_32_alpha_kernel = image_convert_32_32_alpha_sse2;
+	}
+#endif
+
+#ifdef WITH_AVX2
+	if (cpu_opt & CPU_AVX2)
+	{
+		image_convert_16_32_kernel = image_convert_16_32_avx2;
+		image_convert_16_32_invert_kernel = image_convert_16_32_invert_avx2;
+		image_convert_24_32_kernel = image_convert_24_32_avx2;
+		image_convert_32_32_alpha_kernel = image_convert_32_32_alpha_avx2;
+	}
+#endif
+}
+
+/**
+ * Select the scanline routine for a conversion.
+ * Returns NULL for combinations only the generic converters know about.
+ */
+
+static p_freerdp_image_convert_line image_convert_select(int srcBpp, int dstBpp, HCLRCONV clrconv)
+{
+	boolean invert = clrconv->invert;
+	boolean dst555 = (dstBpp == 15) || (dstBpp == 16 && clrconv->rgb555);
+
+	switch (srcBpp)
+	{
+		case 8:
+			if (dstBpp == 8)
+				return image_convert_copy_8;
+			else if (dst555)
+				return (invert) ? image_convert_8_15_invert : image_convert_8_15;
+			else if (dstBpp == 16)
+				return (invert) ? image_convert_8_16_invert : image_convert_8_16;
+			else if (dstBpp == 32)
+				return (invert) ? image_convert_8_32_invert : image_convert_8_32;
+			break;
+
+		case 15:
+			if (dst555)
+				return image_convert_copy_16;
+			else if (dstBpp == 16)
+				return (invert) ? image_convert_15_16_invert : image_convert_15_16;
+			else if (dstBpp == 32)
+				return (invert) ? image_convert_15_32_invert : image_convert_15_32;
+			break;
+
+		case 16:
+			if (dstBpp == 16 && clrconv->rgb555)
+				return (invert) ? image_convert_16_15_invert : image_convert_16_15;
+			else if (dstBpp == 16)
+				return image_convert_copy_16;
+			else if (dstBpp == 24)
+				return (invert) ? image_convert_16_24_invert : image_convert_16_24;
+			else if (dstBpp == 32)
+				return (invert) ? image_convert_16_32_invert_kernel : image_convert_16_32_kernel;
+			break;
+
+		case 24:
+			if (dstBpp == 32)
+				return image_convert_24_32_kernel;
+			break;
+
+		case 32:
+			if (dstBpp == 16)
+				return (invert) ? image_convert_32_16_invert : image_convert_32_16;
+			else if (dstBpp == 24)
+				return (invert) ? image_convert_32_24_invert : image_convert_32_24;
+			else if (dstBpp == 32)
+				return (clrconv->alpha) ? image_convert_32_32_alpha_kernel : image_convert_copy_32;
+			break;
+
+		default:
+			break;
+	}
+
+	return NULL;
+}
+
+/**
+ * Convert an image, writing scanlines dstStride bytes apart.
+ * @param dstStride destination scanline length, 0 for tightly packed rows
+ * @param flip write the scanlines bottom-up
+ * When srcData and dstData are the same buffer, both formats must have the same
+ * pixel size and dstStride must be 0; the flip is then done in place.
+ */
+
+uint8* freerdp_image_convert_ex(uint8* srcData, uint8* dstData, int width, int height,
+		int srcBpp, int dstBpp, int dstStride, boolean flip, HCLRCONV clrconv)
+{
+	int y;
+	int srcStride;
+	uint8* srcLine;
+	uint8* dstLine;
+	uint8* tmpLine;
+	p_freerdp_image_convert_line convert_line;
+
+	convert_line = image_convert_select(srcBpp, dstBpp, clrconv);
+
+	if (dstStride == 0)
+		dstStride = width * ((dstBpp + 7) / 8);
+
+	if (convert_line == NULL)
+	{
+		uint8* tmpData;
+		int scanline = width * ((dstBpp + 7) / 8);
+		p_freerdp_image_convert _p_freerdp_image_convert = freerdp_image_convert_[IBPP(srcBpp)];
+
+		if (_p_freerdp_image_convert == NULL)
+			return 0;
+
+		if (dstStride == scanline && !flip)
+			return _p_freerdp_image_convert(srcData, dstData, width, height, srcBpp, dstBpp, clrconv);
+
+		tmpData = _p_freerdp_image_convert(srcData, NULL, width, height, srcBpp, dstBpp, clrconv);
+
+		if (tmpData == srcData)
+			return srcData;
+
+		if (dstData == NULL)
+			dstData = (uint8*) malloc(dstStride * height);
+
+		for (y = 0; y < height; y++)
+		{
+			dstLine = &dstData[(flip ? (height - y - 1) : y) * dstStride];
+			memcpy(dstLine, &tmpData[y * scanline], scanline);
+		}
+
+		free(tmpData);
+		return dstData;
+	}
+
+	srcStride = width * ((srcBpp + 7) / 8);
+
+	if (dstData == NULL)
+		dstData = (uint8*) malloc(dstStride * height);
+
+	if (srcData == dstData && flip)
+	{
+		/* swap scanline pairs through a temporary line, converting on the way */
+		tmpLine = (uint8*) xmalloc(srcStride);
+
+		for (y = 0; y < height / 2; y++)
+		{
+			srcLine = &srcData[y * srcStride];
+			dstLine = &dstData[(height - y - 1) * dstStride];
+
+			memcpy(tmpLine, srcLine, srcStride);
+			convert_line(dstLine, srcLine, width, clrconv);
+			convert_line(tmpLine, dstLine, width, clrconv);
+		}
+
+		if (height % 2)
+		{
+			srcLine = &srcData[y * srcStride];
+			convert_line(srcLine, srcLine, width, clrconv);
+		}
+
+		xfree(tmpLine);
+		return dstData;
+	}
+
+	for (y = 0; y < height; y++)
+	{
+		srcLine = &srcData[y * srcStride];
+		dstLine = &dstData[(flip ? (height - y - 1) : y) * dstStride];
+		convert_line(srcLine, dstLine, width, clrconv);
+	}
+
+	return dstData;
+}
+
+uint8* freerdp_image_convert(uint8* srcData, uint8* dstData, int width, int height, int srcBpp, int dstBpp, HCLRCONV clrconv)
+{
+	return freerdp_image_convert_ex(srcData, dstData, width, height, srcBpp, dstBpp, 0, false, clrconv);
 }
 
 void   freerdp_bitmap_flip(uint8 * src, uint8 * dst, int scanLineSz, int height)
@@ -0,0 +1,138 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * Color Conversion Routines - AVX2 Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+
+#include "color_avx2.h"
+
+/**
+ * Same as the SSE2 variant, sixteen pixels at a time. The 16-bit unpacks
+ * work within each 128-bit lane, so the two halves are put back in order
+ * with a cross-lane permute before storing.
+ */
+
+static INLINE void image_convert_16_32_avx2_line(uint8* srcData, uint8* dstData, int width, boolean invert)
+{
+	int x;
+	uint32 pixel;
+	uint8 red, green, blue;
+	__m256i p, r, g, b, lo, hi, t0, t1;
+	uint16* src16 = (uint16*) srcData;
+	uint32* dst32 = (uint32*) dstData;
+	const __m256i mask5 = _mm256_set1_epi16(0x1F);
+	const __m256i mask6 = _mm256_set1_epi16(0x3F);
+
+	for (x = 0; x + 16 <= width; x += 16)
+	{
+		p = _mm256_loadu_si256((__m256i*) &src16[x]);
+
+		r = _mm256_srli_epi16(p, 11);
+		g = _mm256_and_si256(_mm256_srli_epi16(p, 5), mask6);
+		b = _mm256_and_si256(p, mask5);
+
+		r = _mm256_or_si256(_mm256_slli_epi16(r, 3), _mm256_srli_epi16(r, 2));
+		g = _mm256_or_si256(_mm256_slli_epi16(g, 2), _mm256_srli_epi16(g, 4));
+		b = _mm256_or_si256(_mm256_slli_epi16(b, 3), _mm256_srli_epi16(b, 2));
+
+		if (invert)
+		{
+			lo = _mm256_or_si256(r, _mm256_slli_epi16(g, 8));
+			hi = b;
+		}
+		else
+		{
+			lo = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+			hi = r;
+		}
+
+		t0 = _mm256_unpacklo_epi16(lo, hi);
+		t1 = _mm256_unpackhi_epi16(lo, hi);
+
+		_mm256_storeu_si256((__m256i*) &dst32[x], _mm256_permute2x128_si256(t0, t1, 0x20));
+		_mm256_storeu_si256((__m256i*) &dst32[x + 8], _mm256_permute2x128_si256(t0, t1, 0x31));
+	}
+
+	for (; x < width; x++)
+	{
+		pixel = src16[x];
+		GetBGR16(red, green, blue, pixel);
+		dst32[x] = (invert) ? RGB32(red, green, blue) : BGR32(red, green, blue);
+	}
+}
+
+void image_convert_16_32_avx2(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv)
+{
+	image_convert_16_32_avx2_line(srcData, dstData, width, false);
+}
+
+void image_convert_16_32_invert_avx2(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv)
+{
+	image_convert_16_32_avx2_line(srcData, dstData, width, true);
+}
+
+void image_convert_24_32_avx2(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv)
+{
+	int x;
+	__m256i v;
+	uint8* src8 = srcData;
+	uint8* dst8 = dstData;
+	const __m256i alpha = _mm256_set1_epi32(0xFF000000);
+	const __m256i shuffle = _mm256_setr_epi8(
+		0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+		0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+
+	/* each lane takes 12 bytes but loads 16, the upper lane starting at byte 12 */
+	for (x = 0; x + 10 <= width; x += 8)
+	{
+		v = _mm256_castsi128_si256(_mm_loadu_si128((__m128i*) src8));
+		v = _mm256_inserti128_si256(v, _mm_loadu_si128((__m128i*) &src8[12]), 1);
+		v = _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle), alpha);
+
+		_mm256_storeu_si256((__m256i*) dst8, v);
+
+		src8 += 24;
+		dst8 += 32;
+	}
+
+	for (; x < width; x++)
+	{
+		*dst8++ = *src8++;
+		*dst8++ = *src8++;
+		*dst8++ = *src8++;
+		*dst8++ = 0xFF;
+	}
+}
+
+void image_convert_32_32_alpha_avx2(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv)
+{
+	int x;
+	uint32* src32 = (uint32*) srcData;
+	uint32* dst32 = (uint32*) dstData;
+	const __m256i alpha = _mm256_set1_epi32(0xFF000000);
+
+	for (x = 0; x + 8 <= width; x += 8)
+	{
+		_mm256_storeu_si256((__m256i*) &dst32[x],
+			_mm256_or_si256(_mm256_loadu_si256((__m256i*) &src32[x]), alpha));
+	}
+
+	for (; x < width; x++)
+		dst32[x] = src32[x] | 0xFF000000;
+}
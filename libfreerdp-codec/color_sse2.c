@@ -0,0 +1,134 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * Color Conversion Routines - SSE2 Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <emmintrin.h>
+
+#include "color_sse2.h"
+
+/**
+ * Expand eight RGB565 pixels into eight 32bpp pixels.
+ * The field stored in the high bits of the 16bpp pixel ends up in bits 16-23
+ * unless invert is set, in which case the outer fields are swapped.
+ */
+
+static INLINE void image_convert_16_32_sse2_line(uint8* srcData, uint8* dstData, int width, boolean invert)
+{
+	int x;
+	uint32 pixel;
+	uint8 red, green, blue;
+	__m128i p, r, g, b, lo, hi;
+	uint16* src16 = (uint16*) srcData;
+	uint32* dst32 = (uint32*) dstData;
+	const __m128i mask5 = _mm_set1_epi16(0x1F);
+	const __m128i mask6 = _mm_set1_epi16(0x3F);
+
+	for (x = 0; x + 8 <= width; x += 8)
+	{
+		p = _mm_loadu_si128((__m128i*) &src16[x]);
+
+		r = _mm_srli_epi16(p, 11);
+		g = _mm_and_si128(_mm_srli_epi16(p, 5), mask6);
+		b = _mm_and_si128(p, mask5);
+
+		r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+		g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+		b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+		if (invert)
+		{
+			lo = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+			hi = b;
+		}
+		else
+		{
+			lo = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+			hi = r;
+		}
+
+		_mm_storeu_si128((__m128i*) &dst32[x], _mm_unpacklo_epi16(lo, hi));
+		_mm_storeu_si128((__m128i*) &dst32[x + 4], _mm_unpackhi_epi16(lo, hi));
+	}
+
+	for (; x < width; x++)
+	{
+		pixel = src16[x];
+		GetBGR16(red, green, blue, pixel);
+		dst32[x] = (invert) ? RGB32(red, green, blue) : BGR32(red, green, blue);
+	}
+}
+
+void image_convert_16_32_sse2(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv)
+{
+	image_convert_16_32_sse2_line(srcData, dstData, width, false);
+}
+
+void image_convert_16_32_invert_sse2(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv)
+{
+	image_convert_16_32_sse2_line(srcData, dstData, width, true);
+}
+
+void image_convert_24_32_sse2(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv)
+{
+	int x;
+	__m128i v, t0, t1;
+	uint8* src8 = srcData;
+	uint8* dst8 = dstData;
+	const __m128i alpha = _mm_set1_epi32(0xFF000000);
+
+	/* each iteration consumes 12 bytes but loads 16 */
+	for (x = 0; x + 6 <= width; x += 4)
+	{
+		v = _mm_loadu_si128((__m128i*) src8);
+
+		t0 = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+		t1 = _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9));
+		v = _mm_or_si128(_mm_unpacklo_epi64(t0, t1), alpha);
+
+		_mm_storeu_si128((__m128i*) dst8, v);
+
+		src8 += 12;
+		dst8 += 16;
+	}
+
+	for (; x < width; x++)
+	{
+		*dst8++ = *src8++;
+		*dst8++ = *src8++;
+		*dst8++ = *src8++;
+		*dst8++ = 0xFF;
+	}
+}
+
+void image_convert_32_32_alpha_sse2(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv)
+{
+	int x;
+	uint32* src32 = (uint32*) srcData;
+	uint32* dst32 = (uint32*) dstData;
+	const __m128i alpha = _mm_set1_epi32(0xFF000000);
+
+	for (x = 0; x + 4 <= width; x += 4)
+	{
+		_mm_storeu_si128((__m128i*) &dst32[x],
+			_mm_or_si128(_mm_loadu_si128((__m128i*) &src32[x]), alpha));
+	}
+
+	for (; x < width; x++)
+		dst32[x] = src32[x] | 0xFF000000;
+}
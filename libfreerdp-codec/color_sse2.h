@@ -0,0 +1,28 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * Color Conversion Routines - SSE2 Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __COLOR_SSE2_H
+#define __COLOR_SSE2_H
+
+#include <freerdp/codec/color.h>
+
+void image_convert_16_32_sse2(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv);
+void image_convert_16_32_invert_sse2(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv);
+void image_convert_24_32_sse2(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv);
+void image_convert_32_32_alpha_sse2(uint8* srcData, uint8* dstData, int width, HCLRCONV clrconv);
+
+#endif /* __COLOR_SSE2_H */
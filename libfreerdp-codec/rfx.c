@@ -52,7 +52,9 @@
  *
  * This is the default values being use by the MS RDP server, and we will also
  * use it as our default values for the encoder. It can be overrided by setting
- * the context->num_quants and context->quants member.
+ * the context->num_quants and context->quants member, or with
+ * rfx_context_set_quantization(). Under rate control, the encoder picks the
+ * values of each tile from rfx_rate_quantization_values instead.
  *
  * The order of the values are:
  * LL3, LH3, HL3, HH3, LH2, HL2, HH2, LH1, HL1, HH1
@@ -136,6 +138,7 @@ RFX_CONTEXT* rfx_context_new(void)
 	context = xnew(RFX_CONTEXT);
 	context->priv = xnew(RFX_CONTEXT_PRIV);
 	context->priv->pool = rfx_pool_new();
+	context->priv->rate = rfx_rate_new();
 
 	/* initialize the default pixel format */
 	rfx_context_set_pixel_format(context, RFX_PIXEL_FORMAT_BGRA);
@@ -173,6 +176,7 @@ void rfx_context_free(RFX_CONTEXT* context)
 	xfree(context->quants);
 
 	rfx_pool_free(context->priv->pool);
+	rfx_rate_free(context->priv->rate);
 
 	rfx_profiler_print(context);
 	rfx_profiler_free(context);
@@ -216,6 +220,48 @@ void rfx_context_reset(RFX_CONTEXT* context)
 	context->frame_idx = 0;
 }
 
+/**
+ * Encode every tile with the given quantization sets, y, cb and cr being
+ * indices into them.
+ */
+
+void rfx_context_set_quantization(RFX_CONTEXT* context, const uint32* quants, int num_quants,
+	int quant_idx_y, int quant_idx_cb, int quant_idx_cr)
+{
+	context->num_quants = num_quants;
+
+	if (context->quants != NULL)
+		context->quants = (uint32*) xrealloc((void*) context->quants, num_quants * 10 * sizeof(uint32));
+	else
+		context->quants = (uint32*) xmalloc(num_quants * 10 * sizeof(uint32));
+
+	memcpy(context->quants, quants, num_quants * 10 * sizeof(uint32));
+
+	context->quant_idx_y = quant_idx_y;
+	context->quant_idx_cb = quant_idx_cb;
+	context->quant_idx_cr = quant_idx_cr;
+}
+
+/**
+ * Keep encoded frames within frame_budget bytes, on average. Zero turns
+ * rate control off, the quantization of the context is then used again.
+ */
+
+void rfx_context_set_rate_control(RFX_CONTEXT* context, uint32 frame_budget)
+{
+	rfx_rate_set_budget(context->priv->rate, frame_budget);
+}
+
+/**
+ * Quality level of the last frame encoded under rate control, 0 being the
+ * finest.
+ */
+
+int rfx_context_get_quality(RFX_CONTEXT* context)
+{
+	return context->priv->rate->quality;
+}
+
 static void rfx_process_message_sync(RFX_CONTEXT* context, STREAM* s)
 {
 	uint32 magic;
@@ -792,8 +838,21 @@ static void rfx_compose_message_tileset(RFX_CONTEXT* context, STREAM* s,
 	int xIdx;
 	int yIdx;
 	int tilesDataSize;
+	int tile_pos;
+	int level;
+	RFX_RATE* rate = context->priv->rate;
 
-	if (context->num_quants == 0)
+	if (rate->frame_budget > 0)
+	{
+		numQuants = RFX_QUANT_LEVELS;
+		quantVals = rfx_rate_quantization_values;
+		quantIdxY = 0;
+		quantIdxCb = 0;
+		quantIdxCr = 0;
+
+		rfx_rate_begin_frame(rate, image_data, width, height, rowstride, context->bits_per_pixel / 8);
+	}
+	else if (context->num_quants == 0)
 	{
 		numQuants = 1;
 		quantVals = rfx_default_quantization_values;
@@ -844,13 +903,30 @@ static void rfx_compose_message_tileset(RFX_CONTEXT* context, STREAM* s,
 	{
 		for (xIdx = 0; xIdx < numTilesX; xIdx++)
 		{
+			if (rate->frame_budget > 0)
+			{
+				level = rfx_rate_tile_level(rate, yIdx * numTilesX + xIdx);
+				quantIdxY = level;
+				quantIdxCb = MIN(level + 1, RFX_QUANT_LEVELS - 1);
+				quantIdxCr = quantIdxCb;
+			}
+
+			tile_pos = stream_get_pos(s);
+
 			rfx_compose_message_tile(context, s,
 				image_data + yIdx * 64 * rowstride + xIdx * 8 * context->bits_per_pixel,
 				(xIdx < numTilesX - 1) ? 64 : width - xIdx * 64,
 				(yIdx < numTilesY - 1) ? 64 : height - yIdx * 64,
 				rowstride, quantVals, quantIdxY, quantIdxCb, quantIdxCr, xIdx, yIdx);
+
+			if (rate->frame_budget > 0)
+				rfx_rate_tile_done(rate, yIdx * numTilesX + xIdx, stream_get_pos(s) - tile_pos);
 		}
 	}
+
+	if (rate->frame_budget > 0)
+		rfx_rate_end_frame(rate);
+
 	tilesDataSize = stream_get_pos(s) - end_pos;
 	size += tilesDataSize;
 	end_pos = stream_get_pos(s);
@@ -0,0 +1,251 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol client.
+ * RemoteFX Codec Library - Rate Control
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <freerdp/utils/memory.h>
+
+#include "rfx_rate.h"
+
+/**
+ * The second set is the one used by the MS RDP server. Luma uses the set of
+ * the tile level, chroma the next coarser one.
+ *
+ * The order of the values are:
+ * LL3, LH3, HL3, HH3, LH2, HL2, HH2, LH1, HL1, HH1
+ */
+const uint32 rfx_rate_quantization_values[RFX_QUANT_LEVELS * 10] =
+{
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 7, 7, 8, 8, 8, 9,
+	7, 7, 7, 7, 8, 8, 9, 9, 9, 10,
+	8, 8, 8, 8, 9, 9, 10, 10, 10, 11,
+	9, 9, 9, 9, 10, 10, 11, 11, 11, 12,
+	10, 10, 10, 10, 11, 11, 12, 12, 12, 13
+};
+
+/* first guesses of the bytes per tile, until tiles of that level are encoded */
+static const uint32 rfx_rate_initial_cost[2][RFX_QUANT_LEVELS] =
+{
+	{ 6000, 3000, 2000, 1300, 900, 600 },
+	{ 1500, 1000, 800, 600, 450, 350 }
+};
+
+RFX_RATE* rfx_rate_new()
+{
+	RFX_RATE* rate;
+
+	rate = xnew(RFX_RATE);
+	memcpy(rate->cost, rfx_rate_initial_cost, sizeof(rate->cost));
+	rate->quality = RFX_QUANT_LEVEL_TEXT;
+
+	return rate;
+}
+
+void rfx_rate_free(RFX_RATE* rate)
+{
+	xfree(rate->classes);
+	xfree(rate);
+}
+
+void rfx_rate_set_budget(RFX_RATE* rate, uint32 frame_budget)
+{
+	/* turning rate control on starts over from the default quality */
+	if (rate->frame_budget == 0 && frame_budget > 0)
+	{
+		rate->credit = 0;
+		rate->quality = RFX_QUANT_LEVEL_TEXT;
+	}
+
+	rate->frame_budget = frame_budget;
+	rate->credit = MIN(rate->credit, (sint32) frame_budget);
+}
+
+/**
+ * Text, drawings and flat user interface repeat the same color along a
+ * row most of the time, photos and video hardly ever do.
+ */
+
+int rfx_rate_classify_tile(const uint8* data, int width, int height, int rowstride, int bytes_per_pixel)
+{
+	int x, y;
+	int flat;
+	int total;
+	const uint8* row;
+	const uint32* pixels;
+
+	if (bytes_per_pixel < 1)
+		return RFX_TILE_NATURAL;
+
+	flat = 0;
+	total = 0;
+
+	/* every other row is enough to tell */
+	for (y = 0; y < height; y += 2)
+	{
+		row = &data[y * rowstride];
+
+		if (bytes_per_pixel == 4)
+		{
+			pixels = (const uint32*) row;
+
+			for (x = 1; x < width; x++)
+			{
+				if (pixels[x] == pixels[x - 1])
+					flat++;
+			}
+		}
+		else
+		{
+			for (x = 1; x < width; x++)
+			{
+				if (memcmp(&row[x * bytes_per_pixel], &row[(x - 1) * bytes_per_pixel], bytes_per_pixel) == 0)
+					flat++;
+			}
+		}
+
+		total += width - 1;
+	}
+
+	return (2 * flat >= total) ? RFX_TILE_TEXT : RFX_TILE_NATURAL;
+}
+
+static int rfx_rate_class_level(int level, int class_id)
+{
+	return (class_id == RFX_TILE_TEXT) ? MIN(level, RFX_QUANT_LEVEL_TEXT) : level;
+}
+
+static int rfx_rate_choose_level(RFX_RATE* rate)
+{
+	int level;
+	sint64 size;
+	sint64 allowance;
+
+	allowance = (sint64) rate->credit + rate->frame_budget;
+
+	for (level = MAX(rate->quality - 1, 0); level < RFX_QUANT_LEVELS - 1; level++)
+	{
+		size = (sint64) rate->count[RFX_TILE_NATURAL] * rate->cost[RFX_TILE_NATURAL][level] +
+			(sint64) rate->count[RFX_TILE_TEXT] * rate->cost[RFX_TILE_TEXT][rfx_rate_class_level(level, RFX_TILE_TEXT)];
+
+		if (size <= allowance)
+			break;
+	}
+
+	return level;
+}
+
+void rfx_rate_begin_frame(RFX_RATE* rate, const uint8* image_data, int width, int height,
+	int rowstride, int bytes_per_pixel)
+{
+	int xIdx, yIdx;
+	int numTilesX;
+	int numTilesY;
+	int index;
+
+	numTilesX = (width + 63) / 64;
+	numTilesY = (height + 63) / 64;
+
+	if (numTilesX * numTilesY > rate->max_tiles)
+	{
+		rate->max_tiles = numTilesX * numTilesY;
+		xfree(rate->classes);
+		rate->classes = (uint8*) xmalloc(rate->max_tiles);
+	}
+
+	rate->count[RFX_TILE_NATURAL] = 0;
+	rate->count[RFX_TILE_TEXT] = 0;
+	memset(rate->bytes, 0, sizeof(rate->bytes));
+	memset(rate->tiles, 0, sizeof(rate->tiles));
+
+	for (yIdx = 0; yIdx < numTilesY; yIdx++)
+	{
+		for (xIdx = 0; xIdx < numTilesX; xIdx++)
+		{
+			index = yIdx * numTilesX + xIdx;
+
+			rate->classes[index] = rfx_rate_classify_tile(
+				image_data + yIdx * 64 * rowstride + xIdx * 64 * bytes_per_pixel,
+				(xIdx < numTilesX - 1) ? 64 : width - xIdx * 64,
+				(yIdx < numTilesY - 1) ? 64 : height - yIdx * 64,
+				rowstride, bytes_per_pixel);
+
+			rate->count[rate->classes[index]]++;
+		}
+	}
+
+	rate->quality = rfx_rate_choose_level(rate);
+}
+
+int rfx_rate_tile_level(RFX_RATE* rate, int index)
+{
+	return rfx_rate_class_level(rate->quality, rate->classes[index]);
+}
+
+void rfx_rate_tile_done(RFX_RATE* rate, int index, int size)
+{
+	int level;
+	int class_id;
+
+	class_id = rate->classes[index];
+	level = rfx_rate_class_level(rate->quality, class_id);
+
+	rate->bytes[class_id][level] += size;
+	rate->tiles[class_id][level]++;
+}
+
+/**
+ * Fold the sizes of the frame into the estimates. Coarser levels are
+ * never expected to cost more than finer ones.
+ */
+
+void rfx_rate_end_frame(RFX_RATE* rate)
+{
+	int i;
+	int level;
+	int class_id;
+	uint32 size;
+	uint32* cost;
+	sint64 credit;
+
+	size = 0;
+
+	for (class_id = 0; class_id < 2; class_id++)
+	{
+		cost = rate->cost[class_id];
+
+		for (level = 0; level < RFX_QUANT_LEVELS; level++)
+		{
+			if (rate->tiles[class_id][level] == 0)
+				continue;
+
+			size += rate->bytes[class_id][level];
+			cost[level] = (3 * cost[level] + rate->bytes[class_id][level] / rate->tiles[class_id][level]) / 4;
+
+			for (i = 0; i < level; i++)
+				cost[i] = MAX(cost[i], cost[level]);
+
+			for (i = level + 1; i < RFX_QUANT_LEVELS; i++)
+				cost[i] = MIN(cost[i], cost[level]);
+		}
+	}
+
+	/* unused budget carries over to the next frame, an overrun is paid back over the next two */
+	credit = (sint64) rate->credit + rate->frame_budget - size;
+	credit = MAX(credit, -2 * (sint64) rate->frame_budget);
+	credit = MIN(credit, (sint64) rate->frame_budget);
+	rate->credit = (sint32) credit;
+}
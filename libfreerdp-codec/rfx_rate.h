@@ -0,0 +1,66 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol client.
+ * RemoteFX Codec Library - Rate Control
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __RFX_RATE_H
+#define __RFX_RATE_H
+
+#include <freerdp/codec/rfx.h>
+
+#define RFX_TILE_NATURAL	0
+#define RFX_TILE_TEXT		1
+
+/**
+ * Each frame is given a byte budget. The quality level of a frame is the
+ * finest one whose estimated size fits the budget and what previous frames
+ * left unused, estimates being kept per tile class and level from the
+ * tiles already encoded. Quality drops at once and recovers one level per
+ * frame, so that a busy screen does not make the picture flicker.
+ */
+
+struct _RFX_RATE
+{
+	uint32 frame_budget;
+	sint32 credit;
+	int quality;
+
+	/* estimated bytes per tile of each class at each level */
+	uint32 cost[2][RFX_QUANT_LEVELS];
+
+	/* the frame being encoded */
+	uint8* classes;
+	int max_tiles;
+	int count[2];
+	uint32 bytes[2][RFX_QUANT_LEVELS];
+	uint32 tiles[2][RFX_QUANT_LEVELS];
+};
+typedef struct _RFX_RATE RFX_RATE;
+
+extern const uint32 rfx_rate_quantization_values[RFX_QUANT_LEVELS * 10];
+
+RFX_RATE* rfx_rate_new();
+void rfx_rate_free(RFX_RATE* rate);
+void rfx_rate_set_budget(RFX_RATE* rate, uint32 frame_budget);
+
+int rfx_rate_classify_tile(const uint8* data, int width, int height, int rowstride, int bytes_per_pixel);
+
+void rfx_rate_begin_frame(RFX_RATE* rate, const uint8* image_data, int width, int height,
+	int rowstride, int bytes_per_pixel);
+int rfx_rate_tile_level(RFX_RATE* rate, int index);
+void rfx_rate_tile_done(RFX_RATE* rate, int index, int size);
+void rfx_rate_end_frame(RFX_RATE* rate);
+
+#endif /* __RFX_RATE_H */
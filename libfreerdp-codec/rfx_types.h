@@ -31,6 +31,7 @@
 #endif
 
 #include "rfx_pool.h"
+#include "rfx_rate.h"
 
 struct _RFX_CONTEXT_PRIV
 {
@@ -38,6 +39,8 @@ struct _RFX_CONTEXT_PRIV
 
 	RFX_POOL* pool; /* memory pool */
 
+	RFX_RATE* rate; /* encoder rate control */
+
 	sint16 y_r_mem[4096 + 8]; /* 4096 = 64x64 (+ 8x2 = 16 for mem align) */
 	sint16 cb_g_mem[4096 + 8]; /* 4096 = 64x64 (+ 8x2 = 16 for mem align) */
 	sint16 cr_b_mem[4096 + 8]; /* 4096 = 64x64 (+ 8x2 = 16 for mem align) */
@@ -178,33 +178,86 @@ void rdp_write_persistent_list_entry(STREAM* s, uint32 key1, uint32 key2)
 	stream_write_uint32(s, key2); /* key2 (4 bytes) */
 }
 
-void rdp_write_client_persistent_key_list_pdu(STREAM* s, rdpSettings* settings)
+/**
+ * Write a persistent key list PDU, taking the next keys of each cell.
+ * @param s stream
+ * @param settings settings
+ * @param sent number of keys of each cell already sent, updated
+ * @param bBitMask PERSIST_FIRST_PDU and/or PERSIST_LAST_PDU
+ */
+
+void rdp_write_client_persistent_key_list_pdu(STREAM* s, rdpSettings* settings, uint32* sent, uint8 bBitMask)
 {
-	stream_write_uint16(s, 0); /* numEntriesCache0 (2 bytes) */
-	stream_write_uint16(s, 0); /* numEntriesCache1 (2 bytes) */
-	stream_write_uint16(s, 0); /* numEntriesCache2 (2 bytes) */
-	stream_write_uint16(s, 0); /* numEntriesCache3 (2 bytes) */
-	stream_write_uint16(s, 0); /* numEntriesCache4 (2 bytes) */
-	stream_write_uint16(s, 0); /* totalEntriesCache0 (2 bytes) */
-	stream_write_uint16(s, 0); /* totalEntriesCache1 (2 bytes) */
-	stream_write_uint16(s, 0); /* totalEntriesCache2 (2 bytes) */
-	stream_write_uint16(s, 0); /* totalEntriesCache3 (2 bytes) */
-	stream_write_uint16(s, 0); /* totalEntriesCache4 (2 bytes) */
-	stream_write_uint8(s, PERSIST_FIRST_PDU | PERSIST_LAST_PDU); /* bBitMask (1 byte) */
+	int i;
+	uint32 j;
+	uint64 key;
+	uint32 count[5];
+	uint32 left = PERSIST_MAX_KEYS_PER_PDU;
+	BITMAP_CACHE_V2_CELL_INFO* cellInfo;
+
+	for (i = 0; i < 5; i++)
+	{
+		cellInfo = &settings->bitmapCacheV2CellInfo[i];
+		count[i] = MIN(cellInfo->numPersistentKeys - sent[i], left);
+		left -= count[i];
+	}
+
+	for (i = 0; i < 5; i++)
+		stream_write_uint16(s, count[i]); /* numEntriesCacheX (2 bytes) */
+
+	for (i = 0; i < 5; i++)
+		stream_write_uint16(s, settings->bitmapCacheV2CellInfo[i].numPersistentKeys); /* totalEntriesCacheX (2 bytes) */
+
+	stream_write_uint8(s, bBitMask); /* bBitMask (1 byte) */
 	stream_write_uint8(s, 0); /* pad1 (1 byte) */
 	stream_write_uint16(s, 0); /* pad3 (2 bytes) */
 
 	/* entries */
+	for (i = 0; i < 5; i++)
+	{
+		cellInfo = &settings->bitmapCacheV2CellInfo[i];
+
+		for (j = 0; j < count[i]; j++)
+		{
+			key = cellInfo->persistentKeys[sent[i] + j];
+			rdp_write_persistent_list_entry(s, (uint32) key, (uint32) (key >> 32));
+		}
+
+		sent[i] += count[i];
+	}
 }
 
 boolean rdp_send_client_persistent_key_list_pdu(rdpRdp* rdp)
 {
+	int i;
 	STREAM* s;
+	uint32 total = 0;
+	uint32 done = 0;
+	uint32 sent[5] = { 0 };
+	uint8 bBitMask = PERSIST_FIRST_PDU;
+	rdpSettings* settings = rdp->settings;
 
-	s = rdp_data_pdu_init(rdp);
-	rdp_write_client_persistent_key_list_pdu(s, rdp->settings);
+	for (i = 0; i < 5; i++)
+		total += settings->bitmapCacheV2CellInfo[i].numPersistentKeys;
+
+	/* an empty list is still sent as a single PDU */
+	do
+	{
+		if (total - done <= PERSIST_MAX_KEYS_PER_PDU)
+			bBitMask |= PERSIST_LAST_PDU;
+
+		s = rdp_data_pdu_init(rdp);
+		rdp_write_client_persistent_key_list_pdu(s, settings, sent, bBitMask);
 
-	return rdp_send_data_pdu(rdp, s, DATA_PDU_TYPE_BITMAP_CACHE_PERSISTENT_LIST, rdp->mcs->user_id);
+		if (!rdp_send_data_pdu(rdp, s, DATA_PDU_TYPE_BITMAP_CACHE_PERSISTENT_LIST, rdp->mcs->user_id))
+			return false;
+
+		done += MIN(total - done, PERSIST_MAX_KEYS_PER_PDU);
+		bBitMask = 0;
+	}
+	while (done < total);
+
+	return true;
 }
 
 boolean rdp_recv_client_font_list_pdu(STREAM* s)
@@ -789,7 +789,10 @@ void rdp_write_font_capability_set(STREAM* s, rdpSettings* settings)
 
 void rdp_read_brush_capability_set(STREAM* s, uint16 length, rdpSettings* settings)
 {
-	stream_seek_uint32(s); /* brushSupportLevel (4 bytes) */
+	if (settings->server_mode)
+		stream_read_uint32(s, settings->brush_support_level); /* brushSupportLevel (4 bytes) */
+	else
+		stream_seek_uint32(s); /* brushSupportLevel (4 bytes) */
 }
 
 /**
@@ -841,10 +844,23 @@ void rdp_write_cache_definition(STREAM* s, GLYPH_CACHE_DEFINITION* cache_definit
 
 void rdp_read_glyph_cache_capability_set(STREAM* s, uint16 length, rdpSettings* settings)
 {
+	int i;
 	uint16 glyphSupportLevel;
 
-	stream_seek(s, 40); /* glyphCache (40 bytes) */
-	stream_seek_uint32(s); /* fragCache (4 bytes) */
+	if (settings->server_mode)
+	{
+		/* glyphCache (40 bytes) */
+		for (i = 0; i < 10; i++)
+			rdp_read_cache_definition(s, &(settings->glyphCache[i])); /* glyphCacheN (4 bytes) */
+
+		rdp_read_cache_definition(s, settings->fragCache); /* fragCache (4 bytes) */
+	}
+	else
+	{
+		stream_seek(s, 40); /* glyphCache (40 bytes) */
+		stream_seek_uint32(s); /* fragCache (4 bytes) */
+	}
+
 	stream_read_uint16(s, glyphSupportLevel); /* glyphSupportLevel (2 bytes) */
 	stream_seek_uint16(s); /* pad2Octets (2 bytes) */
 
@@ -967,6 +983,15 @@ void rdp_write_bitmap_cache_host_support_capability_set(STREAM* s, rdpSettings*
 	rdp_capability_set_finish(s, header, CAPSET_TYPE_BITMAP_CACHE_HOST_SUPPORT);
 }
 
+void rdp_read_bitmap_cache_cell_info(STREAM* s, BITMAP_CACHE_V2_CELL_INFO* cellInfo)
+{
+	uint32 info;
+
+	stream_read_uint32(s, info);
+	cellInfo->numEntries = (info & 0x7FFFFFFF);
+	cellInfo->persistent = (info & 0x80000000) ? true : false;
+}
+
 void rdp_write_bitmap_cache_cell_info(STREAM* s, BITMAP_CACHE_V2_CELL_INFO* cellInfo)
 {
 	uint32 info;
@@ -991,12 +1016,29 @@ void rdp_read_bitmap_cache_v2_capability_set(STREAM* s, uint16 length, rdpSettin
 {
 	stream_seek_uint16(s); /* cacheFlags (2 bytes) */
 	stream_seek_uint8(s); /* pad2 (1 byte) */
-	stream_seek_uint8(s); /* numCellCaches (1 byte) */
-	stream_seek(s, 4); /* bitmapCache0CellInfo (4 bytes) */
-	stream_seek(s, 4); /* bitmapCache1CellInfo (4 bytes) */
-	stream_seek(s, 4); /* bitmapCache2CellInfo (4 bytes) */
-	stream_seek(s, 4); /* bitmapCache3CellInfo (4 bytes) */
-	stream_seek(s, 4); /* bitmapCache4CellInfo (4 bytes) */
+
+	if (settings->server_mode)
+	{
+		stream_read_uint8(s, settings->bitmapCacheV2NumCells); /* numCellCaches (1 byte) */
+		rdp_read_bitmap_cache_cell_info(s, &settings->bitmapCacheV2CellInfo[0]); /* bitmapCache0CellInfo (4 bytes) */
+		rdp_read_bitmap_cache_cell_info(s, &settings->bitmapCacheV2CellInfo[1]); /* bitmapCache1CellInfo (4 bytes) */
+		rdp_read_bitmap_cache_cell_info(s, &settings->bitmapCacheV2CellInfo[2]); /* bitmapCache2CellInfo (4 bytes) */
+		rdp_read_bitmap_cache_cell_info(s, &settings->bitmapCacheV2CellInfo[3]); /* bitmapCache3CellInfo (4 bytes) */
+		rdp_read_bitmap_cache_cell_info(s, &settings->bitmapCacheV2CellInfo[4]); /* bitmapCache4CellInfo (4 bytes) */
+
+		if (settings->bitmapCacheV2NumCells > 5)
+			settings->bitmapCacheV2NumCells = 5;
+	}
+	else
+	{
+		stream_seek_uint8(s); /* numCellCaches (1 byte) */
+		stream_seek(s, 4); /* bitmapCache0CellInfo (4 bytes) */
+		stream_seek(s, 4); /* bitmapCache1CellInfo (4 bytes) */
+		stream_seek(s, 4); /* bitmapCache2CellInfo (4 bytes) */
+		stream_seek(s, 4); /* bitmapCache3CellInfo (4 bytes) */
+		stream_seek(s, 4); /* bitmapCache4CellInfo (4 bytes) */
+	}
+
 	stream_seek(s, 12); /* pad3 (12 bytes) */
 }
 
@@ -1643,7 +1685,13 @@ void rdp_write_bitmap_codecs_capability_set(STREAM* s, rdpSettings* settings)
 
 void rdp_read_frame_acknowledge_capability_set(STREAM* s, uint16 length, rdpSettings* settings)
 {
-	stream_seek_uint32(s); /* (4 bytes) */
+	uint32 maxUnacknowledgedFrameCount;
+
+	stream_read_uint32(s, maxUnacknowledgedFrameCount); /* maxUnacknowledgedFrameCount (4 bytes) */
+
+	/* a server keeps at most what the client asked for in flight */
+	if (settings->server_mode)
+		settings->max_unacknowledged_frames = maxUnacknowledgedFrameCount;
 }
 
 /**
@@ -1658,7 +1706,7 @@ void rdp_write_frame_acknowledge_capability_set(STREAM* s, rdpSettings* settings
 
 	header = rdp_capability_set_start(s);
 
-	stream_write_uint32(s, 2); /* (4 bytes) */
+	stream_write_uint32(s, settings->max_unacknowledged_frames); /* maxUnacknowledgedFrameCount (4 bytes) */
 
 	rdp_capability_set_finish(s, header, CAPSET_TYPE_FRAME_ACKNOWLEDGE);
 }
@@ -1922,6 +1970,12 @@ void rdp_write_demand_active(STREAM* s, rdpSettings* settings)
 	rdp_write_surface_commands_capability_set(s, settings);
 	rdp_write_bitmap_codecs_capability_set(s, settings);
 
+	if (settings->frame_acknowledge)
+	{
+		numberCapabilities++;
+		rdp_write_frame_acknowledge_capability_set(s, settings);
+	}
+
 	if (settings->persistent_bitmap_cache)
 	{
 		numberCapabilities++;
@@ -2007,6 +2061,10 @@ boolean rdp_recv_confirm_active(rdpRdp* rdp, STREAM* s)
 	if (!rdp_read_capability_sets(s, rdp->settings, numberCapabilities))
 		return false;
 
+	/* frames are only acknowledged by clients that say so */
+	if (!rdp->settings->received_caps[CAPSET_TYPE_FRAME_ACKNOWLEDGE])
+		rdp->settings->frame_acknowledge = false;
+
 	return true;
 }
 
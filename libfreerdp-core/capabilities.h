@@ -105,11 +105,6 @@
 /* Font Support Flags */
 #define FONTSUPPORT_FONTLIST			0x0001
 
-/* Brush Support Level */
-#define BRUSH_DEFAULT				0x00000000
-#define BRUSH_COLOR_8x8				0x00000001
-#define BRUSH_COLOR_FULL			0x00000002
-
 /* Bitmap Cache Version */
 #define BITMAP_CACHE_V2				0x01
 
@@ -0,0 +1,545 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol client.
+ * Server Event Loop
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <freerdp/utils/memory.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#endif
+
+#include "eventloop.h"
+
+/**
+ * A single thread (the one calling freerdp_event_loop_run) waits on the
+ * epoll set and queues ready sources, a fixed pool of workers runs their
+ * check callbacks. Descriptors are registered one-shot and re-armed once
+ * the callback has returned, so a source is only ever handled by one worker
+ * and idle sources cost no thread at all. Sources are only freed by the
+ * dispatching thread, after the batch of events that may refer to them.
+ */
+
+#ifdef HAVE_SYS_EPOLL_H
+
+#define EVENT_LOOP_MAX_EVENTS	64
+
+static void event_loop_enqueue(rdpEventLoop* loop, rdpEventSource* source)
+{
+	source->state = EVENT_SOURCE_QUEUED;
+	source->next = NULL;
+
+	if (loop->queue_tail != NULL)
+		loop->queue_tail->next = source;
+	else
+		loop->queue_head = source;
+
+	loop->queue_tail = source;
+
+	pthread_cond_signal(&loop->cond);
+}
+
+static rdpEventSource* event_loop_dequeue(rdpEventLoop* loop)
+{
+	rdpEventSource* source;
+
+	source = loop->queue_head;
+	loop->queue_head = source->next;
+
+	if (loop->queue_head == NULL)
+		loop->queue_tail = NULL;
+
+	source->next = NULL;
+
+	return source;
+}
+
+static void event_loop_arm(rdpEventLoop* loop, rdpEventSource* source, int op)
+{
+	int i;
+	struct epoll_event event;
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN | EPOLLONESHOT;
+	event.data.ptr = source;
+
+	for (i = 0; i < source->num_fds; i++)
+		epoll_ctl(loop->epfd, op, source->fds[i], &event);
+}
+
+static void event_loop_wakeup(rdpEventLoop* loop)
+{
+	if (write(loop->pipe_fd[1], "w", 1) < 0)
+	{
+		/* the pipe is full, the dispatcher is woken up anyway */
+	}
+}
+
+static void event_loop_destroy_source(rdpEventLoop* loop, rdpEventSource* source)
+{
+	int i;
+
+	for (i = 0; i < source->num_fds; i++)
+		epoll_ctl(loop->epfd, EPOLL_CTL_DEL, source->fds[i], NULL);
+
+	pthread_mutex_lock(&loop->mutex);
+
+	if (source->prev_source != NULL)
+		source->prev_source->next_source = source->next_source;
+	else
+		loop->sources = source->next_source;
+
+	if (source->next_source != NULL)
+		source->next_source->prev_source = source->prev_source;
+
+	loop->num_sources--;
+
+	pthread_mutex_unlock(&loop->mutex);
+
+	IFCALL(source->Closed, source, source->param);
+
+	xfree(source);
+}
+
+static void* event_loop_worker(void* arg)
+{
+	boolean status;
+	rdpEventSource* source;
+	rdpEventLoop* loop = (rdpEventLoop*) arg;
+
+	pthread_mutex_lock(&loop->mutex);
+
+	while (1)
+	{
+		while ((loop->queue_head == NULL) && !loop->stopped)
+			pthread_cond_wait(&loop->cond, &loop->mutex);
+
+		if (loop->stopped)
+			break;
+
+		source = event_loop_dequeue(loop);
+		source->state = EVENT_SOURCE_RUNNING;
+		source->pending = false;
+
+		pthread_mutex_unlock(&loop->mutex);
+
+		status = source->Check(source, source->param);
+
+		pthread_mutex_lock(&loop->mutex);
+
+		if (status != true)
+		{
+			source->state = EVENT_SOURCE_CLOSED;
+			source->next = loop->closed;
+			loop->closed = source;
+			event_loop_wakeup(loop);
+		}
+		else if (source->pending)
+		{
+			event_loop_enqueue(loop, source);
+		}
+		else
+		{
+			/* re-armed under the lock, the source cannot be freed meanwhile */
+			source->state = EVENT_SOURCE_IDLE;
+			event_loop_arm(loop, source, EPOLL_CTL_MOD);
+		}
+	}
+
+	pthread_mutex_unlock(&loop->mutex);
+
+	return NULL;
+}
+
+static rdpEventSource* event_loop_source_new(rdpEventLoop* loop, void** rfds, int rcount,
+		psEventSourceCheck Check, psEventSourceClosed Closed, void* param)
+{
+	int i;
+	rdpEventSource* source;
+
+	if ((rcount < 1) || (rcount > EVENT_SOURCE_MAX_FDS))
+		return NULL;
+
+	source = xnew(rdpEventSource);
+	source->loop = loop;
+	source->Check = Check;
+	source->Closed = Closed;
+	source->param = param;
+	source->state = EVENT_SOURCE_IDLE;
+
+	for (i = 0; i < rcount; i++)
+		source->fds[source->num_fds++] = (int)(long) rfds[i];
+
+	return source;
+}
+
+static void event_loop_register(rdpEventLoop* loop, rdpEventSource* source)
+{
+	pthread_mutex_lock(&loop->mutex);
+
+	source->next_source = loop->sources;
+
+	if (loop->sources != NULL)
+		loop->sources->prev_source = source;
+
+	loop->sources = source;
+	loop->num_sources++;
+
+	event_loop_arm(loop, source, EPOLL_CTL_ADD);
+
+	pthread_mutex_unlock(&loop->mutex);
+}
+
+/**
+ * Register a set of file descriptors with the loop.
+ * @param rfds descriptors, as returned by GetFileDescriptor
+ * @param Check called on a worker thread when one of the descriptors is readable
+ * @param Closed called once the source has been removed, may be NULL
+ * @return source, or NULL on failure
+ */
+
+rdpEventSource* freerdp_event_loop_add(rdpEventLoop* loop, void** rfds, int rcount,
+		psEventSourceCheck Check, psEventSourceClosed Closed, void* param)
+{
+	rdpEventSource* source;
+
+	source = event_loop_source_new(loop, rfds, rcount, Check, Closed, param);
+
+	if (source != NULL)
+		event_loop_register(loop, source);
+
+	return source;
+}
+
+static boolean event_loop_check_listener(rdpEventSource* source, void* param)
+{
+	freerdp_listener* instance = (freerdp_listener*) param;
+
+	return instance->CheckFileDescriptor(instance);
+}
+
+/**
+ * Register the listening sockets of a listener. Accepted peers are passed
+ * to its PeerAccepted callback, from a worker thread.
+ */
+
+rdpEventSource* freerdp_event_loop_add_listener(rdpEventLoop* loop, freerdp_listener* instance)
+{
+	int rcount = 0;
+	void* rfds[EVENT_SOURCE_MAX_FDS];
+
+	if (instance->GetFileDescriptor(instance, rfds, &rcount) != true)
+		return NULL;
+
+	return freerdp_event_loop_add(loop, rfds, rcount, event_loop_check_listener, NULL, instance);
+}
+
+static boolean event_loop_check_peer(rdpEventSource* source, void* param)
+{
+	freerdp_peer* client = (freerdp_peer*) param;
+
+	if (client->CheckFileDescriptor(client) != true)
+		return false;
+
+	if (source->PeerCheck != NULL)
+		return source->PeerCheck(source, param);
+
+	return true;
+}
+
+static void event_loop_closed_peer(rdpEventSource* source, void* param)
+{
+	freerdp_peer* client = (freerdp_peer*) param;
+
+	if (source->PeerClosed != NULL)
+	{
+		source->PeerClosed(source, param);
+		return;
+	}
+
+	client->Disconnect(client);
+	freerdp_peer_context_free(client);
+	freerdp_peer_free(client);
+}
+
+/**
+ * Register an initialized peer, along with descriptors of its own.
+ * @param rfds additional descriptors of the server for this peer, may be NULL
+ * @param Check called after the peer has processed its input, may be NULL
+ * @param Closed called when the peer is removed; if NULL the peer is disconnected and freed
+ */
+
+rdpEventSource* freerdp_event_loop_add_peer(rdpEventLoop* loop, freerdp_peer* client,
+		void** rfds, int rcount, psEventSourceCheck Check, psEventSourceClosed Closed)
+{
+	int i;
+	int count = 0;
+	rdpEventSource* source;
+	void* fds[EVENT_SOURCE_MAX_FDS];
+
+	if (client->GetFileDescriptor(client, fds, &count) != true)
+		return NULL;
+
+	if (count + rcount > EVENT_SOURCE_MAX_FDS)
+		return NULL;
+
+	for (i = 0; i < rcount; i++)
+		fds[count++] = rfds[i];
+
+	source = event_loop_source_new(loop, fds, count, event_loop_check_peer, event_loop_closed_peer, client);
+
+	if (source != NULL)
+	{
+		source->PeerCheck = Check;
+		source->PeerClosed = Closed;
+		event_loop_register(loop, source);
+	}
+
+	return source;
+}
+
+rdpEventLoop* freerdp_event_source_get_loop(rdpEventSource* source)
+{
+	return source->loop;
+}
+
+/**
+ * Dispatch events until freerdp_event_loop_stop is called.
+ */
+
+void freerdp_event_loop_run(rdpEventLoop* loop)
+{
+	int i;
+	int status;
+	char buf[64];
+	rdpEventSource* source;
+	rdpEventSource* closed;
+	struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+
+	loop->threads = (pthread_t*) xzalloc(sizeof(pthread_t) * loop->num_workers);
+
+	for (i = 0; i < loop->num_workers; i++)
+		pthread_create(&loop->threads[i], 0, event_loop_worker, (void*) loop);
+
+	while (1)
+	{
+		status = epoll_wait(loop->epfd, events, EVENT_LOOP_MAX_EVENTS, -1);
+
+		if (status < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			perror("epoll_wait");
+			break;
+		}
+
+		pthread_mutex_lock(&loop->mutex);
+
+		for (i = 0; i < status; i++)
+		{
+			source = (rdpEventSource*) events[i].data.ptr;
+
+			if (source == NULL)
+			{
+				while (read(loop->pipe_fd[0], buf, sizeof(buf)) > 0);
+				continue;
+			}
+
+			if (source->state == EVENT_SOURCE_IDLE)
+				event_loop_enqueue(loop, source);
+			else if (source->state == EVENT_SOURCE_RUNNING)
+				source->pending = true;
+		}
+
+		if (loop->stopped)
+		{
+			pthread_mutex_unlock(&loop->mutex);
+			break;
+		}
+
+		closed = loop->closed;
+		loop->closed = NULL;
+
+		pthread_mutex_unlock(&loop->mutex);
+
+		while (closed != NULL)
+		{
+			source = closed;
+			closed = closed->next;
+			event_loop_destroy_source(loop, source);
+		}
+	}
+
+	pthread_mutex_lock(&loop->mutex);
+	loop->stopped = true;
+	pthread_cond_broadcast(&loop->cond);
+	pthread_mutex_unlock(&loop->mutex);
+
+	for (i = 0; i < loop->num_workers; i++)
+		pthread_join(loop->threads[i], NULL);
+
+	xfree(loop->threads);
+	loop->threads = NULL;
+}
+
+/**
+ * Make freerdp_event_loop_run return, may be called from any thread.
+ */
+
+void freerdp_event_loop_stop(rdpEventLoop* loop)
+{
+	pthread_mutex_lock(&loop->mutex);
+	loop->stopped = true;
+	pthread_cond_broadcast(&loop->cond);
+	event_loop_wakeup(loop);
+	pthread_mutex_unlock(&loop->mutex);
+}
+
+/**
+ * Create an event loop.
+ * @param workers number of worker threads, or 0 for one per processor
+ */
+
+rdpEventLoop* freerdp_event_loop_new(int workers)
+{
+	rdpEventLoop* loop;
+	struct epoll_event event;
+
+	loop = xnew(rdpEventLoop);
+
+	if (workers < 1)
+		workers = (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+	loop->num_workers = (workers < 1) ? 1 : workers;
+
+	loop->epfd = epoll_create(EVENT_LOOP_MAX_EVENTS);
+
+	if (loop->epfd == -1)
+	{
+		perror("epoll_create");
+		xfree(loop);
+		return NULL;
+	}
+
+	if (pipe(loop->pipe_fd) < 0)
+	{
+		perror("pipe");
+		close(loop->epfd);
+		xfree(loop);
+		return NULL;
+	}
+
+	fcntl(loop->pipe_fd[0], F_SETFL, O_NONBLOCK);
+	fcntl(loop->pipe_fd[1], F_SETFL, O_NONBLOCK);
+
+	/* level-triggered and never re-armed, this is the only source without a pointer */
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;
+	epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->pipe_fd[0], &event);
+
+	pthread_mutex_init(&loop->mutex, NULL);
+	pthread_cond_init(&loop->cond, NULL);
+
+	return loop;
+}
+
+/**
+ * Free an event loop that is not running. Sources still registered are
+ * removed and their closed callback is called.
+ */
+
+void freerdp_event_loop_free(rdpEventLoop* loop)
+{
+	rdpEventSource* source;
+
+	if (loop == NULL)
+		return;
+
+	while (loop->closed != NULL)
+	{
+		source = loop->closed;
+		loop->closed = source->next;
+		event_loop_destroy_source(loop, source);
+	}
+
+	while (loop->sources != NULL)
+		event_loop_destroy_source(loop, loop->sources);
+
+	close(loop->pipe_fd[0]);
+	close(loop->pipe_fd[1]);
+	close(loop->epfd);
+
+	pthread_mutex_destroy(&loop->mutex);
+	pthread_cond_destroy(&loop->cond);
+
+	xfree(loop);
+}
+
+#else
+
+rdpEventSource* freerdp_event_loop_add(rdpEventLoop* loop, void** rfds, int rcount,
+		psEventSourceCheck Check, psEventSourceClosed Closed, void* param)
+{
+	return NULL;
+}
+
+rdpEventSource* freerdp_event_loop_add_listener(rdpEventLoop* loop, freerdp_listener* instance)
+{
+	return NULL;
+}
+
+rdpEventSource* freerdp_event_loop_add_peer(rdpEventLoop* loop, freerdp_peer* client,
+		void** rfds, int rcount, psEventSourceCheck Check, psEventSourceClosed Closed)
+{
+	return NULL;
+}
+
+rdpEventLoop* freerdp_event_source_get_loop(rdpEventSource* source)
+{
+	return NULL;
+}
+
+void freerdp_event_loop_run(rdpEventLoop* loop)
+{
+
+}
+
+void freerdp_event_loop_stop(rdpEventLoop* loop)
+{
+
+}
+
+rdpEventLoop* freerdp_event_loop_new(int workers)
+{
+	printf("freerdp_event_loop_new: epoll is not available on this platform\n");
+	return NULL;
+}
+
+void freerdp_event_loop_free(rdpEventLoop* loop)
+{
+
+}
+
+#endif
@@ -0,0 +1,73 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol client.
+ * Server Event Loop
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __EVENT_LOOP_H
+#define __EVENT_LOOP_H
+
+#include <freerdp/eventloop.h>
+
+#ifdef HAVE_SYS_EPOLL_H
+
+#define EVENT_SOURCE_IDLE	0
+#define EVENT_SOURCE_QUEUED	1
+#define EVENT_SOURCE_RUNNING	2
+#define EVENT_SOURCE_CLOSED	3
+
+struct rdp_event_source
+{
+	rdpEventLoop* loop;
+
+	int fds[EVENT_SOURCE_MAX_FDS];
+	int num_fds;
+
+	psEventSourceCheck Check;
+	psEventSourceClosed Closed;
+	void* param;
+
+	psEventSourceCheck PeerCheck;
+	psEventSourceClosed PeerClosed;
+
+	int state;
+	boolean pending;
+	rdpEventSource* next;
+
+	rdpEventSource* prev_source;
+	rdpEventSource* next_source;
+};
+
+struct rdp_event_loop
+{
+	int epfd;
+	int pipe_fd[2];
+
+	int num_workers;
+	pthread_t* threads;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	boolean stopped;
+
+	rdpEventSource* queue_head;
+	rdpEventSource* queue_tail;
+	rdpEventSource* closed;
+
+	rdpEventSource* sources;
+	int num_sources;
+};
+
+#endif
+
+#endif /* __EVENT_LOOP_H */
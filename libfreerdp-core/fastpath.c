@@ -234,6 +234,7 @@ static void fastpath_recv_update_data(rdpFastPath* fastpath, STREAM* s)
 	uint8 compressionFlags;
 	STREAM* update_stream;
 	STREAM* comp_stream;
+	STREAM decompressed;
 	rdpRdp  *rdp;
 	uint32 roff;
 	uint32 rlen;
@@ -255,10 +256,9 @@ static void fastpath_recv_update_data(rdpFastPath* fastpath, STREAM* s)
 	{
 		if (decompress_rdp(rdp, s->p, size, compressionFlags, &roff, &rlen))
 		{
-			comp_stream = stream_new(0);
-			comp_stream->data = rdp->mppc->history_buf + roff;
-			comp_stream->p = comp_stream->data;
-			comp_stream->size = rlen;
+			/* read in place from the decompression history */
+			comp_stream = &decompressed;
+			stream_attach(comp_stream, rdp->mppc->history_buf + roff, rlen);
 			size = comp_stream->size;
 		}
 		else
@@ -294,9 +294,6 @@ static void fastpath_recv_update_data(rdpFastPath* fastpath, STREAM* s)
 		fastpath_recv_update(fastpath, updateCode, totalSize, update_stream);
 
 	stream_set_pos(s, next_pos);
-
-	if (comp_stream != s)
-		xfree(comp_stream);
 }
 
 boolean fastpath_recv_updates(rdpFastPath* fastpath, STREAM* s)
@@ -312,6 +309,13 @@ boolean fastpath_recv_updates(rdpFastPath* fastpath, STREAM* s)
 
 	IFCALL(update->EndPaint, update->context);
 
+	/* a frame is acknowledged once presented, which covers the frames before it */
+	if (update->acknowledge_frame)
+	{
+		update->acknowledge_frame = false;
+		IFCALL(update->SurfaceFrameAcknowledge, update->context, update->acknowledge_frame_id);
+	}
+
 	return true;
 }
 
@@ -502,7 +506,12 @@ static uint32 fastpath_get_sec_bytes(rdpRdp* rdp)
 	return sec_bytes;
 }
 
-STREAM* fastpath_input_pdu_init(rdpFastPath* fastpath, uint8 eventFlags, uint8 eventCode)
+/**
+ * Start a fast-path input PDU, leaving room for its header. The events
+ * are written by the caller, each with its own eventHeader.
+ */
+
+STREAM* fastpath_input_multi_pdu_init(rdpFastPath* fastpath)
 {
 	rdpRdp *rdp;
 	STREAM* s;
@@ -517,11 +526,24 @@ STREAM* fastpath_input_pdu_init(rdpFastPath* fastpath, uint8 eventFlags, uint8 e
 			rdp->sec_flags |= SEC_SECURE_CHECKSUM;
 	}
 	stream_seek(s, fastpath_get_sec_bytes(rdp));
+	return s;
+}
+
+STREAM* fastpath_input_pdu_init(rdpFastPath* fastpath, uint8 eventFlags, uint8 eventCode)
+{
+	STREAM* s;
+
+	s = fastpath_input_multi_pdu_init(fastpath);
 	stream_write_uint8(s, eventFlags | (eventCode << 5)); /* eventHeader (1 byte) */
 	return s;
 }
 
 boolean fastpath_send_input_pdu(rdpFastPath* fastpath, STREAM* s)
+{
+	return fastpath_send_multi_input_pdu(fastpath, s, 1);
+}
+
+boolean fastpath_send_multi_input_pdu(rdpFastPath* fastpath, STREAM* s, uint8 numberEvents)
 {
 	rdpRdp *rdp;
 	uint16 length;
@@ -537,8 +559,14 @@ boolean fastpath_send_input_pdu(rdpFastPath* fastpath, STREAM* s)
 		return false;
 	}
 
+	if (numberEvents < 1 || numberEvents > FASTPATH_INPUT_MAX_EVENTS)
+	{
+		printf("fastpath_send_multi_input_pdu: invalid number of events %d\n", numberEvents);
+		return false;
+	}
+
 	eventHeader = FASTPATH_INPUT_ACTION_FASTPATH;
-	eventHeader |= (1 << 2); /* numberEvents */
+	eventHeader |= (numberEvents << 2); /* numberEvents */
 	if (rdp->sec_flags & SEC_ENCRYPT)
 		eventHeader |= (FASTPATH_INPUT_ENCRYPTED << 6);
 	if (rdp->sec_flags & SEC_SECURE_CHECKSUM)
@@ -602,6 +630,7 @@ boolean fastpath_send_update_pdu(rdpFastPath* fastpath, uint8 updateCode, STREAM
 	uint32 totalLength;
 	uint8 fragmentation;
 	uint8 header;
+	STREAM pdu;
 	STREAM* update;
 
 	result = true;
@@ -611,7 +640,9 @@ boolean fastpath_send_update_pdu(rdpFastPath* fastpath, uint8 updateCode, STREAM
 	maxLength = FASTPATH_MAX_PACKET_SIZE - 6 - sec_bytes;
 	totalLength = stream_get_length(s) - 6 - sec_bytes;
 	stream_set_pos(s, 0);
-	update = stream_new(0);
+
+	/* each fragment is sent in place, from within s */
+	update = &pdu;
 
 	for (fragment = 0; totalLength > 0; fragment++)
 	{
@@ -659,8 +690,6 @@ boolean fastpath_send_update_pdu(rdpFastPath* fastpath, uint8 updateCode, STREAM
 		stream_seek(s, length - 6 - sec_bytes);
 	}
 
-	stream_free(update);
-
 	return result;
 }
 
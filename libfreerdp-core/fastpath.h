@@ -94,6 +94,9 @@ enum FASTPATH_INPUT_KBDFLAGS
 	FASTPATH_INPUT_KBDFLAGS_EXTENDED = 0x02
 };
 
+/* Most events an input PDU carries with numberEvents in fpInputHeader */
+#define FASTPATH_INPUT_MAX_EVENTS	15
+
 struct rdp_fastpath
 {
 	rdpRdp* rdp;
@@ -110,6 +113,8 @@ boolean fastpath_recv_inputs(rdpFastPath* fastpath, STREAM* s);
 
 STREAM* fastpath_input_pdu_init(rdpFastPath* fastpath, uint8 eventFlags, uint8 eventCode);
 boolean fastpath_send_input_pdu(rdpFastPath* fastpath, STREAM* s);
+STREAM* fastpath_input_multi_pdu_init(rdpFastPath* fastpath);
+boolean fastpath_send_multi_input_pdu(rdpFastPath* fastpath, STREAM* s, uint8 numberEvents);
 
 STREAM* fastpath_update_pdu_init(rdpFastPath* fastpath);
 boolean fastpath_send_update_pdu(rdpFastPath* fastpath, uint8 updateCode, STREAM* s);
@@ -145,59 +145,137 @@ void input_send_extended_mouse_event(rdpInput* input, uint16 flags, uint16 x, ui
 	rdp_send_client_input_pdu(rdp, s);
 }
 
-void input_send_fastpath_synchronize_event(rdpInput* input, uint32 flags)
+/**
+ * Send the fast-path input events gathered so far in one PDU.
+ */
+
+static void input_flush_events(rdpInput* input)
 {
 	STREAM* s;
 	rdpRdp* rdp = input->context->rdp;
 
+	if (input->number_events > 0)
+	{
+		s = fastpath_input_multi_pdu_init(rdp->fastpath);
+		stream_check_size(s, stream_get_length(input->events));
+		stream_write(s, stream_get_head(input->events), stream_get_length(input->events));
+		fastpath_send_multi_input_pdu(rdp->fastpath, s, input->number_events);
+	}
+
+	stream_set_pos(input->events, 0);
+	input->number_events = 0;
+	input->last_move = -1;
+}
+
+/**
+ * Between BeginBatch and EndBatch, typically one pass of a client event
+ * loop, fast-path input events are gathered instead of each being sent in
+ * a PDU of its own.
+ */
+
+void input_begin_batch(rdpInput* input)
+{
+	input->batch_events = true;
+}
+
+void input_end_batch(rdpInput* input)
+{
+	input_flush_events(input);
+	input->batch_events = false;
+}
+
+static STREAM* input_fastpath_event_init(rdpInput* input, uint8 eventFlags, uint8 eventCode)
+{
+	STREAM* s;
+	rdpRdp* rdp = input->context->rdp;
+
+	if (input->batch_events != true)
+		return fastpath_input_pdu_init(rdp->fastpath, eventFlags, eventCode);
+
+	if (input->number_events >= FASTPATH_INPUT_MAX_EVENTS)
+		input_flush_events(input);
+
+	s = input->events;
+	stream_check_size(s, 7); /* eventHeader and the largest event */
+	stream_write_uint8(s, eventFlags | (eventCode << 5)); /* eventHeader (1 byte) */
+	input->last_move = -1;
+
+	return s;
+}
+
+static void input_fastpath_event_send(rdpInput* input, STREAM* s)
+{
+	rdpRdp* rdp = input->context->rdp;
+
+	if (input->batch_events != true)
+		fastpath_send_input_pdu(rdp->fastpath, s);
+	else
+		input->number_events++;
+}
+
+void input_send_fastpath_synchronize_event(rdpInput* input, uint32 flags)
+{
+	STREAM* s;
+
 	/* The FastPath Synchronization eventFlags has identical values as SlowPath */
-	s = fastpath_input_pdu_init(rdp->fastpath, (uint8) flags, FASTPATH_INPUT_EVENT_SYNC);
-	fastpath_send_input_pdu(rdp->fastpath, s);
+	s = input_fastpath_event_init(input, (uint8) flags, FASTPATH_INPUT_EVENT_SYNC);
+	input_fastpath_event_send(input, s);
 }
 
 void input_send_fastpath_keyboard_event(rdpInput* input, uint16 flags, uint16 code)
 {
 	STREAM* s;
 	uint8 eventFlags = 0;
-	rdpRdp* rdp = input->context->rdp;
 
 	eventFlags |= (flags & KBD_FLAGS_RELEASE) ? FASTPATH_INPUT_KBDFLAGS_RELEASE : 0;
 	eventFlags |= (flags & KBD_FLAGS_EXTENDED) ? FASTPATH_INPUT_KBDFLAGS_EXTENDED : 0;
-	s = fastpath_input_pdu_init(rdp->fastpath, eventFlags, FASTPATH_INPUT_EVENT_SCANCODE);
+	s = input_fastpath_event_init(input, eventFlags, FASTPATH_INPUT_EVENT_SCANCODE);
 	stream_write_uint8(s, code); /* keyCode (1 byte) */
-	fastpath_send_input_pdu(rdp->fastpath, s);
+	input_fastpath_event_send(input, s);
 }
 
 void input_send_fastpath_unicode_keyboard_event(rdpInput* input, uint16 flags, uint16 code)
 {
 	STREAM* s;
 	uint8 eventFlags = 0;
-	rdpRdp* rdp = input->context->rdp;
 
 	eventFlags |= (flags & KBD_FLAGS_RELEASE) ? FASTPATH_INPUT_KBDFLAGS_RELEASE : 0;
-	s = fastpath_input_pdu_init(rdp->fastpath, eventFlags, FASTPATH_INPUT_EVENT_UNICODE);
+	s = input_fastpath_event_init(input, eventFlags, FASTPATH_INPUT_EVENT_UNICODE);
 	stream_write_uint16(s, code); /* unicodeCode (2 bytes) */
-	fastpath_send_input_pdu(rdp->fastpath, s);
+	input_fastpath_event_send(input, s);
 }
 
 void input_send_fastpath_mouse_event(rdpInput* input, uint16 flags, uint16 x, uint16 y)
 {
+	int pos;
 	STREAM* s;
-	rdpRdp* rdp = input->context->rdp;
 
-	s = fastpath_input_pdu_init(rdp->fastpath, 0, FASTPATH_INPUT_EVENT_MOUSE);
+	if (flags == PTR_FLAGS_MOVE && input->last_move >= 0)
+	{
+		/* of consecutive moves only the last position is sent */
+		pos = stream_get_pos(input->events);
+		stream_set_pos(input->events, input->last_move + 1);
+		input_write_mouse_event(input->events, flags, x, y);
+		stream_set_pos(input->events, pos);
+		return;
+	}
+
+	s = input_fastpath_event_init(input, 0, FASTPATH_INPUT_EVENT_MOUSE);
+
+	if (input->batch_events && flags == PTR_FLAGS_MOVE)
+		input->last_move = stream_get_pos(s) - 1;
+
 	input_write_mouse_event(s, flags, x, y);
-	fastpath_send_input_pdu(rdp->fastpath, s);
+	input_fastpath_event_send(input, s);
 }
 
 void input_send_fastpath_extended_mouse_event(rdpInput* input, uint16 flags, uint16 x, uint16 y)
 {
 	STREAM* s;
-	rdpRdp* rdp = input->context->rdp;
 
-	s = fastpath_input_pdu_init(rdp->fastpath, 0, FASTPATH_INPUT_EVENT_MOUSEX);
+	s = input_fastpath_event_init(input, 0, FASTPATH_INPUT_EVENT_MOUSEX);
 	input_write_extended_mouse_event(s, flags, x, y);
-	fastpath_send_input_pdu(rdp->fastpath, s);
+	input_fastpath_event_send(input, s);
 }
 
 static boolean input_recv_sync_event(rdpInput* input, STREAM* s)
@@ -387,6 +465,8 @@ void input_register_client_callbacks(rdpInput* input)
 		input->UnicodeKeyboardEvent = input_send_fastpath_unicode_keyboard_event;
 		input->MouseEvent = input_send_fastpath_mouse_event;
 		input->ExtendedMouseEvent = input_send_fastpath_extended_mouse_event;
+		input->BeginBatch = input_begin_batch;
+		input->EndBatch = input_end_batch;
 	}
 	else
 	{
@@ -406,7 +486,8 @@ rdpInput* input_new(rdpRdp* rdp)
 
 	if (input != NULL)
 	{
-
+		input->events = stream_new(64);
+		input->last_move = -1;
 	}
 
 	return input;
@@ -416,6 +497,7 @@ void input_free(rdpInput* input)
 {
 	if (input != NULL)
 	{
+		stream_free(input->events);
 		xfree(input);
 	}
 }
@@ -53,6 +53,9 @@ void input_send_fastpath_unicode_keyboard_event(rdpInput* input, uint16 flags, u
 void input_send_fastpath_mouse_event(rdpInput* input, uint16 flags, uint16 x, uint16 y);
 void input_send_fastpath_extended_mouse_event(rdpInput* input, uint16 flags, uint16 x, uint16 y);
 
+void input_begin_batch(rdpInput* input);
+void input_end_batch(rdpInput* input);
+
 boolean input_recv(rdpInput* input, STREAM* s);
 void input_recv_keyboard_ime_status_event(rdpInput* input, STREAM* s);
 
@@ -2070,3 +2070,1965 @@ void update_recv_order(rdpUpdate* update, STREAM* s)
 		update_recv_primary_order(update, s, controlFlags);
 }
 
+
+/* Primary Drawing Order Encoding */
+
+/**
+ * The encoder keeps the last order of each type it sent, in the same
+ * rdpPrimaryUpdate a client decodes into, and only sends the fields that
+ * changed. Coordinates go as one byte deltas when every changed one fits.
+ */
+
+static INLINE void update_compare_field(ORDER_INFO* orderInfo, uint32 field, uint32 value, uint32 last)
+{
+	if (value != last)
+		orderInfo->fieldFlags |= field;
+}
+
+static INLINE void update_compare_coord(ORDER_INFO* orderInfo, uint32 field, sint32 value, sint32 last)
+{
+	if (value != last)
+	{
+		orderInfo->fieldFlags |= field;
+
+		if (value - last < -128 || value - last > 127)
+			orderInfo->deltaCoordinates = false;
+	}
+}
+
+static INLINE void update_write_coord(STREAM* s, sint32 coord, sint32 last, boolean delta)
+{
+	if (delta)
+		stream_write_uint8(s, (uint8) (coord - last));
+	else
+		stream_write_uint16(s, (uint16) coord);
+}
+
+static INLINE void update_write_color(STREAM* s, uint32 color)
+{
+	stream_write_uint8(s, color & 0xFF);
+	stream_write_uint8(s, (color >> 8) & 0xFF);
+	stream_write_uint8(s, (color >> 16) & 0xFF);
+}
+
+static INLINE void update_write_delta(STREAM* s, sint32 value)
+{
+	if (value >= -64 && value <= 63)
+	{
+		stream_write_uint8(s, value & 0x7F);
+	}
+	else
+	{
+		stream_write_uint8(s, 0x80 | ((value >> 8) & 0x7F));
+		stream_write_uint8(s, value & 0xFF);
+	}
+}
+
+static INLINE uint32 update_brush_hatch(rdpBrush* brush)
+{
+	return (brush->style & CACHED_BRUSH) ? brush->index : brush->hatch;
+}
+
+static INLINE uint8* update_brush_data(rdpBrush* brush)
+{
+	return (brush->data != NULL) ? brush->data : brush->p8x8;
+}
+
+static void update_compare_brush(ORDER_INFO* orderInfo, int shift, rdpBrush* brush, rdpBrush* last)
+{
+	update_compare_field(orderInfo, ORDER_FIELD_01 << shift, brush->x, last->x);
+	update_compare_field(orderInfo, ORDER_FIELD_02 << shift, brush->y, last->y);
+	update_compare_field(orderInfo, ORDER_FIELD_03 << shift, brush->style, last->style);
+	update_compare_field(orderInfo, ORDER_FIELD_04 << shift, update_brush_hatch(brush), update_brush_hatch(last));
+
+	/* the pattern kept for another style is not to be trusted */
+	if (brush->style == BS_PATTERN)
+	{
+		if ((orderInfo->fieldFlags & (ORDER_FIELD_03 << shift)) ||
+				memcmp(&update_brush_data(brush)[1], &last->p8x8[1], 7) != 0)
+			orderInfo->fieldFlags |= (ORDER_FIELD_05 << shift);
+	}
+}
+
+static void update_write_brush(STREAM* s, rdpBrush* brush, uint8 fieldFlags)
+{
+	uint8* data;
+
+	if (fieldFlags & ORDER_FIELD_01)
+		stream_write_uint8(s, brush->x);
+
+	if (fieldFlags & ORDER_FIELD_02)
+		stream_write_uint8(s, brush->y);
+
+	if (fieldFlags & ORDER_FIELD_03)
+		stream_write_uint8(s, brush->style);
+
+	if (fieldFlags & ORDER_FIELD_04)
+		stream_write_uint8(s, update_brush_hatch(brush));
+
+	if (fieldFlags & ORDER_FIELD_05)
+	{
+		data = update_brush_data(brush);
+		stream_write_uint8(s, data[7]);
+		stream_write_uint8(s, data[6]);
+		stream_write_uint8(s, data[5]);
+		stream_write_uint8(s, data[4]);
+		stream_write_uint8(s, data[3]);
+		stream_write_uint8(s, data[2]);
+		stream_write_uint8(s, data[1]);
+	}
+}
+
+/* The brush copied along with its order still points to the caller's pattern */
+static void update_save_brush(rdpBrush* last, rdpBrush* brush)
+{
+	memmove(last->p8x8, update_brush_data(brush), 8);
+	last->data = last->p8x8;
+}
+
+/**
+ * Rectangles are numbered from 1, the way update_read_delta_rects() leaves
+ * them, with the first one relative to the origin.
+ */
+
+static INLINE int update_delta_rects_number(uint32 number)
+{
+	return (number > 44) ? 44 : number;
+}
+
+static void update_compare_delta_rects(ORDER_INFO* orderInfo, uint32 numberField, uint32 dataField,
+		uint32 number, DELTA_RECT* rectangles, uint32 lastNumber, DELTA_RECT* lastRectangles)
+{
+	int count = update_delta_rects_number(number);
+
+	update_compare_field(orderInfo, numberField, count, update_delta_rects_number(lastNumber));
+
+	if ((orderInfo->fieldFlags & numberField) ||
+			memcmp(&rectangles[1], &lastRectangles[1], sizeof(DELTA_RECT) * count) != 0)
+		orderInfo->fieldFlags |= dataField;
+}
+
+static void update_write_delta_rects(STREAM* s, DELTA_RECT* rectangles, int number)
+{
+	int i;
+	uint8 flags;
+	uint8* zeroBits;
+	uint8* cbDataMark;
+	uint8* endMark;
+	DELTA_RECT* prev;
+	DELTA_RECT origin;
+
+	memset(&origin, 0, sizeof(DELTA_RECT));
+
+	stream_get_mark(s, cbDataMark);
+	stream_seek_uint16(s); /* cbData (2 bytes) */
+
+	stream_get_mark(s, zeroBits);
+	stream_write_zero(s, (number + 1) / 2);
+
+	for (i = 1; i < number + 1; i++)
+	{
+		prev = (i > 1) ? &rectangles[i - 1] : &origin;
+		flags = 0;
+
+		if (rectangles[i].left == prev->left)
+			flags |= 0x80;
+		else
+			update_write_delta(s, rectangles[i].left - prev->left);
+
+		if (rectangles[i].top == prev->top)
+			flags |= 0x40;
+		else
+			update_write_delta(s, rectangles[i].top - prev->top);
+
+		if (rectangles[i].width == prev->width)
+			flags |= 0x20;
+		else
+			update_write_delta(s, rectangles[i].width);
+
+		if (rectangles[i].height == prev->height)
+			flags |= 0x10;
+		else
+			update_write_delta(s, rectangles[i].height);
+
+		zeroBits[(i - 1) / 2] |= ((i - 1) % 2 == 0) ? flags : (flags >> 4);
+	}
+
+	stream_get_mark(s, endMark);
+	stream_set_mark(s, cbDataMark);
+	stream_write_uint16(s, endMark - zeroBits);
+	stream_set_mark(s, endMark);
+}
+
+static void update_write_delta_points(STREAM* s, DELTA_POINT* points, int number)
+{
+	int i;
+	uint8 flags;
+	uint8* zeroBits;
+	uint8* cbDataMark;
+	uint8* endMark;
+
+	stream_check_size(s, 1 + (number + 3) / 4 + number * 4);
+
+	stream_get_mark(s, cbDataMark);
+	stream_seek_uint8(s); /* cbData (1 byte) */
+
+	stream_get_mark(s, zeroBits);
+	stream_write_zero(s, (number + 3) / 4);
+
+	for (i = 0; i < number; i++)
+	{
+		flags = 0;
+
+		if (points[i].x == 0)
+			flags |= 0x80;
+		else
+			update_write_delta(s, points[i].x);
+
+		if (points[i].y == 0)
+			flags |= 0x40;
+		else
+			update_write_delta(s, points[i].y);
+
+		zeroBits[i / 4] |= (flags >> ((i % 4) * 2));
+	}
+
+	stream_get_mark(s, endMark);
+	stream_set_mark(s, cbDataMark);
+	stream_write_uint8(s, endMark - zeroBits);
+	stream_set_mark(s, endMark);
+}
+
+static INLINE int update_delta_size(sint32 value)
+{
+	if (value == 0)
+		return 0;
+
+	return (value >= -64 && value <= 63) ? 1 : 2;
+}
+
+/**
+ * Number of points from the start of the list a single polyline order can
+ * take, both numPoints and cbData being one byte.
+ */
+
+int update_polyline_points_fit(DELTA_POINT* points, int number)
+{
+	int i;
+	int size;
+
+	size = 0;
+
+	for (i = 0; i < MIN(number, 0xFF); i++)
+	{
+		size += update_delta_size(points[i].x) + update_delta_size(points[i].y);
+
+		if ((i + 4) / 4 + size > 0xFF)
+			break;
+	}
+
+	return i;
+}
+
+static void update_write_raw_data(STREAM* s, uint8* data, uint32 length)
+{
+	stream_write_uint8(s, length);
+
+	if (length > 0)
+		stream_write(s, data, length);
+}
+
+static void update_compare_dstblt_order(ORDER_INFO* orderInfo, DSTBLT_ORDER* dstblt, DSTBLT_ORDER* last)
+{
+	update_compare_coord(orderInfo, ORDER_FIELD_01, dstblt->nLeftRect, last->nLeftRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_02, dstblt->nTopRect, last->nTopRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_03, dstblt->nWidth, last->nWidth);
+	update_compare_coord(orderInfo, ORDER_FIELD_04, dstblt->nHeight, last->nHeight);
+	update_compare_field(orderInfo, ORDER_FIELD_05, dstblt->bRop, last->bRop);
+}
+
+static void update_write_dstblt_order(STREAM* s, ORDER_INFO* orderInfo, DSTBLT_ORDER* dstblt, DSTBLT_ORDER* last)
+{
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		update_write_coord(s, dstblt->nLeftRect, last->nLeftRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, dstblt->nTopRect, last->nTopRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		update_write_coord(s, dstblt->nWidth, last->nWidth, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		update_write_coord(s, dstblt->nHeight, last->nHeight, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		stream_write_uint8(s, dstblt->bRop);
+
+	*last = *dstblt;
+}
+
+static void update_compare_patblt_order(ORDER_INFO* orderInfo, PATBLT_ORDER* patblt, PATBLT_ORDER* last)
+{
+	update_compare_coord(orderInfo, ORDER_FIELD_01, patblt->nLeftRect, last->nLeftRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_02, patblt->nTopRect, last->nTopRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_03, patblt->nWidth, last->nWidth);
+	update_compare_coord(orderInfo, ORDER_FIELD_04, patblt->nHeight, last->nHeight);
+	update_compare_field(orderInfo, ORDER_FIELD_05, patblt->bRop, last->bRop);
+	update_compare_field(orderInfo, ORDER_FIELD_06, patblt->backColor, last->backColor);
+	update_compare_field(orderInfo, ORDER_FIELD_07, patblt->foreColor, last->foreColor);
+	update_compare_brush(orderInfo, 7, &patblt->brush, &last->brush);
+}
+
+static void update_write_patblt_order(STREAM* s, ORDER_INFO* orderInfo, PATBLT_ORDER* patblt, PATBLT_ORDER* last)
+{
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		update_write_coord(s, patblt->nLeftRect, last->nLeftRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, patblt->nTopRect, last->nTopRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		update_write_coord(s, patblt->nWidth, last->nWidth, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		update_write_coord(s, patblt->nHeight, last->nHeight, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		stream_write_uint8(s, patblt->bRop);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		update_write_color(s, patblt->backColor);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_07)
+		update_write_color(s, patblt->foreColor);
+
+	update_write_brush(s, &patblt->brush, orderInfo->fieldFlags >> 7);
+
+	*last = *patblt;
+	update_save_brush(&last->brush, &patblt->brush);
+}
+
+static void update_compare_scrblt_order(ORDER_INFO* orderInfo, SCRBLT_ORDER* scrblt, SCRBLT_ORDER* last)
+{
+	update_compare_coord(orderInfo, ORDER_FIELD_01, scrblt->nLeftRect, last->nLeftRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_02, scrblt->nTopRect, last->nTopRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_03, scrblt->nWidth, last->nWidth);
+	update_compare_coord(orderInfo, ORDER_FIELD_04, scrblt->nHeight, last->nHeight);
+	update_compare_field(orderInfo, ORDER_FIELD_05, scrblt->bRop, last->bRop);
+	update_compare_coord(orderInfo, ORDER_FIELD_06, scrblt->nXSrc, last->nXSrc);
+	update_compare_coord(orderInfo, ORDER_FIELD_07, scrblt->nYSrc, last->nYSrc);
+}
+
+static void update_write_scrblt_order(STREAM* s, ORDER_INFO* orderInfo, SCRBLT_ORDER* scrblt, SCRBLT_ORDER* last)
+{
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		update_write_coord(s, scrblt->nLeftRect, last->nLeftRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, scrblt->nTopRect, last->nTopRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		update_write_coord(s, scrblt->nWidth, last->nWidth, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		update_write_coord(s, scrblt->nHeight, last->nHeight, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		stream_write_uint8(s, scrblt->bRop);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		update_write_coord(s, scrblt->nXSrc, last->nXSrc, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_07)
+		update_write_coord(s, scrblt->nYSrc, last->nYSrc, orderInfo->deltaCoordinates);
+
+	*last = *scrblt;
+}
+
+static void update_compare_opaque_rect_order(ORDER_INFO* orderInfo, OPAQUE_RECT_ORDER* opaque_rect, OPAQUE_RECT_ORDER* last)
+{
+	update_compare_coord(orderInfo, ORDER_FIELD_01, opaque_rect->nLeftRect, last->nLeftRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_02, opaque_rect->nTopRect, last->nTopRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_03, opaque_rect->nWidth, last->nWidth);
+	update_compare_coord(orderInfo, ORDER_FIELD_04, opaque_rect->nHeight, last->nHeight);
+	update_compare_field(orderInfo, ORDER_FIELD_05, opaque_rect->color & 0xFF, last->color & 0xFF);
+	update_compare_field(orderInfo, ORDER_FIELD_06, (opaque_rect->color >> 8) & 0xFF, (last->color >> 8) & 0xFF);
+	update_compare_field(orderInfo, ORDER_FIELD_07, (opaque_rect->color >> 16) & 0xFF, (last->color >> 16) & 0xFF);
+}
+
+static void update_write_opaque_rect_order(STREAM* s, ORDER_INFO* orderInfo, OPAQUE_RECT_ORDER* opaque_rect, OPAQUE_RECT_ORDER* last)
+{
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		update_write_coord(s, opaque_rect->nLeftRect, last->nLeftRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, opaque_rect->nTopRect, last->nTopRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		update_write_coord(s, opaque_rect->nWidth, last->nWidth, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		update_write_coord(s, opaque_rect->nHeight, last->nHeight, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		stream_write_uint8(s, opaque_rect->color & 0xFF);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		stream_write_uint8(s, (opaque_rect->color >> 8) & 0xFF);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_07)
+		stream_write_uint8(s, (opaque_rect->color >> 16) & 0xFF);
+
+	*last = *opaque_rect;
+}
+
+static void update_compare_draw_nine_grid_order(ORDER_INFO* orderInfo, DRAW_NINE_GRID_ORDER* draw_nine_grid, DRAW_NINE_GRID_ORDER* last)
+{
+	update_compare_coord(orderInfo, ORDER_FIELD_01, draw_nine_grid->srcLeft, last->srcLeft);
+	update_compare_coord(orderInfo, ORDER_FIELD_02, draw_nine_grid->srcTop, last->srcTop);
+	update_compare_coord(orderInfo, ORDER_FIELD_03, draw_nine_grid->srcRight, last->srcRight);
+	update_compare_coord(orderInfo, ORDER_FIELD_04, draw_nine_grid->srcBottom, last->srcBottom);
+	update_compare_field(orderInfo, ORDER_FIELD_05, draw_nine_grid->bitmapId, last->bitmapId);
+}
+
+static void update_write_draw_nine_grid_order(STREAM* s, ORDER_INFO* orderInfo, DRAW_NINE_GRID_ORDER* draw_nine_grid, DRAW_NINE_GRID_ORDER* last)
+{
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		update_write_coord(s, draw_nine_grid->srcLeft, last->srcLeft, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, draw_nine_grid->srcTop, last->srcTop, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		update_write_coord(s, draw_nine_grid->srcRight, last->srcRight, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		update_write_coord(s, draw_nine_grid->srcBottom, last->srcBottom, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		stream_write_uint16(s, draw_nine_grid->bitmapId);
+
+	*last = *draw_nine_grid;
+}
+
+static void update_compare_multi_dstblt_order(ORDER_INFO* orderInfo, MULTI_DSTBLT_ORDER* multi_dstblt, MULTI_DSTBLT_ORDER* last)
+{
+	update_compare_coord(orderInfo, ORDER_FIELD_01, multi_dstblt->nLeftRect, last->nLeftRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_02, multi_dstblt->nTopRect, last->nTopRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_03, multi_dstblt->nWidth, last->nWidth);
+	update_compare_coord(orderInfo, ORDER_FIELD_04, multi_dstblt->nHeight, last->nHeight);
+	update_compare_field(orderInfo, ORDER_FIELD_05, multi_dstblt->bRop, last->bRop);
+	update_compare_delta_rects(orderInfo, ORDER_FIELD_06, ORDER_FIELD_07,
+			multi_dstblt->numRectangles, multi_dstblt->rectangles, last->numRectangles, last->rectangles);
+}
+
+static void update_write_multi_dstblt_order(STREAM* s, ORDER_INFO* orderInfo, MULTI_DSTBLT_ORDER* multi_dstblt, MULTI_DSTBLT_ORDER* last)
+{
+	int numRectangles = update_delta_rects_number(multi_dstblt->numRectangles);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		update_write_coord(s, multi_dstblt->nLeftRect, last->nLeftRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, multi_dstblt->nTopRect, last->nTopRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		update_write_coord(s, multi_dstblt->nWidth, last->nWidth, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		update_write_coord(s, multi_dstblt->nHeight, last->nHeight, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		stream_write_uint8(s, multi_dstblt->bRop);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		stream_write_uint8(s, numRectangles);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_07)
+		update_write_delta_rects(s, multi_dstblt->rectangles, numRectangles);
+
+	*last = *multi_dstblt;
+}
+
+static void update_compare_multi_patblt_order(ORDER_INFO* orderInfo, MULTI_PATBLT_ORDER* multi_patblt, MULTI_PATBLT_ORDER* last)
+{
+	update_compare_coord(orderInfo, ORDER_FIELD_01, multi_patblt->nLeftRect, last->nLeftRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_02, multi_patblt->nTopRect, last->nTopRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_03, multi_patblt->nWidth, last->nWidth);
+	update_compare_coord(orderInfo, ORDER_FIELD_04, multi_patblt->nHeight, last->nHeight);
+	update_compare_field(orderInfo, ORDER_FIELD_05, multi_patblt->bRop, last->bRop);
+	update_compare_field(orderInfo, ORDER_FIELD_06, multi_patblt->backColor, last->backColor);
+	update_compare_field(orderInfo, ORDER_FIELD_07, multi_patblt->foreColor, last->foreColor);
+	update_compare_brush(orderInfo, 7, &multi_patblt->brush, &last->brush);
+	update_compare_delta_rects(orderInfo, ORDER_FIELD_13, ORDER_FIELD_14,
+			multi_patblt->numRectangles, multi_patblt->rectangles, last->numRectangles, last->rectangles);
+}
+
+static void update_write_multi_patblt_order(STREAM* s, ORDER_INFO* orderInfo, MULTI_PATBLT_ORDER* multi_patblt, MULTI_PATBLT_ORDER* last)
+{
+	int numRectangles = update_delta_rects_number(multi_patblt->numRectangles);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		update_write_coord(s, multi_patblt->nLeftRect, last->nLeftRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, multi_patblt->nTopRect, last->nTopRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		update_write_coord(s, multi_patblt->nWidth, last->nWidth, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		update_write_coord(s, multi_patblt->nHeight, last->nHeight, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		stream_write_uint8(s, multi_patblt->bRop);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		update_write_color(s, multi_patblt->backColor);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_07)
+		update_write_color(s, multi_patblt->foreColor);
+
+	update_write_brush(s, &multi_patblt->brush, orderInfo->fieldFlags >> 7);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_13)
+		stream_write_uint8(s, numRectangles);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_14)
+		update_write_delta_rects(s, multi_patblt->rectangles, numRectangles);
+
+	*last = *multi_patblt;
+	update_save_brush(&last->brush, &multi_patblt->brush);
+}
+
+static void update_compare_multi_scrblt_order(ORDER_INFO* orderInfo, MULTI_SCRBLT_ORDER* multi_scrblt, MULTI_SCRBLT_ORDER* last)
+{
+	update_compare_coord(orderInfo, ORDER_FIELD_01, multi_scrblt->nLeftRect, last->nLeftRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_02, multi_scrblt->nTopRect, last->nTopRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_03, multi_scrblt->nWidth, last->nWidth);
+	update_compare_coord(orderInfo, ORDER_FIELD_04, multi_scrblt->nHeight, last->nHeight);
+	update_compare_field(orderInfo, ORDER_FIELD_05, multi_scrblt->bRop, last->bRop);
+	update_compare_coord(orderInfo, ORDER_FIELD_06, multi_scrblt->nXSrc, last->nXSrc);
+	update_compare_coord(orderInfo, ORDER_FIELD_07, multi_scrblt->nYSrc, last->nYSrc);
+	update_compare_delta_rects(orderInfo, ORDER_FIELD_08, ORDER_FIELD_09,
+			multi_scrblt->numRectangles, multi_scrblt->rectangles, last->numRectangles, last->rectangles);
+}
+
+static void update_write_multi_scrblt_order(STREAM* s, ORDER_INFO* orderInfo, MULTI_SCRBLT_ORDER* multi_scrblt, MULTI_SCRBLT_ORDER* last)
+{
+	int numRectangles = update_delta_rects_number(multi_scrblt->numRectangles);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		update_write_coord(s, multi_scrblt->nLeftRect, last->nLeftRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, multi_scrblt->nTopRect, last->nTopRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		update_write_coord(s, multi_scrblt->nWidth, last->nWidth, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		update_write_coord(s, multi_scrblt->nHeight, last->nHeight, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		stream_write_uint8(s, multi_scrblt->bRop);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		update_write_coord(s, multi_scrblt->nXSrc, last->nXSrc, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_07)
+		update_write_coord(s, multi_scrblt->nYSrc, last->nYSrc, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_08)
+		stream_write_uint8(s, numRectangles);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_09)
+		update_write_delta_rects(s, multi_scrblt->rectangles, numRectangles);
+
+	*last = *multi_scrblt;
+}
+
+static void update_compare_multi_opaque_rect_order(ORDER_INFO* orderInfo, MULTI_OPAQUE_RECT_ORDER* multi_opaque_rect, MULTI_OPAQUE_RECT_ORDER* last)
+{
+	update_compare_coord(orderInfo, ORDER_FIELD_01, multi_opaque_rect->nLeftRect, last->nLeftRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_02, multi_opaque_rect->nTopRect, last->nTopRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_03, multi_opaque_rect->nWidth, last->nWidth);
+	update_compare_coord(orderInfo, ORDER_FIELD_04, multi_opaque_rect->nHeight, last->nHeight);
+	update_compare_field(orderInfo, ORDER_FIELD_05, multi_opaque_rect->color & 0xFF, last->color & 0xFF);
+	update_compare_field(orderInfo, ORDER_FIELD_06, (multi_opaque_rect->color >> 8) & 0xFF, (last->color >> 8) & 0xFF);
+	update_compare_field(orderInfo, ORDER_FIELD_07, (multi_opaque_rect->color >> 16) & 0xFF, (last->color >> 16) & 0xFF);
+	update_compare_delta_rects(orderInfo, ORDER_FIELD_08, ORDER_FIELD_09,
+			multi_opaque_rect->numRectangles, multi_opaque_rect->rectangles, last->numRectangles, last->rectangles);
+}
+
+static void update_write_multi_opaque_rect_order(STREAM* s, ORDER_INFO* orderInfo, MULTI_OPAQUE_RECT_ORDER* multi_opaque_rect, MULTI_OPAQUE_RECT_ORDER* last)
+{
+	int numRectangles = update_delta_rects_number(multi_opaque_rect->numRectangles);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		update_write_coord(s, multi_opaque_rect->nLeftRect, last->nLeftRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, multi_opaque_rect->nTopRect, last->nTopRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		update_write_coord(s, multi_opaque_rect->nWidth, last->nWidth, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		update_write_coord(s, multi_opaque_rect->nHeight, last->nHeight, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		stream_write_uint8(s, multi_opaque_rect->color & 0xFF);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		stream_write_uint8(s, (multi_opaque_rect->color >> 8) & 0xFF);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_07)
+		stream_write_uint8(s, (multi_opaque_rect->color >> 16) & 0xFF);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_08)
+		stream_write_uint8(s, numRectangles);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_09)
+		update_write_delta_rects(s, multi_opaque_rect->rectangles, numRectangles);
+
+	*last = *multi_opaque_rect;
+}
+
+static void update_compare_multi_draw_nine_grid_order(ORDER_INFO* orderInfo, MULTI_DRAW_NINE_GRID_ORDER* multi_draw_nine_grid, MULTI_DRAW_NINE_GRID_ORDER* last)
+{
+	update_compare_coord(orderInfo, ORDER_FIELD_01, multi_draw_nine_grid->srcLeft, last->srcLeft);
+	update_compare_coord(orderInfo, ORDER_FIELD_02, multi_draw_nine_grid->srcTop, last->srcTop);
+	update_compare_coord(orderInfo, ORDER_FIELD_03, multi_draw_nine_grid->srcRight, last->srcRight);
+	update_compare_coord(orderInfo, ORDER_FIELD_04, multi_draw_nine_grid->srcBottom, last->srcBottom);
+	update_compare_field(orderInfo, ORDER_FIELD_05, multi_draw_nine_grid->bitmapId, last->bitmapId);
+	update_compare_field(orderInfo, ORDER_FIELD_06, multi_draw_nine_grid->nDeltaEntries, last->nDeltaEntries);
+
+	if (multi_draw_nine_grid->cbData > 0)
+		orderInfo->fieldFlags |= ORDER_FIELD_07;
+}
+
+static void update_write_multi_draw_nine_grid_order(STREAM* s, ORDER_INFO* orderInfo, MULTI_DRAW_NINE_GRID_ORDER* multi_draw_nine_grid, MULTI_DRAW_NINE_GRID_ORDER* last)
+{
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		update_write_coord(s, multi_draw_nine_grid->srcLeft, last->srcLeft, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, multi_draw_nine_grid->srcTop, last->srcTop, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		update_write_coord(s, multi_draw_nine_grid->srcRight, last->srcRight, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		update_write_coord(s, multi_draw_nine_grid->srcBottom, last->srcBottom, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		stream_write_uint16(s, multi_draw_nine_grid->bitmapId);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		stream_write_uint8(s, multi_draw_nine_grid->nDeltaEntries);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_07)
+	{
+		stream_check_size(s, 2 + multi_draw_nine_grid->cbData);
+		stream_write_uint16(s, multi_draw_nine_grid->cbData);
+		stream_write(s, multi_draw_nine_grid->codeDeltaList, multi_draw_nine_grid->cbData);
+	}
+
+	*last = *multi_draw_nine_grid;
+	last->codeDeltaList = NULL;
+}
+
+static void update_compare_line_to_order(ORDER_INFO* orderInfo, LINE_TO_ORDER* line_to, LINE_TO_ORDER* last)
+{
+	update_compare_field(orderInfo, ORDER_FIELD_01, line_to->backMode, last->backMode);
+	update_compare_coord(orderInfo, ORDER_FIELD_02, line_to->nXStart, last->nXStart);
+	update_compare_coord(orderInfo, ORDER_FIELD_03, line_to->nYStart, last->nYStart);
+	update_compare_coord(orderInfo, ORDER_FIELD_04, line_to->nXEnd, last->nXEnd);
+	update_compare_coord(orderInfo, ORDER_FIELD_05, line_to->nYEnd, last->nYEnd);
+	update_compare_field(orderInfo, ORDER_FIELD_06, line_to->backColor, last->backColor);
+	update_compare_field(orderInfo, ORDER_FIELD_07, line_to->bRop2, last->bRop2);
+	update_compare_field(orderInfo, ORDER_FIELD_08, line_to->penStyle, last->penStyle);
+	update_compare_field(orderInfo, ORDER_FIELD_09, line_to->penWidth, last->penWidth);
+	update_compare_field(orderInfo, ORDER_FIELD_10, line_to->penColor, last->penColor);
+}
+
+static void update_write_line_to_order(STREAM* s, ORDER_INFO* orderInfo, LINE_TO_ORDER* line_to, LINE_TO_ORDER* last)
+{
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		stream_write_uint16(s, line_to->backMode);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, line_to->nXStart, last->nXStart, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		update_write_coord(s, line_to->nYStart, last->nYStart, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		update_write_coord(s, line_to->nXEnd, last->nXEnd, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		update_write_coord(s, line_to->nYEnd, last->nYEnd, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		update_write_color(s, line_to->backColor);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_07)
+		stream_write_uint8(s, line_to->bRop2);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_08)
+		stream_write_uint8(s, line_to->penStyle);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_09)
+		stream_write_uint8(s, line_to->penWidth);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_10)
+		update_write_color(s, line_to->penColor);
+
+	*last = *line_to;
+}
+
+static void update_compare_polyline_order(ORDER_INFO* orderInfo, POLYLINE_ORDER* polyline, POLYLINE_ORDER* last)
+{
+	update_compare_coord(orderInfo, ORDER_FIELD_01, polyline->xStart, last->xStart);
+	update_compare_coord(orderInfo, ORDER_FIELD_02, polyline->yStart, last->yStart);
+	update_compare_field(orderInfo, ORDER_FIELD_03, polyline->bRop2, last->bRop2);
+	update_compare_field(orderInfo, ORDER_FIELD_05, polyline->penColor, last->penColor);
+	update_compare_field(orderInfo, ORDER_FIELD_06, polyline->numPoints, last->numPoints);
+
+	/* the points are not kept, always send them */
+	if (polyline->numPoints > 0)
+		orderInfo->fieldFlags |= ORDER_FIELD_07;
+}
+
+static void update_write_polyline_order(STREAM* s, ORDER_INFO* orderInfo, POLYLINE_ORDER* polyline, POLYLINE_ORDER* last)
+{
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		update_write_coord(s, polyline->xStart, last->xStart, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, polyline->yStart, last->yStart, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		stream_write_uint8(s, polyline->bRop2);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		update_write_color(s, polyline->penColor);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		stream_write_uint8(s, polyline->numPoints);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_07)
+		update_write_delta_points(s, polyline->points, polyline->numPoints);
+
+	*last = *polyline;
+	last->points = NULL;
+}
+
+/* colorIndex is taken from the cacheId field each time an order is read, so it has to be resent */
+static INLINE uint32 update_memblt_cache_id(uint32 cacheId, uint32 colorIndex)
+{
+	return (colorIndex << 8) | (cacheId & 0xFF);
+}
+
+static void update_compare_memblt_order(ORDER_INFO* orderInfo, MEMBLT_ORDER* memblt, MEMBLT_ORDER* last)
+{
+	update_compare_field(orderInfo, ORDER_FIELD_01, update_memblt_cache_id(memblt->cacheId, memblt->colorIndex),
+			update_memblt_cache_id(last->cacheId, last->colorIndex));
+	update_compare_coord(orderInfo, ORDER_FIELD_02, memblt->nLeftRect, last->nLeftRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_03, memblt->nTopRect, last->nTopRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_04, memblt->nWidth, last->nWidth);
+	update_compare_coord(orderInfo, ORDER_FIELD_05, memblt->nHeight, last->nHeight);
+	update_compare_field(orderInfo, ORDER_FIELD_06, memblt->bRop, last->bRop);
+	update_compare_coord(orderInfo, ORDER_FIELD_07, memblt->nXSrc, last->nXSrc);
+	update_compare_coord(orderInfo, ORDER_FIELD_08, memblt->nYSrc, last->nYSrc);
+	update_compare_field(orderInfo, ORDER_FIELD_09, memblt->cacheIndex, last->cacheIndex);
+
+	if (memblt->colorIndex != 0)
+		orderInfo->fieldFlags |= ORDER_FIELD_01;
+}
+
+static void update_write_memblt_order(STREAM* s, ORDER_INFO* orderInfo, MEMBLT_ORDER* memblt, MEMBLT_ORDER* last)
+{
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		stream_write_uint16(s, update_memblt_cache_id(memblt->cacheId, memblt->colorIndex));
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, memblt->nLeftRect, last->nLeftRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		update_write_coord(s, memblt->nTopRect, last->nTopRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		update_write_coord(s, memblt->nWidth, last->nWidth, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		update_write_coord(s, memblt->nHeight, last->nHeight, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		stream_write_uint8(s, memblt->bRop);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_07)
+		update_write_coord(s, memblt->nXSrc, last->nXSrc, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_08)
+		update_write_coord(s, memblt->nYSrc, last->nYSrc, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_09)
+		stream_write_uint16(s, memblt->cacheIndex);
+
+	*last = *memblt;
+}
+
+static void update_compare_mem3blt_order(ORDER_INFO* orderInfo, MEM3BLT_ORDER* mem3blt, MEM3BLT_ORDER* last)
+{
+	update_compare_field(orderInfo, ORDER_FIELD_01, update_memblt_cache_id(mem3blt->cacheId, mem3blt->colorIndex),
+			update_memblt_cache_id(last->cacheId, last->colorIndex));
+	update_compare_coord(orderInfo, ORDER_FIELD_02, mem3blt->nLeftRect, last->nLeftRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_03, mem3blt->nTopRect, last->nTopRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_04, mem3blt->nWidth, last->nWidth);
+	update_compare_coord(orderInfo, ORDER_FIELD_05, mem3blt->nHeight, last->nHeight);
+	update_compare_field(orderInfo, ORDER_FIELD_06, mem3blt->bRop, last->bRop);
+	update_compare_coord(orderInfo, ORDER_FIELD_07, mem3blt->nXSrc, last->nXSrc);
+	update_compare_coord(orderInfo, ORDER_FIELD_08, mem3blt->nYSrc, last->nYSrc);
+	update_compare_field(orderInfo, ORDER_FIELD_09, mem3blt->backColor, last->backColor);
+	update_compare_field(orderInfo, ORDER_FIELD_10, mem3blt->foreColor, last->foreColor);
+	update_compare_brush(orderInfo, 10, &mem3blt->brush, &last->brush);
+	update_compare_field(orderInfo, ORDER_FIELD_16, mem3blt->cacheIndex, last->cacheIndex);
+
+	if (mem3blt->colorIndex != 0)
+		orderInfo->fieldFlags |= ORDER_FIELD_01;
+}
+
+static void update_write_mem3blt_order(STREAM* s, ORDER_INFO* orderInfo, MEM3BLT_ORDER* mem3blt, MEM3BLT_ORDER* last)
+{
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		stream_write_uint16(s, update_memblt_cache_id(mem3blt->cacheId, mem3blt->colorIndex));
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, mem3blt->nLeftRect, last->nLeftRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		update_write_coord(s, mem3blt->nTopRect, last->nTopRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		update_write_coord(s, mem3blt->nWidth, last->nWidth, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		update_write_coord(s, mem3blt->nHeight, last->nHeight, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		stream_write_uint8(s, mem3blt->bRop);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_07)
+		update_write_coord(s, mem3blt->nXSrc, last->nXSrc, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_08)
+		update_write_coord(s, mem3blt->nYSrc, last->nYSrc, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_09)
+		update_write_color(s, mem3blt->backColor);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_10)
+		update_write_color(s, mem3blt->foreColor);
+
+	update_write_brush(s, &mem3blt->brush, orderInfo->fieldFlags >> 10);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_16)
+		stream_write_uint16(s, mem3blt->cacheIndex);
+
+	*last = *mem3blt;
+	update_save_brush(&last->brush, &mem3blt->brush);
+}
+
+static void update_compare_save_bitmap_order(ORDER_INFO* orderInfo, SAVE_BITMAP_ORDER* save_bitmap, SAVE_BITMAP_ORDER* last)
+{
+	update_compare_field(orderInfo, ORDER_FIELD_01, save_bitmap->savedBitmapPosition, last->savedBitmapPosition);
+	update_compare_coord(orderInfo, ORDER_FIELD_02, save_bitmap->nLeftRect, last->nLeftRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_03, save_bitmap->nTopRect, last->nTopRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_04, save_bitmap->nRightRect, last->nRightRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_05, save_bitmap->nBottomRect, last->nBottomRect);
+	update_compare_field(orderInfo, ORDER_FIELD_06, save_bitmap->operation, last->operation);
+}
+
+static void update_write_save_bitmap_order(STREAM* s, ORDER_INFO* orderInfo, SAVE_BITMAP_ORDER* save_bitmap, SAVE_BITMAP_ORDER* last)
+{
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		stream_write_uint32(s, save_bitmap->savedBitmapPosition);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, save_bitmap->nLeftRect, last->nLeftRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		update_write_coord(s, save_bitmap->nTopRect, last->nTopRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		update_write_coord(s, save_bitmap->nRightRect, last->nRightRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		update_write_coord(s, save_bitmap->nBottomRect, last->nBottomRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		stream_write_uint8(s, save_bitmap->operation);
+
+	*last = *save_bitmap;
+}
+
+static void update_compare_glyph_index_order(ORDER_INFO* orderInfo, GLYPH_INDEX_ORDER* glyph_index, GLYPH_INDEX_ORDER* last)
+{
+	update_compare_field(orderInfo, ORDER_FIELD_01, glyph_index->cacheId, last->cacheId);
+	update_compare_field(orderInfo, ORDER_FIELD_02, glyph_index->flAccel, last->flAccel);
+	update_compare_field(orderInfo, ORDER_FIELD_03, glyph_index->ulCharInc, last->ulCharInc);
+	update_compare_field(orderInfo, ORDER_FIELD_04, glyph_index->fOpRedundant, last->fOpRedundant);
+	update_compare_field(orderInfo, ORDER_FIELD_05, glyph_index->backColor, last->backColor);
+	update_compare_field(orderInfo, ORDER_FIELD_06, glyph_index->foreColor, last->foreColor);
+	update_compare_field(orderInfo, ORDER_FIELD_07, glyph_index->bkLeft, last->bkLeft);
+	update_compare_field(orderInfo, ORDER_FIELD_08, glyph_index->bkTop, last->bkTop);
+	update_compare_field(orderInfo, ORDER_FIELD_09, glyph_index->bkRight, last->bkRight);
+	update_compare_field(orderInfo, ORDER_FIELD_10, glyph_index->bkBottom, last->bkBottom);
+	update_compare_field(orderInfo, ORDER_FIELD_11, glyph_index->opLeft, last->opLeft);
+	update_compare_field(orderInfo, ORDER_FIELD_12, glyph_index->opTop, last->opTop);
+	update_compare_field(orderInfo, ORDER_FIELD_13, glyph_index->opRight, last->opRight);
+	update_compare_field(orderInfo, ORDER_FIELD_14, glyph_index->opBottom, last->opBottom);
+	update_compare_brush(orderInfo, 14, &glyph_index->brush, &last->brush);
+	update_compare_field(orderInfo, ORDER_FIELD_20, glyph_index->x, last->x);
+	update_compare_field(orderInfo, ORDER_FIELD_21, glyph_index->y, last->y);
+
+	if (glyph_index->cbData != last->cbData || memcmp(glyph_index->data, last->data, glyph_index->cbData) != 0)
+		orderInfo->fieldFlags |= ORDER_FIELD_22;
+}
+
+static void update_write_glyph_index_order(STREAM* s, ORDER_INFO* orderInfo, GLYPH_INDEX_ORDER* glyph_index, GLYPH_INDEX_ORDER* last)
+{
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		stream_write_uint8(s, glyph_index->cacheId);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		stream_write_uint8(s, glyph_index->flAccel);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		stream_write_uint8(s, glyph_index->ulCharInc);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		stream_write_uint8(s, glyph_index->fOpRedundant);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		update_write_color(s, glyph_index->backColor);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		update_write_color(s, glyph_index->foreColor);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_07)
+		stream_write_uint16(s, glyph_index->bkLeft);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_08)
+		stream_write_uint16(s, glyph_index->bkTop);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_09)
+		stream_write_uint16(s, glyph_index->bkRight);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_10)
+		stream_write_uint16(s, glyph_index->bkBottom);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_11)
+		stream_write_uint16(s, glyph_index->opLeft);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_12)
+		stream_write_uint16(s, glyph_index->opTop);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_13)
+		stream_write_uint16(s, glyph_index->opRight);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_14)
+		stream_write_uint16(s, glyph_index->opBottom);
+
+	update_write_brush(s, &glyph_index->brush, orderInfo->fieldFlags >> 14);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_20)
+		stream_write_uint16(s, glyph_index->x);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_21)
+		stream_write_uint16(s, glyph_index->y);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_22)
+		update_write_raw_data(s, glyph_index->data, glyph_index->cbData);
+
+	*last = *glyph_index;
+	update_save_brush(&last->brush, &glyph_index->brush);
+}
+
+static void update_compare_fast_index_order(ORDER_INFO* orderInfo, FAST_INDEX_ORDER* fast_index, FAST_INDEX_ORDER* last)
+{
+	update_compare_field(orderInfo, ORDER_FIELD_01, fast_index->cacheId, last->cacheId);
+	update_compare_field(orderInfo, ORDER_FIELD_02, fast_index->ulCharInc, last->ulCharInc);
+	update_compare_field(orderInfo, ORDER_FIELD_02, fast_index->flAccel, last->flAccel);
+	update_compare_field(orderInfo, ORDER_FIELD_03, fast_index->backColor, last->backColor);
+	update_compare_field(orderInfo, ORDER_FIELD_04, fast_index->foreColor, last->foreColor);
+	update_compare_coord(orderInfo, ORDER_FIELD_05, fast_index->bkLeft, last->bkLeft);
+	update_compare_coord(orderInfo, ORDER_FIELD_06, fast_index->bkTop, last->bkTop);
+	update_compare_coord(orderInfo, ORDER_FIELD_07, fast_index->bkRight, last->bkRight);
+	update_compare_coord(orderInfo, ORDER_FIELD_08, fast_index->bkBottom, last->bkBottom);
+	update_compare_coord(orderInfo, ORDER_FIELD_09, fast_index->opLeft, last->opLeft);
+	update_compare_coord(orderInfo, ORDER_FIELD_10, fast_index->opTop, last->opTop);
+	update_compare_coord(orderInfo, ORDER_FIELD_11, fast_index->opRight, last->opRight);
+	update_compare_coord(orderInfo, ORDER_FIELD_12, fast_index->opBottom, last->opBottom);
+	update_compare_coord(orderInfo, ORDER_FIELD_13, fast_index->x, last->x);
+	update_compare_coord(orderInfo, ORDER_FIELD_14, fast_index->y, last->y);
+
+	if (fast_index->cbData != last->cbData || memcmp(fast_index->data, last->data, fast_index->cbData) != 0)
+		orderInfo->fieldFlags |= ORDER_FIELD_15;
+}
+
+static void update_write_fast_index_order(STREAM* s, ORDER_INFO* orderInfo, FAST_INDEX_ORDER* fast_index, FAST_INDEX_ORDER* last)
+{
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		stream_write_uint8(s, fast_index->cacheId);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+	{
+		stream_write_uint8(s, fast_index->ulCharInc);
+		stream_write_uint8(s, fast_index->flAccel);
+	}
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		update_write_color(s, fast_index->backColor);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		update_write_color(s, fast_index->foreColor);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		update_write_coord(s, fast_index->bkLeft, last->bkLeft, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		update_write_coord(s, fast_index->bkTop, last->bkTop, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_07)
+		update_write_coord(s, fast_index->bkRight, last->bkRight, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_08)
+		update_write_coord(s, fast_index->bkBottom, last->bkBottom, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_09)
+		update_write_coord(s, fast_index->opLeft, last->opLeft, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_10)
+		update_write_coord(s, fast_index->opTop, last->opTop, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_11)
+		update_write_coord(s, fast_index->opRight, last->opRight, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_12)
+		update_write_coord(s, fast_index->opBottom, last->opBottom, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_13)
+		update_write_coord(s, fast_index->x, last->x, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_14)
+		update_write_coord(s, fast_index->y, last->y, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_15)
+		update_write_raw_data(s, fast_index->data, fast_index->cbData);
+
+	*last = *fast_index;
+}
+
+static void update_compare_fast_glyph_order(ORDER_INFO* orderInfo, FAST_GLYPH_ORDER* fast_glyph, FAST_GLYPH_ORDER* last)
+{
+	update_compare_field(orderInfo, ORDER_FIELD_01, fast_glyph->cacheId, last->cacheId);
+	update_compare_field(orderInfo, ORDER_FIELD_02, fast_glyph->ulCharInc, last->ulCharInc);
+	update_compare_field(orderInfo, ORDER_FIELD_02, fast_glyph->flAccel, last->flAccel);
+	update_compare_field(orderInfo, ORDER_FIELD_03, fast_glyph->backColor, last->backColor);
+	update_compare_field(orderInfo, ORDER_FIELD_04, fast_glyph->foreColor, last->foreColor);
+	update_compare_coord(orderInfo, ORDER_FIELD_05, fast_glyph->bkLeft, last->bkLeft);
+	update_compare_coord(orderInfo, ORDER_FIELD_06, fast_glyph->bkTop, last->bkTop);
+	update_compare_coord(orderInfo, ORDER_FIELD_07, fast_glyph->bkRight, last->bkRight);
+	update_compare_coord(orderInfo, ORDER_FIELD_08, fast_glyph->bkBottom, last->bkBottom);
+	update_compare_coord(orderInfo, ORDER_FIELD_09, fast_glyph->opLeft, last->opLeft);
+	update_compare_coord(orderInfo, ORDER_FIELD_10, fast_glyph->opTop, last->opTop);
+	update_compare_coord(orderInfo, ORDER_FIELD_11, fast_glyph->opRight, last->opRight);
+	update_compare_coord(orderInfo, ORDER_FIELD_12, fast_glyph->opBottom, last->opBottom);
+	update_compare_coord(orderInfo, ORDER_FIELD_13, fast_glyph->x, last->x);
+	update_compare_coord(orderInfo, ORDER_FIELD_14, fast_glyph->y, last->y);
+
+	if (fast_glyph->cbData != last->cbData || memcmp(fast_glyph->data, last->data, fast_glyph->cbData) != 0)
+		orderInfo->fieldFlags |= ORDER_FIELD_15;
+}
+
+static void update_write_fast_glyph_order(STREAM* s, ORDER_INFO* orderInfo, FAST_GLYPH_ORDER* fast_glyph, FAST_GLYPH_ORDER* last)
+{
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		stream_write_uint8(s, fast_glyph->cacheId);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+	{
+		stream_write_uint8(s, fast_glyph->ulCharInc);
+		stream_write_uint8(s, fast_glyph->flAccel);
+	}
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		update_write_color(s, fast_glyph->backColor);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		update_write_color(s, fast_glyph->foreColor);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		update_write_coord(s, fast_glyph->bkLeft, last->bkLeft, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		update_write_coord(s, fast_glyph->bkTop, last->bkTop, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_07)
+		update_write_coord(s, fast_glyph->bkRight, last->bkRight, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_08)
+		update_write_coord(s, fast_glyph->bkBottom, last->bkBottom, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_09)
+		update_write_coord(s, fast_glyph->opLeft, last->opLeft, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_10)
+		update_write_coord(s, fast_glyph->opTop, last->opTop, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_11)
+		update_write_coord(s, fast_glyph->opRight, last->opRight, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_12)
+		update_write_coord(s, fast_glyph->opBottom, last->opBottom, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_13)
+		update_write_coord(s, fast_glyph->x, last->x, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_14)
+		update_write_coord(s, fast_glyph->y, last->y, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_15)
+		update_write_raw_data(s, fast_glyph->data, fast_glyph->cbData);
+
+	*last = *fast_glyph;
+	last->glyph_data = NULL;
+}
+
+static void update_compare_polygon_sc_order(ORDER_INFO* orderInfo, POLYGON_SC_ORDER* polygon_sc, POLYGON_SC_ORDER* last)
+{
+	update_compare_coord(orderInfo, ORDER_FIELD_01, polygon_sc->xStart, last->xStart);
+	update_compare_coord(orderInfo, ORDER_FIELD_02, polygon_sc->yStart, last->yStart);
+	update_compare_field(orderInfo, ORDER_FIELD_03, polygon_sc->bRop2, last->bRop2);
+	update_compare_field(orderInfo, ORDER_FIELD_04, polygon_sc->fillMode, last->fillMode);
+	update_compare_field(orderInfo, ORDER_FIELD_05, polygon_sc->brushColor, last->brushColor);
+	update_compare_field(orderInfo, ORDER_FIELD_06, polygon_sc->nDeltaEntries, last->nDeltaEntries);
+
+	if (polygon_sc->cbData > 0)
+		orderInfo->fieldFlags |= ORDER_FIELD_07;
+}
+
+static void update_write_polygon_sc_order(STREAM* s, ORDER_INFO* orderInfo, POLYGON_SC_ORDER* polygon_sc, POLYGON_SC_ORDER* last)
+{
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		update_write_coord(s, polygon_sc->xStart, last->xStart, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, polygon_sc->yStart, last->yStart, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		stream_write_uint8(s, polygon_sc->bRop2);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		stream_write_uint8(s, polygon_sc->fillMode);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		update_write_color(s, polygon_sc->brushColor);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		stream_write_uint8(s, polygon_sc->nDeltaEntries);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_07)
+		update_write_raw_data(s, polygon_sc->codeDeltaList, polygon_sc->cbData);
+
+	*last = *polygon_sc;
+	last->codeDeltaList = NULL;
+}
+
+static void update_compare_polygon_cb_order(ORDER_INFO* orderInfo, POLYGON_CB_ORDER* polygon_cb, POLYGON_CB_ORDER* last)
+{
+	update_compare_coord(orderInfo, ORDER_FIELD_01, polygon_cb->xStart, last->xStart);
+	update_compare_coord(orderInfo, ORDER_FIELD_02, polygon_cb->yStart, last->yStart);
+	update_compare_field(orderInfo, ORDER_FIELD_03, polygon_cb->bRop2, last->bRop2);
+	update_compare_field(orderInfo, ORDER_FIELD_04, polygon_cb->fillMode, last->fillMode);
+	update_compare_field(orderInfo, ORDER_FIELD_05, polygon_cb->backColor, last->backColor);
+	update_compare_field(orderInfo, ORDER_FIELD_06, polygon_cb->foreColor, last->foreColor);
+	update_compare_brush(orderInfo, 6, &polygon_cb->brush, &last->brush);
+	update_compare_field(orderInfo, ORDER_FIELD_12, polygon_cb->nDeltaEntries, last->nDeltaEntries);
+
+	if (polygon_cb->cbData > 0)
+		orderInfo->fieldFlags |= ORDER_FIELD_13;
+}
+
+static void update_write_polygon_cb_order(STREAM* s, ORDER_INFO* orderInfo, POLYGON_CB_ORDER* polygon_cb, POLYGON_CB_ORDER* last)
+{
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		update_write_coord(s, polygon_cb->xStart, last->xStart, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, polygon_cb->yStart, last->yStart, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		stream_write_uint8(s, polygon_cb->bRop2);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		stream_write_uint8(s, polygon_cb->fillMode);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		update_write_color(s, polygon_cb->backColor);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		update_write_color(s, polygon_cb->foreColor);
+
+	update_write_brush(s, &polygon_cb->brush, orderInfo->fieldFlags >> 6);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_12)
+		stream_write_uint8(s, polygon_cb->nDeltaEntries);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_13)
+		update_write_raw_data(s, polygon_cb->codeDeltaList, polygon_cb->cbData);
+
+	*last = *polygon_cb;
+	last->codeDeltaList = NULL;
+	update_save_brush(&last->brush, &polygon_cb->brush);
+}
+
+static void update_compare_ellipse_sc_order(ORDER_INFO* orderInfo, ELLIPSE_SC_ORDER* ellipse_sc, ELLIPSE_SC_ORDER* last)
+{
+	update_compare_coord(orderInfo, ORDER_FIELD_01, ellipse_sc->leftRect, last->leftRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_02, ellipse_sc->topRect, last->topRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_03, ellipse_sc->rightRect, last->rightRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_04, ellipse_sc->bottomRect, last->bottomRect);
+	update_compare_field(orderInfo, ORDER_FIELD_05, ellipse_sc->bRop2, last->bRop2);
+	update_compare_field(orderInfo, ORDER_FIELD_06, ellipse_sc->fillMode, last->fillMode);
+	update_compare_field(orderInfo, ORDER_FIELD_07, ellipse_sc->color, last->color);
+}
+
+static void update_write_ellipse_sc_order(STREAM* s, ORDER_INFO* orderInfo, ELLIPSE_SC_ORDER* ellipse_sc, ELLIPSE_SC_ORDER* last)
+{
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		update_write_coord(s, ellipse_sc->leftRect, last->leftRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, ellipse_sc->topRect, last->topRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		update_write_coord(s, ellipse_sc->rightRect, last->rightRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		update_write_coord(s, ellipse_sc->bottomRect, last->bottomRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		stream_write_uint8(s, ellipse_sc->bRop2);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		stream_write_uint8(s, ellipse_sc->fillMode);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_07)
+		update_write_color(s, ellipse_sc->color);
+
+	*last = *ellipse_sc;
+}
+
+static void update_compare_ellipse_cb_order(ORDER_INFO* orderInfo, ELLIPSE_CB_ORDER* ellipse_cb, ELLIPSE_CB_ORDER* last)
+{
+	update_compare_coord(orderInfo, ORDER_FIELD_01, ellipse_cb->leftRect, last->leftRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_02, ellipse_cb->topRect, last->topRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_03, ellipse_cb->rightRect, last->rightRect);
+	update_compare_coord(orderInfo, ORDER_FIELD_04, ellipse_cb->bottomRect, last->bottomRect);
+	update_compare_field(orderInfo, ORDER_FIELD_05, ellipse_cb->bRop2, last->bRop2);
+	update_compare_field(orderInfo, ORDER_FIELD_06, ellipse_cb->fillMode, last->fillMode);
+	update_compare_field(orderInfo, ORDER_FIELD_07, ellipse_cb->backColor, last->backColor);
+	update_compare_field(orderInfo, ORDER_FIELD_08, ellipse_cb->foreColor, last->foreColor);
+	update_compare_brush(orderInfo, 8, &ellipse_cb->brush, &last->brush);
+}
+
+static void update_write_ellipse_cb_order(STREAM* s, ORDER_INFO* orderInfo, ELLIPSE_CB_ORDER* ellipse_cb, ELLIPSE_CB_ORDER* last)
+{
+	if (orderInfo->fieldFlags & ORDER_FIELD_01)
+		update_write_coord(s, ellipse_cb->leftRect, last->leftRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_02)
+		update_write_coord(s, ellipse_cb->topRect, last->topRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_03)
+		update_write_coord(s, ellipse_cb->rightRect, last->rightRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_04)
+		update_write_coord(s, ellipse_cb->bottomRect, last->bottomRect, orderInfo->deltaCoordinates);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_05)
+		stream_write_uint8(s, ellipse_cb->bRop2);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_06)
+		stream_write_uint8(s, ellipse_cb->fillMode);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_07)
+		update_write_color(s, ellipse_cb->backColor);
+
+	if (orderInfo->fieldFlags & ORDER_FIELD_08)
+		update_write_color(s, ellipse_cb->foreColor);
+
+	update_write_brush(s, &ellipse_cb->brush, orderInfo->fieldFlags >> 8);
+
+	*last = *ellipse_cb;
+	update_save_brush(&last->brush, &ellipse_cb->brush);
+}
+
+static void update_write_field_flags(STREAM* s, uint32 fieldFlags, uint8 fieldBytes)
+{
+	int i;
+
+	for (i = 0; i < fieldBytes; i++)
+		stream_write_uint8(s, (fieldFlags >> (i * 8)) & 0xFF);
+}
+
+static INLINE uint8 update_bound_flag(sint32 value, sint32 last, uint8 absolute, uint8 delta)
+{
+	if (value == last)
+		return 0;
+
+	return (value - last >= -128 && value - last <= 127) ? delta : absolute;
+}
+
+static void update_write_bounds(STREAM* s, rdpBounds* bounds, rdpBounds* last)
+{
+	uint8 flags;
+
+	flags = update_bound_flag(bounds->left, last->left, BOUND_LEFT, BOUND_DELTA_LEFT);
+	flags |= update_bound_flag(bounds->top, last->top, BOUND_TOP, BOUND_DELTA_TOP);
+	flags |= update_bound_flag(bounds->right, last->right, BOUND_RIGHT, BOUND_DELTA_RIGHT);
+	flags |= update_bound_flag(bounds->bottom, last->bottom, BOUND_BOTTOM, BOUND_DELTA_BOTTOM);
+
+	stream_write_uint8(s, flags); /* field flags */
+
+	if (flags & (BOUND_LEFT | BOUND_DELTA_LEFT))
+		update_write_coord(s, bounds->left, last->left, (flags & BOUND_DELTA_LEFT) ? true : false);
+
+	if (flags & (BOUND_TOP | BOUND_DELTA_TOP))
+		update_write_coord(s, bounds->top, last->top, (flags & BOUND_DELTA_TOP) ? true : false);
+
+	if (flags & (BOUND_RIGHT | BOUND_DELTA_RIGHT))
+		update_write_coord(s, bounds->right, last->right, (flags & BOUND_DELTA_RIGHT) ? true : false);
+
+	if (flags & (BOUND_BOTTOM | BOUND_DELTA_BOTTOM))
+		update_write_coord(s, bounds->bottom, last->bottom, (flags & BOUND_DELTA_BOTTOM) ? true : false);
+
+	*last = *bounds;
+}
+
+/**
+ * Write a primary drawing order, relative to the orders previously written
+ * with the same primary update. The order is clipped to bounds, unless
+ * bounds is NULL.
+ */
+
+void update_write_primary_order(STREAM* s, rdpPrimaryUpdate* primary, uint8 orderType, void* order, rdpBounds* bounds)
+{
+	uint8 flags;
+	uint8 fieldBytes;
+	uint8 zeroBytes;
+	ORDER_INFO* orderInfo;
+
+	orderInfo = &(primary->order_info);
+	orderInfo->fieldFlags = 0;
+	orderInfo->deltaCoordinates = true;
+
+	switch (orderType)
+	{
+		case ORDER_TYPE_DSTBLT:
+			update_compare_dstblt_order(orderInfo, order, &(primary->dstblt));
+			break;
+
+		case ORDER_TYPE_PATBLT:
+			update_compare_patblt_order(orderInfo, order, &(primary->patblt));
+			break;
+
+		case ORDER_TYPE_SCRBLT:
+			update_compare_scrblt_order(orderInfo, order, &(primary->scrblt));
+			break;
+
+		case ORDER_TYPE_OPAQUE_RECT:
+			update_compare_opaque_rect_order(orderInfo, order, &(primary->opaque_rect));
+			break;
+
+		case ORDER_TYPE_DRAW_NINE_GRID:
+			update_compare_draw_nine_grid_order(orderInfo, order, &(primary->draw_nine_grid));
+			break;
+
+		case ORDER_TYPE_MULTI_DSTBLT:
+			update_compare_multi_dstblt_order(orderInfo, order, &(primary->multi_dstblt));
+			break;
+
+		case ORDER_TYPE_MULTI_PATBLT:
+			update_compare_multi_patblt_order(orderInfo, order, &(primary->multi_patblt));
+			break;
+
+		case ORDER_TYPE_MULTI_SCRBLT:
+			update_compare_multi_scrblt_order(orderInfo, order, &(primary->multi_scrblt));
+			break;
+
+		case ORDER_TYPE_MULTI_OPAQUE_RECT:
+			update_compare_multi_opaque_rect_order(orderInfo, order, &(primary->multi_opaque_rect));
+			break;
+
+		case ORDER_TYPE_MULTI_DRAW_NINE_GRID:
+			update_compare_multi_draw_nine_grid_order(orderInfo, order, &(primary->multi_draw_nine_grid));
+			break;
+
+		case ORDER_TYPE_LINE_TO:
+			update_compare_line_to_order(orderInfo, order, &(primary->line_to));
+			break;
+
+		case ORDER_TYPE_POLYLINE:
+			update_compare_polyline_order(orderInfo, order, &(primary->polyline));
+			break;
+
+		case ORDER_TYPE_MEMBLT:
+			update_compare_memblt_order(orderInfo, order, &(primary->memblt));
+			break;
+
+		case ORDER_TYPE_MEM3BLT:
+			update_compare_mem3blt_order(orderInfo, order, &(primary->mem3blt));
+			break;
+
+		case ORDER_TYPE_SAVE_BITMAP:
+			update_compare_save_bitmap_order(orderInfo, order, &(primary->save_bitmap));
+			break;
+
+		case ORDER_TYPE_GLYPH_INDEX:
+			update_compare_glyph_index_order(orderInfo, order, &(primary->glyph_index));
+			break;
+
+		case ORDER_TYPE_FAST_INDEX:
+			update_compare_fast_index_order(orderInfo, order, &(primary->fast_index));
+			break;
+
+		case ORDER_TYPE_FAST_GLYPH:
+			update_compare_fast_glyph_order(orderInfo, order, &(primary->fast_glyph));
+			break;
+
+		case ORDER_TYPE_POLYGON_SC:
+			update_compare_polygon_sc_order(orderInfo, order, &(primary->polygon_sc));
+			break;
+
+		case ORDER_TYPE_POLYGON_CB:
+			update_compare_polygon_cb_order(orderInfo, order, &(primary->polygon_cb));
+			break;
+
+		case ORDER_TYPE_ELLIPSE_SC:
+			update_compare_ellipse_sc_order(orderInfo, order, &(primary->ellipse_sc));
+			break;
+
+		case ORDER_TYPE_ELLIPSE_CB:
+			update_compare_ellipse_cb_order(orderInfo, order, &(primary->ellipse_cb));
+			break;
+
+		default:
+			printf("update_write_primary_order: unknown order type 0x%02X\n", orderType);
+			return;
+	}
+
+	stream_check_size(s, PRIMARY_DRAWING_ORDER_MAX_SIZE);
+
+	flags = ORDER_STANDARD;
+
+	if (orderType != orderInfo->orderType)
+		flags |= ORDER_TYPE_CHANGE;
+
+	if (orderInfo->deltaCoordinates)
+		flags |= ORDER_DELTA_COORDINATES;
+
+	if (bounds != NULL)
+	{
+		flags |= ORDER_BOUNDS;
+
+		if (memcmp(bounds, &orderInfo->bounds, sizeof(rdpBounds)) == 0)
+			flags |= ORDER_ZERO_BOUNDS_DELTAS;
+	}
+
+	/* leave out the trailing field flag bytes that are zero */
+	fieldBytes = PRIMARY_DRAWING_ORDER_FIELD_BYTES[orderType];
+
+	for (zeroBytes = 0; zeroBytes < fieldBytes && zeroBytes < 3; zeroBytes++)
+	{
+		if ((orderInfo->fieldFlags >> ((fieldBytes - zeroBytes - 1) * 8)) & 0xFF)
+			break;
+	}
+
+	if (zeroBytes & 1)
+		flags |= ORDER_ZERO_FIELD_BYTE_BIT0;
+
+	if (zeroBytes & 2)
+		flags |= ORDER_ZERO_FIELD_BYTE_BIT1;
+
+	stream_write_uint8(s, flags); /* controlFlags (1 byte) */
+
+	if (flags & ORDER_TYPE_CHANGE)
+		stream_write_uint8(s, orderType); /* orderType (1 byte) */
+
+	update_write_field_flags(s, orderInfo->fieldFlags, fieldBytes - zeroBytes);
+
+	if ((flags & ORDER_BOUNDS) && !(flags & ORDER_ZERO_BOUNDS_DELTAS))
+		update_write_bounds(s, bounds, &orderInfo->bounds);
+
+	orderInfo->orderType = orderType;
+
+	switch (orderType)
+	{
+		case ORDER_TYPE_DSTBLT:
+			update_write_dstblt_order(s, orderInfo, order, &(primary->dstblt));
+			break;
+
+		case ORDER_TYPE_PATBLT:
+			update_write_patblt_order(s, orderInfo, order, &(primary->patblt));
+			break;
+
+		case ORDER_TYPE_SCRBLT:
+			update_write_scrblt_order(s, orderInfo, order, &(primary->scrblt));
+			break;
+
+		case ORDER_TYPE_OPAQUE_RECT:
+			update_write_opaque_rect_order(s, orderInfo, order, &(primary->opaque_rect));
+			break;
+
+		case ORDER_TYPE_DRAW_NINE_GRID:
+			update_write_draw_nine_grid_order(s, orderInfo, order, &(primary->draw_nine_grid));
+			break;
+
+		case ORDER_TYPE_MULTI_DSTBLT:
+			update_write_multi_dstblt_order(s, orderInfo, order, &(primary->multi_dstblt));
+			break;
+
+		case ORDER_TYPE_MULTI_PATBLT:
+			update_write_multi_patblt_order(s, orderInfo, order, &(primary->multi_patblt));
+			break;
+
+		case ORDER_TYPE_MULTI_SCRBLT:
+			update_write_multi_scrblt_order(s, orderInfo, order, &(primary->multi_scrblt));
+			break;
+
+		case ORDER_TYPE_MULTI_OPAQUE_RECT:
+			update_write_multi_opaque_rect_order(s, orderInfo, order, &(primary->multi_opaque_rect));
+			break;
+
+		case ORDER_TYPE_MULTI_DRAW_NINE_GRID:
+			update_write_multi_draw_nine_grid_order(s, orderInfo, order, &(primary->multi_draw_nine_grid));
+			break;
+
+		case ORDER_TYPE_LINE_TO:
+			update_write_line_to_order(s, orderInfo, order, &(primary->line_to));
+			break;
+
+		case ORDER_TYPE_POLYLINE:
+			update_write_polyline_order(s, orderInfo, order, &(primary->polyline));
+			break;
+
+		case ORDER_TYPE_MEMBLT:
+			update_write_memblt_order(s, orderInfo, order, &(primary->memblt));
+			break;
+
+		case ORDER_TYPE_MEM3BLT:
+			update_write_mem3blt_order(s, orderInfo, order, &(primary->mem3blt));
+			break;
+
+		case ORDER_TYPE_SAVE_BITMAP:
+			update_write_save_bitmap_order(s, orderInfo, order, &(primary->save_bitmap));
+			break;
+
+		case ORDER_TYPE_GLYPH_INDEX:
+			update_write_glyph_index_order(s, orderInfo, order, &(primary->glyph_index));
+			break;
+
+		case ORDER_TYPE_FAST_INDEX:
+			update_write_fast_index_order(s, orderInfo, order, &(primary->fast_index));
+			break;
+
+		case ORDER_TYPE_FAST_GLYPH:
+			update_write_fast_glyph_order(s, orderInfo, order, &(primary->fast_glyph));
+			break;
+
+		case ORDER_TYPE_POLYGON_SC:
+			update_write_polygon_sc_order(s, orderInfo, order, &(primary->polygon_sc));
+			break;
+
+		case ORDER_TYPE_POLYGON_CB:
+			update_write_polygon_cb_order(s, orderInfo, order, &(primary->polygon_cb));
+			break;
+
+		case ORDER_TYPE_ELLIPSE_SC:
+			update_write_ellipse_sc_order(s, orderInfo, order, &(primary->ellipse_sc));
+			break;
+
+		case ORDER_TYPE_ELLIPSE_CB:
+			update_write_ellipse_cb_order(s, orderInfo, order, &(primary->ellipse_cb));
+			break;
+
+		default:
+			break;
+	}
+}
+
+/* Secondary Drawing Order Encoding */
+
+static INLINE void update_write_2byte_unsigned(STREAM* s, uint32 value)
+{
+	if (value > 0x7F)
+	{
+		stream_write_uint8(s, 0x80 | ((value >> 8) & 0x7F));
+		stream_write_uint8(s, value & 0xFF);
+	}
+	else
+	{
+		stream_write_uint8(s, value);
+	}
+}
+
+static INLINE void update_write_2byte_signed(STREAM* s, sint32 value)
+{
+	uint8 byte;
+
+	byte = (value < 0) ? 0x40 : 0;
+
+	if (value < 0)
+		value *= -1;
+
+	if (value > 0x3F)
+	{
+		stream_write_uint8(s, byte | 0x80 | ((value >> 8) & 0x3F));
+		stream_write_uint8(s, value & 0xFF);
+	}
+	else
+	{
+		stream_write_uint8(s, byte | value);
+	}
+}
+
+static INLINE void update_write_4byte_unsigned(STREAM* s, uint32 value)
+{
+	if (value <= 0x3F)
+	{
+		stream_write_uint8(s, value);
+	}
+	else if (value <= 0x3FFF)
+	{
+		stream_write_uint8(s, 0x40 | (value >> 8));
+		stream_write_uint8(s, value & 0xFF);
+	}
+	else if (value <= 0x3FFFFF)
+	{
+		stream_write_uint8(s, 0x80 | (value >> 16));
+		stream_write_uint8(s, (value >> 8) & 0xFF);
+		stream_write_uint8(s, value & 0xFF);
+	}
+	else
+	{
+		stream_write_uint8(s, 0xC0 | ((value >> 24) & 0x3F));
+		stream_write_uint8(s, (value >> 16) & 0xFF);
+		stream_write_uint8(s, (value >> 8) & 0xFF);
+		stream_write_uint8(s, value & 0xFF);
+	}
+}
+
+static INLINE uint32 update_glyph_size(uint32 cx, uint32 cy)
+{
+	uint32 cb;
+
+	cb = ((cx + 7) / 8) * cy;
+	cb += ((cb % 4) > 0) ? 4 - (cb % 4) : 0;
+
+	return cb;
+}
+
+/**
+ * The header is written once the order is, orderLength counts the bytes
+ * following orderType less seven.
+ */
+
+static void update_write_secondary_order_header(STREAM* s, uint32 start, uint16 extraFlags, uint8 orderType)
+{
+	uint32 end;
+
+	end = stream_get_pos(s);
+	stream_set_pos(s, start);
+
+	stream_write_uint8(s, ORDER_STANDARD | ORDER_SECONDARY); /* controlFlags (1 byte) */
+	stream_write_uint16(s, (uint16) (end - start - 6 - 7)); /* orderLength (2 bytes) */
+	stream_write_uint16(s, extraFlags); /* extraFlags (2 bytes) */
+	stream_write_uint8(s, orderType); /* orderType (1 byte) */
+
+	stream_set_pos(s, end);
+}
+
+int update_approximate_cache_bitmap_v2_order(CACHE_BITMAP_V2_ORDER* cache_bitmap_v2_order)
+{
+	return 32 + cache_bitmap_v2_order->bitmapLength;
+}
+
+void update_write_cache_bitmap_v2_order(STREAM* s, CACHE_BITMAP_V2_ORDER* cache_bitmap_v2_order)
+{
+	uint32 start;
+	uint32 flags;
+	uint16 extraFlags;
+	uint8 bitsPerPixelId;
+
+	stream_check_size(s, update_approximate_cache_bitmap_v2_order(cache_bitmap_v2_order));
+	start = stream_get_pos(s);
+	stream_seek(s, 6);
+
+	switch (cache_bitmap_v2_order->bitmapBpp)
+	{
+		case 8:
+			bitsPerPixelId = CBR2_8BPP;
+			break;
+
+		case 15:
+		case 16:
+			bitsPerPixelId = CBR2_16BPP;
+			break;
+
+		case 24:
+			bitsPerPixelId = CBR2_24BPP;
+			break;
+
+		default:
+			bitsPerPixelId = CBR2_32BPP;
+			break;
+	}
+
+	flags = cache_bitmap_v2_order->flags & ~CBR2_HEIGHT_SAME_AS_WIDTH;
+
+	if (cache_bitmap_v2_order->bitmapWidth == cache_bitmap_v2_order->bitmapHeight)
+		flags |= CBR2_HEIGHT_SAME_AS_WIDTH;
+
+	/* the compression header is never sent, bitmapLength is the compressed size */
+	if (cache_bitmap_v2_order->compressed)
+		flags |= CBR2_NO_BITMAP_COMPRESSION_HDR;
+
+	extraFlags = (cache_bitmap_v2_order->cacheId & 0x0003) | (bitsPerPixelId << 3) | ((flags << 7) & 0xFF80);
+
+	if (flags & CBR2_PERSISTENT_KEY_PRESENT)
+	{
+		stream_write_uint32(s, cache_bitmap_v2_order->key1); /* key1 (4 bytes) */
+		stream_write_uint32(s, cache_bitmap_v2_order->key2); /* key2 (4 bytes) */
+	}
+
+	update_write_2byte_unsigned(s, cache_bitmap_v2_order->bitmapWidth); /* bitmapWidth */
+
+	if (!(flags & CBR2_HEIGHT_SAME_AS_WIDTH))
+		update_write_2byte_unsigned(s, cache_bitmap_v2_order->bitmapHeight); /* bitmapHeight */
+
+	update_write_4byte_unsigned(s, cache_bitmap_v2_order->bitmapLength); /* bitmapLength */
+	update_write_2byte_unsigned(s, cache_bitmap_v2_order->cacheIndex); /* cacheIndex */
+	stream_write(s, cache_bitmap_v2_order->bitmapDataStream, cache_bitmap_v2_order->bitmapLength);
+
+	update_write_secondary_order_header(s, start, extraFlags, cache_bitmap_v2_order->compressed ?
+			ORDER_TYPE_BITMAP_COMPRESSED_V2 : ORDER_TYPE_BITMAP_UNCOMPRESSED_V2);
+}
+
+int update_approximate_cache_glyph_order(CACHE_GLYPH_ORDER* cache_glyph_order)
+{
+	int i;
+	int size = 8;
+	GLYPH_DATA* glyph;
+
+	for (i = 0; i < (int) cache_glyph_order->cGlyphs; i++)
+	{
+		glyph = cache_glyph_order->glyphData[i];
+		size += 10 + update_glyph_size(glyph->cx, glyph->cy);
+	}
+
+	return size;
+}
+
+void update_write_cache_glyph_order(STREAM* s, CACHE_GLYPH_ORDER* cache_glyph_order)
+{
+	int i;
+	uint32 start;
+	GLYPH_DATA* glyph;
+
+	stream_check_size(s, update_approximate_cache_glyph_order(cache_glyph_order));
+	start = stream_get_pos(s);
+	stream_seek(s, 6);
+
+	stream_write_uint8(s, cache_glyph_order->cacheId); /* cacheId (1 byte) */
+	stream_write_uint8(s, cache_glyph_order->cGlyphs); /* cGlyphs (1 byte) */
+
+	for (i = 0; i < (int) cache_glyph_order->cGlyphs; i++)
+	{
+		glyph = cache_glyph_order->glyphData[i];
+
+		stream_write_uint16(s, glyph->cacheIndex);
+		stream_write_uint16(s, (uint16) glyph->x);
+		stream_write_uint16(s, (uint16) glyph->y);
+		stream_write_uint16(s, glyph->cx);
+		stream_write_uint16(s, glyph->cy);
+		stream_write(s, glyph->aj, update_glyph_size(glyph->cx, glyph->cy));
+	}
+
+	update_write_secondary_order_header(s, start, 0, ORDER_TYPE_CACHE_GLYPH);
+}
+
+int update_approximate_cache_glyph_v2_order(CACHE_GLYPH_V2_ORDER* cache_glyph_v2_order)
+{
+	int i;
+	int size = 8;
+	GLYPH_DATA_V2* glyph;
+
+	for (i = 0; i < (int) cache_glyph_v2_order->cGlyphs; i++)
+	{
+		glyph = cache_glyph_v2_order->glyphData[i];
+		size += 9 + update_glyph_size(glyph->cx, glyph->cy);
+	}
+
+	return size;
+}
+
+void update_write_cache_glyph_v2_order(STREAM* s, CACHE_GLYPH_V2_ORDER* cache_glyph_v2_order)
+{
+	int i;
+	uint32 start;
+	uint16 extraFlags;
+	GLYPH_DATA_V2* glyph;
+
+	stream_check_size(s, update_approximate_cache_glyph_v2_order(cache_glyph_v2_order));
+	start = stream_get_pos(s);
+	stream_seek(s, 6);
+
+	/* no unicode characters follow the glyphs */
+	extraFlags = (cache_glyph_v2_order->cacheId & 0x000F) | ((cache_glyph_v2_order->cGlyphs & 0xFF) << 8);
+
+	for (i = 0; i < (int) cache_glyph_v2_order->cGlyphs; i++)
+	{
+		glyph = cache_glyph_v2_order->glyphData[i];
+
+		stream_write_uint8(s, glyph->cacheIndex);
+		update_write_2byte_signed(s, glyph->x);
+		update_write_2byte_signed(s, glyph->y);
+		update_write_2byte_unsigned(s, glyph->cx);
+		update_write_2byte_unsigned(s, glyph->cy);
+		stream_write(s, glyph->aj, update_glyph_size(glyph->cx, glyph->cy));
+	}
+
+	update_write_secondary_order_header(s, start, extraFlags, ORDER_TYPE_CACHE_GLYPH);
+}
+
+int update_approximate_cache_brush_order(CACHE_BRUSH_ORDER* cache_brush_order)
+{
+	return 6 + 6 + 8 * 8 * 4;
+}
+
+/**
+ * A color brush of at most four colors goes as a 2 bit index per pixel
+ * followed by the palette when the order length asks for it, the way
+ * update_decompress_brush() expects it. Rows go bottom-up either way.
+ */
+
+static void update_compress_brush(STREAM* s, uint8* input, uint8 bpp)
+{
+	int x, y, k;
+	int index;
+	int count = 0;
+	uint8 byte = 0;
+	uint8 palette[4 * 4];
+	int bytesPerPixel;
+	uint8* pixel;
+
+	bytesPerPixel = ((bpp + 1) / 8);
+	memset(palette, 0, sizeof(palette));
+
+	for (y = 7; y >= 0; y--)
+	{
+		for (x = 0; x < 8; x++)
+		{
+			pixel = &input[(y * 8 + x) * bytesPerPixel];
+
+			for (index = 0; index < count; index++)
+			{
+				if (memcmp(&palette[index * bytesPerPixel], pixel, bytesPerPixel) == 0)
+					break;
+			}
+
+			if (index == count && count < 4)
+			{
+				memcpy(&palette[index * bytesPerPixel], pixel, bytesPerPixel);
+				count++;
+			}
+
+			byte |= (index & 0x03) << ((3 - (x % 4)) * 2);
+
+			if ((x % 4) == 3)
+			{
+				stream_write_uint8(s, byte);
+				byte = 0;
+			}
+		}
+	}
+
+	for (k = 0; k < 4 * bytesPerPixel; k++)
+		stream_write_uint8(s, palette[k]);
+}
+
+void update_write_cache_brush_order(STREAM* s, CACHE_BRUSH_ORDER* cache_brush_order)
+{
+	int i;
+	uint32 start;
+	int scanline;
+	uint8 iBitmapFormat;
+
+	stream_check_size(s, update_approximate_cache_brush_order(cache_brush_order));
+	start = stream_get_pos(s);
+	stream_seek(s, 6);
+
+	switch (cache_brush_order->bpp)
+	{
+		case 1:
+			iBitmapFormat = BMF_1BPP;
+			break;
+
+		case 8:
+			iBitmapFormat = BMF_8BPP;
+			break;
+
+		case 16:
+			iBitmapFormat = BMF_16BPP;
+			break;
+
+		case 24:
+			iBitmapFormat = BMF_24BPP;
+			break;
+
+		default:
+			iBitmapFormat = BMF_32BPP;
+			break;
+	}
+
+	stream_write_uint8(s, cache_brush_order->index); /* cacheEntry (1 byte) */
+	stream_write_uint8(s, iBitmapFormat); /* iBitmapFormat (1 byte) */
+	stream_write_uint8(s, 8); /* cx (1 byte) */
+	stream_write_uint8(s, 8); /* cy (1 byte) */
+	stream_write_uint8(s, cache_brush_order->style); /* style (1 byte) */
+	stream_write_uint8(s, cache_brush_order->length); /* iBytes (1 byte) */
+
+	scanline = (cache_brush_order->bpp / 8) * 8;
+
+	if (cache_brush_order->bpp == 1)
+	{
+		for (i = 7; i >= 0; i--)
+			stream_write_uint8(s, cache_brush_order->data[i]);
+	}
+	else if ((int) cache_brush_order->length == 8 * scanline)
+	{
+		for (i = 7; i >= 0; i--)
+			stream_write(s, &cache_brush_order->data[i * scanline], scanline);
+	}
+	else
+	{
+		update_compress_brush(s, cache_brush_order->data, cache_brush_order->bpp);
+	}
+
+	update_write_secondary_order_header(s, start, 0, ORDER_TYPE_CACHE_BRUSH);
+}
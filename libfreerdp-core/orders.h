@@ -160,6 +160,9 @@
 #define ELLIPSE_CB_ORDER_FIELD_BYTES		2
 #define GLYPH_INDEX_ORDER_FIELD_BYTES		3
 
+/* Room made for a primary drawing order, longer variable data makes its own */
+#define PRIMARY_DRAWING_ORDER_MAX_SIZE		512
+
 /* Secondary Drawing Orders */
 #define ORDER_TYPE_BITMAP_UNCOMPRESSED		0x00
 #define ORDER_TYPE_CACHE_COLOR_TABLE		0x01
@@ -235,4 +238,16 @@ void update_read_draw_gdiplus_cache_first_order(STREAM* s, DRAW_GDIPLUS_CACHE_FI
 void update_read_draw_gdiplus_cache_next_order(STREAM* s, DRAW_GDIPLUS_CACHE_NEXT_ORDER* draw_gdiplus_cache_next);
 void update_read_draw_gdiplus_cache_end_order(STREAM* s, DRAW_GDIPLUS_CACHE_END_ORDER* draw_gdiplus_cache_end);
 
+int update_polyline_points_fit(DELTA_POINT* points, int number);
+void update_write_primary_order(STREAM* s, rdpPrimaryUpdate* primary, uint8 orderType, void* order, rdpBounds* bounds);
+
+int update_approximate_cache_bitmap_v2_order(CACHE_BITMAP_V2_ORDER* cache_bitmap_v2_order);
+void update_write_cache_bitmap_v2_order(STREAM* s, CACHE_BITMAP_V2_ORDER* cache_bitmap_v2_order);
+int update_approximate_cache_glyph_order(CACHE_GLYPH_ORDER* cache_glyph_order);
+void update_write_cache_glyph_order(STREAM* s, CACHE_GLYPH_ORDER* cache_glyph_order);
+int update_approximate_cache_glyph_v2_order(CACHE_GLYPH_V2_ORDER* cache_glyph_v2_order);
+void update_write_cache_glyph_v2_order(STREAM* s, CACHE_GLYPH_V2_ORDER* cache_glyph_v2_order);
+int update_approximate_cache_brush_order(CACHE_BRUSH_ORDER* cache_brush_order);
+void update_write_cache_brush_order(STREAM* s, CACHE_BRUSH_ORDER* cache_brush_order);
+
 #endif /* __ORDERS_H */
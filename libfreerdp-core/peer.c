@@ -107,6 +107,11 @@ static boolean peer_recv_data_pdu(freerdp_peer* client, STREAM* s)
 			}
 			break;
 
+		case DATA_PDU_TYPE_FRAME_ACKNOWLEDGE:
+			if (!update_recv_frame_acknowledge(client->update, s))
+				return false;
+			break;
+
 		case DATA_PDU_TYPE_SHUTDOWN_REQUEST:
 			mcs_send_disconnect_provider_ultimatum(client->context->rdp->mcs);
 			return false;
@@ -287,6 +292,15 @@ static void freerdp_peer_disconnect(freerdp_peer* client)
 	transport_disconnect(client->context->rdp->transport);
 }
 
+static void freerdp_peer_get_send_status(freerdp_peer* client, PEER_SEND_STATUS* status)
+{
+	rdpTransport* transport = client->context->rdp->transport;
+
+	status->backlog = tcp_get_send_backlog(transport->tcp);
+	status->stalls = transport->write_stalls;
+	status->stall_time = transport->write_stall_time;
+}
+
 static int freerdp_peer_send_channel_data(freerdp_peer* client, int channelId, uint8* data, int size)
 {
 	return rdp_send_channel_data(client->context->rdp, channelId, data, size);
@@ -338,6 +352,7 @@ freerdp_peer* freerdp_peer_new(int sockfd)
 		client->GetFileDescriptor = freerdp_peer_get_fds;
 		client->CheckFileDescriptor = freerdp_peer_check_fds;
 		client->Disconnect = freerdp_peer_disconnect;
+		client->GetSendStatus = freerdp_peer_get_send_status;
 		client->SendChannelData = freerdp_peer_send_channel_data;
 	}
 
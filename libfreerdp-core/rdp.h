@@ -102,6 +102,7 @@
 #define DATA_PDU_TYPE_ARC_STATUS				0x32
 #define DATA_PDU_TYPE_STATUS_INFO				0x36
 #define DATA_PDU_TYPE_MONITOR_LAYOUT				0x37
+#define DATA_PDU_TYPE_FRAME_ACKNOWLEDGE				0x38
 
 /* Compression Types */
 #define PACKET_COMPRESSED		0x20
@@ -111,10 +111,15 @@ rdpSettings* settings_new(void* instance)
 		settings->draw_gdi_plus = false;
 
 		settings->frame_marker = false;
+		settings->frame_acknowledge = true;
+		settings->max_unacknowledged_frames = 2;
 		settings->bitmap_cache_v3 = false;
 
 		settings->bitmap_cache = true;
 		settings->persistent_bitmap_cache = false;
+		settings->bitmap_cache_persist_enabled = false;
+		settings->bitmap_decode_threads = 0;
+		settings->gdi_display_list = false;
 		settings->bitmapCacheV2CellInfo = xzalloc(sizeof(BITMAP_CACHE_V2_CELL_INFO) * 6);
 
 		settings->refresh_rect = true;
@@ -208,6 +213,7 @@ void settings_free(rdpSettings* settings)
 		xfree(settings->server_auto_reconnect_cookie);
 		xfree(settings->client_time_zone);
 		xfree(settings->bitmapCacheV2CellInfo);
+		xfree(settings->bitmap_cache_persist_file);
 		xfree(settings->glyphCache);
 		xfree(settings->fragCache);
 		key_free(settings->server_key);
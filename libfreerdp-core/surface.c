@@ -49,12 +49,20 @@ static int update_recv_surfcmd_surface_bits(rdpUpdate* update, STREAM* s)
 static int update_recv_surfcmd_frame_marker(rdpUpdate* update, STREAM* s)
 {
 	SURFACE_FRAME_MARKER* marker = &update->surface_frame_marker;
+	rdpSettings* settings = update->context->rdp->settings;
 
 	stream_read_uint16(s, marker->frameAction);
 	stream_read_uint32(s, marker->frameId);
 
 	IFCALL(update->SurfaceFrameMarker, update->context, marker);
 
+	if (marker->frameAction == SURFACECMD_FRAMEACTION_END && settings->frame_acknowledge &&
+			settings->received_caps[CAPSET_TYPE_FRAME_ACKNOWLEDGE])
+	{
+		update->acknowledge_frame = true;
+		update->acknowledge_frame_id = marker->frameId;
+	}
+
 	return 6;
 }
 
@@ -343,6 +343,27 @@ boolean tcp_set_blocking_mode(rdpTcp* tcp, boolean blocking)
 	return true;
 }
 
+/**
+ * Get the number of bytes written to the socket but not sent yet.
+ * @return number of bytes, or -1 if the platform cannot tell
+ */
+
+int tcp_get_send_backlog(rdpTcp* tcp)
+{
+	int count = -1;
+
+#if defined(FIONWRITE)
+	if (ioctl(tcp->sockfd, FIONWRITE, &count) < 0)
+		count = -1;
+#elif defined(TIOCOUTQ)
+	/* same as SIOCOUTQ on sockets */
+	if (ioctl(tcp->sockfd, TIOCOUTQ, &count) < 0)
+		count = -1;
+#endif
+
+	return count;
+}
+
 boolean tcp_set_keep_alive_mode(rdpTcp* tcp)
 {
 #ifndef _WIN32
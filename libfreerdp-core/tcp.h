@@ -59,6 +59,7 @@ int tcp_read(rdpTcp* tcp, uint8* data, int length);
 int tcp_write(rdpTcp* tcp, uint8* data, int length);
 boolean tcp_set_blocking_mode(rdpTcp* tcp, boolean blocking);
 boolean tcp_set_keep_alive_mode(rdpTcp* tcp);
+int tcp_get_send_backlog(rdpTcp* tcp);
 
 rdpTcp* tcp_new(rdpSettings* settings);
 void tcp_free(rdpTcp* tcp);
@@ -248,6 +248,9 @@ int transport_write(rdpTransport* transport, STREAM* s)
 			/* blocking while sending */
 			freerdp_usleep(transport->usleep_interval);
 
+			transport->write_stalls++;
+			transport->write_stall_time += transport->usleep_interval;
+
 			/* when sending is blocked in nonblocking mode, the receiving buffer should be checked */
 			if (!transport->blocking)
 			{
@@ -341,7 +344,7 @@ int transport_check_fds(rdpTransport** ptransport)
 		 * for the next packet, we copy it to the new receive buffer.
 		 */
 		received = transport->recv_buffer;
-		transport->recv_buffer = stream_new(BUFFER_SIZE);
+		transport->recv_buffer = stream_pool_acquire(transport->pool, BUFFER_SIZE);
 
 		if (pos > length)
 		{
@@ -356,13 +359,16 @@ int transport_check_fds(rdpTransport** ptransport)
 		
 		if (transport->recv_callback(transport, received, transport->recv_extra) == false)
 			status = -1;
-	
-		stream_free(received);
+
+		/* transport might now have been freed by rdp_client_redirect and a new rdp->transport created */
+		if (*ptransport == transport)
+			stream_pool_release(transport->pool, received);
+		else
+			stream_free(received);
 
 		if (status < 0)
 			return status;
 
-		/* transport might now have been freed by rdp_client_redirect and a new rdp->transport created */
 		transport = *ptransport;
 	}
 
@@ -389,8 +395,9 @@ rdpTransport* transport_new(rdpSettings* settings)
 		/* a small 0.1ms delay when transport is blocking. */
 		transport->usleep_interval = 100;
 
-		/* receive buffer for non-blocking read. */
-		transport->recv_buffer = stream_new(BUFFER_SIZE);
+		/* receive buffers for non-blocking read, one for each packet received */
+		transport->pool = stream_pool_new();
+		transport->recv_buffer = stream_pool_acquire(transport->pool, BUFFER_SIZE);
 		transport->recv_event = wait_obj_new();
 
 		/* buffers for blocking read/write */
@@ -412,6 +419,7 @@ void transport_free(rdpTransport* transport)
 		stream_free(transport->recv_buffer);
 		stream_free(transport->recv_stream);
 		stream_free(transport->send_stream);
+		stream_pool_free(transport->pool);
 		wait_obj_free(transport->recv_event);
 		if (transport->tls)
 			tls_free(transport->tls);
@@ -53,9 +53,12 @@ struct rdp_transport
 	uint32 usleep_interval;
 	void* recv_extra;
 	STREAM* recv_buffer;
+	STREAM_POOL* pool;
 	TransportRecv recv_callback;
 	struct wait_obj* recv_event;
 	boolean blocking;
+	uint32 write_stalls;
+	uint64 write_stall_time;
 };
 
 STREAM* transport_recv_stream_init(rdpTransport* transport, int size);
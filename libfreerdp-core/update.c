@@ -309,6 +309,10 @@ void update_reset_state(rdpUpdate* update)
 	rdpPrimaryUpdate* primary = update->primary;
 	rdpAltSecUpdate* altsec = update->altsec;
 
+	/* orders still batched were written against the state about to go */
+	stream_set_pos(update->orders, 0);
+	update->number_orders = 0;
+
 	memset(&primary->order_info, 0, sizeof(ORDER_INFO));
 	memset(&primary->dstblt, 0, sizeof(DSTBLT_ORDER));
 	memset(&primary->patblt, 0, sizeof(PATBLT_ORDER));
@@ -338,14 +342,30 @@ void update_reset_state(rdpUpdate* update)
 	IFCALL(altsec->SwitchSurface, update->context, &(altsec->switch_surface));
 }
 
-static void update_begin_paint(rdpContext* context)
+/**
+ * Send the drawing orders batched so far in one orders update. Any other
+ * update flushes them first, so the client sees everything in order.
+ */
+
+static void update_flush_orders(rdpUpdate* update)
 {
+	STREAM* s;
+	int length;
+	rdpRdp* rdp = update->context->rdp;
 
-}
+	if (update->number_orders == 0)
+		return;
 
-static void update_end_paint(rdpContext* context)
-{
+	length = stream_get_length(update->orders);
 
+	s = fastpath_update_pdu_init(rdp->fastpath);
+	stream_check_size(s, 2 + length);
+	stream_write_uint16(s, update->number_orders); /* numberOrders (2 bytes) */
+	stream_write(s, update->orders->data, length);
+	fastpath_send_update_pdu(rdp->fastpath, FASTPATH_UPDATETYPE_ORDERS, s);
+
+	stream_set_pos(update->orders, 0);
+	update->number_orders = 0;
 }
 
 static void update_write_refresh_rect(STREAM* s, uint8 count, RECTANGLE_16* areas)
@@ -390,11 +410,252 @@ static void update_send_suppress_output(rdpContext* context, uint8 allow, RECTAN
 	rdp_send_data_pdu(rdp, s, DATA_PDU_TYPE_SUPPRESS_OUTPUT, rdp->mcs->user_id);
 }
 
+static void update_send_frame_acknowledge(rdpContext* context, uint32 frameId)
+{
+	STREAM* s;
+	rdpRdp* rdp = context->rdp;
+
+	s = rdp_data_pdu_init(rdp);
+	stream_write_uint32(s, frameId); /* frameID (4 bytes) */
+
+	rdp_send_data_pdu(rdp, s, DATA_PDU_TYPE_FRAME_ACKNOWLEDGE, rdp->mcs->user_id);
+}
+
+boolean update_recv_frame_acknowledge(rdpUpdate* update, STREAM* s)
+{
+	uint32 frameId;
+
+	if (stream_get_left(s) < 4)
+		return false;
+
+	stream_read_uint32(s, frameId); /* frameID (4 bytes) */
+
+	IFCALL(update->SurfaceFrameAcknowledge, update->context, frameId);
+
+	return true;
+}
+
+static void update_write_bitmap_data(STREAM* s, BITMAP_DATA* bitmap_data)
+{
+	uint16 flags;
+	int Bpp = (bitmap_data->bitsPerPixel + 7) / 8;
+
+	stream_check_size(s, 26 + (int) bitmap_data->bitmapLength);
+
+	stream_write_uint16(s, bitmap_data->destLeft);
+	stream_write_uint16(s, bitmap_data->destTop);
+	stream_write_uint16(s, bitmap_data->destRight);
+	stream_write_uint16(s, bitmap_data->destBottom);
+	stream_write_uint16(s, bitmap_data->width);
+	stream_write_uint16(s, bitmap_data->height);
+	stream_write_uint16(s, bitmap_data->bitsPerPixel);
+
+	if (bitmap_data->compressed)
+	{
+		flags = (bitmap_data->flags | BITMAP_COMPRESSION);
+		stream_write_uint16(s, flags);
+
+		if (!(flags & NO_BITMAP_COMPRESSION_HDR))
+		{
+			stream_write_uint16(s, bitmap_data->bitmapLength + 8);
+			stream_write_uint16(s, 0); /* cbCompFirstRowSize (2 bytes) */
+			stream_write_uint16(s, bitmap_data->bitmapLength); /* cbCompMainBodySize (2 bytes) */
+			stream_write_uint16(s, bitmap_data->width * Bpp); /* cbScanWidth (2 bytes) */
+			stream_write_uint16(s, bitmap_data->width * bitmap_data->height * Bpp); /* cbUncompressedSize (2 bytes) */
+		}
+		else
+		{
+			stream_write_uint16(s, bitmap_data->bitmapLength);
+		}
+	}
+	else
+	{
+		flags = (bitmap_data->flags & ~BITMAP_COMPRESSION);
+		stream_write_uint16(s, flags);
+		stream_write_uint16(s, bitmap_data->bitmapLength);
+	}
+
+	stream_write(s, bitmap_data->bitmapDataStream, bitmap_data->bitmapLength);
+}
+
+static STREAM* update_bitmap_pdu_init(rdpRdp* rdp, uint8** count_mark)
+{
+	STREAM* s;
+
+	s = fastpath_update_pdu_init(rdp->fastpath);
+	stream_write_uint16(s, UPDATE_TYPE_BITMAP); /* updateType (2 bytes) */
+	stream_get_mark(s, *count_mark);
+	stream_write_uint16(s, 0); /* numberRectangles (2 bytes) */
+
+	return s;
+}
+
+static void update_send_bitmap_pdu(rdpRdp* rdp, STREAM* s, uint8* count_mark, uint16 count)
+{
+	uint8* bm;
+
+	stream_get_mark(s, bm);
+	stream_set_mark(s, count_mark);
+	stream_write_uint16(s, count); /* numberRectangles (2 bytes) */
+	stream_set_mark(s, bm);
+
+	fastpath_send_update_pdu(rdp->fastpath, FASTPATH_UPDATETYPE_BITMAP, s);
+}
+
+/**
+ * Send a bitmap update.\n
+ * Compressed rectangles are sent as they are. Uncompressed rectangles carry
+ * top-down pixel data which is split into 64x64 tiles, compressed with
+ * interleaved RLE (planar for 32bpp) and packed into as few PDUs as the
+ * client's maximum request size allows. A tile the encoder cannot compress
+ * is sent uncompressed.
+ */
+static void update_send_bitmap_update(rdpContext* context, BITMAP_UPDATE* bitmap_update)
+{
+	int i;
+	int x, y;
+	int Bpp;
+	int length;
+	int scanline;
+	uint16 count;
+	uint32 maxSize;
+	uint8* tile;
+	uint8* src;
+	uint8* count_mark;
+	STREAM* s;
+	STREAM* data;
+	BITMAP_DATA* bitmap_data;
+	BITMAP_DATA tile_data;
+	rdpRdp* rdp = context->rdp;
+
+	update_flush_orders(rdp->update);
+
+	maxSize = rdp->settings->multifrag_max_request_size;
+
+	if (maxSize == 0 || maxSize > BITMAP_UPDATE_MAX_SIZE)
+		maxSize = BITMAP_UPDATE_MAX_SIZE;
+
+	count = 0;
+	data = NULL;
+	tile = NULL;
+	s = update_bitmap_pdu_init(rdp, &count_mark);
+
+	for (i = 0; i < (int) bitmap_update->number; i++)
+	{
+		bitmap_data = &bitmap_update->rectangles[i];
+
+		if (bitmap_data->compressed)
+		{
+			if (count > 0 && stream_get_length(s) + 26 + bitmap_data->bitmapLength > maxSize)
+			{
+				update_send_bitmap_pdu(rdp, s, count_mark, count);
+				s = update_bitmap_pdu_init(rdp, &count_mark);
+				count = 0;
+			}
+
+			update_write_bitmap_data(s, bitmap_data);
+			count++;
+			continue;
+		}
+
+		if (data == NULL)
+		{
+			data = stream_new(BITMAP_TILE_SIZE * BITMAP_TILE_SIZE * 4);
+			tile = (uint8*) xmalloc(BITMAP_TILE_SIZE * BITMAP_TILE_SIZE * 4);
+		}
+
+		Bpp = (bitmap_data->bitsPerPixel + 7) / 8;
+		scanline = bitmap_data->width * Bpp;
+
+		for (y = 0; y < (int) bitmap_data->height; y += BITMAP_TILE_SIZE)
+		{
+			for (x = 0; x < (int) bitmap_data->width; x += BITMAP_TILE_SIZE)
+			{
+				memset(&tile_data, 0, sizeof(BITMAP_DATA));
+				tile_data.bitsPerPixel = bitmap_data->bitsPerPixel;
+				tile_data.destLeft = bitmap_data->destLeft + x;
+				tile_data.destTop = bitmap_data->destTop + y;
+				tile_data.height = MIN(BITMAP_TILE_SIZE, bitmap_data->height - y);
+				length = MIN(BITMAP_TILE_SIZE, bitmap_data->width - x);
+				tile_data.destRight = tile_data.destLeft + length - 1;
+				tile_data.destBottom = tile_data.destTop + tile_data.height - 1;
+
+				/* bitmap widths are sent as multiples of four, pad by repeating the last column */
+				tile_data.width = (length + 3) & ~3;
+				src = &bitmap_data->bitmapDataStream[y * scanline + x * Bpp];
+
+				if (tile_data.width != length)
+				{
+					int row, col;
+
+					for (row = 0; row < (int) tile_data.height; row++)
+					{
+						memcpy(&tile[row * tile_data.width * Bpp], &src[row * scanline], length * Bpp);
+
+						for (col = length; col < (int) tile_data.width; col++)
+						{
+							memcpy(&tile[(row * tile_data.width + col) * Bpp],
+									&src[row * scanline + (length - 1) * Bpp], Bpp);
+						}
+					}
+
+					src = tile;
+				}
+
+				stream_set_pos(data, 0);
+
+				if (bitmap_compress(src, data, tile_data.width, tile_data.height,
+						(src == tile) ? tile_data.width * Bpp : scanline, tile_data.bitsPerPixel))
+				{
+					tile_data.compressed = true;
+				}
+				else
+				{
+					int row;
+					int rowstride = (src == tile) ? tile_data.width * Bpp : scanline;
+
+					/* sent as is rather than leaving the client with stale pixels, bottom-up */
+					stream_set_pos(data, 0);
+
+					for (row = tile_data.height - 1; row >= 0; row--)
+						stream_write(data, &src[row * rowstride], tile_data.width * Bpp);
+
+					tile_data.compressed = false;
+				}
+
+				tile_data.bitmapLength = stream_get_length(data);
+				tile_data.bitmapDataStream = stream_get_head(data);
+
+				if (count > 0 && stream_get_length(s) + 26 + tile_data.bitmapLength > maxSize)
+				{
+					update_send_bitmap_pdu(rdp, s, count_mark, count);
+					s = update_bitmap_pdu_init(rdp, &count_mark);
+					count = 0;
+				}
+
+				update_write_bitmap_data(s, &tile_data);
+				count++;
+			}
+		}
+	}
+
+	if (count > 0)
+		update_send_bitmap_pdu(rdp, s, count_mark, count);
+
+	if (data != NULL)
+	{
+		stream_free(data);
+		xfree(tile);
+	}
+}
+
 static void update_send_surface_command(rdpContext* context, STREAM* s)
 {
 	STREAM* update;
 	rdpRdp* rdp = context->rdp;
 
+	update_flush_orders(rdp->update);
+
 	update = fastpath_update_pdu_init(rdp->fastpath);
 	stream_check_size(update, stream_get_length(s));
 	stream_write(update, stream_get_head(s), stream_get_length(s));
@@ -406,6 +667,8 @@ static void update_send_surface_bits(rdpContext* context, SURFACE_BITS_COMMAND*
 	STREAM* s;
 	rdpRdp* rdp = context->rdp;
 
+	update_flush_orders(rdp->update);
+
 	s = fastpath_update_pdu_init(rdp->fastpath);
 	stream_check_size(s, SURFCMD_SURFACE_BITS_HEADER_LENGTH + (int) surface_bits_command->bitmapDataLength);
 	update_write_surfcmd_surface_bits_header(s, surface_bits_command);
@@ -418,6 +681,8 @@ static void update_send_surface_frame_marker(rdpContext* context, SURFACE_FRAME_
 	STREAM* s;
 	rdpRdp* rdp = context->rdp;
 
+	update_flush_orders(rdp->update);
+
 	s = fastpath_update_pdu_init(rdp->fastpath);
 	update_write_surfcmd_frame_marker(s, surface_frame_marker->frameAction, surface_frame_marker->frameId);
 	fastpath_send_update_pdu(rdp->fastpath, FASTPATH_UPDATETYPE_SURFCMDS, s);
@@ -428,6 +693,8 @@ static void update_send_synchronize(rdpContext* context)
 	STREAM* s;
 	rdpRdp* rdp = context->rdp;
 
+	update_flush_orders(rdp->update);
+
 	s = fastpath_update_pdu_init(rdp->fastpath);
 	stream_write_zero(s, 2); /* pad2Octets (2 bytes) */
 	fastpath_send_update_pdu(rdp->fastpath, FASTPATH_UPDATETYPE_SYNCHRONIZE, s);
@@ -435,30 +702,244 @@ static void update_send_synchronize(rdpContext* context)
 
 static void update_send_desktop_resize(rdpContext* context)
 {
+	update_flush_orders(context->rdp->update);
 	rdp_server_reactivate(context->rdp);
 }
 
+static void update_send_begin_paint(rdpContext* context)
+{
+	rdpUpdate* update = context->rdp->update;
+
+	update_flush_orders(update);
+	update->batch_orders = true;
+}
+
+static void update_send_end_paint(rdpContext* context)
+{
+	rdpUpdate* update = context->rdp->update;
+
+	update->batch_orders = false;
+	update_flush_orders(update);
+}
+
+static void update_send_set_bounds(rdpContext* context, rdpBounds* bounds)
+{
+	rdpUpdate* update = context->rdp->update;
+
+	if (bounds != NULL)
+	{
+		update->use_bounds = true;
+		memcpy(&update->bounds, bounds, sizeof(rdpBounds));
+	}
+	else
+	{
+		update->use_bounds = false;
+	}
+}
+
+/**
+ * Make room for an order of up to the given size in the current orders
+ * update, sending what it holds first when it could not take the order.
+ */
+
+static void update_prepare_order(rdpUpdate* update, int size)
+{
+	if (update->number_orders > 0)
+	{
+		if (stream_get_length(update->orders) + size > ORDERS_UPDATE_MAX_SIZE ||
+				update->number_orders == 0xFFFF)
+			update_flush_orders(update);
+	}
+}
+
+/* Outside of BeginPaint and EndPaint each order is sent right away */
+static void update_finish_order(rdpUpdate* update)
+{
+	update->number_orders++;
+
+	if (update->batch_orders != true)
+		update_flush_orders(update);
+}
+
+static void update_send_primary_order(rdpContext* context, uint8 orderType, void* order)
+{
+	rdpUpdate* update = context->rdp->update;
+
+	update_prepare_order(update, PRIMARY_DRAWING_ORDER_MAX_SIZE);
+	update_write_primary_order(update->orders, update->primary, orderType, order,
+			update->use_bounds ? &update->bounds : NULL);
+	update_finish_order(update);
+}
+
+static void update_send_dstblt(rdpContext* context, DSTBLT_ORDER* dstblt)
+{
+	update_send_primary_order(context, ORDER_TYPE_DSTBLT, dstblt);
+}
+
+static void update_send_patblt(rdpContext* context, PATBLT_ORDER* patblt)
+{
+	update_send_primary_order(context, ORDER_TYPE_PATBLT, patblt);
+}
+
 static void update_send_scrblt(rdpContext* context, SCRBLT_ORDER* scrblt)
 {
-	STREAM* s;
-	rdpRdp* rdp = context->rdp;
+	update_send_primary_order(context, ORDER_TYPE_SCRBLT, scrblt);
+}
 
-	s = fastpath_update_pdu_init(rdp->fastpath);
+static void update_send_opaque_rect(rdpContext* context, OPAQUE_RECT_ORDER* opaque_rect)
+{
+	update_send_primary_order(context, ORDER_TYPE_OPAQUE_RECT, opaque_rect);
+}
+
+static void update_send_draw_nine_grid(rdpContext* context, DRAW_NINE_GRID_ORDER* draw_nine_grid)
+{
+	update_send_primary_order(context, ORDER_TYPE_DRAW_NINE_GRID, draw_nine_grid);
+}
 
-	stream_write_uint16(s, 1); /* numberOrders (2 bytes) */
-	stream_write_uint8(s, ORDER_STANDARD | ORDER_TYPE_CHANGE); /* controlFlags (1 byte) */
-	stream_write_uint8(s, ORDER_TYPE_SCRBLT); /* orderType (1 byte) */
-	stream_write_uint8(s, 0x7F); /* fieldFlags (variable) */
+static void update_send_multi_dstblt(rdpContext* context, MULTI_DSTBLT_ORDER* multi_dstblt)
+{
+	update_send_primary_order(context, ORDER_TYPE_MULTI_DSTBLT, multi_dstblt);
+}
 
-	stream_write_uint16(s, scrblt->nLeftRect);
-	stream_write_uint16(s, scrblt->nTopRect);
-	stream_write_uint16(s, scrblt->nWidth);
-	stream_write_uint16(s, scrblt->nHeight);
-	stream_write_uint8(s, scrblt->bRop);
-	stream_write_uint16(s, scrblt->nXSrc);
-	stream_write_uint16(s, scrblt->nYSrc);
+static void update_send_multi_patblt(rdpContext* context, MULTI_PATBLT_ORDER* multi_patblt)
+{
+	update_send_primary_order(context, ORDER_TYPE_MULTI_PATBLT, multi_patblt);
+}
 
-	fastpath_send_update_pdu(rdp->fastpath, FASTPATH_UPDATETYPE_ORDERS, s);
+static void update_send_multi_scrblt(rdpContext* context, MULTI_SCRBLT_ORDER* multi_scrblt)
+{
+	update_send_primary_order(context, ORDER_TYPE_MULTI_SCRBLT, multi_scrblt);
+}
+
+static void update_send_multi_opaque_rect(rdpContext* context, MULTI_OPAQUE_RECT_ORDER* multi_opaque_rect)
+{
+	update_send_primary_order(context, ORDER_TYPE_MULTI_OPAQUE_RECT, multi_opaque_rect);
+}
+
+static void update_send_multi_draw_nine_grid(rdpContext* context, MULTI_DRAW_NINE_GRID_ORDER* multi_draw_nine_grid)
+{
+	update_send_primary_order(context, ORDER_TYPE_MULTI_DRAW_NINE_GRID, multi_draw_nine_grid);
+}
+
+static void update_send_line_to(rdpContext* context, LINE_TO_ORDER* line_to)
+{
+	update_send_primary_order(context, ORDER_TYPE_LINE_TO, line_to);
+}
+
+/* a long polyline goes out as several orders, each starting where the last one ended */
+static void update_send_polyline(rdpContext* context, POLYLINE_ORDER* polyline)
+{
+	int i;
+	int count;
+	int remaining;
+	POLYLINE_ORDER part;
+
+	part = *polyline;
+	remaining = polyline->numPoints;
+
+	do
+	{
+		count = update_polyline_points_fit(part.points, remaining);
+		part.numPoints = count;
+
+		update_send_primary_order(context, ORDER_TYPE_POLYLINE, &part);
+
+		for (i = 0; i < count; i++)
+		{
+			part.xStart += part.points[i].x;
+			part.yStart += part.points[i].y;
+		}
+
+		part.points += count;
+		remaining -= count;
+	}
+	while (remaining > 0);
+}
+
+static void update_send_memblt(rdpContext* context, MEMBLT_ORDER* memblt)
+{
+	update_send_primary_order(context, ORDER_TYPE_MEMBLT, memblt);
+}
+
+static void update_send_mem3blt(rdpContext* context, MEM3BLT_ORDER* mem3blt)
+{
+	update_send_primary_order(context, ORDER_TYPE_MEM3BLT, mem3blt);
+}
+
+static void update_send_save_bitmap(rdpContext* context, SAVE_BITMAP_ORDER* save_bitmap)
+{
+	update_send_primary_order(context, ORDER_TYPE_SAVE_BITMAP, save_bitmap);
+}
+
+static void update_send_glyph_index(rdpContext* context, GLYPH_INDEX_ORDER* glyph_index)
+{
+	update_send_primary_order(context, ORDER_TYPE_GLYPH_INDEX, glyph_index);
+}
+
+static void update_send_fast_index(rdpContext* context, FAST_INDEX_ORDER* fast_index)
+{
+	update_send_primary_order(context, ORDER_TYPE_FAST_INDEX, fast_index);
+}
+
+static void update_send_fast_glyph(rdpContext* context, FAST_GLYPH_ORDER* fast_glyph)
+{
+	update_send_primary_order(context, ORDER_TYPE_FAST_GLYPH, fast_glyph);
+}
+
+static void update_send_polygon_sc(rdpContext* context, POLYGON_SC_ORDER* polygon_sc)
+{
+	update_send_primary_order(context, ORDER_TYPE_POLYGON_SC, polygon_sc);
+}
+
+static void update_send_polygon_cb(rdpContext* context, POLYGON_CB_ORDER* polygon_cb)
+{
+	update_send_primary_order(context, ORDER_TYPE_POLYGON_CB, polygon_cb);
+}
+
+static void update_send_ellipse_sc(rdpContext* context, ELLIPSE_SC_ORDER* ellipse_sc)
+{
+	update_send_primary_order(context, ORDER_TYPE_ELLIPSE_SC, ellipse_sc);
+}
+
+static void update_send_ellipse_cb(rdpContext* context, ELLIPSE_CB_ORDER* ellipse_cb)
+{
+	update_send_primary_order(context, ORDER_TYPE_ELLIPSE_CB, ellipse_cb);
+}
+
+static void update_send_cache_bitmap_v2(rdpContext* context, CACHE_BITMAP_V2_ORDER* cache_bitmap_v2)
+{
+	rdpUpdate* update = context->rdp->update;
+
+	update_prepare_order(update, update_approximate_cache_bitmap_v2_order(cache_bitmap_v2));
+	update_write_cache_bitmap_v2_order(update->orders, cache_bitmap_v2);
+	update_finish_order(update);
+}
+
+static void update_send_cache_glyph(rdpContext* context, CACHE_GLYPH_ORDER* cache_glyph)
+{
+	rdpUpdate* update = context->rdp->update;
+
+	update_prepare_order(update, update_approximate_cache_glyph_order(cache_glyph));
+	update_write_cache_glyph_order(update->orders, cache_glyph);
+	update_finish_order(update);
+}
+
+static void update_send_cache_glyph_v2(rdpContext* context, CACHE_GLYPH_V2_ORDER* cache_glyph_v2)
+{
+	rdpUpdate* update = context->rdp->update;
+
+	update_prepare_order(update, update_approximate_cache_glyph_v2_order(cache_glyph_v2));
+	update_write_cache_glyph_v2_order(update->orders, cache_glyph_v2);
+	update_finish_order(update);
+}
+
+static void update_send_cache_brush(rdpContext* context, CACHE_BRUSH_ORDER* cache_brush)
+{
+	rdpUpdate* update = context->rdp->update;
+
+	update_prepare_order(update, update_approximate_cache_brush_order(cache_brush));
+	update_write_cache_brush_order(update->orders, cache_brush);
+	update_finish_order(update);
 }
 
 static void update_send_pointer_system(rdpContext* context, POINTER_SYSTEM_UPDATE* pointer_system)
@@ -467,6 +948,8 @@ static void update_send_pointer_system(rdpContext* context, POINTER_SYSTEM_UPDAT
 	uint8 updateCode;
 	rdpRdp* rdp = context->rdp;
 
+	update_flush_orders(rdp->update);
+
 	s = fastpath_update_pdu_init(rdp->fastpath);
 	if (pointer_system->type == SYSPTR_NULL)
 		updateCode = FASTPATH_UPDATETYPE_PTR_NULL;
@@ -497,6 +980,8 @@ static void update_send_pointer_color(rdpContext* context, POINTER_COLOR_UPDATE*
 	STREAM* s;
 	rdpRdp* rdp = context->rdp;
 
+	update_flush_orders(rdp->update);
+
 	s = fastpath_update_pdu_init(rdp->fastpath);
         update_write_pointer_color(s, pointer_color);
 	fastpath_send_update_pdu(rdp->fastpath, FASTPATH_UPDATETYPE_COLOR, s);
@@ -507,6 +992,8 @@ static void update_send_pointer_new(rdpContext* context, POINTER_NEW_UPDATE* poi
 	STREAM* s;
 	rdpRdp* rdp = context->rdp;
 
+	update_flush_orders(rdp->update);
+
 	s = fastpath_update_pdu_init(rdp->fastpath);
 	stream_write_uint16(s, pointer_new->xorBpp); /* xorBpp (2 bytes) */
         update_write_pointer_color(s, &pointer_new->colorPtrAttr);
@@ -518,6 +1005,8 @@ static void update_send_pointer_cached(rdpContext* context, POINTER_CACHED_UPDAT
 	STREAM* s;
 	rdpRdp* rdp = context->rdp;
 
+	update_flush_orders(rdp->update);
+
 	s = fastpath_update_pdu_init(rdp->fastpath);
 	stream_write_uint16(s, pointer_cached->cacheIndex); /* cacheIndex (2 bytes) */
 	fastpath_send_update_pdu(rdp->fastpath, FASTPATH_UPDATETYPE_CACHED, s);
@@ -525,16 +1014,44 @@ static void update_send_pointer_cached(rdpContext* context, POINTER_CACHED_UPDAT
 
 void update_register_server_callbacks(rdpUpdate* update)
 {
-	update->BeginPaint = update_begin_paint;
-	update->EndPaint = update_end_paint;
+	update->BeginPaint = update_send_begin_paint;
+	update->EndPaint = update_send_end_paint;
+	update->SetBounds = update_send_set_bounds;
 	update->Synchronize = update_send_synchronize;
 	update->DesktopResize = update_send_desktop_resize;
+	update->BitmapUpdate = update_send_bitmap_update;
 	update->RefreshRect = update_send_refresh_rect;
 	update->SuppressOutput = update_send_suppress_output;
 	update->SurfaceBits = update_send_surface_bits;
+	update->SurfaceFrameAcknowledge = NULL; /* set by the server to be told of acknowledgements */
 	update->SurfaceFrameMarker = update_send_surface_frame_marker;
 	update->SurfaceCommand = update_send_surface_command;
+	update->primary->DstBlt = update_send_dstblt;
+	update->primary->PatBlt = update_send_patblt;
 	update->primary->ScrBlt = update_send_scrblt;
+	update->primary->OpaqueRect = update_send_opaque_rect;
+	update->primary->DrawNineGrid = update_send_draw_nine_grid;
+	update->primary->MultiDstBlt = update_send_multi_dstblt;
+	update->primary->MultiPatBlt = update_send_multi_patblt;
+	update->primary->MultiScrBlt = update_send_multi_scrblt;
+	update->primary->MultiOpaqueRect = update_send_multi_opaque_rect;
+	update->primary->MultiDrawNineGrid = update_send_multi_draw_nine_grid;
+	update->primary->LineTo = update_send_line_to;
+	update->primary->Polyline = update_send_polyline;
+	update->primary->MemBlt = update_send_memblt;
+	update->primary->Mem3Blt = update_send_mem3blt;
+	update->primary->SaveBitmap = update_send_save_bitmap;
+	update->primary->GlyphIndex = update_send_glyph_index;
+	update->primary->FastIndex = update_send_fast_index;
+	update->primary->FastGlyph = update_send_fast_glyph;
+	update->primary->PolygonSC = update_send_polygon_sc;
+	update->primary->PolygonCB = update_send_polygon_cb;
+	update->primary->EllipseSC = update_send_ellipse_sc;
+	update->primary->EllipseCB = update_send_ellipse_cb;
+	update->secondary->CacheBitmapV2 = update_send_cache_bitmap_v2;
+	update->secondary->CacheGlyph = update_send_cache_glyph;
+	update->secondary->CacheGlyphV2 = update_send_cache_glyph_v2;
+	update->secondary->CacheBrush = update_send_cache_brush;
 	update->pointer->PointerSystem = update_send_pointer_system;
 	update->pointer->PointerColor = update_send_pointer_color;
 	update->pointer->PointerNew = update_send_pointer_new;
@@ -565,7 +1082,10 @@ rdpUpdate* update_new(rdpRdp* rdp)
 		deleteList->indices = xmalloc(deleteList->sIndices * 2);
 		deleteList->cIndices = 0;
 
+		update->orders = stream_new(ORDERS_UPDATE_MAX_SIZE);
+
 		update->SuppressOutput = update_send_suppress_output;
+		update->SurfaceFrameAcknowledge = update_send_frame_acknowledge;
 	}
 
 	return update;
@@ -579,6 +1099,7 @@ void update_free(rdpUpdate* update)
 		deleteList = &(update->altsec->create_offscreen_bitmap.deleteList);
 		xfree(deleteList->indices);
 
+		stream_free(update->orders);
 		xfree(update->bitmap_update.rectangles);
 		xfree(update->pointer);
 		xfree(update->primary);
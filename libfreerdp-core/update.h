@@ -35,6 +35,12 @@
 #define BITMAP_COMPRESSION		0x0001
 #define NO_BITMAP_COMPRESSION_HDR	0x0400
 
+#define BITMAP_TILE_SIZE		64
+#define BITMAP_UPDATE_MAX_SIZE		0x10000
+
+/* Batched orders stay within a single fast-path fragment */
+#define ORDERS_UPDATE_MAX_SIZE		0x3F00
+
 rdpUpdate* update_new(rdpRdp* rdp);
 void update_free(rdpUpdate* update);
 void update_free_bitmap(BITMAP_UPDATE* bitmap_update);
@@ -45,6 +51,7 @@ void update_read_palette(rdpUpdate* update, STREAM* s, PALETTE_UPDATE* palette_u
 void update_recv_play_sound(rdpUpdate* update, STREAM* s);
 void update_recv_pointer(rdpUpdate* update, STREAM* s);
 void update_recv(rdpUpdate* update, STREAM* s);
+boolean update_recv_frame_acknowledge(rdpUpdate* update, STREAM* s);
 
 void update_read_pointer_position(STREAM* s, POINTER_POSITION_UPDATE* pointer_position);
 void update_read_pointer_system(STREAM* s, POINTER_SYSTEM_UPDATE* pointer_system);
@@ -33,6 +33,8 @@
 
 #include <freerdp/gdi/16bpp.h>
 
+#include "rop.h"
+
 uint16 gdi_get_color_16bpp(HGDI_DC hdc, GDI_COLOR color)
 {
 	uint8 r, g, b;
@@ -68,8 +70,6 @@ uint16 gdi_get_color_16bpp(HGDI_DC hdc, GDI_COLOR color)
 
 int FillRect_16bpp(HGDI_DC hdc, HGDI_RECT rect, HGDI_BRUSH hbr)
 {
-	int x, y;
-	uint16 *dstp;
 	int nXDest, nYDest;
 	int nWidth, nHeight;
 
@@ -82,19 +82,7 @@ int FillRect_16bpp(HGDI_DC hdc, HGDI_RECT rect, HGDI_BRUSH hbr)
 
 	color16 = gdi_get_color_16bpp(hdc, hbr->color);
 
-	for (y = 0; y < nHeight; y++)
-	{
-		dstp = (uint16*) gdi_get_bitmap_pointer(hdc, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp = color16;
-				dstp++;
-			}
-		}
-	}
+	gdi_rop_blt(hdc, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, (uint8*) &color16, ROP_ROW_PATCOPY);
 
 	gdi_InvalidateRegion(hdc, nXDest, nYDest, nWidth, nHeight);
 	return 0;
@@ -195,174 +183,37 @@ static int BitBlt_SRCCOPY_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWi
 
 static int BitBlt_NOTSRCCOPY_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint16* srcp;
-	uint16* dstp;
-	
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint16*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint16*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp = ~(*srcp);
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_NOTSRCCOPY);
 }
 
 static int BitBlt_DSTINVERT_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight)
 {
-	int x, y;
-	uint16* dstp;
-		
-	for (y = 0; y < nHeight; y++)
-	{
-		dstp = (uint16*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp = ~(*dstp);
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, NULL, ROP_ROW_DSTINVERT);
 }
 
 static int BitBlt_SRCERASE_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint16* srcp;
-	uint16* dstp;
-		
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint16*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint16*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp = *srcp & ~(*dstp);
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_SRCERASE);
 }
 
 static int BitBlt_NOTSRCERASE_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint16* srcp;
-	uint16* dstp;
-		
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint16*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint16*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp = ~(*srcp) & ~(*dstp);
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_NOTSRCERASE);
 }
 
 static int BitBlt_SRCINVERT_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint16* srcp;
-	uint16* dstp;
-		
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint16*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint16*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp ^= *srcp;
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_SRCINVERT);
 }
 
 static int BitBlt_SRCAND_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint16* srcp;
-	uint16* dstp;
-		
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint16*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint16*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp &= *srcp;
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_SRCAND);
 }
 
 static int BitBlt_SRCPAINT_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint16* srcp;
-	uint16* dstp;
-		
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint16*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint16*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp |= *srcp;
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_SRCPAINT);
 }
 
 static int BitBlt_DSPDxax_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
@@ -409,275 +260,64 @@ static int BitBlt_DSPDxax_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWi
 
 static int BitBlt_SPna_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint16* srcp;
-	uint16* dstp;
-	uint16* patp;
-	
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint16*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint16*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				patp = (uint16*) gdi_get_brush_pointer(hdcDest, x, y);
-				*dstp = *srcp & ~(*patp);
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-	
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_SPna);
 }
 
 static int BitBlt_DPa_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight)
 {
-	int x, y;
-	uint16* dstp;
-	uint16* patp;
-
-	for (y = 0; y < nHeight; y++)
-	{
-		dstp = (uint16*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				patp = (uint16*) gdi_get_brush_pointer(hdcDest, x, y);
-
-				*dstp = *dstp & *patp;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, NULL, ROP_ROW_DPa);
 }
 
 static int BitBlt_PDxn_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight)
 {
-	int x, y;
-	uint16* dstp;
-	uint16* patp;
-
-	for (y = 0; y < nHeight; y++)
-	{
-		dstp = (uint16*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				patp = (uint16*) gdi_get_brush_pointer(hdcDest, x, y);
-				*dstp = *dstp ^ ~(*patp);
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, NULL, ROP_ROW_PDxn);
 }
 
 static int BitBlt_DSna_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint16* srcp;
-	uint16* dstp;
-
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint16*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint16*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp = ~(*srcp) & (*dstp);
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_DSna);
 }
 
 
 static int BitBlt_MERGECOPY_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint16* srcp;
-	uint16* dstp;
-	uint16* patp;
-	
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint16*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint16*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				patp = (uint16*) gdi_get_brush_pointer(hdcDest, x, y);
-				*dstp = *srcp & *patp;
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-	
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_MERGECOPY);
 }
 
 static int BitBlt_MERGEPAINT_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint16* srcp;
-	uint16* dstp;
-	
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint16*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint16*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{				
-				*dstp = ~(*srcp) | *dstp;
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-	
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_MERGEPAINT);
 }
 
 static int BitBlt_PATCOPY_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight)
 {
-	int x, y;
-	uint16* dstp;
-	uint16* patp;
 	uint16 color16;
 
 	if (hdcDest->brush->style == GDI_BS_SOLID)
 	{
 		color16 = gdi_get_color_16bpp(hdcDest, hdcDest->brush->color);
-
-		for (y = 0; y < nHeight; y++)
-		{
-			dstp = (uint16*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-			if (dstp != 0)
-			{
-				for (x = 0; x < nWidth; x++)
-				{
-					*dstp = color16;
-					dstp++;
-				}
-			}
-		}
-	}
-	else
-	{
-		for (y = 0; y < nHeight; y++)
-		{
-			dstp = (uint16*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-			if (dstp != 0)
-			{
-				for (x = 0; x < nWidth; x++)
-				{
-					patp = (uint16*) gdi_get_brush_pointer(hdcDest, x, y);
-					*dstp = *patp;
-					dstp++;
-				}
-			}
-		}
+		return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, (uint8*) &color16, ROP_ROW_PATCOPY);
 	}
 
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, NULL, ROP_ROW_PATCOPY);
 }
 
 static int BitBlt_PATINVERT_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight)
 {
-	int x, y;
-	uint16* dstp;
-	uint16* patp;
 	uint16 color16;
 
 	if (hdcDest->brush->style == GDI_BS_SOLID)
 	{
 		color16 = gdi_get_color_16bpp(hdcDest, hdcDest->brush->color);
-
-		for (y = 0; y < nHeight; y++)
-		{
-			dstp = (uint16*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-			if (dstp != 0)
-			{
-				for (x = 0; x < nWidth; x++)
-				{
-					*dstp ^= color16;
-					dstp++;
-				}
-			}
-		}
+		return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, (uint8*) &color16, ROP_ROW_PATINVERT);
 	}
-	else
-	{
-		for (y = 0; y < nHeight; y++)
-		{
-			dstp = (uint16*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
 
-			if (dstp != 0)
-			{
-				for (x = 0; x < nWidth; x++)
-				{
-					patp = (uint16*) gdi_get_brush_pointer(hdcDest, x, y);
-					*dstp = *patp ^ *dstp;
-					dstp++;
-				}
-			}
-		}
-	}
-	
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, NULL, ROP_ROW_PATINVERT);
 }
 
 static int BitBlt_PATPAINT_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint16* srcp;
-	uint16* dstp;
-	uint16* patp;
-	
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint16*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint16*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				patp = (uint16*) gdi_get_brush_pointer(hdcDest, x, y);
-				*dstp = *dstp | (*patp | ~(*srcp));
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-	
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_PATPAINT);
 }
 
 int BitBlt_16bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc, int rop)
@@ -33,6 +33,8 @@
 
 #include <freerdp/gdi/32bpp.h>
 
+#include "rop.h"
+
 uint32 gdi_get_color_32bpp(HGDI_DC hdc, GDI_COLOR color)
 {
 	uint32 color32;
@@ -55,8 +57,6 @@ uint32 gdi_get_color_32bpp(HGDI_DC hdc, GDI_COLOR color)
 
 int FillRect_32bpp(HGDI_DC hdc, HGDI_RECT rect, HGDI_BRUSH hbr)
 {
-	int x, y;
-	uint32 *dstp;
 	uint32 color32;
 	int nXDest, nYDest;
 	int nWidth, nHeight;
@@ -68,19 +68,7 @@ int FillRect_32bpp(HGDI_DC hdc, HGDI_RECT rect, HGDI_BRUSH hbr)
 
 	color32 = gdi_get_color_32bpp(hdc, hbr->color);
 
-	for (y = 0; y < nHeight; y++)
-	{
-		dstp = (uint32*) gdi_get_bitmap_pointer(hdc, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp = color32;
-				dstp++;
-			}
-		}
-	}
+	gdi_rop_blt(hdc, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, (uint8*) &color32, ROP_ROW_PATCOPY);
 
 	gdi_InvalidateRegion(hdc, nXDest, nYDest, nWidth, nHeight);
 	return 0;
@@ -212,174 +200,37 @@ static int BitBlt_SRCCOPY_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWi
 
 static int BitBlt_NOTSRCCOPY_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint32* srcp;
-	uint32* dstp;
-	
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint32*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint32*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp = ~(*srcp);
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_NOTSRCCOPY);
 }
 
 static int BitBlt_DSTINVERT_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight)
 {
-	int x, y;
-	uint32* dstp;
-		
-	for (y = 0; y < nHeight; y++)
-	{
-		dstp = (uint32*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp = ~(*dstp);
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, NULL, ROP_ROW_DSTINVERT);
 }
 
 static int BitBlt_SRCERASE_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint32* srcp;
-	uint32* dstp;
-		
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint32*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint32*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp = *srcp & ~(*dstp);
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_SRCERASE);
 }
 
 static int BitBlt_NOTSRCERASE_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint32* srcp;
-	uint32* dstp;
-		
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint32*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint32*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp = ~(*srcp) & ~(*dstp);
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_NOTSRCERASE);
 }
 
 static int BitBlt_SRCINVERT_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint32* srcp;
-	uint32* dstp;
-		
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint32*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint32*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp ^= *srcp;
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_SRCINVERT);
 }
 
 static int BitBlt_SRCAND_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint32* srcp;
-	uint32* dstp;
-		
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint32*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint32*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp &= *srcp;
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_SRCAND);
 }
 
 static int BitBlt_SRCPAINT_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint32* srcp;
-	uint32* dstp;
-		
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint32*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint32*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp |= *srcp;
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_SRCPAINT);
 }
 
 static int BitBlt_DSPDxax_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
@@ -436,277 +287,63 @@ static int BitBlt_DSPDxax_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWi
 
 static int BitBlt_SPna_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint32* srcp;
-	uint32* dstp;
-	uint32* patp;
-	
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint32*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint32*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				patp = (uint32*) gdi_get_brush_pointer(hdcDest, x, y);
-				
-				*dstp = *srcp & ~(*patp);
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-	
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_SPna);
 }
 
 static int BitBlt_DSna_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint32* srcp;
-	uint32* dstp;
-
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint32*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint32*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp = ~(*srcp) & (*dstp);
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_DSna);
 }
 
 static int BitBlt_DPa_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight)
 {
-	int x, y;
-	uint32* dstp;
-	uint32* patp;
-
-	for (y = 0; y < nHeight; y++)
-	{
-		dstp = (uint32*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				patp = (uint32*) gdi_get_brush_pointer(hdcDest, x, y);
-
-				*dstp = *dstp & *patp;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, NULL, ROP_ROW_DPa);
 }
 
 static int BitBlt_PDxn_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight)
 {
-	int x, y;
-	uint32* dstp;
-	uint32* patp;
-
-	for (y = 0; y < nHeight; y++)
-	{
-		dstp = (uint32*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				patp = (uint32*) gdi_get_brush_pointer(hdcDest, x, y);
-
-				*dstp = *dstp ^ ~(*patp);
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, NULL, ROP_ROW_PDxn);
 }
 
 static int BitBlt_MERGECOPY_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint32* srcp;
-	uint32* dstp;
-	uint32* patp;
-	
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint32*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint32*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				patp = (uint32*) gdi_get_brush_pointer(hdcDest, x, y);
-				
-				*dstp = *srcp & *patp;
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-	
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_MERGECOPY);
 }
 
 static int BitBlt_MERGEPAINT_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint32* srcp;
-	uint32* dstp;
-	
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint32*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint32*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{				
-				*dstp = ~(*srcp) | *dstp;
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-	
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_MERGEPAINT);
 }
 
 static int BitBlt_PATCOPY_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight)
 {
-	int x, y;
-	uint32* dstp;
-	uint32* patp;
 	uint32 color32;
 
 	if (hdcDest->brush->style == GDI_BS_SOLID)
 	{
 		color32 = gdi_get_color_32bpp(hdcDest, hdcDest->brush->color);
-
-		for (y = 0; y < nHeight; y++)
-		{
-			dstp = (uint32*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-			if (dstp != 0)
-			{
-				for (x = 0; x < nWidth; x++)
-				{
-					*dstp = color32;
-					dstp++;
-				}
-			}
-		}
+		return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, (uint8*) &color32, ROP_ROW_PATCOPY);
 	}
-	else
-	{
-		for (y = 0; y < nHeight; y++)
-		{
-			dstp = (uint32*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
 
-			if (dstp != 0)
-			{
-				for (x = 0; x < nWidth; x++)
-				{
-					patp = (uint32*) gdi_get_brush_pointer(hdcDest, x, y);
-					*dstp = *patp;
-					dstp++;
-				}
-			}
-		}
-	}
-	
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, NULL, ROP_ROW_PATCOPY);
 }
 
 static int BitBlt_PATINVERT_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight)
 {
-	int x, y;
-	uint32* dstp;
-	uint32* patp;
 	uint32 color32;
-		
+
 	if (hdcDest->brush->style == GDI_BS_SOLID)
 	{
 		color32 = gdi_get_color_32bpp(hdcDest, hdcDest->brush->color);
-
-		for (y = 0; y < nHeight; y++)
-		{
-			dstp = (uint32*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-			if (dstp != 0)
-			{
-				for (x = 0; x < nWidth; x++)
-				{
-					*dstp ^= color32;
-					dstp++;
-				}
-			}
-		}
+		return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, (uint8*) &color32, ROP_ROW_PATINVERT);
 	}
-	else
-	{
-		for (y = 0; y < nHeight; y++)
-		{
-			dstp = (uint32*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
 
-			if (dstp != 0)
-			{
-				for (x = 0; x < nWidth; x++)
-				{
-					patp = (uint32*) gdi_get_brush_pointer(hdcDest, x, y);
-					*dstp = *patp ^ *dstp;
-					dstp++;
-				}
-			}
-		}
-	}
-	
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, NULL, ROP_ROW_PATINVERT);
 }
 
 static int BitBlt_PATPAINT_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint32* srcp;
-	uint32* dstp;
-	uint32* patp;
-	
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = (uint32*) gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = (uint32*) gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				patp = (uint32*) gdi_get_brush_pointer(hdcDest, x, y);
-				*dstp = *dstp | (*patp | ~(*srcp));
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-	
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_PATPAINT);
 }
 
 int BitBlt_32bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc, int rop)
@@ -33,6 +33,8 @@
 
 #include <freerdp/gdi/8bpp.h>
 
+#include "rop.h"
+
 int FillRect_8bpp(HGDI_DC hdc, HGDI_RECT rect, HGDI_BRUSH hbr)
 {
 	/* TODO: Implement 8bpp FillRect() */
@@ -134,174 +136,37 @@ static int BitBlt_SRCCOPY_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWid
 
 static int BitBlt_NOTSRCCOPY_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint8* srcp;
-	uint8* dstp;
-	
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp = ~(*srcp);
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_NOTSRCCOPY);
 }
 
 static int BitBlt_DSTINVERT_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight)
 {
-	int x, y;
-	uint8* dstp;
-		
-	for (y = 0; y < nHeight; y++)
-	{
-		dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp = ~(*dstp);
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, NULL, ROP_ROW_DSTINVERT);
 }
 
 static int BitBlt_SRCERASE_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint8* srcp;
-	uint8* dstp;
-		
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp = *srcp & ~(*dstp);
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_SRCERASE);
 }
 
 static int BitBlt_NOTSRCERASE_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint8* srcp;
-	uint8* dstp;
-		
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp = ~(*srcp) & ~(*dstp);
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_NOTSRCERASE);
 }
 
 static int BitBlt_SRCINVERT_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint8* srcp;
-	uint8* dstp;
-		
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp ^= *srcp;
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_SRCINVERT);
 }
 
 static int BitBlt_SRCAND_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint8* srcp;
-	uint8* dstp;
-		
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp &= *srcp;
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_SRCAND);
 }
 
 static int BitBlt_SRCPAINT_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint8* srcp;
-	uint8* dstp;
-		
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp |= *srcp;
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_SRCPAINT);
 }
 
 static int BitBlt_DSPDxax_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
@@ -312,282 +177,63 @@ static int BitBlt_DSPDxax_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWid
 
 static int BitBlt_SPna_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint8* srcp;
-	uint8* dstp;
-	uint8* patp;
-	
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);		
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				patp = gdi_get_brush_pointer(hdcDest, x, y);
-				
-				*dstp = *srcp & ~(*patp);
-				patp++;
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-	
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_SPna);
 }
 
 static int BitBlt_DPa_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight)
 {
-	int x, y;
-	uint8* dstp;
-	uint8* patp;
-
-	for (y = 0; y < nHeight; y++)
-	{
-		dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				patp = gdi_get_brush_pointer(hdcDest, x, y);
-
-				*dstp = *dstp & *patp;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, NULL, ROP_ROW_DPa);
 }
 
 static int BitBlt_PDxn_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight)
 {
-	int x, y;
-	uint8* dstp;
-	uint8* patp;
-
-	for (y = 0; y < nHeight; y++)
-	{
-		dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				patp = gdi_get_brush_pointer(hdcDest, x, y);
-
-				*dstp = *dstp ^ ~(*patp);
-				patp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, NULL, ROP_ROW_PDxn);
 }
 
 static int BitBlt_DSna_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint8* srcp;
-	uint8* dstp;
-
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				*dstp = ~(*srcp) & (*dstp);
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_DSna);
 }
 
 static int BitBlt_MERGECOPY_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint8* srcp;
-	uint8* dstp;
-	uint8* patp;
-	
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				patp = gdi_get_brush_pointer(hdcDest, x, y);
-				
-				*dstp = *srcp & *patp;
-				patp++;
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-	
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_MERGECOPY);
 }
 
 static int BitBlt_MERGEPAINT_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint8* srcp;
-	uint8* dstp;
-	
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{				
-				*dstp = ~(*srcp) | *dstp;
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-	
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_MERGEPAINT);
 }
 
 static int BitBlt_PATCOPY_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight)
 {
-	int x, y;
-	uint8* dstp;
-	uint8* patp;
 	uint8 palIndex;
 
-	if(hdcDest->brush->style == GDI_BS_SOLID)
+	if (hdcDest->brush->style == GDI_BS_SOLID)
 	{
 		palIndex = ((hdcDest->brush->color >> 16) & 0xFF);
-		for (y = 0; y < nHeight; y++)
-		{
-			dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-			if (dstp != 0)
-			{
-				for (x = 0; x < nWidth; x++)
-				{
-					*dstp = palIndex;
-					dstp++;
-				}
-			}
-		}
-	}
-	else
-	{
-		for (y = 0; y < nHeight; y++)
-		{
-			dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-			if (dstp != 0)
-			{
-				for (x = 0; x < nWidth; x++)
-				{
-					patp = gdi_get_brush_pointer(hdcDest, x, y);
-
-					*dstp = *patp;
-					patp++;
-					dstp++;
-				}
-			}
-		}
+		return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, &palIndex, ROP_ROW_PATCOPY);
 	}
 
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, NULL, ROP_ROW_PATCOPY);
 }
 
 static int BitBlt_PATINVERT_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight)
 {
-	int x, y;
-	uint8* dstp;
-	uint8* patp;
 	uint8 palIndex;
 
-	if(hdcDest->brush->style == GDI_BS_SOLID)
+	if (hdcDest->brush->style == GDI_BS_SOLID)
 	{
 		palIndex = ((hdcDest->brush->color >> 16) & 0xFF);
-		for (y = 0; y < nHeight; y++)
-		{
-			dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-			if (dstp != 0)
-			{
-				for (x = 0; x < nWidth; x++)
-				{
-					*dstp ^= palIndex;
-					dstp++;
-				}
-			}
-		}
+		return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, &palIndex, ROP_ROW_PATINVERT);
 	}
-	else
-	{
-		for (y = 0; y < nHeight; y++)
-		{
-			dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
 
-			if (dstp != 0)
-			{
-				for (x = 0; x < nWidth; x++)
-				{
-					patp = gdi_get_brush_pointer(hdcDest, x, y);
-
-					*dstp = *patp ^ *dstp;
-					patp++;
-					dstp++;
-				}
-			}
-		}
-	}
-	
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, NULL, 0, 0, NULL, ROP_ROW_PATINVERT);
 }
 
 static int BitBlt_PATPAINT_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc)
 {
-	int x, y;
-	uint8* srcp;
-	uint8* dstp;
-	uint8* patp;
-	
-	for (y = 0; y < nHeight; y++)
-	{
-		srcp = gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + y);
-		dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + y);
-
-		if (dstp != 0)
-		{
-			for (x = 0; x < nWidth; x++)
-			{
-				patp = gdi_get_brush_pointer(hdcDest, x, y);
-				
-				*dstp = *dstp | (*patp | ~(*srcp));
-				patp++;
-				srcp++;
-				dstp++;
-			}
-		}
-	}
-	
-	return 0;
+	return gdi_rop_blt(hdcDest, nXDest, nYDest, nWidth, nHeight, hdcSrc, nXSrc, nYSrc, NULL, ROP_ROW_PATPAINT);
 }
 
 int BitBlt_8bpp(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight, HGDI_DC hdcSrc, int nXSrc, int nYSrc, int rop)
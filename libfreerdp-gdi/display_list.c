@@ -0,0 +1,466 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * GDI Display List
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <freerdp/freerdp.h>
+#include <freerdp/utils/memory.h>
+
+#include <freerdp/gdi/dc.h>
+#include <freerdp/gdi/brush.h>
+#include <freerdp/gdi/clipping.h>
+
+#include "gdi.h"
+#include "display_list.h"
+
+/**
+ * Blits and fills to the primary surface are recorded as they come in,
+ * along with the clipping region they were drawn with, instead of being
+ * drawn right away. When the list is played back, orders whose area is
+ * entirely painted over by a later opaque order are dropped, and adjacent
+ * fills of the same color are drawn as one. Anything else drawing to the
+ * surface, or changing what the recorded orders refer to, plays the list
+ * back first.
+ */
+
+static boolean gdi_dl_rect_empty(GDI_DL_RECT* rect)
+{
+	return (rect->left >= rect->right || rect->top >= rect->bottom) ? true : false;
+}
+
+static boolean gdi_dl_rect_contains(GDI_DL_RECT* outer, GDI_DL_RECT* inner)
+{
+	return (inner->left >= outer->left && inner->right <= outer->right &&
+		inner->top >= outer->top && inner->bottom <= outer->bottom) ? true : false;
+}
+
+static boolean gdi_dl_rect_intersects(GDI_DL_RECT* a, GDI_DL_RECT* b)
+{
+	return (a->left < b->right && b->left < a->right &&
+		a->top < b->bottom && b->top < a->bottom) ? true : false;
+}
+
+static void gdi_dl_rect_intersect(GDI_DL_RECT* rect, GDI_DL_RECT* clip)
+{
+	rect->left = MAX(rect->left, clip->left);
+	rect->top = MAX(rect->top, clip->top);
+	rect->right = MIN(rect->right, clip->right);
+	rect->bottom = MIN(rect->bottom, clip->bottom);
+}
+
+static uint64 gdi_dl_rect_area(GDI_DL_RECT* rect)
+{
+	if (gdi_dl_rect_empty(rect))
+		return 0;
+
+	return (uint64) (rect->right - rect->left) * (rect->bottom - rect->top);
+}
+
+static void gdi_dl_set_rect(GDI_DL_RECT* rect, int x, int y, int width, int height)
+{
+	rect->left = x;
+	rect->top = y;
+	rect->right = x + width;
+	rect->bottom = y + height;
+}
+
+/* The result of the ternary raster operation does not depend on the destination */
+static boolean gdi_dl_rop3_opaque(uint32 rop)
+{
+	rop &= 0xFF;
+	return (((rop >> 1) & 0x55) == (rop & 0x55)) ? true : false;
+}
+
+static boolean gdi_dl_op_opaque(GDI_DL_OP* op)
+{
+	switch (op->type)
+	{
+		case GDI_DL_DSTBLT:
+			return gdi_dl_rop3_opaque(op->order.dstblt.bRop);
+
+		case GDI_DL_PATBLT:
+			return gdi_dl_rop3_opaque(op->order.patblt.bRop);
+
+		case GDI_DL_SCRBLT:
+			return gdi_dl_rop3_opaque(op->order.scrblt.bRop);
+
+		case GDI_DL_MEMBLT:
+			return gdi_dl_rop3_opaque(op->order.memblt.bRop);
+
+		default:
+			break;
+	}
+
+	return true;
+}
+
+/* Is the area painted over by a single one of the opaque orders seen so far */
+static boolean gdi_dl_covered(GDI_DISPLAY_LIST* list, GDI_DL_RECT* rect)
+{
+	int i;
+
+	for (i = 0; i < list->num_covers; i++)
+	{
+		if (gdi_dl_rect_contains(&list->covers[i], rect))
+			return true;
+	}
+
+	return false;
+}
+
+static void gdi_dl_cover(GDI_DISPLAY_LIST* list, GDI_DL_RECT* rect)
+{
+	if (list->num_covers < GDI_DISPLAY_LIST_MAX_COVERS)
+		list->covers[list->num_covers++] = *rect;
+}
+
+/* The area is copied from, what was drawn there before has to be kept */
+static void gdi_dl_uncover(GDI_DISPLAY_LIST* list, GDI_DL_RECT* rect)
+{
+	int i;
+
+	for (i = 0; i < list->num_covers; )
+	{
+		if (gdi_dl_rect_intersects(&list->covers[i], rect))
+			list->covers[i] = list->covers[--list->num_covers];
+		else
+			i++;
+	}
+}
+
+/**
+ * Walk the list backwards, dropping the orders that later opaque orders
+ * paint over. Orders combining with their destination do not hide what is
+ * under them, but what they draw is painted over along with it. Only screen
+ * blits take pixels elsewhere, their source has to be kept.
+ */
+
+static void gdi_display_list_cull(GDI_DISPLAY_LIST* list)
+{
+	int i;
+	GDI_DL_OP* op;
+	GDI_DL_RECT src;
+	SCRBLT_ORDER* scrblt;
+
+	list->num_covers = 0;
+
+	for (i = list->count - 1; i >= 0; i--)
+	{
+		op = &list->ops[i];
+
+		if (gdi_dl_rect_empty(&op->rect) || gdi_dl_covered(list, &op->rect))
+		{
+			op->culled = true;
+			continue;
+		}
+
+		if (op->type == GDI_DL_SCRBLT)
+		{
+			scrblt = &op->order.scrblt;
+			gdi_dl_set_rect(&src, scrblt->nXSrc, scrblt->nYSrc, scrblt->nWidth, scrblt->nHeight);
+			gdi_dl_uncover(list, &src);
+
+			/* a blit onto its own source does not hide what it copies */
+			if (gdi_dl_rect_intersects(&src, &op->rect))
+				continue;
+		}
+
+		if (gdi_dl_op_opaque(op))
+			gdi_dl_cover(list, &op->rect);
+	}
+}
+
+static boolean gdi_dl_can_merge(GDI_DL_OP* a, GDI_DL_OP* b)
+{
+	OPAQUE_RECT_ORDER* ra;
+	OPAQUE_RECT_ORDER* rb;
+
+	if (a->type != GDI_DL_OPAQUE_RECT || b->type != GDI_DL_OPAQUE_RECT)
+		return false;
+
+	if (a->clip_null != b->clip_null)
+		return false;
+
+	if (!a->clip_null && memcmp(&a->clip, &b->clip, sizeof(GDI_DL_RECT)) != 0)
+		return false;
+
+	ra = &a->order.opaque_rect;
+	rb = &b->order.opaque_rect;
+
+	if (ra->color != rb->color)
+		return false;
+
+	if (ra->nTopRect == rb->nTopRect && ra->nHeight == rb->nHeight)
+	{
+		return (ra->nLeftRect + ra->nWidth == rb->nLeftRect ||
+			rb->nLeftRect + rb->nWidth == ra->nLeftRect) ? true : false;
+	}
+
+	if (ra->nLeftRect == rb->nLeftRect && ra->nWidth == rb->nWidth)
+	{
+		return (ra->nTopRect + ra->nHeight == rb->nTopRect ||
+			rb->nTopRect + rb->nHeight == ra->nTopRect) ? true : false;
+	}
+
+	return false;
+}
+
+/* Fold fills of the same color sharing an edge into the first of them */
+static void gdi_display_list_merge(GDI_DISPLAY_LIST* list)
+{
+	int i;
+	GDI_DL_OP* op;
+	GDI_DL_OP* prev = NULL;
+	OPAQUE_RECT_ORDER* ra;
+	OPAQUE_RECT_ORDER* rb;
+	int left, top, right, bottom;
+
+	for (i = 0; i < list->count; i++)
+	{
+		op = &list->ops[i];
+
+		if (op->culled)
+			continue;
+
+		if (prev == NULL || !gdi_dl_can_merge(prev, op))
+		{
+			prev = op;
+			continue;
+		}
+
+		ra = &prev->order.opaque_rect;
+		rb = &op->order.opaque_rect;
+
+		left = MIN(ra->nLeftRect, rb->nLeftRect);
+		top = MIN(ra->nTopRect, rb->nTopRect);
+		right = MAX(ra->nLeftRect + ra->nWidth, rb->nLeftRect + rb->nWidth);
+		bottom = MAX(ra->nTopRect + ra->nHeight, rb->nTopRect + rb->nHeight);
+
+		ra->nLeftRect = left;
+		ra->nTopRect = top;
+		ra->nWidth = right - left;
+		ra->nHeight = bottom - top;
+
+		/* both were clipped the same way, the clipped areas join up as well */
+		prev->rect.left = MIN(prev->rect.left, op->rect.left);
+		prev->rect.top = MIN(prev->rect.top, op->rect.top);
+		prev->rect.right = MAX(prev->rect.right, op->rect.right);
+		prev->rect.bottom = MAX(prev->rect.bottom, op->rect.bottom);
+
+		op->merged = true;
+	}
+}
+
+/**
+ * Record a blit or fill to draw later.
+ * @param gdi current GDI
+ * @param type GDI_DL_* order type
+ * @param order the order, copied into the list
+ * @return true if the order was recorded, false if it is to be drawn now
+ */
+
+boolean gdi_display_list_record(rdpGdi* gdi, uint8 type, void* order)
+{
+	GDI_DL_OP* op;
+	HGDI_RGN clip;
+	GDI_DL_RECT bounds;
+	GDI_DISPLAY_LIST* list = (GDI_DISPLAY_LIST*) gdi->display_list;
+
+	if (list == NULL || list->replaying)
+		return false;
+
+	/* offscreen surfaces are drawn to as before, and pattern brushes point
+	   into the brush cache, which may change before the list is played back */
+	if (gdi->drawing != gdi->primary ||
+		(type == GDI_DL_PATBLT && ((PATBLT_ORDER*) order)->brush.style != GDI_BS_SOLID))
+	{
+		gdi_display_list_flush(gdi);
+		return false;
+	}
+
+	if (list->count >= GDI_DISPLAY_LIST_SIZE)
+		gdi_display_list_flush(gdi);
+
+	op = &list->ops[list->count++];
+	op->type = type;
+	op->culled = false;
+	op->merged = false;
+
+	switch (type)
+	{
+		case GDI_DL_DSTBLT:
+			op->order.dstblt = *((DSTBLT_ORDER*) order);
+			gdi_dl_set_rect(&op->rect, op->order.dstblt.nLeftRect, op->order.dstblt.nTopRect,
+					op->order.dstblt.nWidth, op->order.dstblt.nHeight);
+			break;
+
+		case GDI_DL_PATBLT:
+			op->order.patblt = *((PATBLT_ORDER*) order);
+			gdi_dl_set_rect(&op->rect, op->order.patblt.nLeftRect, op->order.patblt.nTopRect,
+					op->order.patblt.nWidth, op->order.patblt.nHeight);
+			break;
+
+		case GDI_DL_SCRBLT:
+			op->order.scrblt = *((SCRBLT_ORDER*) order);
+			gdi_dl_set_rect(&op->rect, op->order.scrblt.nLeftRect, op->order.scrblt.nTopRect,
+					op->order.scrblt.nWidth, op->order.scrblt.nHeight);
+			break;
+
+		case GDI_DL_OPAQUE_RECT:
+			op->order.opaque_rect = *((OPAQUE_RECT_ORDER*) order);
+			gdi_dl_set_rect(&op->rect, op->order.opaque_rect.nLeftRect, op->order.opaque_rect.nTopRect,
+					op->order.opaque_rect.nWidth, op->order.opaque_rect.nHeight);
+			break;
+
+		case GDI_DL_MEMBLT:
+			op->order.memblt = *((MEMBLT_ORDER*) order);
+			gdi_dl_set_rect(&op->rect, op->order.memblt.nLeftRect, op->order.memblt.nTopRect,
+					op->order.memblt.nWidth, op->order.memblt.nHeight);
+			break;
+	}
+
+	clip = gdi->drawing->hdc->clip;
+	op->clip_null = clip->null ? true : false;
+	gdi_dl_set_rect(&op->clip, clip->x, clip->y, clip->w, clip->h);
+
+	if (!op->clip_null)
+		gdi_dl_rect_intersect(&op->rect, &op->clip);
+
+	gdi_dl_set_rect(&bounds, 0, 0, gdi->primary->bitmap->width, gdi->primary->bitmap->height);
+	gdi_dl_rect_intersect(&op->rect, &bounds);
+
+	list->stats.orders_recorded++;
+
+	return true;
+}
+
+/**
+ * Draw the recorded orders, leaving out those painted over, and empty the
+ * list. The clipping region is left as it was.
+ * @param gdi current GDI
+ */
+
+void gdi_display_list_flush(rdpGdi* gdi)
+{
+	int i;
+	GDI_DL_OP* op;
+	GDI_RGN clip;
+	HGDI_DC hdc;
+	gdiBitmap* drawing;
+	rdpContext* context = gdi->context;
+	GDI_DISPLAY_LIST* list = (GDI_DISPLAY_LIST*) gdi->display_list;
+
+	if (list == NULL || list->replaying || list->count < 1)
+		return;
+
+	gdi_display_list_cull(list);
+	gdi_display_list_merge(list);
+
+	list->replaying = true;
+
+	drawing = gdi->drawing;
+	gdi->drawing = gdi->primary;
+	hdc = gdi->primary->hdc;
+	clip = *(hdc->clip);
+
+	for (i = 0; i < list->count; i++)
+	{
+		op = &list->ops[i];
+
+		if (op->merged)
+		{
+			list->stats.orders_merged++;
+			continue;
+		}
+
+		if (op->culled)
+		{
+			list->stats.orders_culled++;
+			list->stats.pixels_culled += gdi_dl_rect_area(&op->rect);
+			continue;
+		}
+
+		if (op->clip_null)
+			gdi_SetNullClipRgn(hdc);
+		else
+			gdi_SetClipRgn(hdc, op->clip.left, op->clip.top,
+					op->clip.right - op->clip.left, op->clip.bottom - op->clip.top);
+
+		switch (op->type)
+		{
+			case GDI_DL_DSTBLT:
+				gdi_dstblt(context, &op->order.dstblt);
+				break;
+
+			case GDI_DL_PATBLT:
+				gdi_patblt(context, &op->order.patblt);
+				break;
+
+			case GDI_DL_SCRBLT:
+				gdi_scrblt(context, &op->order.scrblt);
+				break;
+
+			case GDI_DL_OPAQUE_RECT:
+				gdi_opaque_rect(context, &op->order.opaque_rect);
+				break;
+
+			case GDI_DL_MEMBLT:
+				gdi_memblt(context, &op->order.memblt);
+				break;
+		}
+
+		list->stats.orders_rasterized++;
+		list->stats.pixels_touched += gdi_dl_rect_area(&op->rect);
+	}
+
+	if (clip.null)
+		gdi_SetNullClipRgn(hdc);
+	else
+		gdi_SetClipRgn(hdc, clip.x, clip.y, clip.w, clip.h);
+
+	gdi->drawing = drawing;
+	list->count = 0;
+	list->replaying = false;
+}
+
+GDI_DISPLAY_LIST* gdi_display_list_new(void)
+{
+	GDI_DISPLAY_LIST* list;
+
+	list = xnew(GDI_DISPLAY_LIST);
+
+	if (list != NULL)
+		list->ops = (GDI_DL_OP*) xzalloc(sizeof(GDI_DL_OP) * GDI_DISPLAY_LIST_SIZE);
+
+	return list;
+}
+
+void gdi_display_list_free(GDI_DISPLAY_LIST* list)
+{
+	if (list != NULL)
+	{
+		DEBUG_GDI("%d orders recorded, %d drawn, %d painted over, %d merged, "
+			"%llu pixels drawn, %llu left out", list->stats.orders_recorded,
+			list->stats.orders_rasterized, list->stats.orders_culled, list->stats.orders_merged,
+			(unsigned long long) list->stats.pixels_touched,
+			(unsigned long long) list->stats.pixels_culled);
+
+		xfree(list->ops);
+		xfree(list);
+	}
+}
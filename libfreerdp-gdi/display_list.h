@@ -0,0 +1,92 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * GDI Display List
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GDI_DISPLAY_LIST_H
+#define __GDI_DISPLAY_LIST_H
+
+#include <freerdp/types.h>
+#include <freerdp/update.h>
+#include <freerdp/gdi/gdi.h>
+
+/* Orders recorded before the list is played back on its own */
+#define GDI_DISPLAY_LIST_SIZE		1024
+
+/* Opaque areas kept track of while looking for overdrawn orders */
+#define GDI_DISPLAY_LIST_MAX_COVERS	32
+
+enum GDI_DISPLAY_LIST_OP_TYPE
+{
+	GDI_DL_DSTBLT,
+	GDI_DL_PATBLT,
+	GDI_DL_SCRBLT,
+	GDI_DL_OPAQUE_RECT,
+	GDI_DL_MEMBLT
+};
+
+struct _GDI_DL_RECT
+{
+	int left;
+	int top;
+	int right; /* exclusive */
+	int bottom; /* exclusive */
+};
+typedef struct _GDI_DL_RECT GDI_DL_RECT;
+
+struct _GDI_DL_OP
+{
+	uint8 type;
+	boolean culled;
+	boolean merged;
+
+	/* clipping region the order was drawn with */
+	boolean clip_null;
+	GDI_DL_RECT clip;
+
+	/* area the order draws to, after clipping */
+	GDI_DL_RECT rect;
+
+	union
+	{
+		DSTBLT_ORDER dstblt;
+		PATBLT_ORDER patblt;
+		SCRBLT_ORDER scrblt;
+		OPAQUE_RECT_ORDER opaque_rect;
+		MEMBLT_ORDER memblt;
+	} order;
+};
+typedef struct _GDI_DL_OP GDI_DL_OP;
+
+struct _GDI_DISPLAY_LIST
+{
+	int count;
+	GDI_DL_OP* ops;
+	boolean replaying;
+
+	int num_covers;
+	GDI_DL_RECT covers[GDI_DISPLAY_LIST_MAX_COVERS];
+
+	GDI_DISPLAY_LIST_STATS stats;
+};
+typedef struct _GDI_DISPLAY_LIST GDI_DISPLAY_LIST;
+
+boolean gdi_display_list_record(rdpGdi* gdi, uint8 type, void* order);
+void gdi_display_list_flush(rdpGdi* gdi);
+
+GDI_DISPLAY_LIST* gdi_display_list_new(void);
+void gdi_display_list_free(GDI_DISPLAY_LIST* list);
+
+#endif /* __GDI_DISPLAY_LIST_H */
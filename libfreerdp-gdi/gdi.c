@@ -44,6 +44,8 @@
 #include <freerdp/gdi/gdi.h>
 
 #include "gdi.h"
+#include "glyph.h"
+#include "display_list.h"
 
 /* Ternary Raster Operation Table */
 static const uint32 rop3_code_table[] =
@@ -433,6 +435,10 @@ void gdi_bitmap_free_ex(gdiBitmap* bitmap)
 void gdi_palette_update(rdpContext* context, PALETTE_UPDATE* palette)
 {
 	rdpGdi* gdi = context->gdi;
+
+	/* recorded colors are converted when drawn */
+	gdi_flush(gdi);
+
 	gdi->clrconv->palette->count = palette->number;
 	gdi->clrconv->palette->entries = palette->entries;
 }
@@ -456,6 +462,9 @@ void gdi_dstblt(rdpContext* context, DSTBLT_ORDER* dstblt)
 {
 	rdpGdi* gdi = context->gdi;
 
+	if (gdi_display_list_record(gdi, GDI_DL_DSTBLT, dstblt))
+		return;
+
 	gdi_BitBlt(gdi->drawing->hdc, dstblt->nLeftRect, dstblt->nTopRect,
 			dstblt->nWidth, dstblt->nHeight, NULL, 0, 0, gdi_rop3_code(dstblt->bRop));
 }
@@ -467,6 +476,9 @@ void gdi_patblt(rdpContext* context, PATBLT_ORDER* patblt)
 	HGDI_BRUSH originalBrush;
 	rdpGdi* gdi = context->gdi;
 
+	if (gdi_display_list_record(gdi, GDI_DL_PATBLT, patblt))
+		return;
+
 	brush = &patblt->brush;
 
 	if (brush->style == GDI_BS_SOLID)
@@ -518,6 +530,9 @@ void gdi_scrblt(rdpContext* context, SCRBLT_ORDER* scrblt)
 {
 	rdpGdi* gdi = context->gdi;
 
+	if (gdi_display_list_record(gdi, GDI_DL_SCRBLT, scrblt))
+		return;
+
 	gdi_BitBlt(gdi->drawing->hdc, scrblt->nLeftRect, scrblt->nTopRect,
 			scrblt->nWidth, scrblt->nHeight, gdi->primary->hdc,
 			scrblt->nXSrc, scrblt->nYSrc, gdi_rop3_code(scrblt->bRop));
@@ -530,6 +545,9 @@ void gdi_opaque_rect(rdpContext* context, OPAQUE_RECT_ORDER* opaque_rect)
 	uint32 brush_color;
 	rdpGdi *gdi = context->gdi;
 
+	if (gdi_display_list_record(gdi, GDI_DL_OPAQUE_RECT, opaque_rect))
+		return;
+
 	gdi_CRgnToRect(opaque_rect->nLeftRect, opaque_rect->nTopRect,
 			opaque_rect->nWidth, opaque_rect->nHeight, &rect);
 
@@ -544,25 +562,22 @@ void gdi_opaque_rect(rdpContext* context, OPAQUE_RECT_ORDER* opaque_rect)
 void gdi_multi_opaque_rect(rdpContext* context, MULTI_OPAQUE_RECT_ORDER* multi_opaque_rect)
 {
 	int i;
-	GDI_RECT rect;
-	HGDI_BRUSH hBrush;
-	uint32 brush_color;
 	DELTA_RECT* rectangle;
-	rdpGdi *gdi = context->gdi;
+	OPAQUE_RECT_ORDER opaque_rect;
+
+	/* each rectangle is filled, or recorded, as an opaque rect of its own */
+	opaque_rect.color = multi_opaque_rect->color;
 
 	for (i = 1; i < (int) multi_opaque_rect->numRectangles + 1; i++)
 	{
 		rectangle = &multi_opaque_rect->rectangles[i];
 
-		gdi_CRgnToRect(rectangle->left, rectangle->top,
-				rectangle->width, rectangle->height, &rect);
-
-		brush_color = freerdp_color_convert_var_bgr(multi_opaque_rect->color, gdi->srcBpp, 32, gdi->clrconv);
+		opaque_rect.nLeftRect = rectangle->left;
+		opaque_rect.nTopRect = rectangle->top;
+		opaque_rect.nWidth = rectangle->width;
+		opaque_rect.nHeight = rectangle->height;
 
-		hBrush = gdi_CreateSolidBrush(brush_color);
-		gdi_FillRect(gdi->drawing->hdc, &rect, hBrush);
-
-		gdi_DeleteObject((HGDIOBJECT) hBrush);
+		gdi_opaque_rect(context, &opaque_rect);
 	}
 }
 
@@ -572,6 +587,8 @@ void gdi_line_to(rdpContext* context, LINE_TO_ORDER* line_to)
 	HGDI_PEN hPen;
 	rdpGdi *gdi = context->gdi;
 
+	gdi_flush(gdi);
+
 	color = freerdp_color_convert_rgb(line_to->penColor, gdi->srcBpp, 32, gdi->clrconv);
 	hPen = gdi_CreatePen(line_to->penStyle, line_to->penWidth, (GDI_COLOR) color);
 	gdi_SelectObject(gdi->drawing->hdc, (HGDIOBJECT) hPen);
@@ -593,6 +610,8 @@ void gdi_polyline(rdpContext* context, POLYLINE_ORDER* polyline)
 	sint32 x;
 	sint32 y;
 
+	gdi_flush(gdi);
+
 	color = freerdp_color_convert_rgb(polyline->penColor, gdi->srcBpp, 32, gdi->clrconv);
 	hPen = gdi_CreatePen(GDI_PS_SOLID, 1, (GDI_COLOR) color);
 	gdi_SelectObject(gdi->drawing->hdc, (HGDIOBJECT) hPen);
@@ -619,6 +638,9 @@ void gdi_memblt(rdpContext* context, MEMBLT_ORDER* memblt)
 	gdiBitmap* bitmap;
 	rdpGdi* gdi = context->gdi;
 
+	if (gdi_display_list_record(gdi, GDI_DL_MEMBLT, memblt))
+		return;
+
 	bitmap = (gdiBitmap*) memblt->bitmap;
 
 	gdi_BitBlt(gdi->drawing->hdc, memblt->nLeftRect, memblt->nTopRect,
@@ -663,6 +685,8 @@ void gdi_surface_bits(rdpContext* context, SURFACE_BITS_COMMAND* surface_bits_co
 	RFX_CONTEXT* rfx_context = (RFX_CONTEXT*) gdi->rfx_context;
 	NSC_CONTEXT* nsc_context = (NSC_CONTEXT*) gdi->nsc_context;
 
+	gdi_flush(gdi);
+
 	DEBUG_GDI("destLeft %d destTop %d destRight %d destBottom %d "
 		"bpp %d codecID %d width %d height %d length %d",
 		surface_bits_command->destLeft, surface_bits_command->destTop,
@@ -731,27 +755,10 @@ void gdi_surface_bits(rdpContext* context, SURFACE_BITS_COMMAND* surface_bits_co
 		gdi->image->bitmap->data = (uint8*) xrealloc(gdi->image->bitmap->data,
 				gdi->image->bitmap->width * gdi->image->bitmap->height * 4);
 
-		if ((surface_bits_command->bpp != 32) || (gdi->clrconv->alpha == true))
-		{
-			uint8* temp_image;
-
-			freerdp_image_convert(surface_bits_command->bitmapData, gdi->image->bitmap->data,
+		/* convert and flip in a single pass */
+		freerdp_image_convert_ex(surface_bits_command->bitmapData, gdi->image->bitmap->data,
 				gdi->image->bitmap->width, gdi->image->bitmap->height,
-				gdi->image->bitmap->bitsPerPixel, 32, gdi->clrconv);
-
-			surface_bits_command->bpp = 32;
-			surface_bits_command->bitmapData = gdi->image->bitmap->data;
-
-			temp_image = (uint8*) xmalloc(gdi->image->bitmap->width * gdi->image->bitmap->height * 4);
-			freerdp_image_flip(gdi->image->bitmap->data, temp_image, gdi->image->bitmap->width, gdi->image->bitmap->height, 32);
-			xfree(gdi->image->bitmap->data);
-			gdi->image->bitmap->data = temp_image;
-		}
-		else
-		{
-			freerdp_image_flip(surface_bits_command->bitmapData, gdi->image->bitmap->data,
-					gdi->image->bitmap->width, gdi->image->bitmap->height, 32);
-		}
+				gdi->image->bitmap->bitsPerPixel, 32, 0, true, gdi->clrconv);
 
 		gdi_BitBlt(gdi->primary->hdc, surface_bits_command->destLeft, surface_bits_command->destTop,
 				surface_bits_command->width, surface_bits_command->height, gdi->image->hdc, 0, 0, GDI_SRCCOPY);
@@ -806,8 +813,20 @@ void gdi_register_update_callbacks(rdpUpdate* update)
 
 void gdi_init_primary(rdpGdi* gdi)
 {
-	gdi->primary = gdi_bitmap_new_ex(gdi, gdi->width, gdi->height, gdi->dstBpp, gdi->primary_buffer);
-	gdi->primary_buffer = gdi->primary->bitmap->data;
+	if (gdi->primary_buffer_external)
+	{
+		/* Draw straight into the caller's buffer, it is not ours to convert or free */
+		gdi->primary = (gdiBitmap*) malloc(sizeof(gdiBitmap));
+		gdi->primary->hdc = gdi_CreateCompatibleDC(gdi->hdc);
+		gdi->primary->bitmap = gdi_CreateBitmap(gdi->width, gdi->height, gdi->dstBpp, gdi->primary_buffer);
+		gdi_SelectObject(gdi->primary->hdc, (HGDIOBJECT) gdi->primary->bitmap);
+		gdi->primary->org_bitmap = NULL;
+	}
+	else
+	{
+		gdi->primary = gdi_bitmap_new_ex(gdi, gdi->width, gdi->height, gdi->dstBpp, NULL);
+		gdi->primary_buffer = gdi->primary->bitmap->data;
+	}
 
 	if (gdi->drawing == NULL)
 		gdi->drawing = gdi->primary;
@@ -821,26 +840,87 @@ void gdi_init_primary(rdpGdi* gdi)
 	gdi->primary->hdc->hwnd->ninvalid = 0;
 }
 
+static void gdi_free_primary(rdpGdi* gdi)
+{
+	if (gdi->primary_buffer_external)
+		gdi->primary->bitmap->data = NULL;
+
+	gdi_bitmap_free_ex(gdi->primary);
+	gdi->primary = NULL;
+}
+
 void gdi_resize(rdpGdi* gdi, int width, int height)
+{
+	gdi_resize_ex(gdi, width, height, NULL);
+}
+
+/**
+ * Resize the primary surface.
+ * @param gdi current GDI
+ * @param width new width
+ * @param height new height
+ * @param buffer caller owned buffer for the new surface, or NULL to have one allocated
+ */
+
+void gdi_resize_ex(rdpGdi* gdi, int width, int height, uint8* buffer)
 {
 	if (gdi && gdi->primary)
 	{
-		if (gdi->width != width || gdi->height != height)
+		if (gdi->width != width || gdi->height != height ||
+			(buffer != NULL && buffer != gdi->primary_buffer))
 		{
+			gdi_flush(gdi);
+
 			if (gdi->drawing == gdi->primary)
 				gdi->drawing = NULL;
 
 			gdi->width = width;
 			gdi->height = height;
-			gdi_bitmap_free_ex(gdi->primary);
+			gdi_free_primary(gdi);
+
+			gdi->primary_buffer = buffer;
+			gdi->primary_buffer_external = (buffer != NULL) ? true : false;
 			gdi_init_primary(gdi);
 		}
 	}
 }
 
+/**
+ * Draw the orders recorded in the display list, if there is one.
+ * Call before reading from the primary surface, at the end of a paint.
+ * @param gdi current GDI
+ */
+
+void gdi_flush(rdpGdi* gdi)
+{
+	if (gdi != NULL)
+		gdi_display_list_flush(gdi);
+}
+
+/**
+ * Get the counters of the display list.
+ * @param gdi current GDI
+ * @param stats counters
+ * @return false if orders are not recorded
+ */
+
+boolean gdi_get_display_list_stats(rdpGdi* gdi, GDI_DISPLAY_LIST_STATS* stats)
+{
+	GDI_DISPLAY_LIST* list = (GDI_DISPLAY_LIST*) gdi->display_list;
+
+	if (list == NULL)
+		return false;
+
+	*stats = list->stats;
+	return true;
+}
+
 /**
  * Initialize GDI
  * @param inst current instance
+ * @param flags color conversion and internal buffer format flags
+ * @param buffer caller owned buffer the primary surface is drawn into, or NULL to have one allocated.
+ * It must hold width * height pixels of the internal buffer format, without row padding.
  * @return
  */
 
@@ -859,6 +939,8 @@ int gdi_init(freerdp* instance, uint32 flags, uint8* buffer)
 	gdi->height = instance->settings->height;
 	gdi->srcBpp = instance->settings->color_depth;
 	gdi->primary_buffer = buffer;
+	gdi->primary_buffer_external = (buffer != NULL) ? true : false;
+	gdi->context = instance->context;
 
 	/* default internal buffer format */
 	gdi->dstBpp = 32;
@@ -933,6 +1015,10 @@ int gdi_init(freerdp* instance, uint32 flags, uint8* buffer)
 
 	gdi->rfx_context = rfx_context_new();
 	gdi->nsc_context = nsc_context_new();
+	gdi->glyph_run = gdi_glyph_run_new();
+
+	if (instance->settings->gdi_display_list)
+		gdi->display_list = gdi_display_list_new();
 
 	return 0;
 }
@@ -943,11 +1029,13 @@ void gdi_free(freerdp* instance)
 
 	if (gdi)
 	{
-		gdi_bitmap_free_ex(gdi->primary);
+		gdi_free_primary(gdi);
 		gdi_bitmap_free_ex(gdi->tile);
 		gdi_bitmap_free_ex(gdi->image);
 		gdi_DeleteDC(gdi->hdc);
 		rfx_context_free((RFX_CONTEXT*)gdi->rfx_context);
+		gdi_glyph_run_free((GDI_GLYPH_RUN*) gdi->glyph_run);
+		gdi_display_list_free((GDI_DISPLAY_LIST*) gdi->display_list);
 		free(gdi->clrconv);
 		free(gdi);
 	}
@@ -25,4 +25,10 @@
 gdiBitmap* gdi_bitmap_new_ex(rdpGdi* gdi, int width, int height, int bpp, uint8* data);
 void gdi_bitmap_free_ex(gdiBitmap* gdi_bmp);
 
+void gdi_dstblt(rdpContext* context, DSTBLT_ORDER* dstblt);
+void gdi_patblt(rdpContext* context, PATBLT_ORDER* patblt);
+void gdi_scrblt(rdpContext* context, SCRBLT_ORDER* scrblt);
+void gdi_opaque_rect(rdpContext* context, OPAQUE_RECT_ORDER* opaque_rect);
+void gdi_memblt(rdpContext* context, MEMBLT_ORDER* memblt);
+
 #endif /* __GDI_CORE_H */
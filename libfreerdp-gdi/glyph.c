@@ -0,0 +1,169 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * GDI Glyph Runs
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <freerdp/freerdp.h>
+#include <freerdp/utils/memory.h>
+
+#include <freerdp/gdi/dc.h>
+#include <freerdp/gdi/brush.h>
+#include <freerdp/gdi/region.h>
+#include <freerdp/gdi/clipping.h>
+#include <freerdp/gdi/16bpp.h>
+#include <freerdp/gdi/32bpp.h>
+
+#include "rop.h"
+#include "glyph.h"
+
+/**
+ * Glyphs of a text run are only queued as they come in, clipped against the
+ * drawing surface. The whole run is then composited in a single pass over
+ * its bounding rows, straight from the packed 1 bpp masks of the glyph cache.
+ */
+
+/**
+ * Queue a glyph of the current text run.
+ * @param run glyph run
+ * @param hdc destination device context
+ * @param glyph cached glyph
+ * @param x destination x
+ * @param y destination y
+ */
+
+void gdi_glyph_run_add(GDI_GLYPH_RUN* run, HGDI_DC hdc, rdpGlyph* glyph, int x, int y)
+{
+	int nXSrc = 0;
+	int nYSrc = 0;
+	int width = glyph->cx;
+	int height = glyph->cy;
+	GDI_GLYPH_ITEM* item;
+
+	if (gdi_ClipCoords(hdc, &x, &y, &width, &height, &nXSrc, &nYSrc) == 0)
+		return;
+
+	if ((width <= 0) || (height <= 0))
+		return;
+
+	if (run->count >= run->size)
+	{
+		run->size *= 2;
+		run->items = (GDI_GLYPH_ITEM*) xrealloc(run->items, sizeof(GDI_GLYPH_ITEM) * run->size);
+	}
+
+	item = &run->items[run->count++];
+
+	item->scanline = (glyph->cx + 7) / 8;
+	item->mask = &glyph->aj[nYSrc * item->scanline];
+	item->offset = nXSrc;
+	item->x = x;
+	item->y = y;
+	item->width = width;
+	item->height = height;
+
+	if (run->count == 1)
+	{
+		run->left = x;
+		run->top = y;
+		run->right = x + width;
+		run->bottom = y + height;
+	}
+	else
+	{
+		run->left = MIN(run->left, x);
+		run->top = MIN(run->top, y);
+		run->right = MAX(run->right, x + width);
+		run->bottom = MAX(run->bottom, y + height);
+	}
+}
+
+/**
+ * Composite the queued glyphs in the text color of the device context,
+ * one destination row at a time, and empty the run.
+ * @param run glyph run
+ * @param hdc destination device context
+ */
+
+void gdi_glyph_run_draw(GDI_GLYPH_RUN* run, HGDI_DC hdc)
+{
+	int i;
+	int y;
+	uint8* dstp;
+	uint32 color;
+	GDI_GLYPH_ITEM* item;
+	pRopGlyphRow glyph_row;
+
+	glyph_row = gdi_rop_glyph_row(hdc->bytesPerPixel);
+
+	if ((run->count < 1) || (glyph_row == NULL))
+	{
+		run->count = 0;
+		return;
+	}
+
+	if (hdc->bytesPerPixel == 2)
+		color = gdi_get_color_16bpp(hdc, hdc->textColor);
+	else
+		color = gdi_get_color_32bpp(hdc, hdc->textColor);
+
+	for (y = run->top; y < run->bottom; y++)
+	{
+		dstp = gdi_get_bitmap_pointer(hdc, 0, y);
+
+		for (i = 0; i < run->count; i++)
+		{
+			item = &run->items[i];
+
+			if ((y < item->y) || (y >= item->y + item->height))
+				continue;
+
+			glyph_row(&dstp[item->x * hdc->bytesPerPixel],
+				&item->mask[(y - item->y) * item->scanline], item->offset, item->width, color);
+		}
+	}
+
+	gdi_InvalidateRegion(hdc, run->left, run->top, run->right - run->left, run->bottom - run->top);
+
+	run->count = 0;
+}
+
+GDI_GLYPH_RUN* gdi_glyph_run_new(void)
+{
+	GDI_GLYPH_RUN* run;
+
+	run = xnew(GDI_GLYPH_RUN);
+
+	if (run != NULL)
+	{
+		run->size = 64;
+		run->items = (GDI_GLYPH_ITEM*) xzalloc(sizeof(GDI_GLYPH_ITEM) * run->size);
+		run->brush = gdi_CreateSolidBrush(0);
+	}
+
+	return run;
+}
+
+void gdi_glyph_run_free(GDI_GLYPH_RUN* run)
+{
+	if (run != NULL)
+	{
+		gdi_DeleteObject((HGDIOBJECT) run->brush);
+		xfree(run->items);
+		xfree(run);
+	}
+}
@@ -0,0 +1,56 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * GDI Glyph Runs
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GDI_GLYPH_H
+#define __GDI_GLYPH_H
+
+#include <freerdp/types.h>
+#include <freerdp/graphics.h>
+#include <freerdp/gdi/gdi.h>
+
+struct _GDI_GLYPH_ITEM
+{
+	uint8* mask;
+	int scanline;
+	int offset;
+	int x;
+	int y;
+	int width;
+	int height;
+};
+typedef struct _GDI_GLYPH_ITEM GDI_GLYPH_ITEM;
+
+struct _GDI_GLYPH_RUN
+{
+	int count;
+	int size;
+	GDI_GLYPH_ITEM* items;
+	HGDI_BRUSH brush;
+	int left;
+	int top;
+	int right;
+	int bottom;
+};
+typedef struct _GDI_GLYPH_RUN GDI_GLYPH_RUN;
+
+void gdi_glyph_run_add(GDI_GLYPH_RUN* run, HGDI_DC hdc, rdpGlyph* glyph, int x, int y);
+void gdi_glyph_run_draw(GDI_GLYPH_RUN* run, HGDI_DC hdc);
+
+GDI_GLYPH_RUN* gdi_glyph_run_new(void);
+void gdi_glyph_run_free(GDI_GLYPH_RUN* run);
+
+#endif /* __GDI_GLYPH_H */
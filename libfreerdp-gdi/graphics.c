@@ -30,6 +30,7 @@
 #include <freerdp/codec/bitmap.h>
 #include <freerdp/cache/glyph.h>
 
+#include "glyph.h"
 #include "graphics.h"
 
 /* Bitmap Class */
@@ -66,6 +67,9 @@ void gdi_Bitmap_Free(rdpContext* context, rdpBitmap* bitmap)
 {
 	gdiBitmap* gdi_bitmap = (gdiBitmap*) bitmap;
 
+	/* recorded blits may still read from it */
+	gdi_flush(context->gdi);
+
 	if (gdi_bitmap != NULL)
 	{
 		gdi_SelectObject(gdi_bitmap->hdc, (HGDIOBJECT) gdi_bitmap->org_bitmap);
@@ -79,6 +83,8 @@ void gdi_Bitmap_Paint(rdpContext* context, rdpBitmap* bitmap)
 	int width, height;
 	gdiBitmap* gdi_bitmap = (gdiBitmap*) bitmap;
 
+	gdi_flush(context->gdi);
+
 	width = bitmap->right - bitmap->left + 1;
 	height = bitmap->bottom - bitmap->top + 1;
 
@@ -89,7 +95,7 @@ void gdi_Bitmap_Paint(rdpContext* context, rdpBitmap* bitmap)
 void gdi_Bitmap_Decompress(rdpContext* context, rdpBitmap* bitmap,
 		uint8* data, int width, int height, int bpp, int length, boolean compressed)
 {
-	uint16 size;
+	uint32 size;
 
 	size = width * height * (bpp + 7) / 8;
 
@@ -122,10 +128,36 @@ void gdi_Bitmap_Decompress(rdpContext* context, rdpBitmap* bitmap,
 	bitmap->bpp = bpp;
 }
 
+void gdi_Bitmap_Convert(rdpContext* context, rdpBitmap* bitmap)
+{
+	int size;
+	uint8* data;
+	HGDI_BITMAP hbmp;
+	rdpGdi* gdi = context->gdi;
+
+	hbmp = ((gdiBitmap*) bitmap)->bitmap;
+	size = bitmap->width * bitmap->height * hbmp->bytesPerPixel;
+
+	/* the bitmap stays selected in its dc, only its pixels are replaced */
+	hbmp->data = (uint8*) realloc(hbmp->data, size);
+
+	hbmp->width = bitmap->width;
+	hbmp->height = bitmap->height;
+	hbmp->scanline = bitmap->width * hbmp->bytesPerPixel;
+
+	data = freerdp_image_convert(bitmap->data, hbmp->data,
+			bitmap->width, bitmap->height, gdi->srcBpp, gdi->dstBpp, gdi->clrconv);
+
+	if (data == bitmap->data)
+		memcpy(hbmp->data, data, MIN((int) bitmap->length, size));
+}
+
 void gdi_Bitmap_SetSurface(rdpContext* context, rdpBitmap* bitmap, boolean primary)
 {
 	rdpGdi* gdi = context->gdi;
 
+	gdi_flush(gdi);
+
 	if (primary)
 		gdi->drawing = gdi->primary;
 	else
@@ -136,47 +168,23 @@ void gdi_Bitmap_SetSurface(rdpContext* context, rdpBitmap* bitmap, boolean prima
 
 void gdi_Glyph_New(rdpContext* context, rdpGlyph* glyph)
 {
-	uint8* data;
 	gdiGlyph* gdi_glyph;
 
+	/* the glyph is drawn straight from its packed 1 bpp mask */
 	gdi_glyph = (gdiGlyph*) glyph;
-
-	gdi_glyph->hdc = gdi_GetDC();
-	gdi_glyph->hdc->bytesPerPixel = 1;
-	gdi_glyph->hdc->bitsPerPixel = 1;
-
-	data = freerdp_glyph_convert(glyph->cx, glyph->cy, glyph->aj);
-	gdi_glyph->bitmap = gdi_CreateBitmap(glyph->cx, glyph->cy, 1, data);
-	gdi_glyph->bitmap->bytesPerPixel = 1;
-	gdi_glyph->bitmap->bitsPerPixel = 1;
-
-	gdi_SelectObject(gdi_glyph->hdc, (HGDIOBJECT) gdi_glyph->bitmap);
-	gdi_glyph->org_bitmap = NULL;
+	gdi_glyph->scanline = (glyph->cx + 7) / 8;
 }
 
 void gdi_Glyph_Free(rdpContext* context, rdpGlyph* glyph)
 {
-	gdiGlyph* gdi_glyph;
 
-	gdi_glyph = (gdiGlyph*) glyph;
-
-	if (gdi_glyph != 0)
-	{
-		gdi_SelectObject(gdi_glyph->hdc, (HGDIOBJECT) gdi_glyph->org_bitmap);
-		gdi_DeleteObject((HGDIOBJECT) gdi_glyph->bitmap);
-		gdi_DeleteDC(gdi_glyph->hdc);
-	}
 }
 
 void gdi_Glyph_Draw(rdpContext* context, rdpGlyph* glyph, int x, int y)
 {
-	gdiGlyph* gdi_glyph;
 	rdpGdi* gdi = context->gdi;
 
-	gdi_glyph = (gdiGlyph*) glyph;
-
-	gdi_BitBlt(gdi->drawing->hdc, x, y, gdi_glyph->bitmap->width,
-			gdi_glyph->bitmap->height, gdi_glyph->hdc, 0, 0, GDI_DSPDxax);
+	gdi_glyph_run_add((GDI_GLYPH_RUN*) gdi->glyph_run, gdi->drawing->hdc, glyph, x, y);
 }
 
 void gdi_Glyph_BeginDraw(rdpContext* context, int x, int y, int width, int height, uint32 bgcolor, uint32 fgcolor)
@@ -185,12 +193,15 @@ void gdi_Glyph_BeginDraw(rdpContext* context, int x, int y, int width, int heigh
 	HGDI_BRUSH brush;
 	rdpGdi* gdi = context->gdi;
 
+	gdi_flush(gdi);
+
 	bgcolor = freerdp_color_convert_var_bgr(bgcolor, gdi->srcBpp, 32, gdi->clrconv);
 	fgcolor = freerdp_color_convert_var_bgr(fgcolor, gdi->srcBpp, 32, gdi->clrconv);
 
 	gdi_CRgnToRect(x, y, width, height, &rect);
 
-	brush = gdi_CreateSolidBrush(fgcolor);
+	brush = ((GDI_GLYPH_RUN*) gdi->glyph_run)->brush;
+	brush->color = fgcolor;
 
 	gdi_FillRect(gdi->drawing->hdc, &rect, brush);
 
@@ -201,6 +212,8 @@ void gdi_Glyph_EndDraw(rdpContext* context, int x, int y, int width, int height,
 {
 	rdpGdi* gdi = context->gdi;
 
+	gdi_glyph_run_draw((GDI_GLYPH_RUN*) gdi->glyph_run, gdi->drawing->hdc);
+
 	bgcolor = freerdp_color_convert_var_bgr(bgcolor, gdi->srcBpp, 32, gdi->clrconv);
 	gdi->textColor = gdi_SetTextColor(gdi->drawing->hdc, bgcolor);
 }
@@ -220,6 +233,7 @@ void gdi_register_graphics(rdpGraphics* graphics)
 	bitmap->Paint = gdi_Bitmap_Paint;
 	bitmap->Decompress = gdi_Bitmap_Decompress;
 	bitmap->SetSurface = gdi_Bitmap_SetSurface;
+	bitmap->Convert = gdi_Bitmap_Convert;
 
 	graphics_register_bitmap(graphics, bitmap);
 	xfree(bitmap);
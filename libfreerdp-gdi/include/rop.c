@@ -0,0 +1,89 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * GDI Raster Operation Row Kernels
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* do not include this file directly! */
+
+/**
+ * Each kernel combines length bytes of destination, source and pattern.
+ * The raster operations are bitwise, so a row is processed the same way
+ * regardless of the color depth, ROP_SIZE bytes at a time. The remainder
+ * is passed on to ROP_ROW_TAIL.
+ */
+
+#define ROP_ROW(_name, _expr) \
+ROP_ROW_STORAGE void ROP_ROW_NAME(_name)(uint8* dst, uint8* src, uint8* pat, int length) \
+{ \
+	int i; \
+	ROP_TYPE D, S, P; \
+	\
+	for (i = 0; i + ROP_SIZE <= length; i += ROP_SIZE) \
+	{ \
+		D = ROP_LOAD(&dst[i]); \
+		S = ROP_LOAD(&src[i]); \
+		P = ROP_LOAD(&pat[i]); \
+		ROP_STORE(&dst[i], _expr); \
+	} \
+	\
+	ROP_ROW_TAIL(_name, &dst[i], &src[i], &pat[i], length - i); \
+}
+
+/* D = ~S */
+ROP_ROW(NOTSRCCOPY, ROP_NOT(S))
+
+/* D = ~D */
+ROP_ROW(DSTINVERT, ROP_NOT(D))
+
+/* D = S & ~D */
+ROP_ROW(SRCERASE, ROP_AND(S, ROP_NOT(D)))
+
+/* D = ~S & ~D */
+ROP_ROW(NOTSRCERASE, ROP_AND(ROP_NOT(S), ROP_NOT(D)))
+
+/* D = S ^ D */
+ROP_ROW(SRCINVERT, ROP_XOR(S, D))
+
+/* D = S & D */
+ROP_ROW(SRCAND, ROP_AND(S, D))
+
+/* D = S | D */
+ROP_ROW(SRCPAINT, ROP_OR(S, D))
+
+/* D = ~S & D */
+ROP_ROW(DSna, ROP_AND(ROP_NOT(S), D))
+
+/* D = ~S | D */
+ROP_ROW(MERGEPAINT, ROP_OR(ROP_NOT(S), D))
+
+/* D = S & ~P */
+ROP_ROW(SPna, ROP_AND(S, ROP_NOT(P)))
+
+/* D = S & P */
+ROP_ROW(MERGECOPY, ROP_AND(S, P))
+
+/* D = D | P | ~S */
+ROP_ROW(PATPAINT, ROP_OR(D, ROP_OR(P, ROP_NOT(S))))
+
+/* D = D & P */
+ROP_ROW(DPa, ROP_AND(D, P))
+
+/* D = D ^ ~P */
+ROP_ROW(PDxn, ROP_XOR(D, ROP_NOT(P)))
+
+/* D = P ^ D */
+ROP_ROW(PATINVERT, ROP_XOR(P, D))
+
+#undef ROP_ROW
@@ -0,0 +1,370 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * GDI Raster Operations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <freerdp/api.h>
+#include <freerdp/freerdp.h>
+#include <freerdp/constants.h>
+#include <freerdp/gdi/gdi.h>
+#include <freerdp/utils/memory.h>
+
+#include "config.h"
+#include "rop.h"
+
+#ifdef WITH_SSE2
+#include "rop_sse2.h"
+#endif
+
+#define ROP_OPERAND_SRC		0x01
+#define ROP_OPERAND_PAT		0x02
+
+static const uint8 rop_operands[ROP_ROW_COUNT] =
+{
+	ROP_OPERAND_SRC, /* NOTSRCCOPY */
+	0, /* DSTINVERT */
+	ROP_OPERAND_SRC, /* SRCERASE */
+	ROP_OPERAND_SRC, /* NOTSRCERASE */
+	ROP_OPERAND_SRC, /* SRCINVERT */
+	ROP_OPERAND_SRC, /* SRCAND */
+	ROP_OPERAND_SRC, /* SRCPAINT */
+	ROP_OPERAND_SRC, /* DSna */
+	ROP_OPERAND_SRC, /* MERGEPAINT */
+	ROP_OPERAND_SRC | ROP_OPERAND_PAT, /* SPna */
+	ROP_OPERAND_SRC | ROP_OPERAND_PAT, /* MERGECOPY */
+	ROP_OPERAND_SRC | ROP_OPERAND_PAT, /* PATPAINT */
+	ROP_OPERAND_PAT, /* DPa */
+	ROP_OPERAND_PAT, /* PDxn */
+	ROP_OPERAND_PAT, /* PATINVERT */
+	ROP_OPERAND_PAT /* PATCOPY */
+};
+
+/* byte-wise kernels, used for the end of a row */
+
+#define ROP_TYPE			uint8
+#define ROP_SIZE			1
+#define ROP_LOAD(_p)			(*(_p))
+#define ROP_STORE(_p, _v)		*(_p) = (uint8) (_v)
+#define ROP_NOT(_a)			(~(_a))
+#define ROP_AND(_a, _b)			((_a) & (_b))
+#define ROP_OR(_a, _b)			((_a) | (_b))
+#define ROP_XOR(_a, _b)			((_a) ^ (_b))
+#define ROP_ROW_STORAGE			static
+#define ROP_ROW_NAME(_name)		RopByte_##_name
+#define ROP_ROW_TAIL(_name, _dst, _src, _pat, _length)
+#include "include/rop.c"
+#undef ROP_TYPE
+#undef ROP_SIZE
+#undef ROP_LOAD
+#undef ROP_STORE
+#undef ROP_ROW_STORAGE
+#undef ROP_ROW_NAME
+#undef ROP_ROW_TAIL
+
+/* word-wise kernels, the generic implementation */
+
+static INLINE uint64 rop_load64(uint8* p)
+{
+	uint64 v;
+	memcpy(&v, p, sizeof(uint64));
+	return v;
+}
+
+static INLINE void rop_store64(uint8* p, uint64 v)
+{
+	memcpy(p, &v, sizeof(uint64));
+}
+
+#define ROP_TYPE			uint64
+#define ROP_SIZE			8
+#define ROP_LOAD(_p)			rop_load64(_p)
+#define ROP_STORE(_p, _v)		rop_store64(_p, _v)
+#define ROP_ROW_STORAGE
+#define ROP_ROW_NAME(_name)		RopRow_##_name
+#define ROP_ROW_TAIL(_name, _dst, _src, _pat, _length) \
+	RopByte_##_name(_dst, _src, _pat, _length)
+#include "include/rop.c"
+#undef ROP_TYPE
+#undef ROP_SIZE
+#undef ROP_LOAD
+#undef ROP_STORE
+#undef ROP_NOT
+#undef ROP_AND
+#undef ROP_OR
+#undef ROP_XOR
+#undef ROP_ROW_STORAGE
+#undef ROP_ROW_NAME
+#undef ROP_ROW_TAIL
+
+static void RopRow_PATCOPY(uint8* dst, uint8* src, uint8* pat, int length)
+{
+	memcpy(dst, pat, length);
+}
+
+/**
+ * Glyph kernels, DSPDxax with a packed 1 bpp source: the destination pixels
+ * whose mask bit is set take the text color, the others are left as is.
+ * @param offset index of the first mask bit to use, counted from the MSB of mask[0]
+ */
+
+void RopGlyph_16(uint8* dst, uint8* mask, int offset, int width, uint32 color)
+{
+	int x;
+	int bit;
+	uint16* dst16 = (uint16*) dst;
+
+	for (x = 0; x < width; x++)
+	{
+		bit = offset + x;
+
+		if (mask[bit >> 3] & (0x80 >> (bit & 7)))
+			dst16[x] = (uint16) color;
+	}
+}
+
+void RopGlyph_32(uint8* dst, uint8* mask, int offset, int width, uint32 color)
+{
+	int x;
+	int bit;
+	uint32* dst32 = (uint32*) dst;
+
+	/* the destination alpha is left untouched */
+	for (x = 0; x < width; x++)
+	{
+		bit = offset + x;
+
+		if (mask[bit >> 3] & (0x80 >> (bit & 7)))
+			dst32[x] = (dst32[x] & 0xFF000000) | (color & 0x00FFFFFF);
+	}
+}
+
+static pRopGlyphRow RopGlyph16 = RopGlyph_16;
+static pRopGlyphRow RopGlyph32 = RopGlyph_32;
+
+static pRopRow RopRows[ROP_ROW_COUNT] =
+{
+	RopRow_NOTSRCCOPY,
+	RopRow_DSTINVERT,
+	RopRow_SRCERASE,
+	RopRow_NOTSRCERASE,
+	RopRow_SRCINVERT,
+	RopRow_SRCAND,
+	RopRow_SRCPAINT,
+	RopRow_DSna,
+	RopRow_MERGEPAINT,
+	RopRow_SPna,
+	RopRow_MERGECOPY,
+	RopRow_PATPAINT,
+	RopRow_DPa,
+	RopRow_PDxn,
+	RopRow_PATINVERT,
+	RopRow_PATCOPY
+};
+
+void gdi_set_cpu_opt(uint32 cpu_opt)
+{
+	RopRows[ROP_ROW_NOTSRCCOPY] = RopRow_NOTSRCCOPY;
+	RopRows[ROP_ROW_DSTINVERT] = RopRow_DSTINVERT;
+	RopRows[ROP_ROW_SRCERASE] = RopRow_SRCERASE;
+	RopRows[ROP_ROW_NOTSRCERASE] = RopRow_NOTSRCERASE;
+	RopRows[ROP_ROW_SRCINVERT] = RopRow_SRCINVERT;
+	RopRows[ROP_ROW_SRCAND] = RopRow_SRCAND;
+	RopRows[ROP_ROW_SRCPAINT] = RopRow_SRCPAINT;
+	RopRows[ROP_ROW_DSna] = RopRow_DSna;
+	RopRows[ROP_ROW_MERGEPAINT] = RopRow_MERGEPAINT;
+	RopRows[ROP_ROW_SPna] = RopRow_SPna;
+	RopRows[ROP_ROW_MERGECOPY] = RopRow_MERGECOPY;
+	RopRows[ROP_ROW_PATPAINT] = RopRow_PATPAINT;
+	RopRows[ROP_ROW_DPa] = RopRow_DPa;
+	RopRows[ROP_ROW_PDxn] = RopRow_PDxn;
+	RopRows[ROP_ROW_PATINVERT] = RopRow_PATINVERT;
+	RopGlyph16 = RopGlyph_16;
+	RopGlyph32 = RopGlyph_32;
+
+#ifdef WITH_SSE2
+	if (cpu_opt & CPU_SSE2)
+	{
+		RopRows[ROP_ROW_NOTSRCCOPY] = RopRow_NOTSRCCOPY_sse2;
+		RopRows[ROP_ROW_DSTINVERT] = RopRow_DSTINVERT_sse2;
+		RopRows[ROP_ROW_SRCERASE] = RopRow_SRCERASE_sse2;
+		RopRows[ROP_ROW_NOTSRCERASE] = RopRow_NOTSRCERASE_sse2;
+		RopRows[ROP_ROW_SRCINVERT] = RopRow_SRCINVERT_sse2;
+		RopRows[ROP_ROW_SRCAND] = RopRow_SRCAND_sse2;
+		RopRows[ROP_ROW_SRCPAINT] = RopRow_SRCPAINT_sse2;
+		RopRows[ROP_ROW_DSna] = RopRow_DSna_sse2;
+		RopRows[ROP_ROW_MERGEPAINT] = RopRow_MERGEPAINT_sse2;
+		RopRows[ROP_ROW_SPna] = RopRow_SPna_sse2;
+		RopRows[ROP_ROW_MERGECOPY] = RopRow_MERGECOPY_sse2;
+		RopRows[ROP_ROW_PATPAINT] = RopRow_PATPAINT_sse2;
+		RopRows[ROP_ROW_DPa] = RopRow_DPa_sse2;
+		RopRows[ROP_ROW_PDxn] = RopRow_PDxn_sse2;
+		RopRows[ROP_ROW_PATINVERT] = RopRow_PATINVERT_sse2;
+		RopGlyph16 = RopGlyph_16_sse2;
+		RopGlyph32 = RopGlyph_32_sse2;
+	}
+#endif
+}
+
+/**
+ * Get the glyph kernel for a destination color depth.
+ * @return kernel, or NULL when the depth is not supported
+ */
+
+pRopGlyphRow gdi_rop_glyph_row(int bytesPerPixel)
+{
+	if (bytesPerPixel == 2)
+		return RopGlyph16;
+	else if (bytesPerPixel == 4)
+		return RopGlyph32;
+
+	return NULL;
+}
+
+/**
+ * Repeat the first period bytes of a row over its whole length.
+ */
+
+static void gdi_rop_replicate(uint8* row, int period, int length)
+{
+	int count;
+
+	while (period < length)
+	{
+		count = (period < length - period) ? period : length - period;
+		memcpy(&row[period], row, count);
+		period += count;
+	}
+}
+
+/**
+ * Expand the pattern operand into full rows, once per blit.
+ * A solid color or the text color of a non-pattern brush gives a single row,
+ * a pattern brush gives one row per pattern scanline.
+ * @param color solid color in destination format, or NULL to use the DC brush
+ * @param rows receives the number of rows returned
+ */
+
+static uint8* gdi_rop_pattern(HGDI_DC hdc, int nWidth, int nHeight, uint8* color, int* rows)
+{
+	int x, y;
+	int count;
+	int length;
+	uint8* data;
+	uint8* row;
+	HGDI_BITMAP pattern;
+	int bpp = hdc->bytesPerPixel;
+
+	length = nWidth * bpp;
+
+	if ((color == NULL) && (hdc->brush != NULL) && (hdc->brush->style == GDI_BS_PATTERN))
+	{
+		pattern = hdc->brush->pattern;
+
+		*rows = (pattern->height < nHeight) ? pattern->height : nHeight;
+		count = (pattern->width < nWidth) ? pattern->width : nWidth;
+		data = (uint8*) xmalloc(*rows * length);
+
+		for (y = 0; y < *rows; y++)
+		{
+			row = &data[y * length];
+
+			for (x = 0; x < count; x++)
+				memcpy(&row[x * bpp], gdi_get_brush_pointer(hdc, x, y), bpp);
+
+			gdi_rop_replicate(row, count * bpp, length);
+		}
+	}
+	else
+	{
+		if (color == NULL)
+			color = (uint8*) &(hdc->textColor);
+
+		*rows = 1;
+		data = (uint8*) xmalloc(length);
+
+		memcpy(data, color, bpp);
+		gdi_rop_replicate(data, bpp, length);
+	}
+
+	return data;
+}
+
+/**
+ * Apply a row raster operation to a clipped rectangle.
+ * @param color solid pattern color in destination format, or NULL
+ * @param rop row raster operation (ROP_ROW_*)
+ */
+
+int gdi_rop_blt(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight,
+		HGDI_DC hdcSrc, int nXSrc, int nYSrc, uint8* color, int rop)
+{
+	int y;
+	int rows = 0;
+	int length;
+	int dstStride;
+	int srcStride = 0;
+	uint8* dstp;
+	uint8* srcp;
+	uint8* patp;
+	uint8* patData = NULL;
+	pRopRow rop_row = RopRows[rop];
+
+	if ((nWidth <= 0) || (nHeight <= 0))
+		return 0;
+
+	length = nWidth * hdcDest->bytesPerPixel;
+
+	/* the rows in between are valid whenever the first and the last one are */
+	dstp = gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest);
+
+	if ((dstp == 0) || (gdi_get_bitmap_pointer(hdcDest, nXDest, nYDest + nHeight - 1) == 0))
+		return 0;
+
+	dstStride = ((HGDI_BITMAP) hdcDest->selectedObject)->width * hdcDest->bytesPerPixel;
+
+	srcp = NULL;
+
+	if (rop_operands[rop] & ROP_OPERAND_SRC)
+	{
+		srcp = gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc);
+
+		if ((srcp == 0) || (gdi_get_bitmap_pointer(hdcSrc, nXSrc, nYSrc + nHeight - 1) == 0))
+			return 0;
+
+		srcStride = ((HGDI_BITMAP) hdcSrc->selectedObject)->width * hdcSrc->bytesPerPixel;
+	}
+
+	if (rop_operands[rop] & ROP_OPERAND_PAT)
+		patData = gdi_rop_pattern(hdcDest, nWidth, nHeight, color, &rows);
+
+	for (y = 0; y < nHeight; y++)
+	{
+		/* operands a kernel does not use point to the destination */
+		patp = (patData != NULL) ? &patData[(y % rows) * length] : dstp;
+		rop_row(dstp, (srcp != NULL) ? srcp : dstp, patp, length);
+
+		dstp += dstStride;
+
+		if (srcp != NULL)
+			srcp += srcStride;
+	}
+
+	xfree(patData);
+
+	return 0;
+}
@@ -0,0 +1,71 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * GDI Raster Operations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GDI_ROP_H
+#define __GDI_ROP_H
+
+#include <freerdp/types.h>
+#include <freerdp/gdi/gdi.h>
+
+/* Row Raster Operations */
+#define ROP_ROW_NOTSRCCOPY	0
+#define ROP_ROW_DSTINVERT	1
+#define ROP_ROW_SRCERASE	2
+#define ROP_ROW_NOTSRCERASE	3
+#define ROP_ROW_SRCINVERT	4
+#define ROP_ROW_SRCAND		5
+#define ROP_ROW_SRCPAINT	6
+#define ROP_ROW_DSna		7
+#define ROP_ROW_MERGEPAINT	8
+#define ROP_ROW_SPna		9
+#define ROP_ROW_MERGECOPY	10
+#define ROP_ROW_PATPAINT	11
+#define ROP_ROW_DPa		12
+#define ROP_ROW_PDxn		13
+#define ROP_ROW_PATINVERT	14
+#define ROP_ROW_PATCOPY		15
+#define ROP_ROW_COUNT		16
+
+typedef void (*pRopRow)(uint8* dst, uint8* src, uint8* pat, int length);
+
+void RopRow_NOTSRCCOPY(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_DSTINVERT(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_SRCERASE(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_NOTSRCERASE(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_SRCINVERT(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_SRCAND(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_SRCPAINT(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_DSna(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_MERGEPAINT(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_SPna(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_MERGECOPY(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_PATPAINT(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_DPa(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_PDxn(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_PATINVERT(uint8* dst, uint8* src, uint8* pat, int length);
+
+typedef void (*pRopGlyphRow)(uint8* dst, uint8* mask, int offset, int width, uint32 color);
+
+void RopGlyph_16(uint8* dst, uint8* mask, int offset, int width, uint32 color);
+void RopGlyph_32(uint8* dst, uint8* mask, int offset, int width, uint32 color);
+
+pRopGlyphRow gdi_rop_glyph_row(int bytesPerPixel);
+
+int gdi_rop_blt(HGDI_DC hdcDest, int nXDest, int nYDest, int nWidth, int nHeight,
+		HGDI_DC hdcSrc, int nXSrc, int nYSrc, uint8* color, int rop);
+
+#endif /* __GDI_ROP_H */
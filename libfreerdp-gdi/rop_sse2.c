@@ -0,0 +1,141 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * GDI Raster Operations - SSE2 Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <emmintrin.h>
+
+#include "rop_sse2.h"
+
+#define ROP_TYPE			__m128i
+#define ROP_SIZE			16
+#define ROP_LOAD(_p)			_mm_loadu_si128((__m128i*) (_p))
+#define ROP_STORE(_p, _v)		_mm_storeu_si128((__m128i*) (_p), _v)
+#define ROP_NOT(_a)			_mm_xor_si128(_a, _mm_set1_epi32(-1))
+#define ROP_AND(_a, _b)			_mm_and_si128(_a, _b)
+#define ROP_OR(_a, _b)			_mm_or_si128(_a, _b)
+#define ROP_XOR(_a, _b)			_mm_xor_si128(_a, _b)
+#define ROP_ROW_STORAGE
+#define ROP_ROW_NAME(_name)		RopRow_##_name##_sse2
+#define ROP_ROW_TAIL(_name, _dst, _src, _pat, _length) \
+	RopRow_##_name(_dst, _src, _pat, _length)
+#include "include/rop.c"
+#undef ROP_TYPE
+#undef ROP_SIZE
+#undef ROP_LOAD
+#undef ROP_STORE
+#undef ROP_NOT
+#undef ROP_AND
+#undef ROP_OR
+#undef ROP_XOR
+#undef ROP_ROW_STORAGE
+#undef ROP_ROW_NAME
+#undef ROP_ROW_TAIL
+
+/**
+ * The glyph kernels expand one mask byte at a time: the byte is broadcast,
+ * each lane keeps its own bit and the comparison turns it into a lane mask
+ * used to select between the text color and the destination.
+ */
+
+void RopGlyph_16_sse2(uint8* dst, uint8* mask, int offset, int width, uint32 color)
+{
+	int x = 0;
+	uint8 bits;
+	__m128i m, d;
+	uint16* dst16 = (uint16*) dst;
+	const __m128i select = _mm_setr_epi16(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+	const __m128i c = _mm_set1_epi16((short) color);
+
+	/* bring the mask to a byte boundary first */
+	mask += offset >> 3;
+
+	if (offset & 7)
+	{
+		x = 8 - (offset & 7);
+		x = (x < width) ? x : width;
+		RopGlyph_16(dst, mask, offset & 7, x, color);
+		mask++;
+	}
+
+	for (; x + 8 <= width; x += 8)
+	{
+		bits = *mask++;
+
+		if (bits == 0)
+			continue;
+
+		m = _mm_set1_epi16(bits);
+		m = _mm_cmpeq_epi16(_mm_and_si128(m, select), select);
+
+		d = _mm_loadu_si128((__m128i*) &dst16[x]);
+		d = _mm_or_si128(_mm_andnot_si128(m, d), _mm_and_si128(m, c));
+		_mm_storeu_si128((__m128i*) &dst16[x], d);
+	}
+
+	if (x < width)
+		RopGlyph_16((uint8*) &dst16[x], mask, 0, width - x, color);
+}
+
+void RopGlyph_32_sse2(uint8* dst, uint8* mask, int offset, int width, uint32 color)
+{
+	int x = 0;
+	uint8 bits;
+	__m128i m, d;
+	uint32* dst32 = (uint32*) dst;
+	const __m128i select_lo = _mm_setr_epi32(0x80, 0x40, 0x20, 0x10);
+	const __m128i select_hi = _mm_setr_epi32(0x08, 0x04, 0x02, 0x01);
+	const __m128i rgb = _mm_set1_epi32(0x00FFFFFF);
+	const __m128i c = _mm_set1_epi32(color & 0x00FFFFFF);
+
+	mask += offset >> 3;
+
+	if (offset & 7)
+	{
+		x = 8 - (offset & 7);
+		x = (x < width) ? x : width;
+		RopGlyph_32(dst, mask, offset & 7, x, color);
+		mask++;
+	}
+
+	/* the destination alpha is left untouched */
+	for (; x + 8 <= width; x += 8)
+	{
+		bits = *mask++;
+
+		if (bits == 0)
+			continue;
+
+		m = _mm_set1_epi32(bits);
+
+		d = _mm_loadu_si128((__m128i*) &dst32[x]);
+		m = _mm_and_si128(_mm_cmpeq_epi32(_mm_and_si128(m, select_lo), select_lo), rgb);
+		d = _mm_or_si128(_mm_andnot_si128(m, d), _mm_and_si128(m, c));
+		_mm_storeu_si128((__m128i*) &dst32[x], d);
+
+		m = _mm_set1_epi32(bits);
+
+		d = _mm_loadu_si128((__m128i*) &dst32[x + 4]);
+		m = _mm_and_si128(_mm_cmpeq_epi32(_mm_and_si128(m, select_hi), select_hi), rgb);
+		d = _mm_or_si128(_mm_andnot_si128(m, d), _mm_and_si128(m, c));
+		_mm_storeu_si128((__m128i*) &dst32[x + 4], d);
+	}
+
+	if (x < width)
+		RopGlyph_32((uint8*) &dst32[x], mask, 0, width - x, color);
+}
@@ -0,0 +1,42 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * GDI Raster Operations - SSE2 Optimizations
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __GDI_ROP_SSE2_H
+#define __GDI_ROP_SSE2_H
+
+#include "rop.h"
+
+void RopRow_NOTSRCCOPY_sse2(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_DSTINVERT_sse2(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_SRCERASE_sse2(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_NOTSRCERASE_sse2(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_SRCINVERT_sse2(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_SRCAND_sse2(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_SRCPAINT_sse2(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_DSna_sse2(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_MERGEPAINT_sse2(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_SPna_sse2(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_MERGECOPY_sse2(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_PATPAINT_sse2(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_DPa_sse2(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_PDxn_sse2(uint8* dst, uint8* src, uint8* pat, int length);
+void RopRow_PATINVERT_sse2(uint8* dst, uint8* src, uint8* pat, int length);
+
+void RopGlyph_16_sse2(uint8* dst, uint8* mask, int offset, int width, uint32 color);
+void RopGlyph_32_sse2(uint8* dst, uint8* mask, int offset, int width, uint32 color);
+
+#endif /* __GDI_ROP_SSE2_H */
@@ -115,9 +115,13 @@ int freerdp_parse_args(rdpSettings* settings, int argc, char** argv,
 				"  --no-motion: don't send mouse motion events\n"
 				"  --no-osb: disable offscreen bitmaps\n"
 				"  --no-bmp-cache: disable bitmap cache\n"
+				"  --persist-bmp-cache: keep bitmap cache cells 3 and 4 on disk across sessions\n"
+				"  --bmp-decode-threads: threads decoding bitmap updates, 1 decodes them in order, default is one per cpu up to 4\n"
+				"  --display-list: record drawing orders and leave out those painted over (software gdi)\n"
 				"  --plugin: load a virtual channel plugin\n"
 				"  --rfx: enable RemoteFX\n"
 				"  --rfx-mode: RemoteFX operational flags (v[ideo], i[mage]), default is video\n"
+				"  --no-frame-ack: don't acknowledge RemoteFX frames\n"
 				"  --nsc: enable NSCodec (experimental)\n"
 				"  --disable-wallpaper: disables wallpaper\n"
 				"  --composition: enable desktop composition\n"
@@ -329,6 +333,24 @@ int freerdp_parse_args(rdpSettings* settings, int argc, char** argv,
 		{
 			settings->bitmap_cache = false;
 		}
+		else if (strcmp("--persist-bmp-cache", argv[index]) == 0)
+		{
+			settings->bitmap_cache_persist_enabled = true;
+		}
+		else if (strcmp("--bmp-decode-threads", argv[index]) == 0)
+		{
+			index++;
+			if (index == argc)
+			{
+				printf("missing number of bitmap decoding threads\n");
+				return FREERDP_ARGS_PARSE_FAILURE;
+			}
+			settings->bitmap_decode_threads = atoi(argv[index]);
+		}
+		else if (strcmp("--display-list", argv[index]) == 0)
+		{
+			settings->gdi_display_list = true;
+		}
 		else if (strcmp("--no-auth", argv[index]) == 0)
 		{
 			settings->authentication = false;
@@ -356,6 +378,10 @@ int freerdp_parse_args(rdpSettings* settings, int argc, char** argv,
 
 			settings->certificate_name = xstrdup(argv[index]);
 		}
+		else if (strcmp("--no-frame-ack", argv[index]) == 0)
+		{
+			settings->frame_acknowledge = false;
+		}
 		else if (strcmp("--no-fastpath", argv[index]) == 0)
 		{
 			settings->fastpath_input = false;
@@ -399,7 +425,6 @@ int freerdp_parse_args(rdpSettings* settings, int argc, char** argv,
 			settings->rfx_codec = true;
 			settings->fastpath_output = true;
 			settings->color_depth = 32;
-			settings->frame_acknowledge = false;
 			settings->performance_flags = PERF_FLAG_NONE;
 			settings->large_pointer = true;
 		}
@@ -62,6 +62,176 @@ uint8* dsp_resample(uint8* src, int bytes_per_sample,
 	return dst;
 }
 
+/**
+ * Streaming resampler: linear interpolation between consecutive source
+ * frames, stepped by a 32.32 fixed-point phase so that no division is
+ * needed per frame. The last two source frames and the phase are carried
+ * across calls, which keeps block boundaries continuous.
+ *
+ * 8-bit samples are unsigned as in WAVE PCM, 16-bit samples are signed
+ * little-endian. Source channel n is mixed into target channel n % rchan
+ * when downmixing, and target channel n repeats source channel n % schan
+ * when upmixing.
+ */
+
+#define DSP_PHASE_ONE	((uint64) 1 << 32)
+
+DSP_RESAMPLER* dsp_resampler_new(int bytes_per_sample,
+	uint32 schan, uint32 srate, uint32 rchan, uint32 rrate)
+{
+	DSP_RESAMPLER* resampler;
+
+	if (schan < 1 || schan > DSP_MAX_CHANNELS || rchan < 1 || rchan > DSP_MAX_CHANNELS)
+		return NULL;
+	if (srate < 1 || rrate < 1 || (bytes_per_sample != 1 && bytes_per_sample != 2))
+		return NULL;
+
+	resampler = xnew(DSP_RESAMPLER);
+	resampler->bytes_per_sample = bytes_per_sample;
+	resampler->schan = schan;
+	resampler->srate = srate;
+	resampler->rchan = rchan;
+	resampler->rrate = rrate;
+	resampler->step = ((uint64) srate << 32) / rrate;
+
+	return resampler;
+}
+
+void dsp_resampler_free(DSP_RESAMPLER* resampler)
+{
+	xfree(resampler);
+}
+
+void dsp_resampler_reset(DSP_RESAMPLER* resampler)
+{
+	resampler->primed = false;
+	resampler->phase = 0;
+	resampler->pending = 0;
+}
+
+/**
+ * Upper bound on the number of frames produced from sframes source frames,
+ * used to size the output buffer passed to dsp_resampler_process().
+ */
+
+int dsp_resampler_get_max_frames(DSP_RESAMPLER* resampler, int sframes)
+{
+	return (int) (((uint64) (sframes + 1) * resampler->rrate + resampler->srate - 1) / resampler->srate) + 1;
+}
+
+static void dsp_resampler_load(DSP_RESAMPLER* resampler, uint8* src, sint32* frame)
+{
+	uint32 i;
+	sint32 sample;
+	sint32 sum[DSP_MAX_CHANNELS];
+	int count[DSP_MAX_CHANNELS];
+
+	if (resampler->schan <= resampler->rchan)
+	{
+		for (i = 0; i < resampler->schan; i++)
+		{
+			if (resampler->bytes_per_sample == 2)
+				frame[i] = (sint16) (src[2 * i] | (src[2 * i + 1] << 8));
+			else
+				frame[i] = (sint32) src[i] - 128;
+		}
+		return;
+	}
+
+	memset(sum, 0, sizeof(sum));
+	memset(count, 0, sizeof(count));
+
+	for (i = 0; i < resampler->schan; i++)
+	{
+		if (resampler->bytes_per_sample == 2)
+			sample = (sint16) (src[2 * i] | (src[2 * i + 1] << 8));
+		else
+			sample = (sint32) src[i] - 128;
+
+		sum[i % resampler->rchan] += sample;
+		count[i % resampler->rchan]++;
+	}
+
+	for (i = 0; i < resampler->rchan; i++)
+		frame[i] = sum[i] / count[i];
+}
+
+/**
+ * Resample sframes frames from src into dst, which has room for max_rframes
+ * frames. Input left over when dst fills up is dropped; size dst with
+ * dsp_resampler_get_max_frames() to avoid that.
+ * @return number of frames written to dst
+ */
+
+int dsp_resampler_process(DSP_RESAMPLER* resampler, uint8* src, int sframes,
+	uint8* dst, int max_rframes)
+{
+	uint32 i;
+	uint32 chan;
+	uint32 weight;
+	sint32 sample;
+	int sbytes;
+	int rframes;
+	int s;
+
+	s = 0;
+	rframes = 0;
+	sbytes = resampler->bytes_per_sample * resampler->schan;
+	chan = MIN(resampler->schan, resampler->rchan);
+
+	if (!resampler->primed)
+	{
+		if (sframes < 1)
+			return 0;
+
+		dsp_resampler_load(resampler, src, resampler->x1);
+		memcpy(resampler->x0, resampler->x1, sizeof(resampler->x0));
+		resampler->pending = 1;
+		resampler->primed = true;
+		s = 1;
+	}
+
+	while (rframes < max_rframes)
+	{
+		while (resampler->pending > 0)
+		{
+			if (s >= sframes)
+				return rframes;
+
+			memcpy(resampler->x0, resampler->x1, sizeof(resampler->x0));
+			dsp_resampler_load(resampler, src + s * sbytes, resampler->x1);
+			resampler->pending--;
+			s++;
+		}
+
+		/* Q14 weight keeps the product within 32 bits for 16-bit samples */
+		weight = (uint32) (resampler->phase >> 18);
+
+		for (i = 0; i < resampler->rchan; i++)
+		{
+			sample = resampler->x0[i % chan];
+			sample += ((resampler->x1[i % chan] - sample) * (sint32) weight) >> 14;
+
+			if (resampler->bytes_per_sample == 2)
+			{
+				*dst++ = (uint8) (sample & 0xFF);
+				*dst++ = (uint8) ((sample >> 8) & 0xFF);
+			}
+			else
+			{
+				*dst++ = (uint8) (sample + 128);
+			}
+		}
+
+		rframes++;
+		resampler->phase += resampler->step;
+		resampler->pending = (uint32) (resampler->phase >> 32);
+		resampler->phase &= (DSP_PHASE_ONE - 1);
+	}
+
+	return rframes;
+}
+
 /**
  * Microsoft IMA ADPCM specification:
  *
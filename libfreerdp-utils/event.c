@@ -132,7 +132,10 @@ static void freerdp_tsmf_event_free(RDP_EVENT* event)
 		case RDP_EVENT_TYPE_TSMF_VIDEO_FRAME:
 			{
 				RDP_VIDEO_FRAME_EVENT* vevent = (RDP_VIDEO_FRAME_EVENT*)event;
-				xfree(vevent->frame_data);
+
+				/* shared memory frames are given back by the event free callback */
+				if (!vevent->frame_shm)
+					xfree(vevent->frame_data);
 				xfree(vevent->visible_rects);
 			}
 			break;
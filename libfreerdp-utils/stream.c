@@ -38,6 +38,7 @@ STREAM* stream_new(int size)
 			stream->data = (uint8*) xzalloc(size);
 			stream->p = stream->data;
 			stream->size = size;
+			stream->capacity = size;
 		}
 	}
 
@@ -55,6 +56,12 @@ void stream_free(STREAM* stream)
 	}
 }
 
+/**
+ * Grow a stream by the requested size, or by its current size when that is
+ * larger. The buffer is only reallocated when its capacity falls short, a
+ * pooled or sealed stream grows in place otherwise.
+ */
+
 void stream_extend(STREAM* stream, int request_size)
 {
 	int pos;
@@ -66,11 +73,136 @@ void stream_extend(STREAM* stream, int request_size)
 	increased_size = (request_size > original_size ? request_size : original_size);
 	stream->size += increased_size;
 
-	if (original_size == 0)
+	if (stream->data == NULL)
+	{
 		stream->data = (uint8*) xmalloc(stream->size);
-	else
+		stream->capacity = stream->size;
+	}
+	else if (stream->size > stream->capacity)
+	{
 		stream->data = (uint8*) xrealloc(stream->data, stream->size);
+		stream->capacity = stream->size;
+	}
 
 	memset(stream->data + original_size, 0, increased_size);
 	stream_set_pos(stream, pos);
 }
+
+/* smallest size class holding the given size, or -1 when too large to be pooled */
+static int stream_pool_class(int size)
+{
+	int size_class;
+
+	for (size_class = 0; size_class < STREAM_POOL_CLASSES; size_class++)
+	{
+		if (size <= (1 << (STREAM_POOL_MIN_SHIFT + size_class)))
+			return size_class;
+	}
+
+	return -1;
+}
+
+STREAM_POOL* stream_pool_new(void)
+{
+	STREAM_POOL* pool;
+
+	pool = xnew(STREAM_POOL);
+
+	return pool;
+}
+
+void stream_pool_free(STREAM_POOL* pool)
+{
+	int size_class;
+
+	if (pool == NULL)
+		return;
+
+	for (size_class = 0; size_class < STREAM_POOL_CLASSES; size_class++)
+	{
+		while (pool->count[size_class] > 0)
+			stream_free(pool->streams[size_class][--(pool->count[size_class])]);
+	}
+
+	xfree(pool);
+}
+
+/**
+ * Get a stream that can hold at least the given size, taken from the pool
+ * when one of that size class is kept. Without a pool, or when the size is
+ * too large to be pooled, a stream of just that size is allocated. Either
+ * way the buffer is not cleared.
+ */
+
+STREAM* stream_pool_acquire(STREAM_POOL* pool, int size)
+{
+	int size_class;
+	STREAM* stream;
+
+	size = size >= 0 ? size : 0x400;
+	size_class = stream_pool_class(size);
+
+	if (pool != NULL)
+	{
+		pool->acquired++;
+
+		if (size_class >= 0 && pool->count[size_class] > 0)
+		{
+			stream = pool->streams[size_class][--(pool->count[size_class])];
+			pool->bytes_held -= stream->capacity;
+			pool->reused++;
+
+			stream->p = stream->data;
+			stream->size = size;
+
+			return stream;
+		}
+
+		pool->allocated++;
+	}
+
+	stream = xnew(STREAM);
+	stream->capacity = (pool != NULL && size_class >= 0) ? (1 << (STREAM_POOL_MIN_SHIFT + size_class)) : size;
+	stream->data = (uint8*) xmalloc(stream->capacity);
+	stream->p = stream->data;
+	stream->size = size;
+
+	return stream;
+}
+
+/**
+ * Give back a stream once done with it. It is kept for the size class its
+ * buffer fills, unless that class is full, and freed otherwise.
+ */
+
+void stream_pool_release(STREAM_POOL* pool, STREAM* stream)
+{
+	int size_class;
+
+	if (stream == NULL)
+		return;
+
+	if (pool == NULL)
+	{
+		stream_free(stream);
+		return;
+	}
+
+	pool->released++;
+
+	/* the largest size class the buffer fills */
+	size_class = stream_pool_class(stream->capacity);
+
+	if (size_class >= 0 && stream->capacity < (1 << (STREAM_POOL_MIN_SHIFT + size_class)))
+		size_class--;
+
+	if (size_class < 0 || stream->data == NULL || pool->count[size_class] >= STREAM_POOL_DEPTH)
+	{
+		pool->discarded++;
+		stream_free(stream);
+		return;
+	}
+
+	pool->streams[size_class][pool->count[size_class]++] = stream;
+	pool->bytes_held += stream->capacity;
+}
@@ -158,7 +158,8 @@ static void svc_plugin_process_received(rdpSvcPlugin* plugin, void* pData, uint3
 	{
 		if (plugin->priv->data_in != NULL)
 			stream_free(plugin->priv->data_in);
-		plugin->priv->data_in = stream_new(totalLength);
+		/* filled entirely by the chunks that follow, no need to clear it */
+		plugin->priv->data_in = stream_pool_acquire(NULL, totalLength);
 	}
 
 	data_in = plugin->priv->data_in;
@@ -167,12 +168,16 @@ static void svc_plugin_process_received(rdpSvcPlugin* plugin, void* pData, uint3
 
 	if (dataFlags & CHANNEL_FLAG_LAST)
 	{
+		plugin->priv->data_in = NULL;
+
+		/* the part never written holds whatever the buffer held before */
 		if (stream_get_size(data_in) != stream_get_length(data_in))
 		{
 			printf("svc_plugin_process_received: read error\n");
+			stream_free(data_in);
+			return;
 		}
 
-		plugin->priv->data_in = NULL;
 		stream_set_pos(data_in, 0);
 
 		item = xnew(svc_data_in_item);
@@ -17,19 +17,61 @@
  * limitations under the License.
  */
 
+#include <sys/time.h>
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
 #include <freerdp/utils/sleep.h>
+#include <freerdp/utils/memory.h>
 
+#include "xf_motion.h"
 #include "xf_encode.h"
 
-XImage* xf_snapshot(xfPeerContext* xfp, int x, int y, int width, int height)
+static xfEncoder* xf_encoder = NULL;
+static pthread_mutex_t xf_encoder_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* get time in microseconds */
+static uint64 xf_get_utime(void)
+{
+	struct timeval tp;
+
+	gettimeofday(&tp, 0);
+	return ((uint64) tp.tv_sec) * 1000000 + tp.tv_usec;
+}
+
+static void xf_region_union(GDI_RGN* rgn, int x, int y, int width, int height)
+{
+	int right, bottom;
+
+	if (width <= 0 || height <= 0)
+		return;
+
+	if (rgn->null)
+	{
+		rgn->x = x;
+		rgn->y = y;
+		rgn->w = width;
+		rgn->h = height;
+		rgn->null = 0;
+		return;
+	}
+
+	right = MAX(rgn->x + rgn->w, x + width);
+	bottom = MAX(rgn->y + rgn->h, y + height);
+
+	rgn->x = MIN(rgn->x, x);
+	rgn->y = MIN(rgn->y, y);
+	rgn->w = right - rgn->x;
+	rgn->h = bottom - rgn->y;
+}
+
+XImage* xf_snapshot(xfEncoder* encoder, int x, int y, int width, int height)
 {
 	XImage* image;
-	xfInfo* xfi = xfp->info;
+	xfInfo* xfi = encoder->info;
 
 	if (xfi->use_xshm)
 	{
-		pthread_mutex_lock(&(xfp->mutex));
+		pthread_mutex_lock(&(encoder->display_mutex));
 
 		XCopyArea(xfi->display, xfi->root_window, xfi->fb_pixmap,
 				xfi->xdamage_gc, x, y, width, height, x, y);
@@ -38,25 +80,25 @@ XImage* xf_snapshot(xfPeerContext* xfp, int x, int y, int width, int height)
 
 		image = xfi->fb_image;
 
-		pthread_mutex_unlock(&(xfp->mutex));
+		pthread_mutex_unlock(&(encoder->display_mutex));
 	}
 	else
 	{
-		pthread_mutex_lock(&(xfp->mutex));
+		pthread_mutex_lock(&(encoder->display_mutex));
 
 		image = XGetImage(xfi->display, xfi->root_window,
 				x, y, width, height, AllPlanes, ZPixmap);
 
-		pthread_mutex_unlock(&(xfp->mutex));
+		pthread_mutex_unlock(&(encoder->display_mutex));
 	}
 
 	return image;
 }
 
-void xf_xdamage_subtract_region(xfPeerContext* xfp, int x, int y, int width, int height)
+void xf_xdamage_subtract_region(xfEncoder* encoder, int x, int y, int width, int height)
 {
 	XRectangle region;
-	xfInfo* xfi = xfp->info;
+	xfInfo* xfi = encoder->info;
 
 	region.x = x;
 	region.y = y;
@@ -64,33 +106,402 @@ void xf_xdamage_subtract_region(xfPeerContext* xfp, int x, int y, int width, int
 	region.height = height;
 
 #ifdef WITH_XFIXES
-	pthread_mutex_lock(&(xfp->mutex));
+	pthread_mutex_lock(&(encoder->display_mutex));
 	XFixesSetRegion(xfi->display, xfi->xdamage_region, &region, 1);
 	XDamageSubtract(xfi->display, xfi->xdamage, xfi->xdamage_region, None);
-	pthread_mutex_unlock(&(xfp->mutex));
+	pthread_mutex_unlock(&(encoder->display_mutex));
 #endif
 }
 
-void* xf_frame_rate_thread(void* param)
+/**
+ * Split the area of a frame around a moved block spanning its whole width
+ * or height, leaving the parts that still have to be encoded.
+ */
+
+static int xf_motion_exposed_rects(xfMotion* motion, int width, int height, RFX_RECT* rects)
 {
-	xfInfo* xfi;
-	xfEvent* event;
+	int num_rects = 0;
+
+	if (motion->width == width)
+	{
+		if (motion->y > 0)
+		{
+			rects[num_rects].x = 0;
+			rects[num_rects].y = 0;
+			rects[num_rects].width = width;
+			rects[num_rects].height = motion->y;
+			num_rects++;
+		}
+
+		if (motion->y + motion->height < height)
+		{
+			rects[num_rects].x = 0;
+			rects[num_rects].y = motion->y + motion->height;
+			rects[num_rects].width = width;
+			rects[num_rects].height = height - (motion->y + motion->height);
+			num_rects++;
+		}
+	}
+	else
+	{
+		if (motion->x > 0)
+		{
+			rects[num_rects].x = 0;
+			rects[num_rects].y = 0;
+			rects[num_rects].width = motion->x;
+			rects[num_rects].height = height;
+			num_rects++;
+		}
+
+		if (motion->x + motion->width < width)
+		{
+			rects[num_rects].x = motion->x + motion->width;
+			rects[num_rects].y = 0;
+			rects[num_rects].width = width - (motion->x + motion->width);
+			rects[num_rects].height = height;
+			num_rects++;
+		}
+	}
+
+	return num_rects;
+}
+
+/**
+ * Compare the captured area against the reference frame, turning content
+ * that only moved into a SCRBLT of the frame. Returns the rectangles left
+ * to encode, relative to the area.
+ */
+
+static int xf_frame_motion(xfEncoder* encoder, xfFrame* frame, uint8* data, int step, RFX_RECT* rects)
+{
+	uint8* reference;
+	xfMotion motion;
+	int bpp = encoder->info->bytesPerPixel;
+
+	reference = &encoder->reference[(frame->y * encoder->reference_step) + (frame->x * bpp)];
+
+	if (bpp != 4 || !xf_motion_estimate(reference, encoder->reference_step, data, step,
+			frame->width, frame->height, &motion))
+	{
+		rects[0].x = 0;
+		rects[0].y = 0;
+		rects[0].width = frame->width;
+		rects[0].height = frame->height;
+		return 1;
+	}
+
+	frame->scroll = true;
+	frame->scrblt.nLeftRect = frame->x + motion.x;
+	frame->scrblt.nTopRect = frame->y + motion.y;
+	frame->scrblt.nWidth = motion.width;
+	frame->scrblt.nHeight = motion.height;
+	frame->scrblt.bRop = 0xCC; /* SRCCOPY */
+	frame->scrblt.nXSrc = frame->scrblt.nLeftRect - motion.dx;
+	frame->scrblt.nYSrc = frame->scrblt.nTopRect - motion.dy;
+
+	return xf_motion_exposed_rects(&motion, frame->width, frame->height, rects);
+}
+
+static void xf_reference_update(xfEncoder* encoder, xfFrame* frame, uint8* data, int step)
+{
+	int y;
+	uint8* reference;
+	int length = frame->width * encoder->info->bytesPerPixel;
+
+	reference = &encoder->reference[(frame->y * encoder->reference_step) +
+			(frame->x * encoder->info->bytesPerPixel)];
+
+	for (y = 0; y < frame->height; y++)
+		memcpy(&reference[y * encoder->reference_step], &data[y * step], length);
+}
+
+static xfFrame* xf_frame_encode(xfEncoder* encoder, int x, int y, int width, int height, boolean motion)
+{
+	int step;
+	uint8* data;
+	int num_rects;
+	XImage* image;
+	xfFrame* frame;
+	RFX_RECT rects[2];
+	xfInfo* xfi = encoder->info;
+
+	frame = xnew(xfFrame);
+	frame->refs = 1;
+	frame->s = stream_new(65536);
+
+	if (xfi->use_xshm)
+	{
+		width = x + width;
+		height = y + height;
+		x = 0;
+		y = 0;
+
+		image = xf_snapshot(encoder, x, y, width, height);
+
+		step = image->bytes_per_line;
+		data = (uint8*) image->data;
+		data = &data[(y * image->bytes_per_line) + (x * image->bits_per_pixel)];
+	}
+	else
+	{
+		image = xf_snapshot(encoder, x, y, width, height);
+
+		step = width * xfi->bytesPerPixel;
+		data = (uint8*) image->data;
+	}
+
+	frame->x = x;
+	frame->y = y;
+	frame->width = width;
+	frame->height = height;
+
+	if (motion)
+	{
+		num_rects = xf_frame_motion(encoder, frame, data, step, rects);
+	}
+	else
+	{
+		rects[0].x = 0;
+		rects[0].y = 0;
+		rects[0].width = width;
+		rects[0].height = height;
+		num_rects = 1;
+	}
+
+	rfx_context_set_rate_control(encoder->rfx_context, encoder->frame_budget);
+	rfx_compose_message(encoder->rfx_context, frame->s, rects, num_rects, data, width, height, step);
+
+	xf_reference_update(encoder, frame, data, step);
+
+	if (!xfi->use_xshm)
+		XDestroyImage(image);
+
+	return frame;
+}
+
+static void xf_frame_free(xfFrame* frame)
+{
+	stream_free(frame->s);
+	xfree(frame);
+}
+
+void xf_frame_release(xfEncoder* encoder, xfFrame* frame)
+{
+	int refs;
+
+	pthread_mutex_lock(&(encoder->mutex));
+	refs = --(frame->refs);
+	pthread_mutex_unlock(&(encoder->mutex));
+
+	if (refs == 0)
+		xf_frame_free(frame);
+}
+
+/**
+ * A peer is backlogged when its queue is full, or when the frames it holds
+ * and what its socket has not sent yet exceed the bytes allowed in flight.
+ */
+
+static boolean xf_peer_backlogged(freerdp_peer* client)
+{
+	PEER_SEND_STATUS status;
+	xfPeerContext* xfp = (xfPeerContext*) client->context;
+
+	if (xfp->queue.count >= XF_SEND_QUEUE_DEPTH)
+		return true;
+
+	client->GetSendStatus(client, &status);
+	xfp->queue.backlog = MAX(status.backlog, 0);
+
+	return (xfp->queue.bytes + xfp->queue.backlog >= XF_SEND_QUEUE_BYTES) ? true : false;
+}
+
+/* the frames it holds and those it has not acknowledged fill its window */
+static boolean xf_peer_window_full(xfPeerContext* xfp)
+{
+	if (!xfp->queue.acknowledge)
+		return false;
+
+	return (xfp->queue.count + (xfp->queue.frame_id - xfp->queue.acked_id) >= xfp->queue.window) ? true : false;
+}
+
+/**
+ * A peer is congested, and takes no new frame, when it is backlogged or
+ * when its frame acknowledgement window is full.
+ */
+
+static boolean xf_peer_congested(freerdp_peer* client)
+{
+	xfPeerContext* xfp = (xfPeerContext*) client->context;
+
+	if (xf_peer_window_full(xfp))
+		return true;
+
+	return xf_peer_backlogged(client);
+}
+
+static void xf_peer_signal(xfPeerContext* xfp)
+{
+	if ((xfp->queue.count > 0) && !xfp->queue.signaled)
+	{
+		xf_event_push(xfp->event_queue, xf_event_new(XF_EVENT_TYPE_FRAME));
+		xfp->queue.signaled = true;
+	}
+}
+
+/**
+ * Capture and encode the area damaged since the last frame, along with
+ * what each peer dropped, then queue the frame for all peers.
+ */
+
+static void xf_encoder_update(xfEncoder* encoder)
+{
+	int peers;
+	int congested;
+	int backlogged;
+	boolean motion;
+	xfFrame* frame;
+	GDI_RGN region;
 	xfPeerContext* xfp;
 	freerdp_peer* client;
-	uint32 wait_interval;
 
-	client = (freerdp_peer*) param;
-	xfp = (xfPeerContext*) client->context;
-	xfi = xfp->info;
+	pthread_mutex_lock(&(encoder->mutex));
 
-	wait_interval = 1000000 / xfp->fps;
+	peers = list_size(encoder->peers);
+
+	if (peers < 1)
+	{
+		encoder->damage.null = 1;
+		pthread_mutex_unlock(&(encoder->mutex));
+		return;
+	}
+
+	congested = 0;
+	backlogged = 0;
+	client = (freerdp_peer*) list_peek(encoder->peers);
+
+	while (client != NULL)
+	{
+		xfp = (xfPeerContext*) client->context;
+
+		/* frames left waiting on a busy socket are retried on every tick */
+		xf_peer_signal(xfp);
+
+		if (xf_peer_backlogged(client))
+		{
+			backlogged++;
+			congested++;
+		}
+		else if (xf_peer_window_full(xfp))
+		{
+			congested++;
+		}
+
+		client = (freerdp_peer*) list_next(encoder->peers, client);
+	}
+
+	if (congested == peers)
+	{
+		/* nobody can take a frame, keep accumulating damage instead of encoding */
+		pthread_mutex_unlock(&(encoder->mutex));
+		return;
+	}
+
+	region = encoder->damage;
+	encoder->damage.null = 1;
+
+	/* a move can only be replayed by peers showing the reference frame */
+	motion = true;
+	client = (freerdp_peer*) list_peek(encoder->peers);
+
+	while (client != NULL)
+	{
+		xfp = (xfPeerContext*) client->context;
+
+		if (xfp->missed.null == false)
+		{
+			xf_region_union(&region, xfp->missed.x, xfp->missed.y, xfp->missed.w, xfp->missed.h);
+			motion = false;
+		}
+
+		if (!client->settings->order_support[NEG_SCRBLT_INDEX])
+			motion = false;
+
+		xfp->missed.null = 1;
+		client = (freerdp_peer*) list_next(encoder->peers, client);
+	}
+
+	/* a full window is latency, only bytes piling up call for smaller frames */
+	if (!region.null)
+	{
+		if (backlogged > 0)
+			encoder->frame_budget = MAX(encoder->frame_budget / 4 * 3, XF_FRAME_BUDGET_MIN);
+		else
+			encoder->frame_budget = MIN(encoder->frame_budget + XF_FRAME_BUDGET_STEP, XF_FRAME_BUDGET_MAX);
+	}
+
+	pthread_mutex_unlock(&(encoder->mutex));
+
+	if (region.null)
+		return;
+
+	frame = xf_frame_encode(encoder, region.x, region.y, region.w, region.h, motion);
+
+	pthread_mutex_lock(&(encoder->mutex));
+
+	client = (freerdp_peer*) list_peek(encoder->peers);
+
+	while (client != NULL)
+	{
+		xfp = (xfPeerContext*) client->context;
+
+		if (xfp->missed.null == false)
+		{
+			/*
+			 * Attached while the frame was encoded: the peer does not show the
+			 * reference frame a SCRBLT would move, the whole screen is still to come.
+			 */
+			xf_region_union(&xfp->missed, frame->x, frame->y, frame->width, frame->height);
+		}
+		else if (xf_peer_congested(client))
+		{
+			/* coalesced with what the peer missed, sent once it has caught up */
+			xf_region_union(&xfp->missed, frame->x, frame->y, frame->width, frame->height);
+			xfp->queue.dropped++;
+		}
+		else
+		{
+			frame->refs++;
+			xfp->queue.frames[(xfp->queue.head + xfp->queue.count) % XF_SEND_QUEUE_DEPTH] = frame;
+			xfp->queue.count++;
+			xfp->queue.bytes += stream_get_length(frame->s);
+			xfp->queue.max_depth = MAX(xfp->queue.max_depth, xfp->queue.count);
+
+			xf_peer_signal(xfp);
+		}
+
+		client = (freerdp_peer*) list_next(encoder->peers, client);
+	}
+
+	pthread_mutex_unlock(&(encoder->mutex));
+
+	xf_frame_release(encoder, frame);
+}
+
+void* xf_frame_rate_thread(void* param)
+{
+	uint32 wait_interval;
+	xfEncoder* encoder = (xfEncoder*) param;
+
+	wait_interval = 1000000 / encoder->fps;
 
 	while (1)
 	{
-		event = xf_event_new(XF_EVENT_TYPE_FRAME_TICK);
-		xf_event_push(xfp->event_queue, (xfEvent*) event);
+		xf_encoder_update(encoder);
 		freerdp_usleep(wait_interval);
 	}
+
+	return NULL;
 }
 
 void* xf_monitor_updates(void* param)
@@ -101,24 +512,18 @@ void* xf_monitor_updates(void* param)
 	fd_set rfds_set;
 	int select_status;
 	int pending_events;
-	xfPeerContext* xfp;
-	freerdp_peer* client;
 	uint32 wait_interval;
 	struct timeval timeout;
 	int x, y, width, height;
 	XDamageNotifyEvent* notify;
-	xfEventRegion* event_region;
+	xfEncoder* encoder = (xfEncoder*) param;
 
-	client = (freerdp_peer*) param;
-	xfp = (xfPeerContext*) client->context;
-	xfi = xfp->info;
+	xfi = encoder->info;
 
 	fds = xfi->xfds;
 	wait_interval = (1000000 / 2500);
 	memset(&timeout, 0, sizeof(struct timeval));
 
-	pthread_create(&(xfp->frame_rate_thread), 0, xf_frame_rate_thread, (void*) client);
-
 	pthread_detach(pthread_self());
 
 	while (1)
@@ -139,16 +544,16 @@ void* xf_monitor_updates(void* param)
 			//printf("select timeout\n");
 		}
 
-		pthread_mutex_lock(&(xfp->mutex));
+		pthread_mutex_lock(&(encoder->display_mutex));
 		pending_events = XPending(xfi->display);
-		pthread_mutex_unlock(&(xfp->mutex));
+		pthread_mutex_unlock(&(encoder->display_mutex));
 
 		if (pending_events > 0)
 		{
-			pthread_mutex_lock(&(xfp->mutex));
+			pthread_mutex_lock(&(encoder->display_mutex));
 			memset(&xevent, 0, sizeof(xevent));
 			XNextEvent(xfi->display, &xevent);
-			pthread_mutex_unlock(&(xfp->mutex));
+			pthread_mutex_unlock(&(encoder->display_mutex));
 
 			if (xevent.type == xfi->xdamage_notify_event)
 			{
@@ -159,13 +564,193 @@ void* xf_monitor_updates(void* param)
 				width = notify->area.width;
 				height = notify->area.height;
 
-				xf_xdamage_subtract_region(xfp, x, y, width, height);
+				xf_xdamage_subtract_region(encoder, x, y, width, height);
 
-				event_region = xf_event_region_new(x, y, width, height);
-				xf_event_push(xfp->event_queue, (xfEvent*) event_region);
+				pthread_mutex_lock(&(encoder->mutex));
+				xf_region_union(&encoder->damage, x, y, width, height);
+				pthread_mutex_unlock(&(encoder->mutex));
 			}
 		}
 	}
 
 	return NULL;
 }
+
+/**
+ * Get the encoder shared by all peers, started on first use.
+ */
+
+xfEncoder* xf_encoder_get(void)
+{
+	xfEncoder* encoder;
+
+	pthread_mutex_lock(&xf_encoder_mutex);
+
+	if (xf_encoder == NULL)
+	{
+		encoder = xnew(xfEncoder);
+
+		encoder->fps = 24;
+		encoder->info = xf_info_init(true);
+		encoder->peers = list_new();
+		encoder->damage.null = 1;
+
+		encoder->reference_step = encoder->info->width * encoder->info->bytesPerPixel;
+		encoder->reference = (uint8*) xzalloc(encoder->reference_step * encoder->info->height);
+
+		encoder->frame_budget = XF_FRAME_BUDGET_MAX;
+		encoder->rfx_context = rfx_context_new();
+		encoder->rfx_context->mode = RLGR3;
+		encoder->rfx_context->width = encoder->info->width;
+		encoder->rfx_context->height = encoder->info->height;
+		rfx_context_set_pixel_format(encoder->rfx_context, RFX_PIXEL_FORMAT_BGRA);
+
+		/* frames are encoded without it, each peer gets it with its first frame */
+		encoder->header = stream_new(64);
+		rfx_compose_message_header(encoder->rfx_context, encoder->header);
+
+		pthread_mutex_init(&(encoder->mutex), NULL);
+		pthread_mutex_init(&(encoder->display_mutex), NULL);
+
+		pthread_create(&(encoder->monitor_thread), 0, xf_monitor_updates, (void*) encoder);
+		pthread_create(&(encoder->frame_rate_thread), 0, xf_frame_rate_thread, (void*) encoder);
+		pthread_detach(encoder->frame_rate_thread);
+
+		xf_encoder = encoder;
+	}
+
+	pthread_mutex_unlock(&xf_encoder_mutex);
+
+	return xf_encoder;
+}
+
+/**
+ * Start sending frames to a peer, beginning with the whole screen.
+ */
+
+void xf_encoder_attach(xfEncoder* encoder, freerdp_peer* client)
+{
+	xfPeerContext* xfp = (xfPeerContext*) client->context;
+
+	pthread_mutex_lock(&(encoder->mutex));
+
+	if (xfp->encoder == NULL)
+	{
+		list_enqueue(encoder->peers, client);
+		xfp->encoder = encoder;
+	}
+
+	xfp->header_sent = false;
+
+	/* frames are acknowledged cumulatively, those sent before attaching are forgotten */
+	xfp->queue.acknowledge = client->settings->frame_acknowledge;
+	xfp->queue.limit = client->settings->max_unacknowledged_frames;
+
+	if ((xfp->queue.limit < 1) || (xfp->queue.limit > XF_FRAME_MAX_IN_FLIGHT))
+		xfp->queue.limit = XF_FRAME_MAX_IN_FLIGHT;
+
+	xfp->queue.window = xfp->queue.limit;
+	xfp->queue.acked_id = xfp->queue.frame_id;
+
+	xfp->missed.null = 1;
+	xf_region_union(&xfp->missed, 0, 0, encoder->info->width, encoder->info->height);
+
+	pthread_mutex_unlock(&(encoder->mutex));
+}
+
+void xf_encoder_detach(xfEncoder* encoder, freerdp_peer* client)
+{
+	xfFrame* frame;
+	xfPeerContext* xfp = (xfPeerContext*) client->context;
+
+	pthread_mutex_lock(&(encoder->mutex));
+	list_remove(encoder->peers, client);
+	xfp->encoder = NULL;
+	pthread_mutex_unlock(&(encoder->mutex));
+
+	while ((frame = xf_encoder_take_frame(encoder, client)) != NULL)
+		xf_frame_release(encoder, frame);
+}
+
+/**
+ * Take the oldest frame queued for a peer, to be released once sent.
+ * Nothing is returned while the socket of the peer has too much to send.
+ */
+
+xfFrame* xf_encoder_take_frame(xfEncoder* encoder, freerdp_peer* client)
+{
+	xfFrame* frame = NULL;
+	PEER_SEND_STATUS status;
+	xfPeerContext* xfp = (xfPeerContext*) client->context;
+
+	pthread_mutex_lock(&(encoder->mutex));
+
+	xfp->queue.signaled = false;
+
+	if (xfp->queue.count > 0)
+	{
+		status.backlog = 0;
+
+		/* a detached peer is only emptying its queue */
+		if (xfp->encoder != NULL)
+			client->GetSendStatus(client, &status);
+
+		if (status.backlog < XF_SEND_SOCKET_BACKLOG)
+		{
+			frame = xfp->queue.frames[xfp->queue.head];
+			xfp->queue.head = (xfp->queue.head + 1) % XF_SEND_QUEUE_DEPTH;
+			xfp->queue.count--;
+			xfp->queue.bytes -= stream_get_length(frame->s);
+
+			xfp->queue.frame_id++;
+			xfp->queue.sent_time[xfp->queue.frame_id % XF_FRAME_HISTORY] = xf_get_utime();
+		}
+	}
+
+	pthread_mutex_unlock(&(encoder->mutex));
+
+	return frame;
+}
+
+/**
+ * A peer has shown every frame up to frameId. The round trip of that frame
+ * is folded into a smoothed estimate, and the window is set to the frames
+ * sent during one round trip at the encoder frame rate, plus the one being
+ * acknowledged.
+ */
+
+void xf_encoder_acknowledge(xfEncoder* encoder, freerdp_peer* client, uint32 frameId)
+{
+	uint32 rtt;
+	uint32 window;
+	uint32 interval;
+	xfPeerContext* xfp = (xfPeerContext*) client->context;
+
+	pthread_mutex_lock(&(encoder->mutex));
+
+	/* stale or unknown identifiers are ignored, the counters wrap around */
+	if ((frameId - xfp->queue.acked_id) > (xfp->queue.frame_id - xfp->queue.acked_id) ||
+			frameId == xfp->queue.acked_id)
+	{
+		pthread_mutex_unlock(&(encoder->mutex));
+		return;
+	}
+
+	if (xfp->queue.frame_id - frameId < XF_FRAME_HISTORY)
+	{
+		rtt = (uint32) (xf_get_utime() - xfp->queue.sent_time[frameId % XF_FRAME_HISTORY]);
+
+		if (xfp->queue.srtt == 0)
+			xfp->queue.srtt = rtt;
+		else
+			xfp->queue.srtt = (7 * xfp->queue.srtt + rtt) / 8;
+
+		interval = 1000000 / encoder->fps;
+		window = 1 + (xfp->queue.srtt + interval - 1) / interval;
+		xfp->queue.window = MIN(window, xfp->queue.limit);
+	}
+
+	xfp->queue.acked_id = frameId;
+
+	pthread_mutex_unlock(&(encoder->mutex));
+}
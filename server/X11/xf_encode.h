@@ -21,12 +21,125 @@
 #define __XF_ENCODE_H
 
 #include <pthread.h>
+#include <freerdp/gdi/gdi.h>
+#include <freerdp/codec/rfx.h>
+#include <freerdp/utils/list.h>
+#include <freerdp/utils/stream.h>
+
+typedef struct xf_frame xfFrame;
+typedef struct xf_encoder xfEncoder;
+typedef struct xf_send_queue xfSendQueue;
+
+/**
+ * The screen is captured and encoded once for all peers. Each encoded
+ * frame is shared between the peers it is queued for. A peer takes no new
+ * frame while it is congested, the area of the frames it drops is encoded
+ * again in one region once it has caught up.
+ */
+
+#define XF_SEND_QUEUE_DEPTH	4
+#define XF_SEND_QUEUE_BYTES	(2 * 1024 * 1024)
+#define XF_SEND_SOCKET_BACKLOG	(256 * 1024)
+
+/**
+ * A client that acknowledges frames is sent no more frames than it can
+ * show in one round trip, up to what it asked to have in flight. The
+ * round trip is measured from the acknowledgements themselves.
+ */
+
+#define XF_FRAME_MAX_IN_FLIGHT	8
+#define XF_FRAME_HISTORY	16
+
+/**
+ * Frames are encoded under RemoteFX rate control. The byte budget of a
+ * frame is cut by a quarter when the bytes queued for a peer or left in
+ * its socket pile up, and grows back a step at a time while they do not.
+ * A peer only waiting on frame acknowledgements leaves the budget alone.
+ */
+
+#define XF_FRAME_BUDGET_MIN	(8 * 1024)
+#define XF_FRAME_BUDGET_MAX	(XF_SEND_QUEUE_BYTES / XF_SEND_QUEUE_DEPTH)
+#define XF_FRAME_BUDGET_STEP	(4 * 1024)
+
+/**
+ * When every peer shows the last frame encoded, content that only moved
+ * since is sent as a SCRBLT ahead of the frame, which then holds just the
+ * area the move has exposed.
+ */
+
+struct xf_frame
+{
+	int refs;
+	STREAM* s;
+
+	int x;
+	int y;
+	int width;
+	int height;
+
+	boolean scroll;
+	SCRBLT_ORDER scrblt;
+};
+
+struct xf_send_queue
+{
+	xfFrame* frames[XF_SEND_QUEUE_DEPTH];
+	int head;
+	int count;
+	uint32 bytes;
+	int backlog;
+	boolean signaled;
+
+	/* frame acknowledgement */
+	boolean acknowledge;
+	uint32 frame_id;
+	uint32 acked_id;
+	uint32 window;
+	uint32 limit;
+	uint32 srtt;
+	uint64 sent_time[XF_FRAME_HISTORY];
+
+	/* metrics */
+	uint32 sent;
+	uint32 dropped;
+	uint32 max_depth;
+	uint64 stall_time;
+};
+
 #include "xfreerdp.h"
 
 #include "xf_peer.h"
 
-XImage* xf_snapshot(xfPeerContext* xfp, int x, int y, int width, int height);
-void xf_xdamage_subtract_region(xfPeerContext* xfp, int x, int y, int width, int height);
+struct xf_encoder
+{
+	int fps;
+	xfInfo* info;
+	LIST* peers;
+	STREAM* header;
+	GDI_RGN damage;
+	RFX_CONTEXT* rfx_context;
+	uint32 frame_budget;
+
+	/* screen as last encoded, what peers in sync with the encoder show */
+	uint8* reference;
+	int reference_step;
+
+	pthread_mutex_t mutex;
+	pthread_mutex_t display_mutex;
+	pthread_t monitor_thread;
+	pthread_t frame_rate_thread;
+};
+
+XImage* xf_snapshot(xfEncoder* encoder, int x, int y, int width, int height);
+void xf_xdamage_subtract_region(xfEncoder* encoder, int x, int y, int width, int height);
 void* xf_monitor_updates(void* param);
 
+void xf_frame_release(xfEncoder* encoder, xfFrame* frame);
+
+xfEncoder* xf_encoder_get(void);
+void xf_encoder_attach(xfEncoder* encoder, freerdp_peer* client);
+void xf_encoder_detach(xfEncoder* encoder, freerdp_peer* client);
+xfFrame* xf_encoder_take_frame(xfEncoder* encoder, freerdp_peer* client);
+void xf_encoder_acknowledge(xfEncoder* encoder, freerdp_peer* client, uint32 frameId);
+
 #endif /* __XF_ENCODE_H */
@@ -64,10 +64,11 @@ void xf_set_event(xfEventQueue* event_queue)
 void xf_clear_event(xfEventQueue* event_queue)
 {
 	int length;
+	uint32 signal;
 
 	while (xf_is_event_set(event_queue))
 	{
-		length = read(event_queue->pipe_fd[0], &length, 4);
+		length = read(event_queue->pipe_fd[0], &signal, 4);
 
 		if (length != 4)
 			printf("xf_clear_event: error\n");
@@ -109,18 +110,29 @@ xfEvent* xf_event_peek(xfEventQueue* event_queue)
 
 xfEvent* xf_event_pop(xfEventQueue* event_queue)
 {
+	int length;
+	uint32 signal;
 	xfEvent* event;
 
 	pthread_mutex_lock(&(event_queue->mutex));
 
 	if (event_queue->count < 1)
+	{
+		pthread_mutex_unlock(&(event_queue->mutex));
 		return NULL;
+	}
 
 	event = event_queue->events[0];
 	(event_queue->count)--;
 
 	memmove(&event_queue->events[0], &event_queue->events[1], event_queue->count * sizeof(void*));
 
+	/* consume the signal of this event, the pipe stays readable while events are queued */
+	length = read(event_queue->pipe_fd[0], &signal, 4);
+
+	if (length != 4)
+		printf("xf_event_pop: error\n");
+
 	pthread_mutex_unlock(&(event_queue->mutex));
 
 	return event;
@@ -32,7 +32,8 @@ typedef struct xf_event_region xfEventRegion;
 enum xf_event_type
 {
 	XF_EVENT_TYPE_REGION,
-	XF_EVENT_TYPE_FRAME_TICK
+	XF_EVENT_TYPE_FRAME_TICK,
+	XF_EVENT_TYPE_FRAME
 };
 
 struct xf_event
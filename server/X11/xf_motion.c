@@ -0,0 +1,310 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * X11 Motion Estimation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <freerdp/utils/memory.h>
+
+#include "xf_motion.h"
+
+/**
+ * Frames are compared one line at a time, a line being either a row or a
+ * column of 32bpp pixels. Each line of both frames is reduced to a hash,
+ * the lines of the new frame vote for the shift that brings them back to a
+ * reference line with the same hash, and the longest run of lines moved by
+ * the winning shift is then checked pixel for pixel.
+ */
+
+struct xf_motion_search
+{
+	uint8* reference;
+	int reference_step;
+	uint8* frame;
+	int frame_step;
+	int width;
+	int height;
+
+	uint32* reference_hashes;
+	uint32* frame_hashes;
+	int* votes;
+	int* buckets;
+	int* chain;
+	int mask;
+};
+typedef struct xf_motion_search xfMotionSearch;
+
+#define XF_MOTION_HASH_BASIS	2166136261U
+#define XF_MOTION_HASH_PRIME	16777619U
+
+static void xf_motion_hash_rows(uint8* data, int step, int width, int height, uint32* hashes)
+{
+	int x, y;
+	uint32 hash;
+	uint32* pixels;
+
+	for (y = 0; y < height; y++)
+	{
+		hash = XF_MOTION_HASH_BASIS;
+		pixels = (uint32*) &data[y * step];
+
+		for (x = 0; x < width; x++)
+			hash = (hash ^ pixels[x]) * XF_MOTION_HASH_PRIME;
+
+		hashes[y] = hash;
+	}
+}
+
+/* columns are hashed a row at a time, to read the frame in memory order */
+static void xf_motion_hash_columns(uint8* data, int step, int width, int height, uint32* hashes)
+{
+	int x, y;
+	uint32* pixels;
+
+	for (x = 0; x < width; x++)
+		hashes[x] = XF_MOTION_HASH_BASIS;
+
+	for (y = 0; y < height; y++)
+	{
+		pixels = (uint32*) &data[y * step];
+
+		for (x = 0; x < width; x++)
+			hashes[x] = (hashes[x] ^ pixels[x]) * XF_MOTION_HASH_PRIME;
+	}
+}
+
+static boolean xf_motion_lines_equal(xfMotionSearch* search, boolean vertical, int reference_line, int frame_line)
+{
+	int i;
+	uint32* reference;
+	uint32* frame;
+
+	if (vertical)
+	{
+		return memcmp(&search->reference[reference_line * search->reference_step],
+				&search->frame[frame_line * search->frame_step], search->width * 4) == 0 ? true : false;
+	}
+
+	for (i = 0; i < search->height; i++)
+	{
+		reference = (uint32*) &search->reference[i * search->reference_step];
+		frame = (uint32*) &search->frame[i * search->frame_step];
+
+		if (reference[reference_line] != frame[frame_line])
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Find the shift most changed lines of the new frame have moved by. Lines
+ * left as they were, and runs of identical lines such as blank space, say
+ * nothing about the motion and do not vote.
+ */
+
+static int xf_motion_vote(xfMotionSearch* search, int count)
+{
+	int i, j;
+	int best;
+	int candidates;
+	uint32* reference = search->reference_hashes;
+	uint32* frame = search->frame_hashes;
+
+	for (i = 0; i <= search->mask; i++)
+		search->buckets[i] = -1;
+
+	for (i = count - 1; i >= 0; i--)
+	{
+		j = reference[i] & search->mask;
+		search->chain[i] = search->buckets[j];
+		search->buckets[j] = i;
+	}
+
+	memset(search->votes, 0, sizeof(int) * 2 * count);
+
+	for (i = 0; i < count; i++)
+	{
+		if (frame[i] == reference[i])
+			continue;
+
+		if ((i > 0) && (frame[i] == frame[i - 1]))
+			continue;
+
+		candidates = 0;
+
+		for (j = search->buckets[frame[i] & search->mask]; j >= 0; j = search->chain[j])
+		{
+			if (reference[j] != frame[i])
+				continue;
+
+			search->votes[i - j + count]++;
+
+			if (++candidates >= XF_MOTION_MAX_CANDIDATES)
+				break;
+		}
+	}
+
+	best = count;
+
+	for (i = 1; i < 2 * count; i++)
+	{
+		if (search->votes[i] > search->votes[best])
+			best = i;
+	}
+
+	return best - count;
+}
+
+/**
+ * Longest run of lines of the new frame equal to the reference lines they
+ * were shifted from. Hashes only rule lines out, a matching hash is
+ * confirmed against the pixels before a line joins the run.
+ */
+
+static int xf_motion_run(xfMotionSearch* search, boolean vertical, int count, int shift, int* start)
+{
+	int i;
+	int first, last;
+	int length, best;
+
+	first = MAX(0, shift);
+	last = MIN(count, count + shift);
+
+	best = 0;
+	length = 0;
+
+	for (i = first; i < last; i++)
+	{
+		if ((search->frame_hashes[i] == search->reference_hashes[i - shift]) &&
+				xf_motion_lines_equal(search, vertical, i - shift, i))
+		{
+			length++;
+
+			if (length > best)
+			{
+				best = length;
+				*start = i - length + 1;
+			}
+		}
+		else
+		{
+			length = 0;
+		}
+	}
+
+	return best;
+}
+
+static int xf_motion_search_lines(xfMotionSearch* search, boolean vertical, int* shift, int* start)
+{
+	int count;
+	int length;
+
+	count = vertical ? search->height : search->width;
+
+	if (count < XF_MOTION_MIN_LINES)
+		return 0;
+
+	if (vertical)
+	{
+		xf_motion_hash_rows(search->reference, search->reference_step,
+				search->width, search->height, search->reference_hashes);
+		xf_motion_hash_rows(search->frame, search->frame_step,
+				search->width, search->height, search->frame_hashes);
+	}
+	else
+	{
+		xf_motion_hash_columns(search->reference, search->reference_step,
+				search->width, search->height, search->reference_hashes);
+		xf_motion_hash_columns(search->frame, search->frame_step,
+				search->width, search->height, search->frame_hashes);
+	}
+
+	*shift = xf_motion_vote(search, count);
+
+	if (*shift == 0)
+		return 0;
+
+	length = xf_motion_run(search, vertical, count, *shift, start);
+
+	return (length >= XF_MOTION_MIN_LINES) ? length : 0;
+}
+
+/**
+ * Look for a block of the new frame that was scrolled vertically or
+ * horizontally within the same area of the reference frame. Both frames
+ * are 32bpp and of the given size. A vertical move is looked for first,
+ * columns are only hashed when no row has moved.
+ */
+
+boolean xf_motion_estimate(uint8* reference, int reference_step, uint8* frame, int frame_step,
+		int width, int height, xfMotion* motion)
+{
+	int size;
+	int count;
+	int shift;
+	int start;
+	int length;
+	xfMotionSearch search;
+
+	memset(motion, 0, sizeof(xfMotion));
+
+	if (width < XF_MOTION_MIN_LINES && height < XF_MOTION_MIN_LINES)
+		return false;
+
+	search.reference = reference;
+	search.reference_step = reference_step;
+	search.frame = frame;
+	search.frame_step = frame_step;
+	search.width = width;
+	search.height = height;
+
+	count = MAX(width, height);
+
+	for (size = 1; size < count; size <<= 1);
+
+	search.mask = size - 1;
+	search.reference_hashes = (uint32*) xmalloc(sizeof(uint32) * count);
+	search.frame_hashes = (uint32*) xmalloc(sizeof(uint32) * count);
+	search.votes = (int*) xmalloc(sizeof(int) * 2 * count);
+	search.buckets = (int*) xmalloc(sizeof(int) * size);
+	search.chain = (int*) xmalloc(sizeof(int) * count);
+
+	start = 0;
+
+	if ((length = xf_motion_search_lines(&search, true, &shift, &start)) > 0)
+	{
+		motion->dy = shift;
+		motion->y = start;
+		motion->width = width;
+		motion->height = length;
+	}
+	else if ((length = xf_motion_search_lines(&search, false, &shift, &start)) > 0)
+	{
+		motion->dx = shift;
+		motion->x = start;
+		motion->width = length;
+		motion->height = height;
+	}
+
+	xfree(search.reference_hashes);
+	xfree(search.frame_hashes);
+	xfree(search.votes);
+	xfree(search.buckets);
+	xfree(search.chain);
+
+	return (length > 0) ? true : false;
+}
@@ -0,0 +1,52 @@
+/**
+ * FreeRDP: A Remote Desktop Protocol Client
+ * X11 Motion Estimation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __XF_MOTION_H
+#define __XF_MOTION_H
+
+#include <freerdp/types.h>
+
+typedef struct xf_motion xfMotion;
+
+/* Shortest block worth moving with a SCRBLT instead of encoding it */
+#define XF_MOTION_MIN_LINES		32
+
+/* Reference lines looked at for each line of the new frame */
+#define XF_MOTION_MAX_CANDIDATES	8
+
+/**
+ * A block of the new frame that is found as is in the reference frame,
+ * moved by (dx, dy). The block is given in the coordinates of the new
+ * frame, it spans the whole width for a vertical move and the whole
+ * height for a horizontal one.
+ */
+
+struct xf_motion
+{
+	int dx;
+	int dy;
+
+	int x;
+	int y;
+	int width;
+	int height;
+};
+
+boolean xf_motion_estimate(uint8* reference, int reference_step, uint8* frame, int frame_step,
+		int width, int height, xfMotion* motion);
+
+#endif /* __XF_MOTION_H */
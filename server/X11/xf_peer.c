@@ -159,7 +159,7 @@ void xf_xshm_init(xfInfo* xfi)
 			xfi->fb_image->width, xfi->fb_image->height, xfi->fb_image->depth);
 }
 
-xfInfo* xf_info_init()
+xfInfo* xf_info_init(boolean capture)
 {
 	int i;
 	xfInfo* xfi;
@@ -239,13 +239,17 @@ xfInfo* xf_info_init()
 
 	xfi->clrconv = freerdp_clrconv_new(CLRCONV_ALPHA | CLRCONV_INVERT);
 
-	XSelectInput(xfi->display, xfi->root_window, SubstructureNotifyMask);
+	/* only the connection of the shared encoder watches the screen */
+	if (capture)
+	{
+		XSelectInput(xfi->display, xfi->root_window, SubstructureNotifyMask);
 
 #ifdef WITH_XDAMAGE
-	xf_xdamage_init(xfi);
+		xf_xdamage_init(xfi);
 #endif
 
-	xf_xshm_init(xfi);
+		xf_xshm_init(xfi);
+	}
 
 	xfi->bytesPerPixel = 4;
 
@@ -256,13 +260,8 @@ xfInfo* xf_info_init()
 
 void xf_peer_context_new(freerdp_peer* client, xfPeerContext* context)
 {
-	context->info = xf_info_init();
-	context->rfx_context = rfx_context_new();
-	context->rfx_context->mode = RLGR3;
-	context->rfx_context->width = context->info->width;
-	context->rfx_context->height = context->info->height;
-
-	rfx_context_set_pixel_format(context->rfx_context, RFX_PIXEL_FORMAT_BGRA);
+	context->info = xf_info_init(false);
+	context->missed.null = 1;
 
 	context->s = stream_new(65536);
 }
@@ -272,14 +271,12 @@ void xf_peer_context_free(freerdp_peer* client, xfPeerContext* context)
 	if (context)
 	{
 		stream_free(context->s);
-		rfx_context_free(context->rfx_context);
 		xfree(context);
 	}
 }
 
 void xf_peer_init(freerdp_peer* client)
 {
-	xfInfo* xfi;
 	xfPeerContext* xfp;
 
 	client->context_size = sizeof(xfPeerContext);
@@ -289,14 +286,9 @@ void xf_peer_init(freerdp_peer* client)
 
 	xfp = (xfPeerContext*) client->context;
 
-	xfp->fps = 24;
-	xfp->thread = 0;
 	xfp->activations = 0;
 	xfp->event_queue = xf_event_queue_new();
 
-	xfi = xfp->info;
-	xfp->hdc = gdi_CreateDC(xfi->clrconv, xfi->bpp);
-
 	pthread_mutex_init(&(xfp->mutex), NULL);
 }
 
@@ -309,10 +301,7 @@ STREAM* xf_peer_stream_init(xfPeerContext* context)
 
 void xf_peer_live_rfx(freerdp_peer* client)
 {
-	xfPeerContext* xfp = (xfPeerContext*) client->context;
-
-	if (xfp->activations == 1)
-		pthread_create(&(xfp->thread), 0, xf_monitor_updates, (void*) client);
+	xf_encoder_attach(xf_encoder_get(), client);
 }
 
 static boolean xf_peer_sleep_tsdiff(uint32 *old_sec, uint32 *old_usec, uint32 new_sec, uint32 new_usec)
@@ -379,6 +368,7 @@ void xf_peer_dump_rfx(freerdp_peer* client)
 		s->data = xrealloc(s->data, record.length);
 		record.data = s->data;
 		s->size = record.length;
+		s->capacity = record.length;
 
 		pcap_get_next_record_content(pcap_rfx, &record);
 		s->p = s->data + s->size;
@@ -390,80 +380,94 @@ void xf_peer_dump_rfx(freerdp_peer* client)
 	}
 }
 
-void xf_peer_rfx_update(freerdp_peer* client, int x, int y, int width, int height)
+static void xf_peer_send_surface_bits(freerdp_peer* client, xfFrame* frame)
 {
 	STREAM* s;
-	uint8* data;
-	xfInfo* xfi;
-	RFX_RECT rect;
-	XImage* image;
 	rdpUpdate* update;
 	xfPeerContext* xfp;
 	SURFACE_BITS_COMMAND* cmd;
+	SURFACE_FRAME_MARKER* marker;
 
 	update = client->update;
 	xfp = (xfPeerContext*) client->context;
 	cmd = &update->surface_bits_command;
-	xfi = xfp->info;
-
-	if (width * height <= 0)
-		return;
-
-	s = xf_peer_stream_init(xfp);
+	marker = &update->surface_frame_marker;
 
-	if (xfi->use_xshm)
+	if (xfp->header_sent)
 	{
-		width = x + width;
-		height = y + height;
-		x = 0;
-		y = 0;
-
-		rect.x = x;
-		rect.y = y;
-		rect.width = width;
-		rect.height = height;
-
-		image = xf_snapshot(xfp, x, y, width, height);
-
-		data = (uint8*) image->data;
-		data = &data[(y * image->bytes_per_line) + (x * image->bits_per_pixel)];
-
-		rfx_compose_message(xfp->rfx_context, s, &rect, 1, data,
-				width, height, image->bytes_per_line);
-
-		cmd->destLeft = x;
-		cmd->destTop = y;
-		cmd->destRight = x + width;
-		cmd->destBottom = y + height;
+		s = frame->s;
 	}
 	else
 	{
-		rect.x = 0;
-		rect.y = 0;
-		rect.width = width;
-		rect.height = height;
-
-		image = xf_snapshot(xfp, x, y, width, height);
+		/* the first frame sent to a peer carries the RemoteFX stream header */
+		s = xf_peer_stream_init(xfp);
+		stream_check_size(s, stream_get_length(xfp->encoder->header) + stream_get_length(frame->s));
+		stream_write(s, stream_get_head(xfp->encoder->header), stream_get_length(xfp->encoder->header));
+		stream_write(s, stream_get_head(frame->s), stream_get_length(frame->s));
+		xfp->header_sent = true;
+	}
 
-		rfx_compose_message(xfp->rfx_context, s, &rect, 1,
-				(uint8*) image->data, width, height, width * xfi->bytesPerPixel);
+	/* a client that acknowledges frames is told where each one ends */
+	if (xfp->queue.acknowledge)
+	{
+		marker->frameAction = SURFACECMD_FRAMEACTION_BEGIN;
+		marker->frameId = xfp->queue.frame_id;
+		update->SurfaceFrameMarker(update->context, marker);
+	}
 
-		cmd->destLeft = x;
-		cmd->destTop = y;
-		cmd->destRight = x + width;
-		cmd->destBottom = y + height;
+	/* the client moves what it already shows before the exposed area is drawn */
+	if (frame->scroll)
+		update->primary->ScrBlt(update->context, &frame->scrblt);
 
-		XDestroyImage(image);
-	}
+	cmd->destLeft = frame->x;
+	cmd->destTop = frame->y;
+	cmd->destRight = frame->x + frame->width;
+	cmd->destBottom = frame->y + frame->height;
 
 	cmd->bpp = 32;
 	cmd->codecID = client->settings->rfx_codec_id;
-	cmd->width = width;
-	cmd->height = height;
+	cmd->width = frame->width;
+	cmd->height = frame->height;
 	cmd->bitmapDataLength = stream_get_length(s);
 	cmd->bitmapData = stream_get_head(s);
 
 	update->SurfaceBits(update->context, cmd);
+
+	if (xfp->queue.acknowledge)
+	{
+		marker->frameAction = SURFACECMD_FRAMEACTION_END;
+		marker->frameId = xfp->queue.frame_id;
+		update->SurfaceFrameMarker(update->context, marker);
+	}
+}
+
+/**
+ * Send the frames queued for a peer, as long as its socket keeps up.
+ * What is left is retried on the next frame tick.
+ */
+
+void xf_peer_send_frames(freerdp_peer* client)
+{
+	xfFrame* frame;
+	uint64 stall_time;
+	PEER_SEND_STATUS status;
+	xfPeerContext* xfp = (xfPeerContext*) client->context;
+
+	if (xfp->encoder == NULL)
+		return;
+
+	while ((frame = xf_encoder_take_frame(xfp->encoder, client)) != NULL)
+	{
+		client->GetSendStatus(client, &status);
+		stall_time = status.stall_time;
+
+		xf_peer_send_surface_bits(client, frame);
+		xf_frame_release(xfp->encoder, frame);
+
+		client->GetSendStatus(client, &status);
+		xfp->queue.stall_time += status.stall_time - stall_time;
+		xfp->queue.sent++;
+	}
 }
 
 boolean xf_peer_get_fds(freerdp_peer* client, void** rfds, int* rcount)
@@ -481,43 +485,22 @@ boolean xf_peer_get_fds(freerdp_peer* client, void** rfds, int* rcount)
 
 boolean xf_peer_check_fds(freerdp_peer* client)
 {
-	xfInfo* xfi;
 	xfEvent* event;
 	xfPeerContext* xfp;
-	HGDI_RGN invalid_region;
 
 	xfp = (xfPeerContext*) client->context;
-	xfi = xfp->info;
 
 	if (xfp->activated == false)
 		return true;
 
-	event = xf_event_peek(xfp->event_queue);
+	event = xf_event_pop(xfp->event_queue);
 
 	if (event != NULL)
 	{
-		if (event->type == XF_EVENT_TYPE_REGION)
-		{
-			xfEventRegion* region = (xfEventRegion*) xf_event_pop(xfp->event_queue);
-			gdi_InvalidateRegion(xfp->hdc, region->x, region->y, region->width, region->height);
-			xf_event_region_free(region);
-		}
-		else if (event->type == XF_EVENT_TYPE_FRAME_TICK)
-		{
-			event = xf_event_pop(xfp->event_queue);
-			invalid_region = xfp->hdc->hwnd->invalid;
+		if (event->type == XF_EVENT_TYPE_FRAME)
+			xf_peer_send_frames(client);
 
-			if (invalid_region->null == false)
-			{
-				xf_peer_rfx_update(client, invalid_region->x, invalid_region->y,
-					invalid_region->w, invalid_region->h);
-			}
-
-			invalid_region->null = 1;
-			xfp->hdc->hwnd->ninvalid = 0;
-
-			xf_event_free(event);
-		}
+		xf_event_free(event);
 	}
 
 	return true;
@@ -572,7 +555,6 @@ boolean xf_peer_activate(freerdp_peer* client)
 {
 	xfPeerContext* xfp = (xfPeerContext*) client->context;
 
-	rfx_context_reset(xfp->rfx_context);
 	xfp->activated = true;
 
 	if (xf_pcap_file != NULL)
@@ -589,19 +571,18 @@ boolean xf_peer_activate(freerdp_peer* client)
 	return true;
 }
 
-void* xf_peer_main_loop(void* arg)
+static void xf_peer_frame_acknowledge(rdpContext* context, uint32 frameId)
+{
+	xfPeerContext* xfp = (xfPeerContext*) context;
+
+	if (xfp->encoder != NULL)
+		xf_encoder_acknowledge(xfp->encoder, context->peer, frameId);
+}
+
+static void xf_peer_setup(freerdp_peer* client)
 {
-	int i;
-	int fds;
-	int max_fds;
-	int rcount;
-	void* rfds[32];
-	fd_set rfds_set;
 	rdpSettings* settings;
 	char* server_file_path;
-	freerdp_peer* client = (freerdp_peer*) arg;
-
-	memset(rfds, 0, sizeof(rfds));
 
 	printf("We've got a client %s\n", client->hostname);
 
@@ -636,6 +617,47 @@ void* xf_peer_main_loop(void* arg)
 
 	client->Initialize(client);
 
+	client->update->SurfaceFrameAcknowledge = xf_peer_frame_acknowledge;
+}
+
+static void xf_peer_close(freerdp_peer* client)
+{
+	xfPeerContext* xfp = (xfPeerContext*) client->context;
+
+	printf("Client %s disconnected.\n", client->hostname);
+
+	if (xfp->encoder != NULL)
+		xf_encoder_detach(xfp->encoder, client);
+
+	printf("Client %s: %d frames sent, %d dropped, queue depth up to %d, stalled %d ms\n",
+		client->hostname, xfp->queue.sent, xfp->queue.dropped,
+		xfp->queue.max_depth, (int) (xfp->queue.stall_time / 1000));
+
+	if (xfp->queue.acknowledge)
+	{
+		printf("Client %s: round trip %d ms, %d frames in flight\n",
+			client->hostname, (int) (xfp->queue.srtt / 1000), xfp->queue.window);
+	}
+
+	client->Disconnect(client);
+	freerdp_peer_context_free(client);
+	freerdp_peer_free(client);
+}
+
+void* xf_peer_main_loop(void* arg)
+{
+	int i;
+	int fds;
+	int max_fds;
+	int rcount;
+	void* rfds[32];
+	fd_set rfds_set;
+	freerdp_peer* client = (freerdp_peer*) arg;
+
+	memset(rfds, 0, sizeof(rfds));
+
+	xf_peer_setup(client);
+
 	while (1)
 	{
 		rcount = 0;
@@ -692,19 +714,43 @@ void* xf_peer_main_loop(void* arg)
 		}
 	}
 
-	printf("Client %s disconnected.\n", client->hostname);
-
-	client->Disconnect(client);
-	freerdp_peer_context_free(client);
-	freerdp_peer_free(client);
+	xf_peer_close(client);
 
 	return NULL;
 }
 
+static boolean xf_peer_check_source(rdpEventSource* source, void* param)
+{
+	return xf_peer_check_fds((freerdp_peer*) param);
+}
+
+static void xf_peer_closed_source(rdpEventSource* source, void* param)
+{
+	xf_peer_close((freerdp_peer*) param);
+}
+
 void xf_peer_accepted(freerdp_listener* instance, freerdp_peer* client)
 {
 	pthread_t th;
+	int rcount = 0;
+	void* rfds[EVENT_SOURCE_MAX_FDS];
+	rdpEventLoop* loop = (rdpEventLoop*) instance->param1;
 
-	pthread_create(&th, 0, xf_peer_main_loop, client);
-	pthread_detach(th);
+	if (loop == NULL)
+	{
+		/* no event loop on this platform, one thread per client */
+		pthread_create(&th, 0, xf_peer_main_loop, client);
+		pthread_detach(th);
+		return;
+	}
+
+	xf_peer_setup(client);
+	xf_peer_get_fds(client, rfds, &rcount);
+
+	if (freerdp_event_loop_add_peer(loop, client, rfds, rcount,
+			xf_peer_check_source, xf_peer_closed_source) == NULL)
+	{
+		printf("Failed to add client %s to the event loop\n", client->hostname);
+		xf_peer_close(client);
+	}
 }
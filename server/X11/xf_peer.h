@@ -25,30 +25,33 @@
 #include <freerdp/gdi/region.h>
 #include <freerdp/codec/rfx.h>
 #include <freerdp/listener.h>
+#include <freerdp/eventloop.h>
 #include <freerdp/utils/stream.h>
 #include <freerdp/utils/stopwatch.h>
 
 typedef struct xf_peer_context xfPeerContext;
 
 #include "xfreerdp.h"
+#include "xf_encode.h"
 
 struct xf_peer_context
 {
 	rdpContext _p;
 
-	int fps;
 	STREAM* s;
-	HGDI_DC hdc;
 	xfInfo* info;
 	int activations;
-	pthread_t thread;
 	boolean activated;
 	pthread_mutex_t mutex;
-	RFX_CONTEXT* rfx_context;
 	xfEventQueue* event_queue;
-	pthread_t frame_rate_thread;
+
+	xfSendQueue queue;
+	GDI_RGN missed;
+	boolean header_sent;
+	xfEncoder* encoder;
 };
 
+xfInfo* xf_info_init(boolean capture);
 void xf_peer_accepted(freerdp_listener* instance, freerdp_peer* client);
 
 #endif /* __XF_PEER_H */
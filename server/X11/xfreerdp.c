@@ -96,6 +96,7 @@ void xf_server_main_loop(freerdp_listener* instance)
 
 int main(int argc, char* argv[])
 {
+	rdpEventLoop* loop;
 	freerdp_listener* instance;
 
 	/* ignore SIGPIPE, otherwise an SSL_write failure could crash the server */
@@ -110,13 +111,27 @@ int main(int argc, char* argv[])
 	if (argc > 2 && !strcmp(argv[2], "--fast"))
 		xf_pcap_dump_realtime = false;
 
+	/* Clients are served by a pool of worker threads where epoll is available */
+	loop = freerdp_event_loop_new(0);
+	instance->param1 = (void*) loop;
+
 	/* Open the server socket and start listening. */
 	if (instance->Open(instance, NULL, 3389))
 	{
-		/* Entering the server main loop. In a real server the listener can be run in its own thread. */
-		xf_server_main_loop(instance);
+		if (loop != NULL)
+		{
+			freerdp_event_loop_add_listener(loop, instance);
+			freerdp_event_loop_run(loop);
+			instance->Close(instance);
+		}
+		else
+		{
+			/* Entering the server main loop. In a real server the listener can be run in its own thread. */
+			xf_server_main_loop(instance);
+		}
 	}
 
+	freerdp_event_loop_free(loop);
 	freerdp_listener_free(instance);
 
 	return 0;
@@ -322,6 +322,7 @@ void tf_peer_dump_rfx(freerdp_peer* client)
 		s->data = xrealloc(s->data, record.length);
 		record.data = s->data;
 		s->size = record.length;
+		s->capacity = record.length;
 
 		pcap_get_next_record_content(pcap_rfx, &record);
 		s->p = s->data + s->size;